@@ -0,0 +1,60 @@
+// ###########################################################################################
+// ## Shaders compiled when building the program and stored in it, so no shader files need to
+// ## be read or compiled when it starts.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "BakedShaders.h"
+
+#include <cstring>
+#include <cwchar>
+
+#if !RUNTIME_SHADER_COMPILATION
+
+// FxCompile writes every shader in Resources/Shaders to a header holding its bytecode as a
+// byte array, and MWS.vcxproj then generates this header. It includes all of those and lists
+// them in the array gBakedShaders.
+#include <Windows.h>
+#include "BakedShaderRegistry.h"
+
+#endif
+
+const BakedShader* FindBakedShader(const wchar_t* path, const char* entryPoint)
+{
+#if !RUNTIME_SHADER_COMPILATION
+	// Strip the folders, both kinds of slashes are accepted.
+	const wchar_t* fileName = path;
+	for (const wchar_t* c = path; *c != L'\0'; ++c)
+	{
+		if (*c == L'/' || *c == L'\\')
+			fileName = c + 1;
+	}
+
+	for (const BakedShader& shader : gBakedShaders)
+	{
+		if (wcscmp(shader.fileName, fileName) == 0 && strcmp(shader.entryPoint, entryPoint) == 0)
+			return &shader;
+	}
+#else
+	(void)path;
+	(void)entryPoint;
+#endif
+
+	return nullptr;
+}
@@ -0,0 +1,40 @@
+// ###########################################################################################
+// ## Shaders compiled when building the program and stored in it, so no shader files need to
+// ## be read or compiled when it starts.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <cstddef>
+
+// The bytecode of a shader compiled by FxCompile, tied to the HLSL file and entry point it
+// was compiled from.
+struct BakedShader
+{
+	const wchar_t* fileName;	// The file name of the HLSL file, without any folders.
+	const char* entryPoint;
+	const unsigned char* bytecode;
+	size_t bytecodeSize;
+};
+
+// Finds the baked version of the shader at the given path (the folders are ignored) with the
+// given entry point. Returns nullptr if there is none, which is always the case when building
+// with RUNTIME_SHADER_COMPILATION (the default for Debug builds, see MWS.vcxproj).
+const BakedShader* FindBakedShader(const wchar_t* path, const char* entryPoint);
@@ -0,0 +1,2592 @@
+// ###########################################################################################
+// ## Benchmarks run by MWS-Headless with the -benchmark option, measuring the software
+// ## renderer's throughput. Results are printed to the console.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "CommandBuffer.h"
+#include "ConstantBuffers.h"
+#include "DrawQueue.h"
+#include "DynamicBuffer.h"
+#include "FrameArena.h"
+#include "FrameScheduler.h"
+#include "InstanceBuffer.h"
+#include "MeshBuilder.h"
+#include "MeshClusters.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "MeshSimplifier.h"
+#include "PipelineState.h"
+#include "Profiler.h"
+#include "RingAllocator.h"
+#include "Scene.h"
+#include "SceneBvh.h"
+#include "ShaderCache.h"
+#include "SoftwareBackend.h"
+#include "StateFilterBackend.h"
+#include "ThreadPool.h"
+
+// Ties the name given on the command line to a benchmark.
+struct Benchmark
+{
+	const char* name;
+	bool (*run)();
+};
+
+static const Benchmark gBenchmarks[] =
+{
+	{ "rasteriser", RunRasteriserBenchmark },
+	{ "tiles", RunTileBenchmark },
+	{ "mesh", RunMeshBenchmark },
+	{ "shadercache", RunShaderCacheBenchmark },
+	{ "pacing", RunPacingBenchmark },
+	{ "profiler", RunProfilerBenchmark },
+	{ "statefilter", RunStateFilterBenchmark },
+	{ "pipelinestate", RunPipelineStateBenchmark },
+	{ "drawqueue", RunDrawQueueBenchmark },
+	{ "commandbuffer", RunCommandBufferBenchmark },
+	{ "instancing", RunInstancingBenchmark },
+	{ "ringbuffer", RunRingBufferBenchmark },
+	{ "arena", RunArenaBenchmark },
+	{ "constants", RunConstantBufferBenchmark },
+	{ "meshfile", RunMeshFileBenchmark },
+	{ "import", RunImportBenchmark },
+	{ "lod", RunLodBenchmark },
+	{ "clusters", RunClusterBenchmark },
+	{ "culling", RunCullingBenchmark },
+};
+
+bool RunBenchmark(const char* name)
+{
+	for (const Benchmark& benchmark : gBenchmarks)
+	{
+		if (strcmp(benchmark.name, name) == 0)
+		{
+			return benchmark.run();
+		}
+	}
+
+	std::cout << "Unknown benchmark '" << name << "'. Available benchmarks:" << std::endl;
+	for (const Benchmark& benchmark : gBenchmarks)
+		std::cout << "  " << benchmark.name << std::endl;
+
+	return false;
+}
+
+// Calls Render() until at least minFrames frames and minSeconds seconds have passed.
+// Returns the time taken in seconds.
+static double TimeFrames(unsigned int minFrames, double minSeconds, unsigned int& frameCount)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed(0.0);
+	for (frameCount = 0; frameCount < minFrames || elapsed.count() < minSeconds; ++frameCount)
+	{
+		Render();
+		elapsed = std::chrono::high_resolution_clock::now() - start;
+	}
+
+	return elapsed.count();
+}
+
+bool RunRasteriserBenchmark()
+{
+	const unsigned int resolutions[][2] =
+	{
+		{ 1280, 720 },
+		{ 1920, 1080 },
+		{ 3840, 2160 },
+		{ 7680, 4320 },
+	};
+
+	const RasteriserISA isas[] = { RasteriserISA::Scalar, RasteriserISA::SSE41, RasteriserISA::AVX2 };
+
+	std::cout << "Rasteriser benchmark (the frame time includes clearing the back buffer)" << std::endl;
+	std::cout << std::setw(12) << "Resolution" << std::setw(10) << "ISA"
+		<< std::setw(14) << "ms/frame" << std::setw(14) << "Mpixels/s" << std::endl;
+
+	for (const unsigned int* resolution : resolutions)
+	{
+		for (RasteriserISA isa : isas)
+		{
+			if (!IsRasteriserISASupported(isa))
+				continue;
+
+			SoftwareBackend backend(resolution[0], resolution[1]);
+			backend.SetRasteriserISA(isa);
+			if (!SetupScene(&backend))
+			{
+				std::cout << "Failed to set up the scene of the rasteriser benchmark" << std::endl;
+				ReleaseScene();
+				return false;
+			}
+
+			Render();
+			backend.ResetStatistics();
+
+			unsigned int frameCount = 0;
+			double seconds = TimeFrames(10, 0.5, frameCount);
+			double megapixels = backend.GetStatistics().pixelsShaded / 1.0e6;
+
+			std::cout << std::setw(5) << resolution[0] << "x" << std::setw(6) << std::left << resolution[1] << std::right
+				<< std::setw(10) << GetRasteriserISAName(isa)
+				<< std::setw(14) << std::fixed << std::setprecision(3) << seconds * 1000.0 / frameCount
+				<< std::setw(14) << std::setprecision(1) << megapixels / seconds << std::endl;
+
+			ReleaseScene();
+		}
+	}
+
+	return true;
+}
+
+bool RunTileBenchmark()
+{
+	const unsigned int width = 3840;
+	const unsigned int height = 2160;
+
+	// Double the thread count each step, making sure the number of hardware threads is
+	// included at the end.
+	unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+		threadCounts.push_back(threadCount);
+	threadCounts.push_back(hardwareThreads);
+
+	SoftwareBackend backend(width, height);
+	if (!SetupScene(&backend))
+	{
+		std::cout << "Failed to set up the scene of the tile benchmark" << std::endl;
+		ReleaseScene();
+		return false;
+	}
+
+	std::cout << "Tile benchmark at " << width << "x" << height << " using " << GetRasteriserISAName(backend.GetRasteriserISA())
+		<< ", " << (width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE * ((height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE)
+		<< " tiles of " << SOFTWARE_TILE_SIZE << "x" << SOFTWARE_TILE_SIZE << " pixels" << std::endl;
+	std::cout << std::setw(10) << "Threads" << std::setw(14) << "ms/frame"
+		<< std::setw(14) << "Mpixels/s" << std::setw(12) << "Speed-up" << std::endl;
+
+	double singleThreadSeconds = 0.0;
+	for (unsigned int threadCount : threadCounts)
+	{
+		backend.SetThreadCount(threadCount);
+
+		Render();
+		backend.ResetStatistics();
+
+		unsigned int frameCount = 0;
+		double seconds = TimeFrames(10, 0.5, frameCount);
+		double megapixels = backend.GetStatistics().pixelsShaded / 1.0e6;
+		double secondsPerFrame = seconds / frameCount;
+		if (threadCount == 1)
+			singleThreadSeconds = secondsPerFrame;
+
+		std::cout << std::setw(10) << threadCount
+			<< std::setw(14) << std::fixed << std::setprecision(3) << secondsPerFrame * 1000.0
+			<< std::setw(14) << std::setprecision(1) << megapixels / seconds
+			<< std::setw(11) << std::setprecision(2) << singleThreadSeconds / secondsPerFrame << "x" << std::endl;
+	}
+
+	ReleaseScene();
+
+	return true;
+}
+
+// Creates a grid of size * size quads as a triangle list without indices, the way a mesh
+// exported without index data looks. If shuffle is set, the triangles are put in random order.
+static std::vector<Vertex> CreateGridTriangles(unsigned int size, bool shuffle)
+{
+	std::vector<Vertex> corners((size + 1) * (size + 1));
+	for (unsigned int y = 0; y <= size; ++y)
+	{
+		for (unsigned int x = 0; x <= size; ++x)
+		{
+			float u = static_cast<float>(x) / size;
+			float v = static_cast<float>(y) / size;
+			Vertex& corner = corners[y * (size + 1) + x];
+			corner.position = Float3(u * 2.0f - 1.0f, 1.0f - v * 2.0f, 0.0f);
+			corner.colour = Float4(u, v, 1.0f - u, 1.0f);
+		}
+	}
+
+	std::vector<Vertex> triangles;
+	triangles.reserve(size * size * 6);
+	for (unsigned int y = 0; y < size; ++y)
+	{
+		for (unsigned int x = 0; x < size; ++x)
+		{
+			unsigned int topLeft = y * (size + 1) + x;
+			unsigned int bottomLeft = topLeft + size + 1;
+			const unsigned int quad[] = { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft };
+			for (unsigned int corner : quad)
+				triangles.push_back(corners[corner]);
+		}
+	}
+
+	if (shuffle)
+	{
+		// A fixed seed, so every run measures the same mesh.
+		unsigned int random = 12345;
+		unsigned int triangleCount = static_cast<unsigned int>(triangles.size() / 3);
+		for (unsigned int t = triangleCount - 1; t > 0; --t)
+		{
+			random = random * 1664525u + 1013904223u;
+			unsigned int other = (random >> 8) % (t + 1);
+			for (int i = 0; i < 3; ++i)
+				std::swap(triangles[t * 3 + i], triangles[other * 3 + i]);
+		}
+	}
+
+	return triangles;
+}
+
+bool RunMeshBenchmark()
+{
+	const unsigned int gridSize = 256;
+
+	std::cout << "Mesh building benchmark (" << gridSize << "x" << gridSize << " quad grid, ACMR with a "
+		<< VERTEX_CACHE_SIZE << " vertex FIFO cache)" << std::endl;
+	std::cout << std::setw(12) << "Order" << std::setw(12) << "Vertices" << std::setw(10) << "Welded"
+		<< std::setw(10) << "Indices" << std::setw(14) << "ACMR before" << std::setw(13) << "ACMR after"
+		<< std::setw(14) << "Build ms" << std::endl;
+
+	for (int shuffle = 0; shuffle < 2; ++shuffle)
+	{
+		std::vector<Vertex> triangles = CreateGridTriangles(gridSize, shuffle != 0);
+
+		IndexedMesh mesh;
+		MeshBuildStatistics statistics;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		BuildIndexedMesh(triangles.data(), static_cast<unsigned int>(triangles.size()), Vertex::STRIDE, mesh, statistics);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		std::vector<unsigned char> indexData;
+		IndexFormat indexFormat = PackIndices(mesh.indices, mesh.vertexCount, indexData);
+
+		std::cout << std::setw(12) << (shuffle != 0 ? "shuffled" : "rows")
+			<< std::setw(12) << statistics.inputVertexCount << std::setw(10) << statistics.outputVertexCount
+			<< std::setw(10) << (indexFormat == IndexFormat::UInt16 ? "16 bit" : "32 bit")
+			<< std::setw(14) << std::fixed << std::setprecision(3) << statistics.acmrBefore
+			<< std::setw(13) << statistics.acmrAfter
+			<< std::setw(14) << elapsed.count() * 1000.0 << std::endl;
+	}
+
+	return true;
+}
+
+bool RunShaderCacheBenchmark()
+{
+	const unsigned int shaderCount = 64;
+	const size_t bytecodeSize = 16 * 1024;
+
+	ShaderCache cache("ShaderCacheBenchmark");
+	cache.Clear();
+
+	// Made up shaders: the cache only hashes the source and stores the bytecode, so neither
+	// needs to be real.
+	std::vector<unsigned char> bytecode(bytecodeSize);
+	for (size_t i = 0; i < bytecodeSize; ++i)
+		bytecode[i] = static_cast<unsigned char>(i * 31);
+
+	std::vector<std::string> paths(shaderCount);
+	std::vector<std::string> sources(shaderCount);
+	for (unsigned int i = 0; i < shaderCount; ++i)
+	{
+		paths[i] = "Shaders/shader" + std::to_string(i) + ".hlsl";
+		sources[i] = "float4 main(float4 colour : COLOR) : SV_TARGET { return colour * " + std::to_string(i) + ".0f; }";
+		sources[i].append(8 * 1024, ' ');
+	}
+
+	std::vector<ShaderCacheKey> keys(shaderCount);
+	std::vector<ShaderCacheInclude> noIncludes;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < shaderCount; ++i)
+		keys[i] = ShaderCache::MakeKey(paths[i], sources[i], nullptr, 0, "main", "ps_5_0", 0);
+	std::chrono::duration<double> keyTime = std::chrono::high_resolution_clock::now() - start;
+
+	unsigned int misses = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < shaderCount; ++i)
+		misses += cache.Load(keys[i]) == nullptr ? 1 : 0;
+	std::chrono::duration<double> missTime = std::chrono::high_resolution_clock::now() - start;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < shaderCount; ++i)
+		cache.Store(keys[i], bytecode.data(), bytecode.size(), noIncludes);
+	std::chrono::duration<double> storeTime = std::chrono::high_resolution_clock::now() - start;
+
+	unsigned int hits = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < shaderCount; ++i)
+	{
+		std::unique_ptr<ShaderCacheEntry> entry = cache.Load(keys[i]);
+		if (entry != nullptr && entry->GetBytecodeSize() == bytecodeSize &&
+			memcmp(entry->GetBytecode(), bytecode.data(), bytecodeSize) == 0)
+		{
+			++hits;
+		}
+	}
+	std::chrono::duration<double> hitTime = std::chrono::high_resolution_clock::now() - start;
+
+	// Edit every shader and store it again, which should replace the old entries.
+	unsigned int staleEntries = 0;
+	for (unsigned int i = 0; i < shaderCount; ++i)
+	{
+		sources[i] += "// Edited";
+		ShaderCacheKey key = ShaderCache::MakeKey(paths[i], sources[i], nullptr, 0, "main", "ps_5_0", 0);
+		cache.Store(key, bytecode.data(), bytecode.size(), noIncludes);
+		staleEntries += cache.Load(keys[i]) != nullptr ? 1 : 0;
+	}
+
+	std::cout << "Shader cache benchmark (" << shaderCount << " shaders, " << bytecodeSize / 1024
+		<< " KB of bytecode each, in " << cache.GetDirectory() << ")" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "  Key:   " << keyTime.count() * 1.0e6 / shaderCount << " us/shader" << std::endl;
+	std::cout << "  Miss:  " << missTime.count() * 1.0e6 / shaderCount << " us/shader, " << misses << " misses" << std::endl;
+	std::cout << "  Store: " << storeTime.count() * 1.0e6 / shaderCount << " us/shader" << std::endl;
+	std::cout << "  Hit:   " << hitTime.count() * 1.0e6 / shaderCount << " us/shader, " << hits << " hits" << std::endl;
+	std::cout << "  Old entries left after editing every shader: " << staleEntries << std::endl;
+
+	cache.Clear();
+
+	return misses == shaderCount && hits == shaderCount && staleEntries == 0;
+}
+
+// A clock where time only passes when it is slept or advanced. Sleeps are rounded up to the
+// timer's granularity and overshoot by a made up amount, like a real operating system's, so
+// the scheduler can be checked the same way every time.
+class SimulatedFrameClock : public FrameClock
+{
+public:
+	SimulatedFrameClock(double granularity, double maxOversleep)
+		: mTime(0.0), mGranularity(granularity), mMaxOversleep(maxOversleep), mRandom(12345),
+		mSleptSeconds(0.0), mYieldedSeconds(0.0)
+	{
+	}
+
+	double Now() override { return mTime; }
+
+	void Sleep(double seconds) override
+	{
+		if (seconds <= 0.0)
+		{
+			// Yielding and checking the time again costs a little.
+			mTime += YIELD_SECONDS;
+			mYieldedSeconds += YIELD_SECONDS;
+			return;
+		}
+
+		if (mGranularity > 0.0)
+			seconds = std::ceil(seconds / mGranularity) * mGranularity;
+
+		mRandom = mRandom * 1664525u + 1013904223u;
+		seconds += mMaxOversleep * (mRandom >> 8) / 16777216.0;
+
+		mTime += seconds;
+		mSleptSeconds += seconds;
+	}
+
+	void Advance(double seconds) { mTime += seconds; }
+	double GetSleptSeconds() const { return mSleptSeconds; }
+	double GetYieldedSeconds() const { return mYieldedSeconds; }
+
+private:
+	static const double YIELD_SECONDS;
+
+	double mTime;
+	double mGranularity;
+	double mMaxOversleep;
+	unsigned int mRandom;
+	double mSleptSeconds;
+	double mYieldedSeconds;
+};
+
+const double SimulatedFrameClock::YIELD_SECONDS = 2.0e-6;
+
+bool RunPacingBenchmark()
+{
+	struct PacingCase
+	{
+		const char* name;
+		double granularity;		// Of the simulated sleeps.
+		double maxOversleep;
+		double renderSeconds;	// How long each simulated frame takes to render.
+	};
+
+	const PacingCase cases[] =
+	{
+		{ "Precise timer", 0.0, 0.0001, 0.004 },
+		{ "1 ms timer", 0.001, 0.0005, 0.004 },
+		{ "15.6 ms timer", 0.0156, 0.0, 0.004 },
+		{ "Slow frames", 0.001, 0.0005, 0.030 },
+	};
+
+	const unsigned int frameCount = 600;
+	FrameSchedulerDesc desc;	// 60 frames and updates per second.
+
+	std::cout << "Frame pacing benchmark (" << frameCount << " frames at " << desc.targetFrameRate
+		<< " frames/s, " << 1.0 / desc.fixedTimeStep << " updates/s)" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	for (const PacingCase& pacingCase : cases)
+	{
+		SimulatedFrameClock clock(pacingCase.granularity, pacingCase.maxOversleep);
+		FrameScheduler scheduler(&clock, desc);
+
+		unsigned long long updates = 0;
+		double worstFrameTime = 0.0;
+		double start = 0.0;
+		double end = 0.0;
+		for (unsigned int i = 0; i < frameCount; ++i)
+		{
+			// The time is counted from the start of the first frame, so its updates aren't.
+			unsigned int steps = scheduler.BeginFrame();
+			if (i == 0)
+			{
+				start = clock.Now();
+			}
+			else
+			{
+				updates += steps;
+				worstFrameTime = std::max(worstFrameTime, scheduler.GetFrameTime());
+			}
+			end = clock.Now();
+
+			clock.Advance(pacingCase.renderSeconds);
+		}
+
+		double seconds = end - start;
+		double waited = clock.GetSleptSeconds() + clock.GetYieldedSeconds();
+		std::cout << "  " << std::left << std::setw(14) << pacingCase.name << std::right
+			<< "  frame " << seconds * 1000.0 / (frameCount - 1) << " ms (worst " << worstFrameTime * 1000.0
+			<< "), updates/s " << updates / seconds
+			<< ", waiting " << (waited > 0.0 ? clock.GetSleptSeconds() * 100.0 / waited : 0.0) << "% asleep"
+			<< ", margin " << scheduler.GetSleepMargin() * 1000.0 << " ms" << std::endl;
+	}
+
+	// The real clock, for a second.
+	SystemFrameClock clock;
+	FrameScheduler scheduler(&clock, desc);
+	double worstError = 0.0;
+	double start = 0.0;
+	double end = 0.0;
+	for (unsigned int i = 0; i < 60; ++i)
+	{
+		scheduler.BeginFrame();
+		if (i == 0)
+			start = clock.Now();
+		else
+			worstError = std::max(worstError, std::fabs(scheduler.GetFrameTime() - 1.0 / desc.targetFrameRate));
+		end = clock.Now();
+	}
+
+	std::cout << "  " << std::left << std::setw(14) << "System clock" << std::right
+		<< "  frame " << (end - start) * 1000.0 / 59 << " ms (worst error " << worstError * 1000.0
+		<< " ms), margin " << scheduler.GetSleepMargin() * 1000.0 << " ms" << std::endl;
+
+	return true;
+}
+
+// Timed by RunProfilerBenchmark(), from every thread at once.
+static ProfileSection gBenchmarkSection("Benchmark/EmptyScope");
+
+bool RunProfilerBenchmark()
+{
+	const unsigned int scopeCount = 1000000;
+	const unsigned int maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::cout << "Profiler benchmark (" << scopeCount << " empty scopes per thread)" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+
+	for (unsigned int threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+	{
+		std::vector<std::thread> threads;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int t = 0; t < threadCount; ++t)
+		{
+			threads.push_back(std::thread([]
+			{
+				for (unsigned int i = 0; i < scopeCount; ++i)
+					ProfileScope scope(gBenchmarkSection);
+			}));
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		std::cout << "  " << threadCount << " threads: " << elapsed.count() * 1.0e9 / scopeCount
+			<< " ns/scope" << std::endl;
+	}
+
+	return true;
+}
+
+// A backend that creates nothing and records the state bound at every draw, and how many calls
+// were made to it.
+class RecordingBackend : public RenderBackend
+{
+public:
+	struct DrawState
+	{
+		BackendBuffer* vertexBuffer;
+		unsigned int stride;
+		BackendBuffer* indexBuffer;
+		BackendInputLayout* inputLayout;
+		BackendVertexShader* vertexShader;
+		BackendPixelShader* pixelShader;
+		unsigned int indexCount;
+
+		bool operator==(const DrawState& other) const
+		{
+			return memcmp(this, &other, sizeof(DrawState)) == 0;
+		}
+	};
+
+	RecordingBackend() : mBindCalls(0) { memset(&mState, 0, sizeof(mState)); }
+
+	BackendBuffer* CreateVertexBuffer(const void*, unsigned int) override { return nullptr; }
+	BackendBuffer* CreateIndexBuffer(const void*, unsigned int) override { return nullptr; }
+	BackendVertexShader* CreateVertexShader(const ShaderDesc&) override { return nullptr; }
+	BackendPixelShader* CreatePixelShader(const ShaderDesc&) override { return nullptr; }
+	BackendInputLayout* CreateInputLayout(const InputElementDesc*, unsigned int, BackendVertexShader*) override { return new BackendInputLayout(); }
+	BackendBuffer* CreateDynamicBuffer(unsigned int) override { return nullptr; }
+	BackendBuffer* CreateConstantBuffer(unsigned int) override { return nullptr; }
+	bool SupportsConstantBufferOffsets() const override { return true; }
+	BackendRenderTarget* GetBackBuffer() override { return nullptr; }
+
+	void ClearRenderTargetView(BackendRenderTarget*, const float*) override {}
+	void IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+		BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int*) override
+	{
+		++mBindCalls;
+		if (startSlot == 0 && bufferCount > 0)
+		{
+			mState.vertexBuffer = buffers[0];
+			mState.stride = strides[0];
+		}
+	}
+	void IASetIndexBuffer(BackendBuffer* buffer, IndexFormat, unsigned int) override { ++mBindCalls; mState.indexBuffer = buffer; }
+	void IASetInputLayout(BackendInputLayout* inputLayout) override { ++mBindCalls; mState.inputLayout = inputLayout; }
+	void IASetPrimitiveTopology(PrimitiveTopology) override { ++mBindCalls; }
+	void VSSetShader(BackendVertexShader* shader) override { ++mBindCalls; mState.vertexShader = shader; }
+	void PSSetShader(BackendPixelShader* shader) override { ++mBindCalls; mState.pixelShader = shader; }
+	void VSSetConstantBuffers(unsigned int, unsigned int, BackendBuffer* const*, const unsigned int*, const unsigned int*) override { ++mBindCalls; }
+	void* Map(BackendBuffer*, MapMode) override { return nullptr; }
+	void Unmap(BackendBuffer*) override {}
+	void Draw(unsigned int vertexCount, unsigned int) override { RecordDraw(vertexCount); }
+	void DrawIndexed(unsigned int indexCount, unsigned int, int) override { RecordDraw(indexCount); }
+	void DrawInstanced(unsigned int vertexCount, unsigned int, unsigned int, unsigned int) override { RecordDraw(vertexCount); }
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int, unsigned int, int, unsigned int) override { RecordDraw(indexCount); }
+	void Present() override {}
+	unsigned long long InsertFence() override { return 0; }
+	unsigned long long GetCompletedFence() override { return 0; }
+
+	const std::vector<DrawState>& GetDraws() const { return mDraws; }
+	unsigned long long GetBindCalls() const { return mBindCalls; }
+
+private:
+	void RecordDraw(unsigned int count)
+	{
+		mState.indexCount = count;
+		mDraws.push_back(mState);
+	}
+
+	DrawState mState;
+	std::vector<DrawState> mDraws;
+	unsigned long long mBindCalls;
+};
+
+// The made up draws of RunStateFilterBenchmark(), each binding everything it uses.
+struct BenchmarkDraw
+{
+	unsigned int mesh;
+	unsigned int material;
+};
+
+static void SubmitBenchmarkDraws(RenderBackend& backend, const std::vector<BenchmarkDraw>& draws)
+{
+	// Resources are only compared by address, so made up addresses will do.
+	for (const BenchmarkDraw& draw : draws)
+	{
+		BackendBuffer* vertexBuffer = reinterpret_cast<BackendBuffer*>(static_cast<size_t>(0x1000 + draw.mesh * 16));
+		BackendBuffer* indexBuffer = reinterpret_cast<BackendBuffer*>(static_cast<size_t>(0x2000 + draw.mesh * 16));
+		unsigned int stride = Vertex::STRIDE;
+		unsigned int offset = 0;
+		backend.IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+		backend.IASetIndexBuffer(indexBuffer, IndexFormat::UInt16, 0);
+		backend.IASetInputLayout(reinterpret_cast<BackendInputLayout*>(static_cast<size_t>(0x3000)));
+		backend.IASetPrimitiveTopology(PrimitiveTopology::TriangleList);
+		backend.VSSetShader(reinterpret_cast<BackendVertexShader*>(static_cast<size_t>(0x4000 + (draw.material % 4) * 16)));
+		backend.PSSetShader(reinterpret_cast<BackendPixelShader*>(static_cast<size_t>(0x5000 + draw.material * 16)));
+		backend.DrawIndexed(36 + draw.mesh * 3, 0, 0);
+	}
+}
+
+bool RunStateFilterBenchmark()
+{
+	const unsigned int drawCount = 100000;
+	const unsigned int meshCount = 8;
+	const unsigned int materialCount = 16;
+
+	// The same draws in a random order and sorted by material and mesh, as a renderer sorting
+	// its draws would submit them.
+	std::vector<BenchmarkDraw> randomDraws(drawCount);
+	unsigned int random = 12345;
+	for (BenchmarkDraw& draw : randomDraws)
+	{
+		random = random * 1664525u + 1013904223u;
+		draw.mesh = (random >> 8) % meshCount;
+		draw.material = (random >> 16) % materialCount;
+	}
+
+	std::vector<BenchmarkDraw> sortedDraws = randomDraws;
+	std::sort(sortedDraws.begin(), sortedDraws.end(), [](const BenchmarkDraw& a, const BenchmarkDraw& b)
+	{
+		return a.material != b.material ? a.material < b.material : a.mesh < b.mesh;
+	});
+
+	std::cout << "State filter benchmark (" << drawCount << " draws, " << meshCount << " meshes, "
+		<< materialCount << " materials, 6 binds per draw)" << std::endl;
+	std::cout << std::left << std::setw(18) << "  Order" << std::right << std::setw(14) << "Unfiltered"
+		<< std::setw(14) << "Issued" << std::setw(14) << "Elided" << std::setw(12) << "ns/draw" << std::setw(12) << "Mismatches" << std::endl;
+
+	const std::vector<BenchmarkDraw>* orders[] = { &randomDraws, &sortedDraws };
+	const char* orderNames[] = { "Random", "Sorted" };
+	bool passed = true;
+	for (unsigned int order = 0; order < 2; ++order)
+	{
+		RecordingBackend unfiltered;
+		SubmitBenchmarkDraws(unfiltered, *orders[order]);
+
+		RecordingBackend filtered;
+		StateFilterBackend filter(&filtered);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		SubmitBenchmarkDraws(filter, *orders[order]);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		// Every draw must see the same state with and without the filter.
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < drawCount; ++i)
+			mismatches += unfiltered.GetDraws()[i] == filtered.GetDraws()[i] ? 0 : 1;
+
+		const StateFilterStatistics& statistics = filter.GetStatistics();
+		std::cout << "  " << std::left << std::setw(16) << orderNames[order] << std::right
+			<< std::setw(14) << unfiltered.GetBindCalls() << std::setw(14) << statistics.bindsIssued
+			<< std::setw(14) << statistics.bindsElided << std::setw(12) << std::fixed << std::setprecision(1)
+			<< elapsed.count() * 1.0e9 / drawCount << std::setw(12) << mismatches << std::endl;
+		passed = passed && mismatches == 0;
+	}
+
+	return passed;
+}
+
+bool RunPipelineStateBenchmark()
+{
+	const unsigned int vertexShaderCount = 8;
+	const unsigned int pixelShaderCount = 32;
+	const unsigned int lookupCount = 1000000;
+	const unsigned int drawCount = 100000;
+
+	RecordingBackend backend;
+	PipelineStateCache cache(&backend);
+
+	InputElementDesc inputDesc[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(inputDesc, 0);
+
+	// Every combination of the made up shaders, looked up over and over like a renderer asking
+	// for the state of each of its draws.
+	std::vector<const PipelineState*> states(vertexShaderCount * pixelShaderCount);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < lookupCount; ++i)
+	{
+		unsigned int combination = (i * 7919u) % (vertexShaderCount * pixelShaderCount);
+		PipelineStateDesc desc;
+		desc.vertexShader = reinterpret_cast<BackendVertexShader*>(static_cast<size_t>(0x4000 + (combination % vertexShaderCount) * 16));
+		desc.pixelShader = reinterpret_cast<BackendPixelShader*>(static_cast<size_t>(0x5000 + (combination / vertexShaderCount) * 16));
+		desc.inputElements = inputDesc;
+		desc.inputElementCount = Vertex::ELEMENT_COUNT;
+		desc.topology = PrimitiveTopology::TriangleList;
+		states[combination] = cache.GetPipelineState(desc);
+	}
+	std::chrono::duration<double> lookupTime = std::chrono::high_resolution_clock::now() - start;
+
+	PipelineStateCacheStatistics statistics = cache.GetStatistics();
+	std::cout << "Pipeline state benchmark (" << vertexShaderCount << " vertex shaders, " << pixelShaderCount
+		<< " pixel shaders, " << lookupCount << " lookups, " << drawCount << " draws)" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "  Lookup:  " << lookupTime.count() * 1.0e9 / lookupCount << " ns, " << statistics.statesCreated
+		<< " states and " << statistics.inputLayoutsCreated << " input layouts created, " << statistics.stateHits << " hits" << std::endl;
+
+	// Draws sorted by state, bound through a state filter either as four separate calls or as
+	// one pipeline state.
+	for (int usePipelineStates = 0; usePipelineStates < 2; ++usePipelineStates)
+	{
+		RecordingBackend recorder;
+		StateFilterBackend filter(&recorder);
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < drawCount; ++i)
+		{
+			const PipelineState* state = states[i * states.size() / drawCount];
+			if (usePipelineStates)
+			{
+				filter.SetPipelineState(state);
+			}
+			else
+			{
+				filter.IASetInputLayout(state->GetInputLayout());
+				filter.IASetPrimitiveTopology(state->GetTopology());
+				filter.VSSetShader(state->GetVertexShader());
+				filter.PSSetShader(state->GetPixelShader());
+			}
+			filter.Draw(3, 0);
+		}
+		std::chrono::duration<double> drawTime = std::chrono::high_resolution_clock::now() - start;
+
+		std::cout << "  " << (usePipelineStates ? "Pipeline states: " : "Separate binds:  ") << drawTime.count() * 1.0e9 / drawCount
+			<< " ns/draw, " << recorder.GetBindCalls() << " binds issued" << std::endl;
+	}
+
+	return true;
+}
+
+bool RunDrawQueueBenchmark()
+{
+	const unsigned int drawCounts[] = { 10000, 100000, 1000000 };
+	const unsigned int pipelineCount = 32;
+	const unsigned int materialCount = 256;
+	const unsigned int meshCount = 64;
+	const unsigned int frameCount = 10;
+
+	RecordingBackend backend;
+	PipelineStateCache cache(&backend);
+	InputElementDesc inputDesc[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(inputDesc, 0);
+
+	std::vector<const PipelineState*> states(pipelineCount);
+	for (unsigned int i = 0; i < pipelineCount; ++i)
+	{
+		PipelineStateDesc desc;
+		desc.vertexShader = reinterpret_cast<BackendVertexShader*>(static_cast<size_t>(0x4000 + (i % 4) * 16));
+		desc.pixelShader = reinterpret_cast<BackendPixelShader*>(static_cast<size_t>(0x5000 + i * 16));
+		desc.inputElements = inputDesc;
+		desc.inputElementCount = Vertex::ELEMENT_COUNT;
+		desc.topology = PrimitiveTopology::TriangleList;
+		states[i] = cache.GetPipelineState(desc);
+	}
+
+	std::cout << "Draw queue benchmark (" << pipelineCount << " pipeline states, " << materialCount << " materials, "
+		<< meshCount << " meshes, random depths, average of " << frameCount << " frames)" << std::endl;
+	std::cout << std::setw(10) << "Draws" << std::setw(14) << "Radix (ms)" << std::setw(16) << "std::sort (ms)"
+		<< std::setw(14) << "Speed-up" << std::setw(16) << "Binds unsorted" << std::setw(14) << "Binds sorted" << std::setw(9) << "Sorted" << std::endl;
+
+	bool passed = true;
+	for (unsigned int drawCount : drawCounts)
+	{
+		// Made up draws in the order a scene might walk its objects. The material picks the mesh,
+		// like a texture would be tied to a model.
+		DrawQueue queue;
+		unsigned int random = 12345;
+		for (unsigned int i = 0; i < drawCount; ++i)
+		{
+			random = random * 1664525u + 1013904223u;
+			unsigned int pipeline = (random >> 8) % pipelineCount;
+			random = random * 1664525u + 1013904223u;
+			unsigned int material = (random >> 8) % materialCount;
+			random = random * 1664525u + 1013904223u;
+			float depth = (random >> 8) / 16777216.0f;
+
+			QueuedDraw draw;
+			draw.pipelineState = states[pipeline];
+			draw.vertexBuffer = reinterpret_cast<BackendBuffer*>(static_cast<size_t>(0x1000 + (material % meshCount) * 16));
+			draw.vertexStride = Vertex::STRIDE;
+			draw.indexBuffer = reinterpret_cast<BackendBuffer*>(static_cast<size_t>(0x2000 + (material % meshCount) * 16));
+			draw.indexFormat = IndexFormat::UInt16;
+			draw.indexCount = 36;
+			draw.startIndexLocation = 0;
+			draw.baseVertexLocation = 0;
+			draw.constants = nullptr;
+			draw.object = 0;
+			queue.Add(MakeOpaqueDrawKey(states[pipeline]->GetId(), material, depth), draw);
+		}
+		const std::vector<DrawSortEntry> unsorted = queue.GetEntries();
+
+		RecordingBackend unsortedRecorder;
+		queue.Submit(&unsortedRecorder);
+
+		// Sort the same unsorted entries every frame, with the radix sort and with std::sort.
+		std::vector<DrawSortEntry> entries;
+		std::vector<DrawSortEntry> scratch;
+		double radixSeconds = 0.0;
+		double stdSortSeconds = 0.0;
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			entries = unsorted;
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			RadixSortDrawKeys(entries, scratch);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			radixSeconds += elapsed.count();
+
+			entries = unsorted;
+			start = std::chrono::high_resolution_clock::now();
+			std::sort(entries.begin(), entries.end(), [](const DrawSortEntry& a, const DrawSortEntry& b) { return a.key < b.key; });
+			elapsed = std::chrono::high_resolution_clock::now() - start;
+			stdSortSeconds += elapsed.count();
+		}
+
+		queue.Sort();
+		const std::vector<DrawSortEntry>& sortedEntries = queue.GetEntries();
+		bool sorted = std::is_sorted(sortedEntries.begin(), sortedEntries.end(),
+			[](const DrawSortEntry& a, const DrawSortEntry& b) { return a.key < b.key; });
+
+		RecordingBackend sortedRecorder;
+		queue.Submit(&sortedRecorder);
+
+		std::cout << std::fixed << std::setprecision(3) << std::setw(10) << drawCount
+			<< std::setw(14) << radixSeconds * 1000.0 / frameCount << std::setw(16) << stdSortSeconds * 1000.0 / frameCount
+			<< std::setw(13) << std::setprecision(2) << stdSortSeconds / radixSeconds << "x"
+			<< std::setw(16) << unsortedRecorder.GetBindCalls() << std::setw(14) << sortedRecorder.GetBindCalls()
+			<< std::setw(9) << (sorted ? "yes" : "NO") << std::endl;
+		passed = passed && sorted;
+	}
+
+	return passed;
+}
+
+bool RunCommandBufferBenchmark()
+{
+	const unsigned int drawCount = 200000;
+	const unsigned int pipelineCount = 32;
+	const unsigned int meshCount = 64;
+	const unsigned int frameCount = 10;
+	const unsigned int maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	RecordingBackend device;
+	PipelineStateCache cache(&device);
+	InputElementDesc inputDesc[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(inputDesc, 0);
+
+	std::vector<const PipelineState*> states(pipelineCount);
+	for (unsigned int i = 0; i < pipelineCount; ++i)
+	{
+		PipelineStateDesc desc;
+		desc.vertexShader = reinterpret_cast<BackendVertexShader*>(static_cast<size_t>(0x4000 + (i % 4) * 16));
+		desc.pixelShader = reinterpret_cast<BackendPixelShader*>(static_cast<size_t>(0x5000 + i * 16));
+		desc.inputElements = inputDesc;
+		desc.inputElementCount = Vertex::ELEMENT_COUNT;
+		desc.topology = PrimitiveTopology::TriangleList;
+		states[i] = cache.GetPipelineState(desc);
+	}
+
+	// Made up draws, sorted like a frame's would be.
+	DrawQueue queue;
+	unsigned int random = 12345;
+	for (unsigned int i = 0; i < drawCount; ++i)
+	{
+		random = random * 1664525u + 1013904223u;
+		unsigned int pipeline = (random >> 8) % pipelineCount;
+		unsigned int mesh = (random >> 16) % meshCount;
+
+		QueuedDraw draw;
+		draw.pipelineState = states[pipeline];
+		draw.vertexBuffer = reinterpret_cast<BackendBuffer*>(static_cast<size_t>(0x1000 + mesh * 16));
+		draw.vertexStride = Vertex::STRIDE;
+		draw.indexBuffer = reinterpret_cast<BackendBuffer*>(static_cast<size_t>(0x2000 + mesh * 16));
+		draw.indexFormat = IndexFormat::UInt16;
+		draw.indexCount = 36 + i % 7;
+		draw.startIndexLocation = 0;
+		draw.baseVertexLocation = 0;
+		draw.constants = nullptr;
+		draw.object = 0;
+		queue.Add(MakeOpaqueDrawKey(states[pipeline]->GetId(), mesh, (i % 1000) / 1000.0f), draw);
+	}
+	queue.Sort();
+
+	RecordingBackend direct;
+	queue.Submit(&direct);
+
+	std::cout << "Command buffer benchmark (" << drawCount << " draws, average of " << frameCount << " frames)" << std::endl;
+
+	// Record all draws into one command buffer on this thread and execute it, to see the cost
+	// of each half.
+	bool passed = true;
+	{
+		CommandBuffer commandBuffer(&device);
+		RecordingBackend recorder;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		queue.Submit(&commandBuffer);
+		std::chrono::duration<double> recordTime = std::chrono::high_resolution_clock::now() - start;
+
+		start = std::chrono::high_resolution_clock::now();
+		commandBuffer.Execute(&recorder);
+		std::chrono::duration<double> executeTime = std::chrono::high_resolution_clock::now() - start;
+
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < drawCount; ++i)
+			mismatches += direct.GetDraws()[i] == recorder.GetDraws()[i] ? 0 : 1;
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << "  One buffer: " << commandBuffer.GetCommandCount() << " commands in " << commandBuffer.GetSize() / 1024
+			<< " KB, recorded in " << recordTime.count() * 1000.0 << " ms, executed in " << executeTime.count() * 1000.0
+			<< " ms, " << mismatches << " mismatches" << std::endl;
+		passed = mismatches == 0;
+	}
+
+	std::cout << std::setw(10) << "Threads" << std::setw(10) << "Buffers" << std::setw(12) << "Submit (ms)"
+		<< std::setw(12) << "ns/draw" << std::setw(12) << "Mismatches" << std::endl;
+
+	for (unsigned int threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+	{
+		ThreadPool threadPool(threadCount);
+		double seconds = 0.0;
+		unsigned int mismatches = 0;
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			// Replayed through a state filter, like the scene does.
+			RecordingBackend recorder;
+			StateFilterBackend filter(&recorder);
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			queue.SubmitParallel(&filter, &threadPool);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			seconds += elapsed.count();
+
+			// Every draw must see the same state as when submitted directly.
+			for (unsigned int i = 0; i < drawCount; ++i)
+				mismatches += direct.GetDraws()[i] == recorder.GetDraws()[i] ? 0 : 1;
+		}
+
+		unsigned int bufferCount = queue.GetCommandBufferCount();
+		std::cout << std::setw(10) << threadCount << std::setw(10) << bufferCount
+			<< std::setw(12) << std::fixed << std::setprecision(3) << seconds * 1000.0 / frameCount
+			<< std::setw(12) << std::setprecision(1) << seconds * 1.0e9 / frameCount / drawCount << std::setw(12) << mismatches << std::endl;
+		passed = passed && mismatches == 0;
+	}
+
+	return passed;
+}
+
+// What RunInstancingBenchmark() and RunRingBufferBenchmark() draw with.
+struct InstancingResources
+{
+	BackendVertexShader* vertexShader;
+	BackendPixelShader* pixelShader;
+	const PipelineState* pipelineState;
+	BackendBuffer* vertexBuffer;
+	BackendBuffer* indexBuffer;
+	BackendBuffer* instanceBuffer;
+	unsigned int instanceOffset;	// Where the instances start in the instance buffer, in bytes.
+	BackendBuffer* viewConstants;	// An identity view-projection matrix.
+	InstanceBatch batch;
+};
+
+// Fills the builder with a grid of columns * rows small copies of the sample's rectangle
+// filling the screen, each with its own tint, and creates what they are drawn with, the
+// instances in an immutable buffer. Returns false on failure.
+static bool CreateInstancingResources(RenderBackend& backend, PipelineStateCache& cache, unsigned int columns,
+	unsigned int rows, InstanceBufferBuilder& builder, InstancingResources& resources)
+{
+	// The sample's rectangle, as an indexed mesh.
+	Vertex vertices[] =
+	{
+		{ Float3(-0.5f, 0.5f, 0.0f), Float4(1.0f, 0.0f, 0.0f, 1.0f) },
+		{ Float3(0.5f, -0.5f, 0.0f), Float4(0.0f, 1.0f, 0.0f, 1.0f) },
+		{ Float3(-0.5f, -0.5f, 0.0f), Float4(0.0f, 0.0f, 1.0f, 1.0f) },
+		{ Float3(0.5f, 0.5f, 0.0f), Float4(1.0f, 1.0f, 1.0f, 1.0f) },
+	};
+	unsigned short indices[] = { 0, 1, 2, 3, 1, 0 };
+
+	ShaderDesc vertexShaderDesc = { L"../Resources/Shaders/instancedVertexShader.hlsl", "main", "vs_5_0" };
+	ShaderDesc pixelShaderDesc = { L"../Resources/Shaders/pixelShader.hlsl", "main", "ps_5_0" };
+	resources.vertexShader = backend.CreateVertexShader(vertexShaderDesc);
+	resources.pixelShader = backend.CreatePixelShader(pixelShaderDesc);
+
+	InputElementDesc inputDesc[Vertex::ELEMENT_COUNT + Instance::ELEMENT_COUNT];
+	GetInstancedInputElements<Vertex>(inputDesc);
+
+	PipelineStateDesc pipelineDesc;
+	pipelineDesc.vertexShader = resources.vertexShader;
+	pipelineDesc.pixelShader = resources.pixelShader;
+	pipelineDesc.inputElements = inputDesc;
+	pipelineDesc.inputElementCount = Vertex::ELEMENT_COUNT + Instance::ELEMENT_COUNT;
+	pipelineDesc.topology = PrimitiveTopology::TriangleList;
+
+	builder.Clear();
+	const float cellWidth = 2.0f / columns;
+	const float cellHeight = 2.0f / rows;
+	for (unsigned int row = 0; row < rows; ++row)
+	{
+		for (unsigned int column = 0; column < columns; ++column)
+		{
+			Float3x4 transform(
+				Float4(cellWidth * 0.8f, 0.0f, 0.0f, -1.0f + (column + 0.5f) * cellWidth),
+				Float4(0.0f, cellHeight * 0.8f, 0.0f, -1.0f + (row + 0.5f) * cellHeight),
+				Float4(0.0f, 0.0f, 1.0f, 0.0f));
+			builder.Add(transform, Float4((column % 8) / 7.0f, (row % 8) / 7.0f, 1.0f - (column % 8) / 7.0f, 1.0f));
+		}
+	}
+
+	resources.pipelineState = resources.vertexShader != nullptr && resources.pixelShader != nullptr ?
+		cache.GetPipelineState(pipelineDesc) : nullptr;
+	resources.vertexBuffer = backend.CreateVertexBuffer(vertices, sizeof(vertices));
+	resources.indexBuffer = backend.CreateIndexBuffer(indices, sizeof(indices));
+	resources.instanceBuffer = builder.CreateBuffer(&backend);
+	resources.instanceOffset = 0;
+	resources.batch = builder.EndBatch();
+
+	ViewConstants viewConstants;
+	resources.viewConstants = backend.CreateConstantBuffer(sizeof(viewConstants));
+	if (resources.viewConstants != nullptr)
+		backend.UpdateDynamicBuffer(resources.viewConstants, MapMode::WriteDiscard, 0, &viewConstants, sizeof(viewConstants));
+
+	return resources.pipelineState != nullptr && resources.vertexBuffer != nullptr &&
+		resources.indexBuffer != nullptr && resources.instanceBuffer != nullptr && resources.viewConstants != nullptr;
+}
+
+// The pipeline state is released by its cache.
+static void ReleaseInstancingResources(InstancingResources& resources)
+{
+	delete resources.viewConstants;
+	delete resources.instanceBuffer;
+	delete resources.indexBuffer;
+	delete resources.vertexBuffer;
+	delete resources.pixelShader;
+	delete resources.vertexShader;
+}
+
+static void SubmitInstances(RenderBackend& backend, const InstancingResources& resources, bool instanced)
+{
+	BackendBuffer* buffers[] = { resources.vertexBuffer, resources.instanceBuffer };
+	unsigned int strides[] = { Vertex::STRIDE, Instance::STRIDE };
+	unsigned int offsets[] = { 0, resources.instanceOffset };
+	backend.SetPipelineState(resources.pipelineState);
+	backend.IASetIndexBuffer(resources.indexBuffer, IndexFormat::UInt16, 0);
+	backend.VSSetConstantBuffers(CONSTANT_SLOT_VIEW, 1, &resources.viewConstants, nullptr, nullptr);
+
+	if (instanced)
+	{
+		backend.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+		backend.DrawIndexedInstanced(6, resources.batch.instanceCount, 0, 0, resources.batch.startInstanceLocation);
+		return;
+	}
+
+	// Each copy is drawn on its own, with the instance buffer bound at its instance: a draw that
+	// isn't instanced reads the per instance elements of the first instance.
+	for (unsigned int i = 0; i < resources.batch.instanceCount; ++i)
+	{
+		offsets[1] = resources.instanceOffset + (resources.batch.startInstanceLocation + i) * Instance::STRIDE;
+		backend.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+		backend.DrawIndexed(6, 0, 0);
+	}
+}
+
+bool RunInstancingBenchmark()
+{
+	const unsigned int columns = 400;
+	const unsigned int rows = 250;
+	const unsigned int width = 1280;
+	const unsigned int height = 720;
+	const unsigned int frameCount = 5;
+
+	SoftwareBackend backend(width, height);
+	PipelineStateCache cache(&backend);
+	InstanceBufferBuilder builder;
+	InstancingResources resources;
+	if (!CreateInstancingResources(backend, cache, columns, rows, builder, resources))
+	{
+		std::cout << "Failed to create the resources of the instancing benchmark" << std::endl;
+		ReleaseInstancingResources(resources);
+		return false;
+	}
+	std::cout << "Instancing benchmark (" << resources.batch.instanceCount << " instances at " << width << "x" << height
+		<< ", average of " << frameCount << " frames)" << std::endl;
+	std::cout << std::setw(12) << "Path" << std::setw(12) << "Draws" << std::setw(12) << "Binds"
+		<< std::setw(14) << "Calls (ms)" << std::setw(14) << "Submit (ms)" << std::setw(14) << "Frame (ms)" << std::endl;
+
+	std::vector<unsigned char> images[2];
+	for (int instanced = 0; instanced < 2; ++instanced)
+	{
+		// The cost of the calls alone, made to a backend that only records them.
+		RecordingBackend recorder;
+		StateFilterBackend recordingFilter(&recorder);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		SubmitInstances(recordingFilter, resources, instanced != 0);
+		std::chrono::duration<double> callTime = std::chrono::high_resolution_clock::now() - start;
+
+		// The frames themselves, drawn through a state filter like the scene does.
+		StateFilterBackend filter(&backend);
+		std::chrono::duration<double> submitTime(0.0);
+		std::chrono::duration<double> frameTime(0.0);
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			float clearColour[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			start = std::chrono::high_resolution_clock::now();
+			filter.ClearRenderTargetView(filter.GetBackBuffer(), clearColour);
+			SubmitInstances(filter, resources, instanced != 0);
+			std::chrono::high_resolution_clock::time_point submitted = std::chrono::high_resolution_clock::now();
+			filter.Present();
+			submitTime += submitted - start;
+			frameTime += std::chrono::high_resolution_clock::now() - start;
+		}
+
+		const unsigned char* pixels = backend.GetBackBufferData();
+		images[instanced].assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+		std::cout << std::setw(12) << (instanced ? "Instanced" : "Individual") << std::setw(12) << recorder.GetDraws().size()
+			<< std::setw(12) << recorder.GetBindCalls()
+			<< std::setw(14) << std::fixed << std::setprecision(3) << callTime.count() * 1000.0
+			<< std::setw(14) << submitTime.count() * 1000.0 / frameCount
+			<< std::setw(14) << frameTime.count() * 1000.0 / frameCount << std::endl;
+	}
+
+	std::cout << "  Images " << (images[0] == images[1] ? "match" : "differ") << std::endl;
+
+	ReleaseInstancingResources(resources);
+
+	return images[0] == images[1];
+}
+
+// The memory an allocation took up, and the frame (fence) it belongs to.
+struct RingRange
+{
+	unsigned long long fence;
+	unsigned int begin;
+	unsigned int end;
+};
+
+// Runs frames of made up allocations on the allocator. The GPU finishes each frame latency
+// frames after it is submitted, except at the start of every 500 frames when it falls
+// slowLatency frames behind, making the allocator wait. If inFlight is given, every allocation
+// is checked against the memory still in use and the overlaps are counted.
+static void RunRingFrames(RingAllocator& allocator, unsigned int frameCount, unsigned int latency,
+	unsigned int slowLatency, std::deque<RingRange>* inFlight, unsigned long long& allocations,
+	unsigned long long& wraps, unsigned long long& waits, unsigned long long& overlaps)
+{
+	unsigned int random = 12345;
+	unsigned long long completedFence = 0;
+	for (unsigned int frame = 0; frame < frameCount; ++frame)
+	{
+		unsigned long long fence = frame + 1;
+		unsigned int frameLatency = frame % 500 < slowLatency ? slowLatency : latency;
+		completedFence = std::max(completedFence, fence > frameLatency ? fence - frameLatency : 0);
+
+		random = random * 1664525u + 1013904223u;
+		unsigned int allocationCount = 50 + (random >> 8) % 350;
+		for (unsigned int i = 0; i < allocationCount; ++i)
+		{
+			random = random * 1664525u + 1013904223u;
+			unsigned int size = 16 + (random >> 8) % 4096;
+			unsigned int alignment = 4u << ((random >> 24) % 7);
+
+			// When the ring is full, "wait" for the GPU to finish the oldest frame.
+			allocator.ReleaseFrames(completedFence);
+			RingAllocation allocation;
+			bool allocated = allocator.Allocate(size, alignment, allocation);
+			while (!allocated && allocator.GetOldestFence() != 0)
+			{
+				completedFence = allocator.GetOldestFence();
+				allocator.ReleaseFrames(completedFence);
+				allocated = allocator.Allocate(size, alignment, allocation);
+				++waits;
+			}
+			if (!allocated)
+				continue;
+
+			++allocations;
+			wraps += allocation.wrapped ? 1 : 0;
+
+			if (inFlight != nullptr)
+			{
+				while (!inFlight->empty() && inFlight->front().fence <= completedFence)
+					inFlight->pop_front();
+
+				RingRange range = { fence, allocation.offset, allocation.offset + size };
+				bool misplaced = range.end > allocator.GetSize() || allocation.offset % alignment != 0;
+				for (const RingRange& used : *inFlight)
+					misplaced = misplaced || (range.begin < used.end && used.begin < range.end);
+				overlaps += misplaced ? 1 : 0;
+				inFlight->push_back(range);
+			}
+		}
+
+		allocator.EndFrame(fence);
+	}
+}
+
+bool RunRingBufferBenchmark()
+{
+	const unsigned int ringSize = 4 * 1024 * 1024;
+	const unsigned int latency = 3;
+	const unsigned int slowLatency = 12;
+	const unsigned int checkedFrameCount = 2000;
+	const unsigned int timedFrameCount = 20000;
+
+	std::cout << "Ring buffer benchmark (" << ringSize / 1024 << " KB ring, GPU " << latency << " frames behind, "
+		<< slowLatency << " when slow)" << std::endl;
+	std::cout << std::setw(10) << "Frames" << std::setw(14) << "Allocations" << std::setw(10) << "Wraps"
+		<< std::setw(10) << "Waits" << std::setw(12) << "Overlaps" << std::setw(14) << "ns/alloc" << std::endl;
+
+	// Once checking every allocation against the memory in flight, then timed without checks.
+	bool passed = true;
+	for (int timed = 0; timed < 2; ++timed)
+	{
+		RingAllocator allocator(ringSize);
+		std::deque<RingRange> inFlight;
+		unsigned long long allocations = 0;
+		unsigned long long wraps = 0;
+		unsigned long long waits = 0;
+		unsigned long long overlaps = 0;
+		unsigned int frameCount = timed ? timedFrameCount : checkedFrameCount;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		RunRingFrames(allocator, frameCount, latency, slowLatency, timed ? nullptr : &inFlight, allocations, wraps, waits, overlaps);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		std::cout << std::setw(10) << frameCount << std::setw(14) << allocations << std::setw(10) << wraps << std::setw(10) << waits;
+		if (timed)
+			std::cout << std::setw(12) << "-" << std::setw(14) << std::fixed << std::setprecision(1) << elapsed.count() * 1.0e9 / allocations << std::endl;
+		else
+			std::cout << std::setw(12) << overlaps << std::setw(14) << "-" << std::endl;
+		passed = passed && overlaps == 0;
+	}
+
+	// Stream the instances to a dynamic buffer holding a few frames of them, as if they changed
+	// every frame, and draw them from there.
+	const unsigned int columns = 400;
+	const unsigned int rows = 250;
+	const unsigned int width = 1280;
+	const unsigned int height = 720;
+	const unsigned int frameCount = 10;
+
+	SoftwareBackend backend(width, height);
+	PipelineStateCache cache(&backend);
+	InstanceBufferBuilder builder;
+	InstancingResources resources;
+	if (!CreateInstancingResources(backend, cache, columns, rows, builder, resources))
+	{
+		std::cout << "Failed to create the resources of the ring buffer benchmark" << std::endl;
+		ReleaseInstancingResources(resources);
+		return false;
+	}
+
+	float clearColour[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	backend.ClearRenderTargetView(backend.GetBackBuffer(), clearColour);
+	SubmitInstances(backend, resources, true);
+	backend.Present();
+	const unsigned char* pixels = backend.GetBackBufferData();
+	std::vector<unsigned char> immutableImage(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+	DynamicBuffer dynamicBuffer(&backend, builder.GetByteWidth() * 3 + 4096);
+	InstancingResources streamed = resources;
+	streamed.instanceBuffer = dynamicBuffer.GetBuffer();
+
+	unsigned int mismatches = 0;
+	std::chrono::duration<double> writeTime(0.0);
+	for (unsigned int frame = 0; frame < frameCount; ++frame)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		bool written = builder.Write(dynamicBuffer, streamed.instanceOffset);
+		writeTime += std::chrono::high_resolution_clock::now() - start;
+
+		backend.ClearRenderTargetView(backend.GetBackBuffer(), clearColour);
+		if (written)
+			SubmitInstances(backend, streamed, true);
+		backend.Present();
+		dynamicBuffer.EndFrame(backend.InsertFence());
+
+		mismatches += memcmp(backend.GetBackBufferData(), immutableImage.data(), immutableImage.size()) == 0 ? 0 : 1;
+	}
+
+	const DynamicBufferStatistics& statistics = dynamicBuffer.GetStatistics();
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "  Streaming " << builder.GetByteWidth() / 1024 << " KB of instances a frame through a "
+		<< dynamicBuffer.GetSize() / 1024 << " KB dynamic buffer:" << std::endl;
+	std::cout << "    " << writeTime.count() * 1000.0 / frameCount << " ms/frame, "
+		<< std::setprecision(1) << statistics.bytesWritten / writeTime.count() / (1024.0 * 1024.0 * 1024.0) << " GB/s, "
+		<< statistics.writes << " writes, " << statistics.discards << " discards, " << statistics.waits << " waits, "
+		<< mismatches << " of " << frameCount << " frames differ from the immutable buffer" << std::endl;
+
+	ReleaseInstancingResources(resources);
+
+	return passed && mismatches == 0;
+}
+
+// The transient allocations of a made up frame: sizes and alignments like those of draw lists,
+// sort keys and instance arrays, the same every time the same seed is used.
+struct TransientAllocation
+{
+	unsigned int size;
+	unsigned int alignment;
+};
+
+static size_t MakeTransientAllocations(unsigned int count, unsigned int maxSize, unsigned int seed,
+	std::vector<TransientAllocation>& allocations)
+{
+	allocations.resize(count);
+	unsigned int random = seed;
+	size_t byteCount = 0;
+	for (TransientAllocation& allocation : allocations)
+	{
+		random = random * 1664525u + 1013904223u;
+		allocation.size = 16 + (random >> 8) % (maxSize - 15);
+		allocation.alignment = 4u << ((random >> 24) % 5);
+		byteCount += allocation.size;
+	}
+
+	return byteCount;
+}
+
+// Allocates the given sizes from the heap or an arena, writing a byte at either end of each
+// allocation as the data would be. Heap allocations are freed again at the end, like a
+// std::vector made for the frame would be. Returns how many allocations weren't aligned.
+static unsigned int AllocateTransient(const std::vector<TransientAllocation>& allocations, LinearArena* arena,
+	unsigned char stamp, std::vector<unsigned char*>& pointers)
+{
+	unsigned int misaligned = 0;
+	pointers.resize(allocations.size());
+	for (size_t i = 0; i < allocations.size(); ++i)
+	{
+		const TransientAllocation& allocation = allocations[i];
+		unsigned char* memory = arena != nullptr ?
+			static_cast<unsigned char*>(arena->Allocate(allocation.size, allocation.alignment)) :
+			new unsigned char[allocation.size];
+		memory[0] = stamp;
+		memory[allocation.size - 1] = stamp;
+		misaligned += arena != nullptr && reinterpret_cast<size_t>(memory) % allocation.alignment != 0 ? 1 : 0;
+		pointers[i] = memory;
+	}
+
+	if (arena == nullptr)
+	{
+		for (unsigned char* memory : pointers)
+			delete[] memory;
+	}
+
+	return misaligned;
+}
+
+bool RunArenaBenchmark()
+{
+	const unsigned int allocationsPerFrame = 2000;
+	const unsigned int frameCount = 1000;
+	const unsigned int jobCount = 64;
+	const unsigned int allocationsPerJob = 100;
+	const unsigned int threadFrameCount = 200;
+	const unsigned int maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::vector<TransientAllocation> allocations;
+	size_t frameBytes = MakeTransientAllocations(allocationsPerFrame, 4096, 12345, allocations);
+
+	std::cout << "Frame arena benchmark (" << allocationsPerFrame << " allocations, " << frameBytes / 1024
+		<< " KB a frame)" << std::endl;
+	std::cout << std::setw(22) << "Allocator" << std::setw(12) << "ns/alloc" << std::setw(12) << "Speed-up"
+		<< std::setw(16) << "High-water KB" << std::setw(12) << "Overflows" << std::setw(12) << "Errors" << std::endl;
+
+	// The heap first, then double buffered arenas large enough for a frame and too small. The
+	// allocations of the previous frame are checked after each frame to be untouched, as double
+	// buffering promises.
+	double heapTime = 0.0;
+	const size_t arenaSizes[] = { 0, frameBytes + allocationsPerFrame * 64, frameBytes / 4 };
+	const char* names[] = { "Heap", "Arena", "Arena (too small)" };
+	bool passed = true;
+	for (int test = 0; test < 3; ++test)
+	{
+		FrameArenaDesc desc;
+		desc.frameCount = 2;
+		desc.size = test != 0 ? arenaSizes[test] : 1;
+		FrameArena arena(desc);
+
+		std::vector<unsigned char*> pointers[2];
+		unsigned int errors = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			arena.BeginFrame();
+			unsigned char stamp = static_cast<unsigned char>(frame);
+			errors += AllocateTransient(allocations, test != 0 ? &arena.GetArena() : nullptr, stamp, pointers[frame % 2]);
+
+			if (test != 0 && frame != 0)
+			{
+				unsigned char previousStamp = static_cast<unsigned char>(frame - 1);
+				const std::vector<unsigned char*>& previous = pointers[(frame - 1) % 2];
+				for (size_t i = 0; i < previous.size(); ++i)
+				{
+					bool intact = previous[i][0] == previousStamp && previous[i][allocations[i].size - 1] == previousStamp;
+					errors += intact ? 0 : 1;
+				}
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		double time = elapsed.count() / (static_cast<double>(frameCount) * allocationsPerFrame);
+		heapTime = test == 0 ? time : heapTime;
+		FrameArenaStatistics statistics = arena.GetStatistics();
+		std::cout << std::setw(22) << names[test] << std::fixed << std::setprecision(1) << std::setw(12) << time * 1.0e9
+			<< std::setprecision(2) << std::setw(12) << heapTime / time;
+		if (test != 0)
+			std::cout << std::setw(16) << statistics.highWaterMark / 1024 << std::setw(12) << statistics.overflows;
+		else
+			std::cout << std::setw(16) << "-" << std::setw(12) << "-";
+		std::cout << std::setw(12) << errors << std::endl;
+		passed = passed && errors == 0;
+	}
+
+	// Jobs allocating on the threads of a pool, from the heap shared by all threads and from
+	// each thread's own arena. A thread may end up running every job, so each arena is large
+	// enough for all of them.
+	std::vector<std::vector<TransientAllocation>> jobAllocations(jobCount);
+	size_t jobBytes = 0;
+	for (unsigned int job = 0; job < jobCount; ++job)
+		jobBytes += MakeTransientAllocations(allocationsPerJob, 1024, 1000 + job, jobAllocations[job]);
+
+	std::cout << std::setw(10) << "Threads" << std::setw(16) << "Heap ns/alloc" << std::setw(17) << "Arena ns/alloc"
+		<< std::setw(12) << "Speed-up" << std::setw(16) << "High-water KB" << std::setw(12) << "Overflows" << std::endl;
+	for (unsigned int threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+	{
+		ThreadPool pool(threadCount);
+		FrameArenaDesc desc;
+		desc.frameCount = 2;
+		desc.threadCount = pool.GetThreadCount();
+		desc.threadArenaSize = jobBytes + jobCount * allocationsPerJob * 64;
+		FrameArena arena(desc);
+
+		std::vector<std::vector<unsigned char*>> pointers(jobCount);
+		double times[2];
+		for (int useArena = 0; useArena < 2; ++useArena)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (unsigned int frame = 0; frame < threadFrameCount; ++frame)
+			{
+				arena.BeginFrame();
+				pool.ParallelFor(jobCount, [&](unsigned int job, unsigned int threadIndex)
+				{
+					LinearArena* threadArena = useArena ? &arena.GetThreadArena(threadIndex) : nullptr;
+					AllocateTransient(jobAllocations[job], threadArena, static_cast<unsigned char>(frame), pointers[job]);
+				});
+			}
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			times[useArena] = elapsed.count() / (static_cast<double>(threadFrameCount) * jobCount * allocationsPerJob);
+		}
+
+		FrameArenaStatistics statistics = arena.GetStatistics();
+		std::cout << std::setw(10) << threadCount << std::fixed << std::setprecision(1) << std::setw(16) << times[0] * 1.0e9
+			<< std::setw(17) << times[1] * 1.0e9 << std::setprecision(2) << std::setw(12) << times[0] / times[1]
+			<< std::setw(16) << statistics.threadHighWaterMark / 1024 << std::setw(12) << statistics.overflows << std::endl;
+	}
+
+	return passed;
+}
+
+bool RunConstantBufferBenchmark()
+{
+	const unsigned int columns = 100;
+	const unsigned int rows = 100;
+	const unsigned int objectCount = columns * rows;
+	const unsigned int width = 1280;
+	const unsigned int height = 720;
+	const unsigned int frameCount = 5;
+
+	// The sample's rectangle, drawn once for each object, moved into its cell of a grid filling
+	// the screen by the object's world matrix.
+	Vertex vertices[] =
+	{
+		{ Float3(-0.5f, 0.5f, 0.0f), Float4(1.0f, 0.0f, 0.0f, 1.0f) },
+		{ Float3(0.5f, -0.5f, 0.0f), Float4(0.0f, 1.0f, 0.0f, 1.0f) },
+		{ Float3(-0.5f, -0.5f, 0.0f), Float4(0.0f, 0.0f, 1.0f, 1.0f) },
+		{ Float3(0.5f, 0.5f, 0.0f), Float4(1.0f, 1.0f, 1.0f, 1.0f) },
+	};
+	unsigned short indices[] = { 0, 1, 2, 3, 1, 0 };
+
+	std::vector<ObjectConstants> objects(objectCount);
+	const float cellWidth = 2.0f / columns;
+	const float cellHeight = 2.0f / rows;
+	for (unsigned int i = 0; i < objectCount; ++i)
+	{
+		objects[i].world = Float3x4(
+			Float4(cellWidth * 0.8f, 0.0f, 0.0f, -1.0f + (i % columns + 0.5f) * cellWidth),
+			Float4(0.0f, cellHeight * 0.8f, 0.0f, -1.0f + (i / columns + 0.5f) * cellHeight),
+			Float4(0.0f, 0.0f, 1.0f, 0.0f));
+	}
+
+	std::cout << "Constant buffer benchmark (" << objectCount << " objects at " << width << "x" << height
+		<< ", average of " << frameCount << " frames)" << std::endl;
+	std::cout << std::setw(14) << "Path" << std::setw(14) << "Writes/frame" << std::setw(16) << "Constants (ms)"
+		<< std::setw(14) << "Submit (ms)" << std::setw(14) << "Frame (ms)" << std::setw(16) << "Pixels drawn" << std::endl;
+
+	// Once binding ranges of one buffer holding every object, and once writing each object to a
+	// small buffer as it is bound, as without Direct3D 11.1.
+	std::vector<unsigned char> images[2];
+	for (int path = 0; path < 2; ++path)
+	{
+		SoftwareBackend backend(width, height);
+		backend.SetConstantBufferOffsetsSupported(path == 0);
+		StateFilterBackend filter(&backend);
+		PipelineStateCache cache(&filter);
+
+		ShaderDesc vertexShaderDesc = { L"../Resources/Shaders/vertexShader.hlsl", "main", "vs_5_0" };
+		ShaderDesc pixelShaderDesc = { L"../Resources/Shaders/pixelShader.hlsl", "main", "ps_5_0" };
+		BackendVertexShader* vertexShader = filter.CreateVertexShader(vertexShaderDesc);
+		BackendPixelShader* pixelShader = filter.CreatePixelShader(pixelShaderDesc);
+		BackendBuffer* vertexBuffer = filter.CreateVertexBuffer(vertices, sizeof(vertices));
+		BackendBuffer* indexBuffer = filter.CreateIndexBuffer(indices, sizeof(indices));
+
+		InputElementDesc inputDesc[Vertex::ELEMENT_COUNT];
+		Vertex::GetInputElements(inputDesc, 0);
+		PipelineStateDesc pipelineDesc;
+		pipelineDesc.vertexShader = vertexShader;
+		pipelineDesc.pixelShader = pixelShader;
+		pipelineDesc.inputElements = inputDesc;
+		pipelineDesc.inputElementCount = Vertex::ELEMENT_COUNT;
+		pipelineDesc.topology = PrimitiveTopology::TriangleList;
+		const PipelineState* pipelineState = vertexShader != nullptr && pixelShader != nullptr ? cache.GetPipelineState(pipelineDesc) : nullptr;
+
+		ConstantBufferManager constants(&filter, objectCount * OBJECT_CONSTANTS_STRIDE * 3);
+		if (pipelineState == nullptr || vertexBuffer == nullptr || indexBuffer == nullptr)
+		{
+			std::cout << "Failed to create the resources of the constant buffer benchmark" << std::endl;
+			delete indexBuffer;
+			delete vertexBuffer;
+			delete pixelShader;
+			delete vertexShader;
+			return false;
+		}
+
+		DrawQueue queue;
+		std::chrono::duration<double> constantsTime(0.0);
+		std::chrono::duration<double> submitTime(0.0);
+		std::chrono::duration<double> frameTime(0.0);
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			float clearColour[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			filter.ClearRenderTargetView(filter.GetBackBuffer(), clearColour);
+
+			FrameConstants frameConstants;
+			memset(&frameConstants, 0, sizeof(frameConstants));
+			constants.SetFrameConstants(frameConstants);
+			constants.SetViewConstants(ViewConstants());
+			unsigned int firstObject = constants.AddObjects(objects.data(), objectCount);
+			constants.WriteObjects();
+			std::chrono::high_resolution_clock::time_point written = std::chrono::high_resolution_clock::now();
+
+			queue.Clear();
+			for (unsigned int i = 0; i < objectCount; ++i)
+			{
+				QueuedDraw draw;
+				draw.pipelineState = pipelineState;
+				draw.vertexBuffer = vertexBuffer;
+				draw.vertexStride = Vertex::STRIDE;
+				draw.indexBuffer = indexBuffer;
+				draw.indexFormat = IndexFormat::UInt16;
+				draw.indexCount = 6;
+				draw.startIndexLocation = 0;
+				draw.baseVertexLocation = 0;
+				draw.constants = &constants;
+				draw.object = firstObject + i;
+				queue.Add(MakeOpaqueDrawKey(pipelineState->GetId(), 0, 0.5f), draw);
+			}
+			queue.Sort();
+			queue.Submit(&filter);
+			std::chrono::high_resolution_clock::time_point submitted = std::chrono::high_resolution_clock::now();
+
+			filter.Present();
+			constants.EndFrame(filter.InsertFence());
+			constantsTime += written - start;
+			submitTime += submitted - written;
+			frameTime += std::chrono::high_resolution_clock::now() - start;
+		}
+
+		const unsigned char* pixels = backend.GetBackBufferData();
+		images[path].assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		unsigned int pixelsDrawn = 0;
+		for (size_t i = 0; i < images[path].size(); i += 4)
+			pixelsDrawn += images[path][i] != 0 || images[path][i + 1] != 0 || images[path][i + 2] != 0 ? 1 : 0;
+
+		ConstantBufferStatistics statistics = constants.GetStatistics();
+		std::cout << std::setw(14) << (constants.UsesOffsets() ? "Offsets" : "Map/discard") << std::setw(14) << statistics.writes / frameCount
+			<< std::setw(16) << std::fixed << std::setprecision(3) << constantsTime.count() * 1000.0 / frameCount
+			<< std::setw(14) << submitTime.count() * 1000.0 / frameCount
+			<< std::setw(14) << frameTime.count() * 1000.0 / frameCount << std::setw(16) << pixelsDrawn << std::endl;
+
+		delete indexBuffer;
+		delete vertexBuffer;
+		delete pixelShader;
+		delete vertexShader;
+	}
+
+	std::cout << "  Images " << (images[0] == images[1] ? "match" : "differ") << std::endl;
+
+	return images[0] == images[1];
+}
+
+bool RunMeshFileBenchmark()
+{
+	const unsigned int gridSize = 512;
+	const unsigned int runCount = 3;
+	const char* objPath = "MeshFileBenchmark.obj";
+	const char* meshPath = "MeshFileBenchmark.mesh";
+
+	// A grid of size * size quads, with a colour for each vertex.
+	ImportedMesh grid;
+	for (unsigned int y = 0; y <= gridSize; ++y)
+	{
+		for (unsigned int x = 0; x <= gridSize; ++x)
+		{
+			float u = static_cast<float>(x) / gridSize;
+			float v = static_cast<float>(y) / gridSize;
+			grid.positions.push_back(Float3(u * 2.0f - 1.0f, 1.0f - v * 2.0f, 0.0f));
+			grid.colours.push_back(Float4(u, v, 1.0f - u, 1.0f));
+		}
+	}
+
+	for (unsigned int y = 0; y < gridSize; ++y)
+	{
+		for (unsigned int x = 0; x < gridSize; ++x)
+		{
+			unsigned int topLeft = y * (gridSize + 1) + x;
+			unsigned int bottomLeft = topLeft + gridSize + 1;
+			const unsigned int quad[] = { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft };
+			grid.indices.insert(grid.indices.end(), quad, quad + 6);
+		}
+	}
+
+	// The mesh file holds the vertices and indices in the same order as loading the OBJ file
+	// gives, so the two can be compared byte for byte.
+	IndexedMesh converted;
+	ConvertImportedMesh(grid, converted);
+	std::vector<unsigned char> indexData;
+	InputElementDesc elements[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(elements, 0);
+
+	MeshFileDesc desc;
+	desc.vertices = converted.vertices.data();
+	desc.vertexCount = converted.vertexCount;
+	desc.vertexStride = converted.vertexStride;
+	desc.elements = elements;
+	desc.elementCount = Vertex::ELEMENT_COUNT;
+	desc.indexFormat = PackIndices(converted.indices, converted.vertexCount, indexData);
+	desc.indices = indexData.data();
+	desc.indexCount = static_cast<unsigned int>(converted.indices.size());
+	desc.lods = nullptr;
+	desc.lodCount = 0;
+	if (!ExportObj(objPath, grid) || !WriteMeshFile(meshPath, desc))
+	{
+		std::cout << "Failed to write the files of the mesh file benchmark" << std::endl;
+		remove(objPath);
+		remove(meshPath);
+		return false;
+	}
+
+	// Both are loaded into buffers of the software backend, which copies the data like a
+	// driver uploading it. The best of a few runs is kept.
+	SoftwareBackend backend(64, 64);
+	double objLoad = 1.0e9;
+	double objUpload = 1.0e9;
+	double meshLoad = 1.0e9;
+	double meshUpload = 1.0e9;
+	bool loaded = true;
+	bool dataMatches = true;
+	size_t objSize = 0;
+	size_t meshSize = 0;
+	MeshBounds bounds;
+	for (unsigned int run = 0; run < runCount; ++run)
+	{
+		// Parsing the text, converting it to the vertex format and packing the indices.
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		ImportedMesh imported;
+		loaded = ImportObj(objPath, imported) && loaded;
+		IndexedMesh mesh;
+		ConvertImportedMesh(imported, mesh);
+		std::vector<unsigned char> objIndexData;
+		PackIndices(mesh.indices, mesh.vertexCount, objIndexData);
+		std::chrono::high_resolution_clock::time_point parsed = std::chrono::high_resolution_clock::now();
+		BackendBuffer* vertexBuffer = backend.CreateVertexBuffer(mesh.vertices.data(), static_cast<unsigned int>(mesh.vertices.size()));
+		BackendBuffer* indexBuffer = backend.CreateIndexBuffer(objIndexData.data(), static_cast<unsigned int>(objIndexData.size()));
+		std::chrono::high_resolution_clock::time_point uploaded = std::chrono::high_resolution_clock::now();
+		objLoad = std::min(objLoad, std::chrono::duration<double>(parsed - start).count());
+		objUpload = std::min(objUpload, std::chrono::duration<double>(uploaded - parsed).count());
+		delete indexBuffer;
+		delete vertexBuffer;
+
+		// Mapping the file, and creating the buffers straight from the mapping.
+		start = std::chrono::high_resolution_clock::now();
+		MeshFile file;
+		loaded = file.Open(meshPath) && loaded;
+		parsed = std::chrono::high_resolution_clock::now();
+		vertexBuffer = backend.CreateVertexBuffer(file.GetVertexData(), file.GetVertexDataSize());
+		indexBuffer = backend.CreateIndexBuffer(file.GetIndexData(), file.GetIndexDataSize());
+		uploaded = std::chrono::high_resolution_clock::now();
+		meshLoad = std::min(meshLoad, std::chrono::duration<double>(parsed - start).count());
+		meshUpload = std::min(meshUpload, std::chrono::duration<double>(uploaded - parsed).count());
+		delete indexBuffer;
+		delete vertexBuffer;
+
+		dataMatches = dataMatches && file.IsOpen() && file.GetVertexDataSize() == mesh.vertices.size() &&
+			file.GetIndexDataSize() == objIndexData.size() &&
+			memcmp(file.GetVertexData(), mesh.vertices.data(), mesh.vertices.size()) == 0 &&
+			memcmp(file.GetIndexData(), objIndexData.data(), objIndexData.size()) == 0;
+		bounds = file.GetBounds();
+	}
+
+	MappedFile objFile;
+	MappedFile meshFile;
+	objSize = objFile.Open(objPath) ? objFile.GetSize() : 0;
+	meshSize = meshFile.Open(meshPath) ? meshFile.GetSize() : 0;
+	objFile.Close();
+	meshFile.Close();
+	remove(objPath);
+	remove(meshPath);
+
+	std::cout << "Mesh file benchmark (" << gridSize << "x" << gridSize << " quad grid, " << grid.positions.size() << " vertices, "
+		<< grid.indices.size() / 3 << " triangles, best of " << runCount << " runs)" << std::endl;
+	std::cout << "  The files are in the operating system's file cache, so this measures parsing and copying rather than the disk." << std::endl;
+	std::cout << std::setw(10) << "Format" << std::setw(12) << "Size (MB)" << std::setw(12) << "Load (ms)"
+		<< std::setw(14) << "Upload (ms)" << std::setw(13) << "Total (ms)" << std::setw(10) << "MB/s" << std::endl;
+
+	const char* names[] = { "OBJ", "Mesh file" };
+	const size_t sizes[] = { objSize, meshSize };
+	const double loads[] = { objLoad, meshLoad };
+	const double uploads[] = { objUpload, meshUpload };
+	for (int i = 0; i < 2; ++i)
+	{
+		std::cout << std::setw(10) << names[i] << std::setw(12) << std::fixed << std::setprecision(2) << sizes[i] / 1.0e6
+			<< std::setw(12) << std::setprecision(3) << loads[i] * 1000.0 << std::setw(14) << uploads[i] * 1000.0
+			<< std::setw(13) << (loads[i] + uploads[i]) * 1000.0
+			<< std::setw(10) << std::setprecision(0) << sizes[i] / 1.0e6 / (loads[i] + uploads[i]) << std::endl;
+	}
+
+	std::cout << std::setprecision(3);
+	std::cout << "  Bounds: (" << bounds.min.x << ", " << bounds.min.y << ", " << bounds.min.z << ") to ("
+		<< bounds.max.x << ", " << bounds.max.y << ", " << bounds.max.z << ")" << std::endl;
+	std::cout << "  Loaded: " << (loaded ? "yes" : "no") << ", data " << (dataMatches ? "matches" : "differs") << std::endl;
+
+	return loaded && dataMatches;
+}
+
+bool RunImportBenchmark()
+{
+	const unsigned int gridSize = 1024;
+	const unsigned int floatCount = 1000000;
+	const unsigned int maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	// A grid of size * size quads. The colours are whole bytes, so the PLY files, which store
+	// them as bytes, give back the same floats.
+	ImportedMesh grid;
+	for (unsigned int y = 0; y <= gridSize; ++y)
+	{
+		for (unsigned int x = 0; x <= gridSize; ++x)
+		{
+			float u = static_cast<float>(x) / gridSize;
+			float v = static_cast<float>(y) / gridSize;
+			grid.positions.push_back(Float3(u * 2.0f - 1.0f, 1.0f - v * 2.0f, u * v));
+			grid.colours.push_back(Float4((x % 256) / 255.0f, (y % 256) / 255.0f, ((x + y) % 256) / 255.0f, 1.0f));
+		}
+	}
+
+	for (unsigned int y = 0; y < gridSize; ++y)
+	{
+		for (unsigned int x = 0; x < gridSize; ++x)
+		{
+			unsigned int topLeft = y * (gridSize + 1) + x;
+			unsigned int bottomLeft = topLeft + gridSize + 1;
+			const unsigned int quad[] = { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft };
+			grid.indices.insert(grid.indices.end(), quad, quad + 6);
+		}
+	}
+
+	struct ImportFile
+	{
+		const char* name;
+		const char* path;
+		bool (*import)(const char* path, ImportedMesh& mesh, ThreadPool* pool);
+	};
+	const ImportFile files[] =
+	{
+		{ "OBJ", "ImportBenchmark.obj", ImportObj },
+		{ "PLY ASCII", "ImportBenchmark.ascii.ply", ImportPly },
+		{ "PLY binary", "ImportBenchmark.binary.ply", ImportPly },
+	};
+
+	if (!ExportObj(files[0].path, grid) || !ExportPly(files[1].path, grid, false) || !ExportPly(files[2].path, grid, true))
+	{
+		std::cout << "Failed to write the files of the import benchmark" << std::endl;
+		for (const ImportFile& file : files)
+			remove(file.path);
+		return false;
+	}
+
+	std::cout << "Import benchmark (" << gridSize << "x" << gridSize << " quad grid, " << grid.positions.size() << " vertices, "
+		<< grid.indices.size() / 3 << " triangles)" << std::endl;
+	std::cout << std::setw(12) << "Format" << std::setw(10) << "Threads" << std::setw(12) << "Size (MB)"
+		<< std::setw(14) << "Import (ms)" << std::setw(10) << "MB/s" << std::setw(12) << "Mverts/s" << std::setw(10) << "Mesh" << std::endl;
+
+	bool passed = true;
+	for (const ImportFile& file : files)
+	{
+		MappedFile mapped;
+		const size_t size = mapped.Open(file.path) ? mapped.GetSize() : 0;
+		mapped.Close();
+
+		const unsigned int threadCounts[] = { 1, maxThreadCount };
+		for (unsigned int t = 0; t < (maxThreadCount > 1 ? 2u : 1u); ++t)
+		{
+			ThreadPool pool(threadCounts[t]);
+			ImportedMesh mesh;
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			bool imported = file.import(file.path, mesh, &pool);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			bool matches = imported && mesh.positions.size() == grid.positions.size() && mesh.indices == grid.indices &&
+				memcmp(mesh.positions.data(), grid.positions.data(), grid.positions.size() * sizeof(Float3)) == 0 &&
+				memcmp(mesh.colours.data(), grid.colours.data(), grid.colours.size() * sizeof(Float4)) == 0;
+
+			std::cout << std::setw(12) << file.name << std::setw(10) << threadCounts[t]
+				<< std::setw(12) << std::fixed << std::setprecision(2) << size / 1.0e6
+				<< std::setw(14) << std::setprecision(1) << elapsed.count() * 1000.0
+				<< std::setw(10) << std::setprecision(0) << size / 1.0e6 / elapsed.count()
+				<< std::setw(12) << std::setprecision(2) << grid.positions.size() / 1.0e6 / elapsed.count()
+				<< std::setw(10) << (!imported ? "failed" : matches ? "matches" : "differs") << std::endl;
+			passed = passed && matches;
+		}
+	}
+
+	// Welding a mesh where every triangle has its own vertices, the way many exporters and
+	// scanners write them.
+	ImportedMesh unwelded;
+	for (unsigned int index : grid.indices)
+	{
+		unwelded.indices.push_back(static_cast<unsigned int>(unwelded.positions.size()));
+		unwelded.positions.push_back(grid.positions[index]);
+		unwelded.colours.push_back(grid.colours[index]);
+	}
+	const size_t unweldedCount = unwelded.positions.size();
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	WeldImportedMesh(unwelded);
+	std::chrono::duration<double> weldTime = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "  Weld: " << unweldedCount << " vertices to " << unwelded.positions.size() << " in "
+		<< std::setprecision(1) << weldTime.count() * 1000.0 << " ms" << std::endl;
+
+	// Numbers of all sizes, written the way the exporters write them, parsed by ParseFloat()
+	// and by strtof.
+	std::ostringstream numbers;
+	numbers << std::setprecision(9);
+	unsigned int random = 12345;
+	for (unsigned int i = 0; i < floatCount; ++i)
+	{
+		random = random * 1664525u + 1013904223u;
+		float mantissa = static_cast<float>(random >> 8) / (1u << 24);
+		numbers << (random & 1 ? -mantissa : mantissa) * powf(10.0f, static_cast<float>(static_cast<int>(random % 13) - 6)) << " ";
+	}
+	const std::string text = numbers.str();
+
+	std::vector<float> fast(floatCount);
+	std::vector<float> reference(floatCount);
+	start = std::chrono::high_resolution_clock::now();
+	const char* cursor = text.c_str();
+	const char* end = cursor + text.size();
+	for (unsigned int i = 0; i < floatCount; ++i)
+	{
+		ParseFloat(cursor, end, fast[i]);
+		++cursor;
+	}
+	std::chrono::duration<double> fastTime = std::chrono::high_resolution_clock::now() - start;
+
+	start = std::chrono::high_resolution_clock::now();
+	cursor = text.c_str();
+	for (unsigned int i = 0; i < floatCount; ++i)
+	{
+		char* next = nullptr;
+		reference[i] = strtof(cursor, &next);
+		cursor = next;
+	}
+	std::chrono::duration<double> referenceTime = std::chrono::high_resolution_clock::now() - start;
+
+	unsigned int differences = 0;
+	for (unsigned int i = 0; i < floatCount; ++i)
+		differences += memcmp(&fast[i], &reference[i], sizeof(float)) != 0 ? 1 : 0;
+
+	std::cout << "  Floats: ParseFloat " << std::setprecision(1) << fastTime.count() * 1.0e9 / floatCount << " ns, strtof "
+		<< referenceTime.count() * 1.0e9 / floatCount << " ns per number, " << differences << " of " << floatCount << " differ" << std::endl;
+
+	for (const ImportFile& file : files)
+		remove(file.path);
+
+	return passed && differences == 0;
+}
+
+bool RunLodBenchmark()
+{
+	const unsigned int gridSize = 256;
+	const unsigned int columns = 8;
+	const unsigned int rows = 5;
+	const unsigned int objectCount = columns * rows;
+	const unsigned int width = 1280;
+	const unsigned int height = 720;
+	const unsigned int frameCount = 3;
+	const float fovY = 1.0471976f;	// 60 degrees.
+	const float nearestDistance = 9.0f;
+	const float farthestDistance = 288.0f;
+	const float maxPixelError = 1.0f;
+
+	// A bumpy grid of size * size quads two units across, with smoothly changing colours.
+	ImportedMesh grid;
+	for (unsigned int y = 0; y <= gridSize; ++y)
+	{
+		for (unsigned int x = 0; x <= gridSize; ++x)
+		{
+			float u = static_cast<float>(x) / gridSize;
+			float v = static_cast<float>(y) / gridSize;
+			float bump = 0.15f * sinf(u * 9.0f) * cosf(v * 7.0f);
+			grid.positions.push_back(Float3(u * 2.0f - 1.0f, 1.0f - v * 2.0f, -bump));
+			grid.colours.push_back(Float4(u, v, 0.5f + bump * 3.0f, 1.0f));
+		}
+	}
+
+	for (unsigned int y = 0; y < gridSize; ++y)
+	{
+		for (unsigned int x = 0; x < gridSize; ++x)
+		{
+			unsigned int topLeft = y * (gridSize + 1) + x;
+			unsigned int bottomLeft = topLeft + gridSize + 1;
+			const unsigned int quad[] = { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft };
+			grid.indices.insert(grid.indices.end(), quad, quad + 6);
+		}
+	}
+
+	IndexedMesh mesh;
+	ConvertImportedMesh(grid, mesh);
+	OptimiseVertexCache(mesh.indices, mesh.vertexCount);
+	OptimiseVertexFetch(mesh);
+
+	InputElementDesc inputDesc[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(inputDesc, 0);
+	std::vector<unsigned int> indices;
+	MeshLod lods[MESH_MAX_LODS];
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	unsigned int lodCount = BuildLodChain(mesh, inputDesc, Vertex::ELEMENT_COUNT, LodChainDesc(), indices, lods);
+	std::chrono::duration<double> buildTime = std::chrono::high_resolution_clock::now() - start;
+
+	std::cout << "LOD benchmark (" << gridSize << "x" << gridSize << " quad grid, " << mesh.vertexCount << " vertices, "
+		<< mesh.indices.size() / 3 << " triangles)" << std::endl;
+	std::cout << "  Built " << lodCount << " levels in " << std::fixed << std::setprecision(1) << buildTime.count() * 1000.0 << " ms" << std::endl;
+	std::cout << std::setw(6) << "LOD" << std::setw(12) << "Triangles" << std::setw(11) << "Vertices"
+		<< std::setw(18) << "Error (% size)" << std::setw(15) << "Used from" << std::endl;
+	for (unsigned int i = 0; i < lodCount; ++i)
+	{
+		// The error is shown compared with the grid's size of two units, along with the distance
+		// from which it covers at most maxPixelError pixels.
+		float distance = lods[i].error * CalculatePixelsPerUnit(1.0f, fovY, height) / maxPixelError;
+		std::cout << std::setw(6) << i << std::setw(12) << lods[i].indexCount / 3 << std::setw(11) << lods[i].vertexCount
+			<< std::setw(18) << std::setprecision(3) << lods[i].error / 2.0f * 100.0f << std::setw(15) << std::setprecision(1) << distance << std::endl;
+	}
+
+	// The objects are placed in a grid of cells on the screen, each further away than the one
+	// before, and drawn with a perspective projection. Looking along z, with x to the right and
+	// y up.
+	const float aspect = static_cast<float>(width) / height;
+	const float tanHalfFov = tanf(fovY * 0.5f);
+	const float nearPlane = 0.5f;
+	const float farPlane = 1000.0f;
+	ViewConstants view;
+	view.viewProjection = Float4x4(
+		Float4(1.0f / (aspect * tanHalfFov), 0.0f, 0.0f, 0.0f),
+		Float4(0.0f, 1.0f / tanHalfFov, 0.0f, 0.0f),
+		Float4(0.0f, 0.0f, farPlane / (farPlane - nearPlane), -nearPlane * farPlane / (farPlane - nearPlane)),
+		Float4(0.0f, 0.0f, 1.0f, 0.0f));
+
+	std::vector<ObjectConstants> objects(objectCount);
+	std::vector<float> distances(objectCount);
+	for (unsigned int i = 0; i < objectCount; ++i)
+	{
+		float distance = nearestDistance * powf(farthestDistance / nearestDistance, static_cast<float>(i) / (objectCount - 1));
+		float x = (-1.0f + (i % columns + 0.5f) * 2.0f / columns) * distance * tanHalfFov * aspect;
+		float y = (1.0f - (i / columns + 0.5f) * 2.0f / rows) * distance * tanHalfFov;
+		objects[i].world = Float3x4(
+			Float4(1.0f, 0.0f, 0.0f, x),
+			Float4(0.0f, 1.0f, 0.0f, y),
+			Float4(0.0f, 0.0f, 1.0f, distance));
+		distances[i] = distance;
+	}
+
+	std::vector<unsigned char> indexData;
+	IndexFormat indexFormat = PackIndices(indices, mesh.vertexCount, indexData);
+
+	std::cout << "  Drawing " << objectCount << " copies at " << width << "x" << height << " from " << std::setprecision(0)
+		<< nearestDistance << " to " << farthestDistance << " units away, average of " << frameCount << " frames" << std::endl;
+	std::cout << std::setw(8) << "Path" << std::setw(17) << "Vertices/frame" << std::setw(18) << "Triangles/frame"
+		<< std::setw(14) << "Frame (ms)" << std::setw(24) << "Far half tris/object" << std::endl;
+
+	// Once drawing the full mesh for every object, and once picking each object's level from how
+	// many pixels its error would cover.
+	std::vector<unsigned char> images[2];
+	unsigned long long farTriangles[2] = { 0, 0 };
+	for (int path = 0; path < 2; ++path)
+	{
+		SoftwareBackend backend(width, height);
+		StateFilterBackend filter(&backend);
+		PipelineStateCache cache(&filter);
+
+		ShaderDesc vertexShaderDesc = { L"../Resources/Shaders/vertexShader.hlsl", "main", "vs_5_0" };
+		ShaderDesc pixelShaderDesc = { L"../Resources/Shaders/pixelShader.hlsl", "main", "ps_5_0" };
+		BackendVertexShader* vertexShader = filter.CreateVertexShader(vertexShaderDesc);
+		BackendPixelShader* pixelShader = filter.CreatePixelShader(pixelShaderDesc);
+		BackendBuffer* vertexBuffer = filter.CreateVertexBuffer(mesh.vertices.data(), static_cast<unsigned int>(mesh.vertices.size()));
+		BackendBuffer* indexBuffer = filter.CreateIndexBuffer(indexData.data(), static_cast<unsigned int>(indexData.size()));
+
+		PipelineStateDesc pipelineDesc;
+		pipelineDesc.vertexShader = vertexShader;
+		pipelineDesc.pixelShader = pixelShader;
+		pipelineDesc.inputElements = inputDesc;
+		pipelineDesc.inputElementCount = Vertex::ELEMENT_COUNT;
+		pipelineDesc.topology = PrimitiveTopology::TriangleList;
+		const PipelineState* pipelineState = vertexShader != nullptr && pixelShader != nullptr ? cache.GetPipelineState(pipelineDesc) : nullptr;
+
+		ConstantBufferManager constants(&filter, objectCount * OBJECT_CONSTANTS_STRIDE * 3);
+		if (pipelineState == nullptr || vertexBuffer == nullptr || indexBuffer == nullptr)
+		{
+			std::cout << "Failed to create the resources of the LOD benchmark" << std::endl;
+			delete indexBuffer;
+			delete vertexBuffer;
+			delete pixelShader;
+			delete vertexShader;
+			return false;
+		}
+
+		DrawQueue queue;
+		backend.ResetStatistics();
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			float clearColour[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			filter.ClearRenderTargetView(filter.GetBackBuffer(), clearColour);
+
+			FrameConstants frameConstants;
+			memset(&frameConstants, 0, sizeof(frameConstants));
+			constants.SetFrameConstants(frameConstants);
+			constants.SetViewConstants(view);
+			unsigned int firstObject = constants.AddObjects(objects.data(), objectCount);
+			constants.WriteObjects();
+
+			queue.Clear();
+			for (unsigned int i = 0; i < objectCount; ++i)
+			{
+				// The mesh's nearest point is at most its bounding radius (the grid's half
+				// diagonal) closer than its centre.
+				float nearest = distances[i] - 1.42f;
+				unsigned int lod = path == 0 ? 0 : SelectLod(lods, lodCount, CalculatePixelsPerUnit(nearest, fovY, height), maxPixelError);
+				if (i >= objectCount / 2)
+					farTriangles[path] += lods[lod].indexCount / 3;
+
+				QueuedDraw draw;
+				draw.pipelineState = pipelineState;
+				draw.vertexBuffer = vertexBuffer;
+				draw.vertexStride = Vertex::STRIDE;
+				draw.indexBuffer = indexBuffer;
+				draw.indexFormat = indexFormat;
+				draw.indexCount = lods[lod].indexCount;
+				draw.startIndexLocation = lods[lod].firstIndex;
+				draw.baseVertexLocation = 0;
+				draw.constants = &constants;
+				draw.object = firstObject + i;
+				queue.Add(MakeOpaqueDrawKey(pipelineState->GetId(), 0, distances[i] / farPlane), draw);
+			}
+			queue.Sort();
+			queue.Submit(&filter);
+
+			filter.Present();
+			constants.EndFrame(filter.InsertFence());
+		}
+		std::chrono::duration<double> frameTime = std::chrono::high_resolution_clock::now() - start;
+
+		const unsigned char* pixels = backend.GetBackBufferData();
+		images[path].assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+		const SoftwareStatistics& statistics = backend.GetStatistics();
+		std::cout << std::setw(8) << (path == 0 ? "Full" : "LODs") << std::setw(17) << statistics.verticesShaded / frameCount
+			<< std::setw(18) << statistics.trianglesRasterised / frameCount
+			<< std::setw(14) << std::setprecision(1) << frameTime.count() * 1000.0 / frameCount
+			<< std::setw(24) << farTriangles[path] / frameCount / (objectCount - objectCount / 2) << std::endl;
+
+		delete indexBuffer;
+		delete vertexBuffer;
+		delete pixelShader;
+		delete vertexShader;
+	}
+
+	// How much the levels of detail change what ends up on the screen.
+	unsigned int pixelsDrawn = 0;
+	unsigned int pixelsDiffering = 0;
+	for (size_t i = 0; i < images[0].size(); i += 4)
+	{
+		int difference = 0;
+		for (int c = 0; c < 3; ++c)
+			difference = std::max(difference, abs(images[0][i + c] - images[1][i + c]));
+		pixelsDrawn += images[0][i] != 0 || images[0][i + 1] != 0 || images[0][i + 2] != 0 ? 1 : 0;
+		pixelsDiffering += difference > 8 ? 1 : 0;
+	}
+
+	std::cout << "  Far objects draw " << std::setprecision(1) << static_cast<double>(farTriangles[0]) / std::max(farTriangles[1], 1ull)
+		<< " times fewer triangles, " << pixelsDiffering << " of " << pixelsDrawn << " pixels drawn differ by more than 8/255" << std::endl;
+
+	return true;
+}
+
+bool RunClusterBenchmark()
+{
+	const unsigned int segments = 192;
+	const unsigned int rings = 96;
+	const unsigned int columns = 9;
+	const unsigned int rows = 5;
+	const unsigned int layers = 2;
+	const unsigned int objectCount = columns * rows * layers;
+	const unsigned int width = 1280;
+	const unsigned int height = 720;
+	const unsigned int frameCount = 2;
+	const float fovY = 1.0471976f;	// 60 degrees.
+	const float spacing = 2.5f;
+	const float nearestDistance = 6.0f;
+	const float layerDistance = 5.0f;
+
+	// A bumpy sphere with a radius of about one, with smoothly changing colours. Going along a
+	// ring moves right and going down the rings moves down when seen from outside, so the
+	// triangles are wound the same way as the grids of the other benchmarks and face out.
+	const float pi = 3.14159265f;
+	ImportedMesh sphere;
+	for (unsigned int y = 0; y <= rings; ++y)
+	{
+		for (unsigned int x = 0; x <= segments; ++x)
+		{
+			float u = static_cast<float>(x) / segments;
+			float v = static_cast<float>(y) / rings;
+			float theta = v * pi;
+			float phi = u * 2.0f * pi;
+			float bump = 0.04f * sinf(theta * 12.0f) * cosf(phi * 10.0f);
+			float radius = 1.0f + bump;
+			sphere.positions.push_back(Float3(radius * sinf(theta) * cosf(phi), radius * cosf(theta), radius * sinf(theta) * sinf(phi)));
+			sphere.colours.push_back(Float4(u, v, 0.5f + bump * 10.0f, 1.0f));
+		}
+	}
+
+	for (unsigned int y = 0; y < rings; ++y)
+	{
+		for (unsigned int x = 0; x < segments; ++x)
+		{
+			unsigned int topLeft = y * (segments + 1) + x;
+			unsigned int bottomLeft = topLeft + segments + 1;
+			const unsigned int quad[] = { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft };
+			sphere.indices.insert(sphere.indices.end(), quad, quad + 6);
+		}
+	}
+
+	IndexedMesh mesh;
+	ConvertImportedMesh(sphere, mesh);
+	OptimiseVertexCache(mesh.indices, mesh.vertexCount);
+	OptimiseVertexFetch(mesh);
+
+	InputElementDesc inputDesc[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(inputDesc, 0);
+	std::vector<MeshCluster> clusters;
+	std::vector<unsigned int> clusterIndices;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	BuildMeshClusters(mesh, inputDesc, Vertex::ELEMENT_COUNT, mesh.indices.data(), static_cast<unsigned int>(mesh.indices.size()),
+		CLUSTER_MAX_VERTICES, CLUSTER_MAX_TRIANGLES, clusters, clusterIndices);
+	std::chrono::duration<double> buildTime = std::chrono::high_resolution_clock::now() - start;
+	const unsigned int clusterCount = static_cast<unsigned int>(clusters.size());
+
+	float averageCutoff = 0.0f;
+	for (const MeshCluster& cluster : clusters)
+		averageCutoff += cluster.coneCutoff;
+
+	std::cout << "Cluster benchmark (sphere of " << mesh.vertexCount << " vertices, " << mesh.indices.size() / 3 << " triangles)" << std::endl;
+	std::cout << "  Built " << clusterCount << " clusters of at most " << CLUSTER_MAX_VERTICES << " vertices and "
+		<< CLUSTER_MAX_TRIANGLES << " triangles in " << std::fixed << std::setprecision(1) << buildTime.count() * 1000.0
+		<< " ms, " << static_cast<double>(clusterIndices.size() / 3) / std::max(clusterCount, 1u) << " triangles per cluster, average cone cutoff "
+		<< std::setprecision(3) << averageCutoff / std::max(clusterCount, 1u) << std::endl;
+
+	// The spheres are placed in two layers of a grid wider and taller than the screen, looking
+	// along z with x to the right and y up, so some are partly or entirely off the screen and
+	// every one shows the eye only its front half.
+	const float aspect = static_cast<float>(width) / height;
+	const float tanHalfFov = tanf(fovY * 0.5f);
+	const float nearPlane = 0.5f;
+	const float farPlane = 100.0f;
+	ViewConstants view;
+	view.viewProjection = Float4x4(
+		Float4(1.0f / (aspect * tanHalfFov), 0.0f, 0.0f, 0.0f),
+		Float4(0.0f, 1.0f / tanHalfFov, 0.0f, 0.0f),
+		Float4(0.0f, 0.0f, farPlane / (farPlane - nearPlane), -nearPlane * farPlane / (farPlane - nearPlane)),
+		Float4(0.0f, 0.0f, 1.0f, 0.0f));
+
+	std::vector<ObjectConstants> objects(objectCount);
+	for (unsigned int i = 0; i < objectCount; ++i)
+	{
+		unsigned int column = i % columns;
+		unsigned int row = i / columns % rows;
+		unsigned int layer = i / (columns * rows);
+		float x = (column - (columns - 1) * 0.5f) * spacing + layer * spacing * 0.5f;
+		float y = (row - (rows - 1) * 0.5f) * spacing + layer * spacing * 0.5f;
+		objects[i].world = Float3x4(
+			Float4(1.0f, 0.0f, 0.0f, x),
+			Float4(0.0f, 1.0f, 0.0f, y),
+			Float4(0.0f, 0.0f, 1.0f, nearestDistance + layer * layerDistance));
+	}
+
+	std::vector<unsigned char> indexData;
+	IndexFormat indexFormat = PackIndices(clusterIndices, mesh.vertexCount, indexData);
+
+	std::cout << "  Drawing " << objectCount << " copies at " << width << "x" << height << ", average of " << frameCount << " frames" << std::endl;
+	std::cout << std::setw(10) << "Path" << std::setw(18) << "Triangles/frame" << std::setw(17) << "Vertices/frame"
+		<< std::setw(17) << "Rasterised/frame" << std::setw(11) << "Cull (ms)" << std::setw(12) << "Frame (ms)" << std::endl;
+
+	// Once drawing every cluster of every object from a static index buffer, and once writing
+	// the indices of the clusters that survive culling to a dynamic buffer each frame. Both draw
+	// the triangles in the same order, so the images should be the same.
+	std::vector<unsigned char> images[2];
+	ClusterCullStatistics cullStatistics;
+	memset(&cullStatistics, 0, sizeof(cullStatistics));
+	for (int path = 0; path < 2; ++path)
+	{
+		SoftwareBackend backend(width, height);
+		StateFilterBackend filter(&backend);
+		PipelineStateCache cache(&filter);
+
+		ShaderDesc vertexShaderDesc = { L"../Resources/Shaders/vertexShader.hlsl", "main", "vs_5_0" };
+		ShaderDesc pixelShaderDesc = { L"../Resources/Shaders/pixelShader.hlsl", "main", "ps_5_0" };
+		BackendVertexShader* vertexShader = filter.CreateVertexShader(vertexShaderDesc);
+		BackendPixelShader* pixelShader = filter.CreatePixelShader(pixelShaderDesc);
+		BackendBuffer* vertexBuffer = filter.CreateVertexBuffer(mesh.vertices.data(), static_cast<unsigned int>(mesh.vertices.size()));
+		BackendBuffer* indexBuffer = filter.CreateIndexBuffer(indexData.data(), static_cast<unsigned int>(indexData.size()));
+
+		PipelineStateDesc pipelineDesc;
+		pipelineDesc.vertexShader = vertexShader;
+		pipelineDesc.pixelShader = pixelShader;
+		pipelineDesc.inputElements = inputDesc;
+		pipelineDesc.inputElementCount = Vertex::ELEMENT_COUNT;
+		pipelineDesc.topology = PrimitiveTopology::TriangleList;
+		const PipelineState* pipelineState = vertexShader != nullptr && pixelShader != nullptr ? cache.GetPipelineState(pipelineDesc) : nullptr;
+
+		// Room for a frame of every index, for when nothing is culled.
+		ConstantBufferManager constants(&filter, objectCount * OBJECT_CONSTANTS_STRIDE * 3);
+		DynamicBuffer visibleBuffer(&filter, static_cast<unsigned int>(clusterIndices.size() * sizeof(unsigned int)) * objectCount);
+		if (pipelineState == nullptr || vertexBuffer == nullptr || indexBuffer == nullptr || visibleBuffer.GetBuffer() == nullptr)
+		{
+			std::cout << "Failed to create the resources of the cluster benchmark" << std::endl;
+			delete indexBuffer;
+			delete vertexBuffer;
+			delete pixelShader;
+			delete vertexShader;
+			return false;
+		}
+
+		DrawQueue queue;
+		std::vector<unsigned int> visibleIndices;
+		unsigned long long trianglesSubmitted = 0;
+		std::chrono::duration<double> cullTime(0.0);
+		backend.ResetStatistics();
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int frame = 0; frame < frameCount; ++frame)
+		{
+			float clearColour[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			filter.ClearRenderTargetView(filter.GetBackBuffer(), clearColour);
+
+			FrameConstants frameConstants;
+			memset(&frameConstants, 0, sizeof(frameConstants));
+			constants.SetFrameConstants(frameConstants);
+			constants.SetViewConstants(view);
+			unsigned int firstObject = constants.AddObjects(objects.data(), objectCount);
+			constants.WriteObjects();
+
+			queue.Clear();
+			for (unsigned int i = 0; i < objectCount; ++i)
+			{
+				QueuedDraw draw;
+				draw.pipelineState = pipelineState;
+				draw.vertexBuffer = vertexBuffer;
+				draw.vertexStride = Vertex::STRIDE;
+				draw.indexBuffer = indexBuffer;
+				draw.indexFormat = indexFormat;
+				draw.indexCount = static_cast<unsigned int>(clusterIndices.size());
+				draw.startIndexLocation = 0;
+				draw.baseVertexLocation = 0;
+				draw.constants = &constants;
+				draw.object = firstObject + i;
+
+				if (path == 1)
+				{
+					// The worlds only move the spheres, so the eye is at minus the translation in a
+					// sphere's own space.
+					std::chrono::high_resolution_clock::time_point cullStart = std::chrono::high_resolution_clock::now();
+					const Float3x4& world = objects[i].world;
+					Frustum frustum;
+					ExtractFrustum(view.viewProjection, world, frustum);
+					Float3 eyePosition(-world.rows[0].w, -world.rows[1].w, -world.rows[2].w);
+					visibleIndices.clear();
+					unsigned int indexCount = CullMeshClusters(clusters.data(), clusterCount, clusterIndices.data(), frustum,
+						eyePosition, visibleIndices, cullStatistics);
+
+					unsigned int offset = 0;
+					bool written = indexCount > 0 &&
+						visibleBuffer.Write(visibleIndices.data(), indexCount * sizeof(unsigned int), sizeof(unsigned int), offset);
+					cullTime += std::chrono::high_resolution_clock::now() - cullStart;
+					if (!written)
+						continue;
+
+					draw.indexBuffer = visibleBuffer.GetBuffer();
+					draw.indexFormat = IndexFormat::UInt32;
+					draw.indexCount = indexCount;
+					draw.startIndexLocation = offset / sizeof(unsigned int);
+				}
+
+				trianglesSubmitted += draw.indexCount / 3;
+				queue.Add(MakeOpaqueDrawKey(pipelineState->GetId(), 0, objects[i].world.rows[2].w / farPlane), draw);
+			}
+			queue.Sort();
+			queue.Submit(&filter);
+
+			filter.Present();
+			unsigned long long fence = filter.InsertFence();
+			constants.EndFrame(fence);
+			visibleBuffer.EndFrame(fence);
+		}
+		std::chrono::duration<double> frameTime = std::chrono::high_resolution_clock::now() - start;
+
+		const unsigned char* pixels = backend.GetBackBufferData();
+		images[path].assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+		const SoftwareStatistics& statistics = backend.GetStatistics();
+		std::cout << std::setw(10) << (path == 0 ? "Full" : "Clusters") << std::setw(18) << trianglesSubmitted / frameCount
+			<< std::setw(17) << statistics.verticesShaded / frameCount << std::setw(17) << statistics.trianglesRasterised / frameCount
+			<< std::setw(11) << std::setprecision(2) << cullTime.count() * 1000.0 / frameCount
+			<< std::setw(12) << std::setprecision(1) << frameTime.count() * 1000.0 / frameCount << std::endl;
+
+		delete indexBuffer;
+		delete vertexBuffer;
+		delete pixelShader;
+		delete vertexShader;
+	}
+
+	unsigned int pixelsDrawn = 0;
+	unsigned int pixelsDiffering = 0;
+	for (size_t i = 0; i < images[0].size(); i += 4)
+	{
+		pixelsDrawn += images[0][i] != 0 || images[0][i + 1] != 0 || images[0][i + 2] != 0 ? 1 : 0;
+		pixelsDiffering += memcmp(&images[0][i], &images[1][i], 4) != 0 ? 1 : 0;
+	}
+
+	double tested = static_cast<double>(std::max(cullStatistics.clustersTested, 1ull));
+	std::cout << "  Of the clusters tested, " << std::setprecision(1) << cullStatistics.clustersOutside * 100.0 / tested
+		<< "% were outside the frustum and " << cullStatistics.clustersBackFacing * 100.0 / tested << "% faced away, leaving "
+		<< cullStatistics.trianglesVisible * 100.0 / std::max(cullStatistics.trianglesTested, 1ull) << "% of the triangles" << std::endl;
+	std::cout << "  " << pixelsDiffering << " of " << pixelsDrawn << " pixels drawn differ" << std::endl;
+
+	return pixelsDiffering == 0;
+}
+
+// Culls with each of the given views until at least minSeconds have passed, returning the
+// milliseconds per cull. The visible objects of the last view are left in visibleObjects.
+static double TimeCulls(SceneBvh* bvh, const std::vector<BoundingBox>& boxes, const Frustum* frustums,
+	unsigned int frustumCount, double minSeconds, std::vector<unsigned int>& visibleObjects)
+{
+	unsigned int culls = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed(0.0);
+	while (elapsed.count() < minSeconds)
+	{
+		for (unsigned int i = 0; i < frustumCount; ++i)
+		{
+			visibleObjects.clear();
+			if (bvh != nullptr)
+			{
+				bvh->Cull(frustums[i], visibleObjects);
+			}
+			else
+			{
+				for (unsigned int object = 0; object < boxes.size(); ++object)
+				{
+					if (IsBoxInFrustum(frustums[i], boxes[object]))
+						visibleObjects.push_back(object);
+				}
+			}
+		}
+
+		culls += frustumCount;
+		elapsed = std::chrono::high_resolution_clock::now() - start;
+	}
+
+	return elapsed.count() * 1000.0 / culls;
+}
+
+// Whether the hierarchy finds the same objects as testing every box, for every view.
+static bool CheckCulls(SceneBvh& bvh, const std::vector<BoundingBox>& boxes, const Frustum* frustums, unsigned int frustumCount)
+{
+	std::vector<unsigned int> expected;
+	std::vector<unsigned int> visible;
+	for (unsigned int i = 0; i < frustumCount; ++i)
+	{
+		expected.clear();
+		for (unsigned int object = 0; object < boxes.size(); ++object)
+		{
+			if (IsBoxInFrustum(frustums[i], boxes[object]))
+				expected.push_back(object);
+		}
+
+		visible.clear();
+		bvh.Cull(frustums[i], visible);
+		std::sort(visible.begin(), visible.end());
+		if (visible != expected)
+			return false;
+	}
+
+	return true;
+}
+
+bool RunCullingBenchmark()
+{
+	const unsigned int objectCount = 131072;
+	const unsigned int viewCount = 8;
+	const unsigned int moveFrames = 60;
+	const unsigned int movesPerFrame = objectCount / 10;
+	const float worldSize = 1000.0f;
+	const float worldHeight = 100.0f;
+	const float fovY = 1.0471976f;	// 60 degrees.
+	const float aspect = 16.0f / 9.0f;
+	const float nearPlane = 0.5f;
+	const float farPlane = 1000.0f;
+
+	// Boxes of random sizes scattered over a wide, flat world, with a fixed seed so every run
+	// measures the same scene.
+	unsigned int random = 12345;
+	std::vector<BoundingBox> boxes(objectCount);
+	std::vector<Float3> velocities(objectCount);
+	for (unsigned int i = 0; i < objectCount; ++i)
+	{
+		float values[7];
+		for (float& value : values)
+		{
+			random = random * 1664525u + 1013904223u;
+			value = (random >> 8) / 16777216.0f;
+		}
+
+		Float3 centre((values[0] - 0.5f) * worldSize, (values[1] - 0.5f) * worldHeight, (values[2] - 0.5f) * worldSize);
+		Float3 extent(0.5f + values[3] * 3.5f, 0.5f + values[4] * 3.5f, 0.5f + values[5] * 3.5f);
+		boxes[i].minimum = Float3(centre.x - extent.x, centre.y - extent.y, centre.z - extent.z);
+		boxes[i].maximum = Float3(centre.x + extent.x, centre.y + extent.y, centre.z + extent.z);
+		velocities[i] = Float3((values[6] - 0.5f) * 4.0f, 0.0f, (values[3] - 0.5f) * 4.0f);
+	}
+
+	// The eye is in the middle of the world, looking in a different direction along the
+	// ground for each view. The view-projection is the perspective projection of the other
+	// benchmarks after turning the world by -angle around y.
+	const float tanHalfFov = tanf(fovY * 0.5f);
+	const float depthScale = farPlane / (farPlane - nearPlane);
+	Frustum frustums[viewCount];
+	for (unsigned int i = 0; i < viewCount; ++i)
+	{
+		float angle = i * 6.2831853f / viewCount;
+		float c = cosf(angle);
+		float s = sinf(angle);
+		Float4x4 viewProjection(
+			Float4(c / (aspect * tanHalfFov), 0.0f, -s / (aspect * tanHalfFov), 0.0f),
+			Float4(0.0f, 1.0f / tanHalfFov, 0.0f, 0.0f),
+			Float4(depthScale * s, 0.0f, depthScale * c, -nearPlane * depthScale),
+			Float4(s, 0.0f, c, 0.0f));
+		ExtractFrustum(viewProjection, Float3x4(), frustums[i]);
+	}
+
+	SceneBvh bvh;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	bvh.Build(boxes.data(), objectCount);
+	std::chrono::duration<double> buildTime = std::chrono::high_resolution_clock::now() - start;
+
+	std::cout << "Culling benchmark (" << objectCount << " boxes, " << viewCount << " views around the middle of the world)" << std::endl;
+	std::cout << "  Built " << bvh.GetNodeCount() << " nodes of " << SCENE_BVH_WIDTH << " children in " << std::fixed
+		<< std::setprecision(1) << buildTime.count() * 1000.0 << " ms" << std::endl;
+	std::cout << std::setw(14) << "Method" << std::setw(10) << "ISA" << std::setw(12) << "ms/cull"
+		<< std::setw(15) << "Objects/ms" << std::setw(10) << "Visible" << std::setw(13) << "Nodes/cull" << std::setw(10) << "Correct" << std::endl;
+
+	std::vector<unsigned int> visible;
+	double bruteForce = TimeCulls(nullptr, boxes, frustums, viewCount, 0.3, visible);
+	std::cout << std::setw(14) << "Every box" << std::setw(10) << GetRasteriserISAName(RasteriserISA::Scalar)
+		<< std::setw(12) << std::setprecision(3) << bruteForce << std::setw(15) << std::setprecision(0) << objectCount / bruteForce
+		<< std::setw(10) << visible.size() << std::setw(13) << "-" << std::setw(10) << "-" << std::endl;
+
+	const RasteriserISA isas[] = { RasteriserISA::Scalar, RasteriserISA::SSE41, RasteriserISA::AVX2 };
+	bool passed = true;
+	for (RasteriserISA isa : isas)
+	{
+		if (!bvh.SetISA(isa))
+			continue;
+
+		bool correct = CheckCulls(bvh, boxes, frustums, viewCount);
+		bvh.ResetStatistics();
+		double milliseconds = TimeCulls(&bvh, boxes, frustums, viewCount, 0.3, visible);
+		const SceneBvhStatistics& statistics = bvh.GetStatistics();
+		std::cout << std::setw(14) << "Hierarchy" << std::setw(10) << GetRasteriserISAName(isa)
+			<< std::setw(12) << std::setprecision(3) << milliseconds << std::setw(15) << std::setprecision(0) << objectCount / milliseconds
+			<< std::setw(10) << visible.size() << std::setw(13) << statistics.nodesTested / statistics.culls
+			<< std::setw(10) << (correct ? "yes" : "NO") << std::endl;
+		passed = passed && correct;
+	}
+
+	// Move a tenth of the objects every frame, refitting the hierarchy instead of rebuilding it.
+	std::chrono::duration<double> refitTime(0.0);
+	unsigned long long nodesRefitted = 0;
+	for (unsigned int frame = 0; frame < moveFrames; ++frame)
+	{
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < movesPerFrame; ++i)
+		{
+			unsigned int object = (frame * movesPerFrame + i) * 7919u % objectCount;
+			BoundingBox& box = boxes[object];
+			const Float3& velocity = velocities[object];
+			box.minimum = Float3(box.minimum.x + velocity.x, box.minimum.y + velocity.y, box.minimum.z + velocity.z);
+			box.maximum = Float3(box.maximum.x + velocity.x, box.maximum.y + velocity.y, box.maximum.z + velocity.z);
+			bvh.SetObjectBounds(object, box);
+		}
+		nodesRefitted += bvh.Refit();
+		refitTime += std::chrono::high_resolution_clock::now() - start;
+	}
+
+	bool refitCorrect = CheckCulls(bvh, boxes, frustums, viewCount);
+	double refitted = TimeCulls(&bvh, boxes, frustums, viewCount, 0.3, visible);
+	start = std::chrono::high_resolution_clock::now();
+	bvh.Build(boxes.data(), objectCount);
+	buildTime = std::chrono::high_resolution_clock::now() - start;
+	double rebuilt = TimeCulls(&bvh, boxes, frustums, viewCount, 0.3, visible);
+
+	std::cout << "  Moving " << movesPerFrame << " objects a frame for " << moveFrames << " frames: "
+		<< std::setprecision(2) << refitTime.count() * 1000.0 / moveFrames << " ms/frame to move and refit ("
+		<< nodesRefitted / moveFrames << " nodes), rebuilding takes " << buildTime.count() * 1000.0 << " ms" << std::endl;
+	std::cout << "  After moving, " << std::setprecision(0) << objectCount / refitted << " objects/ms refitted and "
+		<< objectCount / rebuilt << " rebuilt, refitted culls " << (refitCorrect ? "correct" : "WRONG") << std::endl;
+
+	return passed && refitCorrect;
+}
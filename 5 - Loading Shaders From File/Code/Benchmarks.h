@@ -0,0 +1,134 @@
+// ###########################################################################################
+// ## Benchmarks run by MWS-Headless with the -benchmark option, measuring the software
+// ## renderer's throughput. Results are printed to the console.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+// Runs the benchmark with the given name, see the table in Benchmarks.cpp. Returns false if
+// there is no benchmark with that name or the benchmark failed.
+bool RunBenchmark(const char* name);
+
+// Each of the benchmarks below returns false if it couldn't set up what it measures or one of
+// its checks failed.
+
+// Renders the sample's rectangle at increasingly large resolutions with every rasteriser
+// instruction set the CPU supports, reporting the fill rate of each.
+bool RunRasteriserBenchmark();
+
+// Renders the sample's rectangle at 3840x2160 with 1 up to as many threads as the hardware
+// supports rasterising the tiles, reporting the speed-up over a single thread.
+bool RunTileBenchmark();
+
+// Builds indexed meshes from a large grid given as a plain triangle list, in row order and
+// shuffled, reporting the welding, the ACMR before and after the vertex cache optimisation
+// and the time taken.
+bool RunMeshBenchmark();
+
+// Stores made up shaders in a shader cache in the working directory and loads them again,
+// reporting the time of keys, misses, stores and hits, and checking that stale entries are
+// removed when a shader changes.
+bool RunShaderCacheBenchmark();
+
+// Runs the FrameScheduler at 60 frames per second against simulated clocks with precise,
+// 1 ms and 15.6 ms sleeps and with frames too slow to keep up, then for a second against the
+// real clock, reporting the frame times, updates per second and how much of the waiting was
+// spent asleep.
+bool RunPacingBenchmark();
+
+// Times empty ProfileScopes on 1 up to as many threads as the hardware supports, all adding
+// samples to the same section, reporting the cost of a scope.
+bool RunProfilerBenchmark();
+
+// Submits made up draws that bind all of their state, in a random order and sorted by
+// material, to a recording backend with and without a StateFilterBackend in front. Reports
+// the binds reaching the backend, the filter's cost per draw and checks that every draw sees
+// the same state either way.
+bool RunStateFilterBenchmark();
+
+// Looks up pipeline states for every combination of a set of made up shaders over and over,
+// reporting the time of a lookup and how many states and input layouts were created, then
+// binds them for draws sorted by state, as separate calls and as pipeline states.
+bool RunPipelineStateBenchmark();
+
+// Sorts queues of 10 thousand up to a million made up draws with random pipeline states,
+// materials and depths, with the radix sort and with std::sort, and counts the binds made
+// when submitting them unsorted and sorted.
+bool RunDrawQueueBenchmark();
+
+// Records a sorted queue of made up draws into one command buffer and executes it, then
+// submits it with 1 up to as many threads as the hardware supports recording command buffers,
+// checking that every draw sees the same state as when submitted directly.
+bool RunCommandBufferBenchmark();
+
+// Draws 100 thousand small copies of the sample's rectangle with the software backend, once
+// with a draw for each copy and once with a single instanced draw, reporting the draw calls,
+// binds and frame times of both, the cost of the calls alone and whether the images match.
+bool RunInstancingBenchmark();
+
+// Allocates from a RingAllocator for thousands of simulated frames with a GPU lagging a few
+// frames behind (and now and then falling further behind), checking that no allocation
+// overlaps memory a frame in flight is using and reporting the cost of an allocation. Then
+// streams the instances of the instancing benchmark through a DynamicBuffer every frame,
+// reporting the upload speed and checking the image against the one from an immutable buffer.
+bool RunRingBufferBenchmark();
+
+// Makes the transient allocations of made up frames from the heap and from double buffered
+// frame arenas, one large enough and one too small, reporting the cost of an allocation, the
+// high-water marks and checking that the previous frame's data survives. Then does the same
+// from jobs on 1 up to as many threads as the hardware supports, each thread with its own arena.
+bool RunArenaBenchmark();
+
+// Draws 10 thousand small copies of the sample's rectangle with the software backend, each
+// placed by its own object constants. Once with every object's constants written to one buffer
+// and bound with offsets, and once writing each object's constants to a small buffer as it is
+// bound, reporting the buffer writes and times of both and whether the images match.
+bool RunConstantBufferBenchmark();
+
+// Loads a quarter of a million vertex grid from an OBJ file and from a mesh file into buffers
+// of the software backend, reporting the time taken to load and to upload each and checking
+// that both give the same data.
+bool RunMeshFileBenchmark();
+
+// Imports a million vertex grid from OBJ, ASCII PLY and binary PLY files on one thread and on
+// every hardware thread, reporting the throughput in bytes and in vertices (the files differ in
+// size for the same mesh) and checking the meshes against the grid.
+// Also times welding and compares ParseFloat() with strtof.
+bool RunImportBenchmark();
+
+// Builds a chain of levels of detail for a bumpy, colourful grid, reporting the triangles,
+// vertices and error of each level, then draws copies of it at increasing distances with the
+// software backend, once always with the full mesh and once with the level picked for each
+// copy from its distance. Reports the vertices and triangles drawn, the frame times and how
+// much of the image the levels change.
+bool RunLodBenchmark();
+
+// Splits a dense, bumpy sphere into clusters, reporting their size and how long that took,
+// then draws copies of it in a grid reaching past the edges of the screen with the software
+// backend, once with every triangle and once with only the clusters that survive frustum and
+// cone culling. Reports the triangles submitted, vertices shaded, triangles rasterised, the
+// culling and frame times, why clusters were culled and checks the images are the same.
+bool RunClusterBenchmark();
+
+// Culls a hundred thousand boxes scattered over a wide world by testing every box and with a
+// SceneBvh using each instruction set, from several directions, reporting the objects culled
+// per millisecond and checking the hierarchy finds the same objects. Then moves a tenth of
+// the objects a frame, refitting the hierarchy, and compares the refits with rebuilding.
+bool RunCullingBenchmark();
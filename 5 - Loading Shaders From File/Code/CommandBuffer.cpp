@@ -0,0 +1,463 @@
+// ###########################################################################################
+// ## A command buffer: the calls made when rendering, recorded into one block of memory so they
+// ## can be recorded on any thread and replayed later on a backend by a single thread.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "CommandBuffer.h"
+
+#include <cstring>
+
+// Every command starts with this header. size includes the header and padding, so the next
+// command starts size bytes further on.
+struct CommandHeader
+{
+	unsigned short type;
+	unsigned short size;
+};
+
+// Commands start at multiples of this, so the pointers they hold can be read in place.
+static const size_t COMMAND_ALIGNMENT = sizeof(void*);
+
+// The arguments of each command, following its header (padded to COMMAND_ALIGNMENT).
+struct ClearCommand
+{
+	BackendRenderTarget* target;
+	float colour[4];
+};
+
+struct SetVertexBuffersCommand
+{
+	unsigned int startSlot;
+	unsigned int bufferCount;
+	// Followed by bufferCount buffer pointers, strides and offsets.
+};
+
+struct SetVSConstantBuffersCommand
+{
+	unsigned int startSlot;
+	unsigned int bufferCount;
+	bool offsets;
+	// Followed by bufferCount buffer pointers and, if offsets is set, first constants and counts.
+};
+
+struct SetIndexBufferCommand
+{
+	BackendBuffer* buffer;
+	IndexFormat format;
+	unsigned int offset;
+};
+
+struct DrawCommand
+{
+	unsigned int vertexCount;
+	unsigned int startVertexLocation;
+};
+
+struct DrawIndexedCommand
+{
+	unsigned int indexCount;
+	unsigned int startIndexLocation;
+	int baseVertexLocation;
+};
+
+struct DrawInstancedCommand
+{
+	unsigned int vertexCountPerInstance;
+	unsigned int instanceCount;
+	unsigned int startVertexLocation;
+	unsigned int startInstanceLocation;
+};
+
+struct DrawIndexedInstancedCommand
+{
+	unsigned int indexCountPerInstance;
+	unsigned int instanceCount;
+	unsigned int startIndexLocation;
+	int baseVertexLocation;
+	unsigned int startInstanceLocation;
+};
+
+struct UpdateDynamicBufferCommand
+{
+	BackendBuffer* buffer;
+	MapMode mode;
+	unsigned int offset;
+	unsigned int size;
+	// Followed by size bytes of data.
+};
+
+// A command's size has to fit in its header, so larger updates are split into several
+// commands of at most this many bytes of data.
+static const unsigned int UPDATE_COMMAND_MAX_DATA_SIZE = 32768;
+
+static size_t AlignCommandSize(size_t size)
+{
+	return (size + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+}
+
+static const size_t COMMAND_HEADER_SIZE = AlignCommandSize(sizeof(CommandHeader));
+
+CommandBuffer::CommandBuffer(RenderBackend* device)
+	: mDevice(device)
+	, mCommandCount(0)
+{
+}
+
+BackendBuffer* CommandBuffer::CreateVertexBuffer(const void* data, unsigned int byteWidth)
+{
+	return mDevice->CreateVertexBuffer(data, byteWidth);
+}
+
+BackendBuffer* CommandBuffer::CreateIndexBuffer(const void* data, unsigned int byteWidth)
+{
+	return mDevice->CreateIndexBuffer(data, byteWidth);
+}
+
+BackendVertexShader* CommandBuffer::CreateVertexShader(const ShaderDesc& desc)
+{
+	return mDevice->CreateVertexShader(desc);
+}
+
+BackendPixelShader* CommandBuffer::CreatePixelShader(const ShaderDesc& desc)
+{
+	return mDevice->CreatePixelShader(desc);
+}
+
+BackendInputLayout* CommandBuffer::CreateInputLayout(const InputElementDesc* elements,
+	unsigned int elementCount, BackendVertexShader* vertexShader)
+{
+	return mDevice->CreateInputLayout(elements, elementCount, vertexShader);
+}
+
+BackendBuffer* CommandBuffer::CreateDynamicBuffer(unsigned int byteWidth)
+{
+	return mDevice->CreateDynamicBuffer(byteWidth);
+}
+
+BackendBuffer* CommandBuffer::CreateConstantBuffer(unsigned int byteWidth)
+{
+	return mDevice->CreateConstantBuffer(byteWidth);
+}
+
+bool CommandBuffer::SupportsConstantBufferOffsets() const
+{
+	return mDevice->SupportsConstantBufferOffsets();
+}
+
+BackendRenderTarget* CommandBuffer::GetBackBuffer()
+{
+	return mDevice->GetBackBuffer();
+}
+
+void CommandBuffer::ClearRenderTargetView(BackendRenderTarget* target, const float colour[4])
+{
+	ClearCommand* command = reinterpret_cast<ClearCommand*>(AddCommand(CommandType::ClearRenderTargetView, sizeof(ClearCommand)));
+	command->target = target;
+	memcpy(command->colour, colour, sizeof(command->colour));
+}
+
+void CommandBuffer::IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+	BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+{
+	// The pointers go first so they stay aligned.
+	size_t pointersSize = sizeof(BackendBuffer*) * bufferCount;
+	size_t valuesSize = sizeof(unsigned int) * bufferCount;
+	unsigned char* arguments = AddCommand(CommandType::SetVertexBuffers,
+		AlignCommandSize(sizeof(SetVertexBuffersCommand)) + pointersSize + valuesSize * 2);
+
+	SetVertexBuffersCommand* command = reinterpret_cast<SetVertexBuffersCommand*>(arguments);
+	command->startSlot = startSlot;
+	command->bufferCount = bufferCount;
+
+	unsigned char* arrays = arguments + AlignCommandSize(sizeof(SetVertexBuffersCommand));
+	memcpy(arrays, buffers, pointersSize);
+	memcpy(arrays + pointersSize, strides, valuesSize);
+	memcpy(arrays + pointersSize + valuesSize, offsets, valuesSize);
+}
+
+void CommandBuffer::IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset)
+{
+	SetIndexBufferCommand* command = reinterpret_cast<SetIndexBufferCommand*>(AddCommand(CommandType::SetIndexBuffer, sizeof(SetIndexBufferCommand)));
+	command->buffer = buffer;
+	command->format = format;
+	command->offset = offset;
+}
+
+void CommandBuffer::IASetInputLayout(BackendInputLayout* inputLayout)
+{
+	*reinterpret_cast<BackendInputLayout**>(AddCommand(CommandType::SetInputLayout, sizeof(inputLayout))) = inputLayout;
+}
+
+void CommandBuffer::IASetPrimitiveTopology(PrimitiveTopology topology)
+{
+	*reinterpret_cast<PrimitiveTopology*>(AddCommand(CommandType::SetPrimitiveTopology, sizeof(topology))) = topology;
+}
+
+void CommandBuffer::VSSetShader(BackendVertexShader* shader)
+{
+	*reinterpret_cast<BackendVertexShader**>(AddCommand(CommandType::SetVertexShader, sizeof(shader))) = shader;
+}
+
+void CommandBuffer::PSSetShader(BackendPixelShader* shader)
+{
+	*reinterpret_cast<BackendPixelShader**>(AddCommand(CommandType::SetPixelShader, sizeof(shader))) = shader;
+}
+
+void CommandBuffer::VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+	const unsigned int* firstConstants, const unsigned int* constantCounts)
+{
+	size_t pointersSize = sizeof(BackendBuffer*) * bufferCount;
+	size_t valuesSize = firstConstants != nullptr ? sizeof(unsigned int) * bufferCount : 0;
+	unsigned char* arguments = AddCommand(CommandType::SetVSConstantBuffers,
+		AlignCommandSize(sizeof(SetVSConstantBuffersCommand)) + pointersSize + valuesSize * 2);
+
+	SetVSConstantBuffersCommand* command = reinterpret_cast<SetVSConstantBuffersCommand*>(arguments);
+	command->startSlot = startSlot;
+	command->bufferCount = bufferCount;
+	command->offsets = firstConstants != nullptr;
+
+	unsigned char* arrays = arguments + AlignCommandSize(sizeof(SetVSConstantBuffersCommand));
+	memcpy(arrays, buffers, pointersSize);
+	if (firstConstants != nullptr)
+	{
+		memcpy(arrays + pointersSize, firstConstants, valuesSize);
+		memcpy(arrays + pointersSize + valuesSize, constantCounts, valuesSize);
+	}
+}
+
+void* CommandBuffer::Map(BackendBuffer* buffer, MapMode mode)
+{
+	(void)buffer;
+	(void)mode;
+	return nullptr;
+}
+
+void CommandBuffer::Unmap(BackendBuffer* buffer)
+{
+	(void)buffer;
+}
+
+void CommandBuffer::UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+	const void* data, unsigned int size)
+{
+	// Only the first part may discard, a discard for a later part would throw away the earlier.
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (unsigned int done = 0; done < size; done += UPDATE_COMMAND_MAX_DATA_SIZE)
+	{
+		unsigned int partSize = size - done < UPDATE_COMMAND_MAX_DATA_SIZE ? size - done : UPDATE_COMMAND_MAX_DATA_SIZE;
+		unsigned char* arguments = AddCommand(CommandType::UpdateDynamicBuffer,
+			AlignCommandSize(sizeof(UpdateDynamicBufferCommand)) + partSize);
+
+		UpdateDynamicBufferCommand* command = reinterpret_cast<UpdateDynamicBufferCommand*>(arguments);
+		command->buffer = buffer;
+		command->mode = done == 0 ? mode : MapMode::WriteNoOverwrite;
+		command->offset = offset + done;
+		command->size = partSize;
+		memcpy(arguments + AlignCommandSize(sizeof(UpdateDynamicBufferCommand)), bytes + done, partSize);
+	}
+}
+
+void CommandBuffer::SetPipelineState(const PipelineState* state)
+{
+	*reinterpret_cast<const PipelineState**>(AddCommand(CommandType::SetPipelineState, sizeof(state))) = state;
+}
+
+void CommandBuffer::Draw(unsigned int vertexCount, unsigned int startVertexLocation)
+{
+	DrawCommand* command = reinterpret_cast<DrawCommand*>(AddCommand(CommandType::Draw, sizeof(DrawCommand)));
+	command->vertexCount = vertexCount;
+	command->startVertexLocation = startVertexLocation;
+}
+
+void CommandBuffer::DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation)
+{
+	DrawIndexedCommand* command = reinterpret_cast<DrawIndexedCommand*>(AddCommand(CommandType::DrawIndexed, sizeof(DrawIndexedCommand)));
+	command->indexCount = indexCount;
+	command->startIndexLocation = startIndexLocation;
+	command->baseVertexLocation = baseVertexLocation;
+}
+
+void CommandBuffer::DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+	unsigned int startVertexLocation, unsigned int startInstanceLocation)
+{
+	DrawInstancedCommand* command = reinterpret_cast<DrawInstancedCommand*>(AddCommand(CommandType::DrawInstanced, sizeof(DrawInstancedCommand)));
+	command->vertexCountPerInstance = vertexCountPerInstance;
+	command->instanceCount = instanceCount;
+	command->startVertexLocation = startVertexLocation;
+	command->startInstanceLocation = startInstanceLocation;
+}
+
+void CommandBuffer::DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+	unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation)
+{
+	DrawIndexedInstancedCommand* command = reinterpret_cast<DrawIndexedInstancedCommand*>(
+		AddCommand(CommandType::DrawIndexedInstanced, sizeof(DrawIndexedInstancedCommand)));
+	command->indexCountPerInstance = indexCountPerInstance;
+	command->instanceCount = instanceCount;
+	command->startIndexLocation = startIndexLocation;
+	command->baseVertexLocation = baseVertexLocation;
+	command->startInstanceLocation = startInstanceLocation;
+}
+
+void CommandBuffer::Present()
+{
+}
+
+unsigned long long CommandBuffer::InsertFence()
+{
+	return 0;
+}
+
+unsigned long long CommandBuffer::GetCompletedFence()
+{
+	return 0;
+}
+
+void CommandBuffer::Execute(RenderBackend* backend) const
+{
+	const unsigned char* position = mCommands.data();
+	const unsigned char* end = position + mCommands.size();
+	while (position < end)
+	{
+		const CommandHeader* header = reinterpret_cast<const CommandHeader*>(position);
+		const unsigned char* arguments = position + COMMAND_HEADER_SIZE;
+
+		switch (static_cast<CommandType>(header->type))
+		{
+		case CommandType::ClearRenderTargetView:
+		{
+			const ClearCommand* command = reinterpret_cast<const ClearCommand*>(arguments);
+			backend->ClearRenderTargetView(command->target, command->colour);
+			break;
+		}
+		case CommandType::SetVertexBuffers:
+		{
+			const SetVertexBuffersCommand* command = reinterpret_cast<const SetVertexBuffersCommand*>(arguments);
+			const unsigned char* arrays = arguments + AlignCommandSize(sizeof(SetVertexBuffersCommand));
+			BackendBuffer* const* buffers = reinterpret_cast<BackendBuffer* const*>(arrays);
+			const unsigned int* strides = reinterpret_cast<const unsigned int*>(buffers + command->bufferCount);
+			const unsigned int* offsets = strides + command->bufferCount;
+			backend->IASetVertexBuffers(command->startSlot, command->bufferCount, buffers, strides, offsets);
+			break;
+		}
+		case CommandType::SetIndexBuffer:
+		{
+			const SetIndexBufferCommand* command = reinterpret_cast<const SetIndexBufferCommand*>(arguments);
+			backend->IASetIndexBuffer(command->buffer, command->format, command->offset);
+			break;
+		}
+		case CommandType::SetInputLayout:
+			backend->IASetInputLayout(*reinterpret_cast<BackendInputLayout* const*>(arguments));
+			break;
+		case CommandType::SetPrimitiveTopology:
+			backend->IASetPrimitiveTopology(*reinterpret_cast<const PrimitiveTopology*>(arguments));
+			break;
+		case CommandType::SetVertexShader:
+			backend->VSSetShader(*reinterpret_cast<BackendVertexShader* const*>(arguments));
+			break;
+		case CommandType::SetPixelShader:
+			backend->PSSetShader(*reinterpret_cast<BackendPixelShader* const*>(arguments));
+			break;
+		case CommandType::SetVSConstantBuffers:
+		{
+			const SetVSConstantBuffersCommand* command = reinterpret_cast<const SetVSConstantBuffersCommand*>(arguments);
+			const unsigned char* arrays = arguments + AlignCommandSize(sizeof(SetVSConstantBuffersCommand));
+			BackendBuffer* const* buffers = reinterpret_cast<BackendBuffer* const*>(arrays);
+			const unsigned int* firstConstants = command->offsets ? reinterpret_cast<const unsigned int*>(buffers + command->bufferCount) : nullptr;
+			const unsigned int* constantCounts = command->offsets ? firstConstants + command->bufferCount : nullptr;
+			backend->VSSetConstantBuffers(command->startSlot, command->bufferCount, buffers, firstConstants, constantCounts);
+			break;
+		}
+		case CommandType::SetPipelineState:
+			backend->SetPipelineState(*reinterpret_cast<const PipelineState* const*>(arguments));
+			break;
+		case CommandType::Draw:
+		{
+			const DrawCommand* command = reinterpret_cast<const DrawCommand*>(arguments);
+			backend->Draw(command->vertexCount, command->startVertexLocation);
+			break;
+		}
+		case CommandType::DrawIndexed:
+		{
+			const DrawIndexedCommand* command = reinterpret_cast<const DrawIndexedCommand*>(arguments);
+			backend->DrawIndexed(command->indexCount, command->startIndexLocation, command->baseVertexLocation);
+			break;
+		}
+		case CommandType::DrawInstanced:
+		{
+			const DrawInstancedCommand* command = reinterpret_cast<const DrawInstancedCommand*>(arguments);
+			backend->DrawInstanced(command->vertexCountPerInstance, command->instanceCount,
+				command->startVertexLocation, command->startInstanceLocation);
+			break;
+		}
+		case CommandType::DrawIndexedInstanced:
+		{
+			const DrawIndexedInstancedCommand* command = reinterpret_cast<const DrawIndexedInstancedCommand*>(arguments);
+			backend->DrawIndexedInstanced(command->indexCountPerInstance, command->instanceCount,
+				command->startIndexLocation, command->baseVertexLocation, command->startInstanceLocation);
+			break;
+		}
+		case CommandType::UpdateDynamicBuffer:
+		{
+			const UpdateDynamicBufferCommand* command = reinterpret_cast<const UpdateDynamicBufferCommand*>(arguments);
+			const unsigned char* data = arguments + AlignCommandSize(sizeof(UpdateDynamicBufferCommand));
+			backend->UpdateDynamicBuffer(command->buffer, command->mode, command->offset, data, command->size);
+			break;
+		}
+		}
+
+		position += header->size;
+	}
+}
+
+void CommandBuffer::Reset()
+{
+	mCommands.clear();
+	mCommandCount = 0;
+}
+
+void CommandBuffer::SetDevice(RenderBackend* device)
+{
+	mDevice = device;
+}
+
+unsigned int CommandBuffer::GetCommandCount() const
+{
+	return mCommandCount;
+}
+
+size_t CommandBuffer::GetSize() const
+{
+	return mCommands.size();
+}
+
+unsigned char* CommandBuffer::AddCommand(CommandType type, size_t argumentSize)
+{
+	size_t size = COMMAND_HEADER_SIZE + AlignCommandSize(argumentSize);
+	size_t offset = mCommands.size();
+	mCommands.resize(offset + size);
+
+	CommandHeader* header = reinterpret_cast<CommandHeader*>(mCommands.data() + offset);
+	header->type = static_cast<unsigned short>(type);
+	header->size = static_cast<unsigned short>(size);
+	++mCommandCount;
+
+	return mCommands.data() + offset + COMMAND_HEADER_SIZE;
+}
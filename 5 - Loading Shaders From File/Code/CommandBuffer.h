@@ -0,0 +1,126 @@
+// ###########################################################################################
+// ## A command buffer: the calls made when rendering, recorded into one block of memory so they
+// ## can be recorded on any thread and replayed later on a backend by a single thread.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "RenderBackend.h"
+
+#include <cstddef>
+#include <vector>
+
+// A RenderBackend that records the frame calls made to it instead of making them, so any code
+// drawing through a RenderBackend can record into it. Each command is a small header followed
+// by its arguments, one after the other; resources are stored as pointers and are not owned.
+//
+// Command buffers can be recorded on different threads at the same time (each buffer by one
+// thread), and are then executed on the backend one after the other by the thread rendering.
+// Resource creation is passed on to the device backend straight away, which is safe from any
+// thread (see RenderBackend.h).
+class CommandBuffer : public RenderBackend
+{
+public:
+	explicit CommandBuffer(RenderBackend* device);
+
+	BackendBuffer* CreateVertexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendBuffer* CreateIndexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendVertexShader* CreateVertexShader(const ShaderDesc& desc) override;
+	BackendPixelShader* CreatePixelShader(const ShaderDesc& desc) override;
+	BackendInputLayout* CreateInputLayout(const InputElementDesc* elements,
+		unsigned int elementCount, BackendVertexShader* vertexShader) override;
+	BackendBuffer* CreateDynamicBuffer(unsigned int byteWidth) override;
+	BackendBuffer* CreateConstantBuffer(unsigned int byteWidth) override;
+	bool SupportsConstantBufferOffsets() const override;
+	BackendRenderTarget* GetBackBuffer() override;
+
+	void ClearRenderTargetView(BackendRenderTarget* target, const float colour[4]) override;
+	void IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+		BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) override;
+	void IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset) override;
+	void IASetInputLayout(BackendInputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(PrimitiveTopology topology) override;
+	void VSSetShader(BackendVertexShader* shader) override;
+	void PSSetShader(BackendPixelShader* shader) override;
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+		const unsigned int* firstConstants, const unsigned int* constantCounts) override;
+
+	// A command buffer can't be mapped while it is recorded, so Map() returns nullptr. Write to
+	// dynamic buffers with UpdateDynamicBuffer() instead, which records a copy of the data.
+	void* Map(BackendBuffer* buffer, MapMode mode) override;
+	void Unmap(BackendBuffer* buffer) override;
+	void UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+		const void* data, unsigned int size) override;
+	void SetPipelineState(const PipelineState* state) override;
+	void Draw(unsigned int vertexCount, unsigned int startVertexLocation) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation) override;
+	void DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+		unsigned int startVertexLocation, unsigned int startInstanceLocation) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+		unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation) override;
+
+	// Presenting ends a frame, which a command buffer doesn't, so it is not recorded. Present on
+	// the backend after executing the frame's command buffers. The same goes for fences, which
+	// are inserted on the backend: InsertFence() and GetCompletedFence() return 0.
+	void Present() override;
+	unsigned long long InsertFence() override;
+	unsigned long long GetCompletedFence() override;
+
+	// Makes the recorded calls on the backend, in the order they were recorded. The buffer can
+	// be executed any number of times.
+	void Execute(RenderBackend* backend) const;
+
+	// Removes all commands, keeping the memory for the next frame.
+	void Reset();
+
+	// Passes resource creation on to device from now on, e.g. when a buffer kept from frame to
+	// frame is recorded for a different backend.
+	void SetDevice(RenderBackend* device);
+
+	unsigned int GetCommandCount() const;
+	size_t GetSize() const;		// In bytes.
+
+private:
+	enum class CommandType : unsigned short
+	{
+		ClearRenderTargetView,
+		SetVertexBuffers,
+		SetIndexBuffer,
+		SetInputLayout,
+		SetPrimitiveTopology,
+		SetVertexShader,
+		SetPixelShader,
+		SetVSConstantBuffers,
+		SetPipelineState,
+		Draw,
+		DrawIndexed,
+		DrawInstanced,
+		DrawIndexedInstanced,
+		UpdateDynamicBuffer,
+	};
+
+	// Adds a command with room for argumentSize bytes of arguments, which are written to the
+	// returned memory. Commands are padded to keep the pointers in them aligned.
+	unsigned char* AddCommand(CommandType type, size_t argumentSize);
+
+	RenderBackend* mDevice;
+	std::vector<unsigned char> mCommands;
+	unsigned int mCommandCount;
+};
@@ -0,0 +1,139 @@
+// ###########################################################################################
+// ## Constant buffers for the data that changes once a frame, once a view and once an object.
+// ## The constants of every object drawn in a frame are written to one large buffer at once.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "ConstantBuffers.h"
+
+#include <cstring>
+
+ConstantBufferStatistics::ConstantBufferStatistics()
+	: objects(0)
+	, writes(0)
+	, objectBinds(0)
+{
+}
+
+ConstantBufferManager::ConstantBufferManager(RenderBackend* backend, unsigned int objectBufferSize)
+	: mBackend(backend)
+	, mOffsets(backend->SupportsConstantBufferOffsets())
+	, mFrameBuffer(backend->CreateConstantBuffer(sizeof(FrameConstants)))
+	, mViewBuffer(backend->CreateConstantBuffer(sizeof(ViewConstants)))
+	, mObjectBuffer(mOffsets ? nullptr : backend->CreateConstantBuffer(OBJECT_CONSTANTS_STRIDE))
+	, mObjectRing(backend, mOffsets ? objectBufferSize : 0, DynamicBufferUsage::Constants)
+	, mObjectCount(0)
+	, mFirstConstant(0)
+	, mAddedObjects(0)
+	, mWrites(0)
+	, mObjectBinds(0)
+{
+}
+
+ConstantBufferManager::~ConstantBufferManager()
+{
+	delete mFrameBuffer;
+	delete mViewBuffer;
+	delete mObjectBuffer;
+}
+
+void ConstantBufferManager::SetFrameConstants(const FrameConstants& constants)
+{
+	mBackend->UpdateDynamicBuffer(mFrameBuffer, MapMode::WriteDiscard, 0, &constants, sizeof(constants));
+	mBackend->VSSetConstantBuffers(CONSTANT_SLOT_FRAME, 1, &mFrameBuffer, nullptr, nullptr);
+	++mWrites;
+}
+
+void ConstantBufferManager::SetViewConstants(const ViewConstants& constants)
+{
+	mBackend->UpdateDynamicBuffer(mViewBuffer, MapMode::WriteDiscard, 0, &constants, sizeof(constants));
+	mBackend->VSSetConstantBuffers(CONSTANT_SLOT_VIEW, 1, &mViewBuffer, nullptr, nullptr);
+	++mWrites;
+}
+
+unsigned int ConstantBufferManager::AddObjects(const ObjectConstants* objects, unsigned int count)
+{
+	// The space between objects is left as it is, the shaders don't read it.
+	unsigned int first = mObjectCount;
+	mObjects.resize(static_cast<size_t>(mObjectCount + count) * OBJECT_CONSTANTS_STRIDE);
+	for (unsigned int i = 0; i < count; ++i)
+		memcpy(&mObjects[static_cast<size_t>(first + i) * OBJECT_CONSTANTS_STRIDE], &objects[i], sizeof(ObjectConstants));
+
+	mObjectCount += count;
+	mAddedObjects += count;
+	return first;
+}
+
+bool ConstantBufferManager::WriteObjects()
+{
+	// Without offsets the constants are written when they are bound.
+	if (!mOffsets || mObjectCount == 0)
+		return true;
+
+	unsigned int offset = 0;
+	if (!mObjectRing.Write(mObjects.data(), mObjectCount * OBJECT_CONSTANTS_STRIDE, OBJECT_CONSTANTS_STRIDE, offset))
+		return false;
+
+	mFirstConstant = offset / CONSTANT_SIZE;
+	++mWrites;
+	return true;
+}
+
+void ConstantBufferManager::BindObject(RenderBackend* backend, unsigned int object)
+{
+	++mObjectBinds;
+
+	if (mOffsets)
+	{
+		BackendBuffer* buffer = mObjectRing.GetBuffer();
+		unsigned int firstConstant = mFirstConstant + object * CONSTANT_BUFFER_OFFSET_ALIGNMENT;
+		unsigned int constantCount = CONSTANT_BUFFER_OFFSET_ALIGNMENT;
+		backend->VSSetConstantBuffers(CONSTANT_SLOT_OBJECT, 1, &buffer, &firstConstant, &constantCount);
+	}
+	else
+	{
+		// Each write discards the last one, which earlier draws go on reading.
+		backend->UpdateDynamicBuffer(mObjectBuffer, MapMode::WriteDiscard, 0,
+			&mObjects[static_cast<size_t>(object) * OBJECT_CONSTANTS_STRIDE], sizeof(ObjectConstants));
+		backend->VSSetConstantBuffers(CONSTANT_SLOT_OBJECT, 1, &mObjectBuffer, nullptr, nullptr);
+		++mWrites;
+	}
+}
+
+void ConstantBufferManager::EndFrame(unsigned long long fence)
+{
+	if (mOffsets)
+		mObjectRing.EndFrame(fence);
+
+	mObjectCount = 0;
+}
+
+bool ConstantBufferManager::UsesOffsets() const
+{
+	return mOffsets;
+}
+
+ConstantBufferStatistics ConstantBufferManager::GetStatistics() const
+{
+	ConstantBufferStatistics statistics;
+	statistics.objects = mAddedObjects;
+	statistics.writes = mWrites;
+	statistics.objectBinds = mObjectBinds;
+	return statistics;
+}
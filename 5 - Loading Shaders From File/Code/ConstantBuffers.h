@@ -0,0 +1,134 @@
+// ###########################################################################################
+// ## Constant buffers for the data that changes once a frame, once a view and once an object.
+// ## The constants of every object drawn in a frame are written to one large buffer at once.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "DynamicBuffer.h"
+#include "MathTypes.h"
+#include "RenderBackend.h"
+
+#include <atomic>
+#include <vector>
+
+// The vertex shader registers each kind of constants is bound to, matching the cbuffer
+// declarations in Resources/Shaders/constants.hlsli.
+const unsigned int CONSTANT_SLOT_FRAME = 0;
+const unsigned int CONSTANT_SLOT_VIEW = 1;
+const unsigned int CONSTANT_SLOT_OBJECT = 2;
+
+// Objects' constants are bound with offsets, which must be multiples of 16 constants, so each
+// object takes up this many bytes of the object buffer.
+const unsigned int OBJECT_CONSTANTS_STRIDE = CONSTANT_SIZE * CONSTANT_BUFFER_OFFSET_ALIGNMENT;
+
+// The layouts of the cbuffers in constants.hlsli. A cbuffer is a whole number of 16 byte
+// constants, and the matrices are declared row_major so they are stored like these.
+struct FrameConstants
+{
+	float time;			// Seconds the scene has been updated for.
+	float timeStep;		// Seconds between two updates.
+	float padding[2];
+};
+
+struct ViewConstants
+{
+	Float4x4 viewProjection;	// From world space to clip space.
+};
+
+struct ObjectConstants
+{
+	Float3x4 world;		// From the object's space to world space.
+};
+
+// Counters for the constants written and bound.
+struct ConstantBufferStatistics
+{
+	ConstantBufferStatistics();
+
+	unsigned long long objects;		// Objects whose constants have been added.
+	unsigned long long writes;		// Buffer updates, each one a map of a buffer.
+	unsigned long long objectBinds;
+};
+
+// Owns the constant buffers the shaders read. The frame's and view's constants each have a
+// small buffer of their own, written with a discard when they are set.
+//
+// Objects' constants are added one after the other during a frame and then written to one
+// large dynamic buffer (see DynamicBuffer.h) with a single write, each one at a multiple of
+// OBJECT_CONSTANTS_STRIDE. A draw binds its object's constants as a range of that buffer, so
+// thousands of objects need neither thousands of buffers nor thousands of maps.
+//
+// Binding with offsets needs Direct3D 11.1 (see RenderBackend::SupportsConstantBufferOffsets()).
+// Without it each bind writes the object's constants to a small buffer with a discard instead,
+// which is the usual way of doing it with Direct3D 11.0.
+class ConstantBufferManager
+{
+public:
+	// The buffers are created on the backend, which must outlive the manager. The object buffer
+	// is objectBufferSize bytes, enough for the objects of a few frames.
+	ConstantBufferManager(RenderBackend* backend, unsigned int objectBufferSize);
+	~ConstantBufferManager();
+
+	// Writes the constants and binds their buffer. The frame's are set once a frame, the view's
+	// before drawing each view.
+	void SetFrameConstants(const FrameConstants& constants);
+	void SetViewConstants(const ViewConstants& constants);
+
+	// Adds the constants of count objects to the frame, returning the index of the first one,
+	// which is passed to BindObject().
+	unsigned int AddObjects(const ObjectConstants* objects, unsigned int count);
+
+	// Writes the constants of the objects added this frame to the GPU. Call once they have all
+	// been added, before any of them are bound. Returns false if they don't fit in the buffer.
+	bool WriteObjects();
+
+	// Binds an object's constants. The backend may be a command buffer being recorded on
+	// another thread, so this may be called from several threads at once.
+	void BindObject(RenderBackend* backend, unsigned int object);
+
+	// Ends the frame once its draws have been made, see DynamicBuffer::EndFrame().
+	void EndFrame(unsigned long long fence);
+
+	// Whether objects are bound with offsets rather than written one at a time.
+	bool UsesOffsets() const;
+	ConstantBufferStatistics GetStatistics() const;
+
+private:
+	ConstantBufferManager(const ConstantBufferManager&);
+	ConstantBufferManager& operator=(const ConstantBufferManager&);
+
+	RenderBackend* mBackend;
+	bool mOffsets;
+	BackendBuffer* mFrameBuffer;
+	BackendBuffer* mViewBuffer;
+	BackendBuffer* mObjectBuffer;		// Only used without offsets, holds one object.
+	DynamicBuffer mObjectRing;			// Only used with offsets.
+
+	// The constants added this frame, OBJECT_CONSTANTS_STRIDE bytes each, and the constant the
+	// first one was written to in the object buffer.
+	std::vector<unsigned char> mObjects;
+	unsigned int mObjectCount;
+	unsigned int mFirstConstant;
+
+	unsigned long long mAddedObjects;
+	std::atomic<unsigned long long> mWrites;
+	std::atomic<unsigned long long> mObjectBinds;
+};
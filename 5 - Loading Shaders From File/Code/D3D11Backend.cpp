@@ -0,0 +1,621 @@
+// ###########################################################################################
+// ## The Direct3D 11 backend, rendering to a window using a swap chain. Every call is passed
+// ## more or less directly on to the device, device context or swap chain.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "D3D11Backend.h"
+#include "BakedShaders.h"
+
+#include <d3dcompiler.h>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Link to needed lib files. Can also be done by adding these to
+// Properties -> Linker -> Input -> Additional Dependencies
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "D3DCompiler.lib")
+
+// The Direct3D versions of the backend resources. Each one releases its COM object(s) when
+// it is deleted.
+class D3D11BackendBuffer : public BackendBuffer
+{
+public:
+	D3D11BackendBuffer(ID3D11Buffer* buffer) : buffer(buffer) {}
+	~D3D11BackendBuffer() override { buffer->Release(); }
+
+	ID3D11Buffer* buffer;
+};
+
+class D3D11BackendVertexShader : public BackendVertexShader
+{
+public:
+	D3D11BackendVertexShader(ID3D11VertexShader* shader, const std::vector<unsigned char>& bytecode) : shader(shader), bytecode(bytecode) {}
+	~D3D11BackendVertexShader() override { shader->Release(); }
+
+	ID3D11VertexShader* shader;
+	std::vector<unsigned char> bytecode;	// Kept to validate input layouts against.
+};
+
+class D3D11BackendPixelShader : public BackendPixelShader
+{
+public:
+	D3D11BackendPixelShader(ID3D11PixelShader* shader) : shader(shader) {}
+	~D3D11BackendPixelShader() override { shader->Release(); }
+
+	ID3D11PixelShader* shader;
+};
+
+class D3D11BackendInputLayout : public BackendInputLayout
+{
+public:
+	D3D11BackendInputLayout(ID3D11InputLayout* inputLayout) : inputLayout(inputLayout) {}
+	~D3D11BackendInputLayout() override { inputLayout->Release(); }
+
+	ID3D11InputLayout* inputLayout;
+};
+
+class D3D11BackendRenderTarget : public BackendRenderTarget
+{
+public:
+	D3D11BackendRenderTarget(ID3D11RenderTargetView* rtv) : rtv(rtv) {}
+	~D3D11BackendRenderTarget() override { rtv->Release(); }
+
+	ID3D11RenderTargetView* rtv;
+};
+
+static DXGI_FORMAT ToDXGIFormat(ElementFormat format)
+{
+	switch (format)
+	{
+	case ElementFormat::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+	case ElementFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+	case ElementFormat::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case ElementFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+	case ElementFormat::Half4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case ElementFormat::UByteN4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+// Reads the files included by a shader, relative to the shader's folder, and records them
+// so they can be stored along with the compiled shader in the cache.
+class ShaderIncludeRecorder : public ID3DInclude
+{
+public:
+	ShaderIncludeRecorder(const std::string& folder) : folder(folder) {}
+
+	HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+	{
+		std::string path = folder + fileName;
+		std::string contents;
+		if (!ShaderCache::ReadSourceFile(path, contents))
+			return E_FAIL;
+
+		ShaderCacheInclude include;
+		include.path = path;
+		include.hash = ShaderCache::Hash(contents.data(), contents.size());
+		includes.push_back(include);
+
+		char* copy = new char[contents.size()];
+		memcpy(copy, contents.data(), contents.size());
+		*data = copy;
+		*bytes = static_cast<UINT>(contents.size());
+		return S_OK;
+	}
+
+	HRESULT __stdcall Close(LPCVOID data) override
+	{
+		delete[] static_cast<const char*>(data);
+		return S_OK;
+	}
+
+	std::string folder;
+	std::vector<ShaderCacheInclude> includes;
+};
+
+D3D11Backend::D3D11Backend()
+	: mDevice(nullptr)
+	, mContext(nullptr)
+	, mContext1(nullptr)
+	, mConstantBufferOffsets(false)
+	, mSwapChain(nullptr)
+	, mBackBuffer(nullptr)
+	, mShaderCache(nullptr)
+	, mLastFence(0)
+	, mCompletedFence(0)
+{
+	for (unsigned int i = 0; i < D3D11_FENCE_QUERY_COUNT; ++i)
+		mFenceQueries[i] = nullptr;
+}
+
+D3D11Backend::~D3D11Backend()
+{
+	delete mBackBuffer;
+
+	for (unsigned int i = 0; i < D3D11_FENCE_QUERY_COUNT; ++i)
+	{
+		if (mFenceQueries[i] != nullptr)
+			mFenceQueries[i]->Release();
+	}
+
+	if (mSwapChain != nullptr)
+		mSwapChain->Release();
+	if (mContext1 != nullptr)
+		mContext1->Release();
+	if (mContext != nullptr)
+		mContext->Release();
+	if (mDevice != nullptr)
+		mDevice->Release();
+}
+
+void D3D11Backend::Initialise(HWND windowHandle, int width, int height)
+{
+	CreateDeviceAndSwapChain(windowHandle, width, height);
+	CreateRenderTargetView();
+	CreateViewport(width, height);
+}
+
+void D3D11Backend::SetShaderCache(ShaderCache* shaderCache)
+{
+	mShaderCache = shaderCache;
+}
+
+void D3D11Backend::CreateDeviceAndSwapChain(HWND windowHandle, int width, int height)
+{
+	DXGI_SWAP_CHAIN_DESC scDesc;
+	scDesc.BufferDesc.Width = width;
+	scDesc.BufferDesc.Height = height;
+	scDesc.BufferDesc.RefreshRate.Numerator = 0;
+	scDesc.BufferDesc.RefreshRate.Denominator = 0;
+	scDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	scDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
+	scDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
+	scDesc.SampleDesc.Count = 1;
+	scDesc.SampleDesc.Quality = 0;
+	scDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	scDesc.BufferCount = 1;
+	scDesc.OutputWindow = windowHandle;
+	scDesc.Windowed = true;
+	scDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+	scDesc.Flags = 0;
+
+	D3D11CreateDeviceAndSwapChain(
+		nullptr,
+		D3D_DRIVER_TYPE_HARDWARE,
+		NULL,
+		NULL,
+		nullptr,
+		0,
+		D3D11_SDK_VERSION,
+		&scDesc,
+		&mSwapChain,
+		&mDevice,
+		nullptr,
+		&mContext
+		);
+
+	// Binding constant buffers with offsets needs the Direct3D 11.1 context, and the driver has
+	// to support both binding and mapping parts of them. Without them constant buffers are
+	// bound whole (see ConstantBuffers.h).
+	if (mContext != nullptr && SUCCEEDED(mContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&mContext1))))
+	{
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+		if (SUCCEEDED(mDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+			mConstantBufferOffsets = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+	}
+}
+
+void D3D11Backend::CreateRenderTargetView()
+{
+	// Get the back buffer from the swap chain, create a render target view of it to use as
+	// the target for rendering.
+	ID3D11Texture2D* backBuffer;
+	ID3D11RenderTargetView* rtv = nullptr;
+	mSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer));
+	mDevice->CreateRenderTargetView(backBuffer, nullptr, &rtv);
+	backBuffer->Release();
+
+	mContext->OMSetRenderTargets(1, &rtv, nullptr);
+	mBackBuffer = new D3D11BackendRenderTarget(rtv);
+}
+
+void D3D11Backend::CreateViewport(int width, int height)
+{
+	D3D11_VIEWPORT vp;
+	vp.TopLeftX = 0.0f;		// The top left corner's x coordinate in pixels from the window's top left corner.
+	vp.TopLeftY = 0.0f;		// The top left corner's y coordinate in pixels from the window's top left corner.
+	vp.Width = static_cast<float>(width);	// This viewport will cover the entire window.
+	vp.Height = static_cast<float>(height);	// This viewport will cover the entire window.
+	vp.MinDepth = 0.0f;		// Minimum depth value used by Direct3D is 0.0f so this is used.
+	vp.MaxDepth = 1.0f;		// Maximum depth value used by Direct3D is 1.0f so this is used.
+
+	mContext->RSSetViewports(1, &vp);				// Set the viewport to use.
+}
+
+bool D3D11Backend::CompileShader(const ShaderDesc& desc, std::vector<unsigned char>& bytecode)
+{
+	// Shaders compiled when building the program are used as they are, without touching the
+	// shader file.
+	const BakedShader* baked = FindBakedShader(desc.path, desc.entryPoint);
+	if (baked != nullptr)
+	{
+		bytecode.assign(baked->bytecode, baked->bytecode + baked->bytecodeSize);
+		return true;
+	}
+
+	// The paths used by the samples only contain ASCII characters.
+	std::string path;
+	for (const wchar_t* c = desc.path; *c != L'\0'; ++c)
+		path += static_cast<char>(*c);
+
+	std::string source;
+	if (!ShaderCache::ReadSourceFile(path, source))
+		return false;
+
+	const UINT flags = 0;	// No shader compile options.
+
+	// If the shader has been compiled with the same source and options before, its bytecode is
+	// in the cache and the compiler isn't needed.
+	ShaderCacheKey key = ShaderCache::MakeKey(path, source, nullptr, 0, desc.entryPoint, desc.target, flags);
+	if (mShaderCache != nullptr)
+	{
+		std::unique_ptr<ShaderCacheEntry> entry = mShaderCache->Load(key);
+		if (entry != nullptr)
+		{
+			const unsigned char* cached = static_cast<const unsigned char*>(entry->GetBytecode());
+			bytecode.assign(cached, cached + entry->GetBytecodeSize());
+			return true;
+		}
+	}
+
+	ShaderIncludeRecorder include(path.substr(0, path.find_last_of("/\\") + 1));
+	ID3DBlob* compiledShader = nullptr;	// A variable to hold the compiled shader data.
+	ID3DBlob* errors = nullptr;			// The compiler's error and warning messages, if any.
+	D3DCompile(
+		source.data(),		// The HLSL source, read from the shader file.
+		source.size(),
+		path.c_str(),		// The name of the shader file, used in error messages.
+		nullptr,			// We don't use any defines.
+		&include,			// Includes are read relative to the shader file, and recorded for the cache.
+		desc.entryPoint,	// The name of the entry function. Must match function in source data.
+		desc.target,		// The shader model to use, e.g. "vs_5_0" for vertex shader model 5.0.
+		flags,				// Shader compile options.
+		0,					// Ignored when compiling a shader (effect compile options).
+		&compiledShader,	// [out] Compiled shader data.
+		&errors				// [out] Compile time error data.
+		);
+
+	// The messages are text, but not necessarily null terminated.
+	if (errors != nullptr)
+	{
+		std::cout << std::string(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize()) << std::endl;
+		errors->Release();
+	}
+
+	if (compiledShader == nullptr)
+		return false;
+
+	const unsigned char* compiled = static_cast<const unsigned char*>(compiledShader->GetBufferPointer());
+	bytecode.assign(compiled, compiled + compiledShader->GetBufferSize());
+	compiledShader->Release();
+
+	if (mShaderCache != nullptr)
+		mShaderCache->Store(key, bytecode.data(), bytecode.size(), include.includes);
+
+	return true;
+}
+
+BackendBuffer* D3D11Backend::CreateVertexBuffer(const void* data, unsigned int byteWidth)
+{
+	// For a vertex buffer, the D3D11_BIND_VERTEX_BUFFER flag must be specified.
+	ID3D11Buffer* buffer = CreateImmutableBuffer(data, byteWidth, D3D11_BIND_VERTEX_BUFFER);
+	return buffer != nullptr ? new D3D11BackendBuffer(buffer) : nullptr;
+}
+
+BackendBuffer* D3D11Backend::CreateIndexBuffer(const void* data, unsigned int byteWidth)
+{
+	// An index buffer works the same way, but is bound as D3D11_BIND_INDEX_BUFFER.
+	ID3D11Buffer* buffer = CreateImmutableBuffer(data, byteWidth, D3D11_BIND_INDEX_BUFFER);
+	return buffer != nullptr ? new D3D11BackendBuffer(buffer) : nullptr;
+}
+
+BackendBuffer* D3D11Backend::CreateDynamicBuffer(unsigned int byteWidth)
+{
+	// A DYNAMIC buffer can be mapped by the CPU for writing (but not reading) while the GPU
+	// reads it. It can be bound as both a vertex and an index buffer, and has no initial data.
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.ByteWidth = byteWidth;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_INDEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	ID3D11Buffer* buffer = nullptr;
+	if (FAILED(mDevice->CreateBuffer(&bufferDesc, NULL, &buffer)))
+		return nullptr;
+
+	return new D3D11BackendBuffer(buffer);
+}
+
+BackendBuffer* D3D11Backend::CreateConstantBuffer(unsigned int byteWidth)
+{
+	// Constant buffers are DYNAMIC as well, but can't be bound as anything else.
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.ByteWidth = byteWidth;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	ID3D11Buffer* buffer = nullptr;
+	if (FAILED(mDevice->CreateBuffer(&bufferDesc, NULL, &buffer)))
+		return nullptr;
+
+	return new D3D11BackendBuffer(buffer);
+}
+
+bool D3D11Backend::SupportsConstantBufferOffsets() const
+{
+	return mConstantBufferOffsets;
+}
+
+ID3D11Buffer* D3D11Backend::CreateImmutableBuffer(const void* data, unsigned int byteWidth, UINT bindFlags)
+{
+	// Fill out the buffer description to use when creating our buffer.
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.ByteWidth = byteWidth;					// The buffer needs to know the total size of its data, e.g. all vertices.
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;			// A buffer whose contents never change after creation is IMMUTABLE.
+	bufferDesc.BindFlags = bindFlags;					// What the buffer will be bound as, e.g. a vertex buffer.
+	bufferDesc.CPUAccessFlags = 0;						// The CPU won't access the buffer after creation.
+	bufferDesc.MiscFlags = 0;							// The buffer is not doing anything extraordinary.
+	bufferDesc.StructureByteStride = 0;					// Only used for structured buffers, which vertex and index buffers are not.
+
+	// Define what data our buffer will contain.
+	D3D11_SUBRESOURCE_DATA bufferContents;
+	bufferContents.pSysMem = data;
+
+	// Create the buffer.
+	ID3D11Buffer* buffer = nullptr;
+	if (FAILED(mDevice->CreateBuffer(&bufferDesc, &bufferContents, &buffer)))
+		return nullptr;
+
+	return buffer;
+}
+
+BackendVertexShader* D3D11Backend::CreateVertexShader(const ShaderDesc& desc)
+{
+	std::vector<unsigned char> bytecode;
+	if (!CompileShader(desc, bytecode))
+		return nullptr;
+
+	ID3D11VertexShader* vertexShader = nullptr;
+	if (FAILED(mDevice->CreateVertexShader(bytecode.data(), bytecode.size(), NULL, &vertexShader)))
+		return nullptr;
+
+	return new D3D11BackendVertexShader(vertexShader, bytecode);
+}
+
+BackendPixelShader* D3D11Backend::CreatePixelShader(const ShaderDesc& desc)
+{
+	std::vector<unsigned char> bytecode;
+	if (!CompileShader(desc, bytecode))
+		return nullptr;
+
+	ID3D11PixelShader* pixelShader = nullptr;
+	if (FAILED(mDevice->CreatePixelShader(bytecode.data(), bytecode.size(), NULL, &pixelShader)))
+		return nullptr;
+
+	return new D3D11BackendPixelShader(pixelShader);
+}
+
+BackendInputLayout* D3D11Backend::CreateInputLayout(const InputElementDesc* elements,
+	unsigned int elementCount, BackendVertexShader* vertexShader)
+{
+	if (vertexShader == nullptr)
+		return nullptr;
+
+	std::vector<D3D11_INPUT_ELEMENT_DESC> inputDesc(elementCount);
+	for (unsigned int i = 0; i < elementCount; ++i)
+	{
+		inputDesc[i].SemanticName = elements[i].semanticName;
+		inputDesc[i].SemanticIndex = elements[i].semanticIndex;
+		inputDesc[i].Format = ToDXGIFormat(elements[i].format);
+		inputDesc[i].InputSlot = elements[i].inputSlot;
+		inputDesc[i].AlignedByteOffset = elements[i].byteOffset;
+		inputDesc[i].InputSlotClass = elements[i].inputSlotClass == InputClassification::PerInstance ?
+			D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+		inputDesc[i].InstanceDataStepRate = elements[i].instanceDataStepRate;
+	}
+
+	// The layout is validated against the vertex shader's input signature.
+	const std::vector<unsigned char>& bytecode = static_cast<D3D11BackendVertexShader*>(vertexShader)->bytecode;
+	ID3D11InputLayout* inputLayout = nullptr;
+	if (FAILED(mDevice->CreateInputLayout(inputDesc.data(), elementCount, bytecode.data(), bytecode.size(), &inputLayout)))
+		return nullptr;
+
+	return new D3D11BackendInputLayout(inputLayout);
+}
+
+BackendRenderTarget* D3D11Backend::GetBackBuffer()
+{
+	return mBackBuffer;
+}
+
+void D3D11Backend::ClearRenderTargetView(BackendRenderTarget* target, const float colour[4])
+{
+	mContext->ClearRenderTargetView(static_cast<D3D11BackendRenderTarget*>(target)->rtv, colour);
+}
+
+void D3D11Backend::IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+	BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+{
+	ID3D11Buffer* d3dBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	for (unsigned int i = 0; i < bufferCount && i < D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT; ++i)
+		d3dBuffers[i] = buffers[i] != nullptr ? static_cast<D3D11BackendBuffer*>(buffers[i])->buffer : nullptr;
+
+	mContext->IASetVertexBuffers(startSlot, bufferCount, d3dBuffers, strides, offsets);
+}
+
+void D3D11Backend::IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset)
+{
+	DXGI_FORMAT dxgiFormat = format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	mContext->IASetIndexBuffer(buffer != nullptr ? static_cast<D3D11BackendBuffer*>(buffer)->buffer : nullptr, dxgiFormat, offset);
+}
+
+void D3D11Backend::IASetInputLayout(BackendInputLayout* inputLayout)
+{
+	mContext->IASetInputLayout(inputLayout != nullptr ? static_cast<D3D11BackendInputLayout*>(inputLayout)->inputLayout : nullptr);
+}
+
+void D3D11Backend::IASetPrimitiveTopology(PrimitiveTopology topology)
+{
+	switch (topology)
+	{
+	case PrimitiveTopology::TriangleList:
+		mContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		break;
+	}
+}
+
+void D3D11Backend::VSSetShader(BackendVertexShader* shader)
+{
+	mContext->VSSetShader(shader != nullptr ? static_cast<D3D11BackendVertexShader*>(shader)->shader : nullptr, NULL, NULL);
+}
+
+void D3D11Backend::PSSetShader(BackendPixelShader* shader)
+{
+	mContext->PSSetShader(shader != nullptr ? static_cast<D3D11BackendPixelShader*>(shader)->shader : nullptr, NULL, NULL);
+}
+
+void D3D11Backend::VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+	const unsigned int* firstConstants, const unsigned int* constantCounts)
+{
+	if (bufferCount > D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT)
+		bufferCount = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+
+	ID3D11Buffer* d3dBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	for (unsigned int i = 0; i < bufferCount; ++i)
+		d3dBuffers[i] = buffers[i] != nullptr ? static_cast<D3D11BackendBuffer*>(buffers[i])->buffer : nullptr;
+
+	if (firstConstants != nullptr && mContext1 != nullptr)
+		mContext1->VSSetConstantBuffers1(startSlot, bufferCount, d3dBuffers, firstConstants, constantCounts);
+	else
+		mContext->VSSetConstantBuffers(startSlot, bufferCount, d3dBuffers);
+}
+
+void* D3D11Backend::Map(BackendBuffer* buffer, MapMode mode)
+{
+	D3D11_MAP mapType = mode == MapMode::WriteDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(mContext->Map(static_cast<D3D11BackendBuffer*>(buffer)->buffer, 0, mapType, 0, &mapped)))
+		return nullptr;
+
+	return mapped.pData;
+}
+
+void D3D11Backend::Unmap(BackendBuffer* buffer)
+{
+	mContext->Unmap(static_cast<D3D11BackendBuffer*>(buffer)->buffer, 0);
+}
+
+void D3D11Backend::Draw(unsigned int vertexCount, unsigned int startVertexLocation)
+{
+	mContext->Draw(vertexCount, startVertexLocation);
+}
+
+void D3D11Backend::DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation)
+{
+	mContext->DrawIndexed(indexCount, startIndexLocation, baseVertexLocation);
+}
+
+void D3D11Backend::DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+	unsigned int startVertexLocation, unsigned int startInstanceLocation)
+{
+	mContext->DrawInstanced(vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation);
+}
+
+void D3D11Backend::DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+	unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation)
+{
+	mContext->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void D3D11Backend::Present()
+{
+	// Swap the back and front buffers, showing the rendered frame.
+	mSwapChain->Present(0, 0);
+}
+
+unsigned long long D3D11Backend::InsertFence()
+{
+	// An event query is signalled when the GPU reaches it. Each fence uses the query after the
+	// last one's, and if that is still in use by an older fence, the older one is waited for.
+	unsigned long long fence = mLastFence + 1;
+	ID3D11Query*& query = mFenceQueries[fence % D3D11_FENCE_QUERY_COUNT];
+	if (query == nullptr)
+	{
+		D3D11_QUERY_DESC queryDesc;
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		queryDesc.MiscFlags = 0;
+		if (FAILED(mDevice->CreateQuery(&queryDesc, &query)))
+			return mLastFence;
+	}
+	else
+	{
+		while (GetCompletedFence() + D3D11_FENCE_QUERY_COUNT <= mLastFence)
+			std::this_thread::yield();
+	}
+
+	mContext->End(query);
+	mLastFence = fence;
+	return fence;
+}
+
+unsigned long long D3D11Backend::GetCompletedFence()
+{
+	// The fences are passed in order, so check them from the oldest one not known to be passed.
+	while (mCompletedFence < mLastFence)
+	{
+		ID3D11Query* query = mFenceQueries[(mCompletedFence + 1) % D3D11_FENCE_QUERY_COUNT];
+		if (mContext->GetData(query, NULL, 0, 0) != S_OK)
+			break;
+
+		++mCompletedFence;
+	}
+
+	return mCompletedFence;
+}
+
+ID3D11Device* D3D11Backend::GetDevice() const
+{
+	return mDevice;
+}
+
+ID3D11DeviceContext* D3D11Backend::GetContext() const
+{
+	return mContext;
+}
@@ -0,0 +1,106 @@
+// ###########################################################################################
+// ## The Direct3D 11 backend, rendering to a window using a swap chain.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <Windows.h>
+#include <d3d11_1.h>
+
+#include "RenderBackend.h"
+#include "ShaderCache.h"
+
+#include <vector>
+
+// Fences are event queries, reused round robin. If this many are still waiting for the GPU when
+// another one is inserted, the oldest is waited for.
+const unsigned int D3D11_FENCE_QUERY_COUNT = 8;
+
+class D3D11Backend : public RenderBackend
+{
+public:
+	D3D11Backend();
+	~D3D11Backend() override;
+
+	// Creates the device, swap chain, render target view and viewport for the given window.
+	void Initialise(HWND windowHandle, int width, int height);
+
+	// Compiled shaders are looked up in and added to the cache, if one is set. The cache must
+	// outlive the backend (or be unset first).
+	void SetShaderCache(ShaderCache* shaderCache);
+
+	BackendBuffer* CreateVertexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendBuffer* CreateIndexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendVertexShader* CreateVertexShader(const ShaderDesc& desc) override;
+	BackendPixelShader* CreatePixelShader(const ShaderDesc& desc) override;
+	BackendInputLayout* CreateInputLayout(const InputElementDesc* elements,
+		unsigned int elementCount, BackendVertexShader* vertexShader) override;
+	BackendBuffer* CreateDynamicBuffer(unsigned int byteWidth) override;
+	BackendBuffer* CreateConstantBuffer(unsigned int byteWidth) override;
+	bool SupportsConstantBufferOffsets() const override;
+	BackendRenderTarget* GetBackBuffer() override;
+
+	void ClearRenderTargetView(BackendRenderTarget* target, const float colour[4]) override;
+	void IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+		BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) override;
+	void IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset) override;
+	void IASetInputLayout(BackendInputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(PrimitiveTopology topology) override;
+	void VSSetShader(BackendVertexShader* shader) override;
+	void PSSetShader(BackendPixelShader* shader) override;
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+		const unsigned int* firstConstants, const unsigned int* constantCounts) override;
+	void* Map(BackendBuffer* buffer, MapMode mode) override;
+	void Unmap(BackendBuffer* buffer) override;
+	void Draw(unsigned int vertexCount, unsigned int startVertexLocation) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation) override;
+	void DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+		unsigned int startVertexLocation, unsigned int startInstanceLocation) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+		unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation) override;
+	void Present() override;
+	unsigned long long InsertFence() override;
+	unsigned long long GetCompletedFence() override;
+
+	ID3D11Device* GetDevice() const;
+	ID3D11DeviceContext* GetContext() const;
+
+private:
+	void CreateDeviceAndSwapChain(HWND windowHandle, int width, int height);
+	void CreateRenderTargetView();
+	void CreateViewport(int width, int height);
+	// Gets the shader's bytecode: baked into the program if it is, otherwise loaded from the
+	// shader cache or compiled. Returns false on failure.
+	bool CompileShader(const ShaderDesc& desc, std::vector<unsigned char>& bytecode);
+	// Creates an immutable buffer bound as the given D3D11_BIND_FLAG.
+	ID3D11Buffer* CreateImmutableBuffer(const void* data, unsigned int byteWidth, UINT bindFlags);
+
+	ID3D11Device* mDevice;
+	ID3D11DeviceContext* mContext;
+	ID3D11DeviceContext1* mContext1;	// The Direct3D 11.1 interface of the context, or nullptr on older runtimes.
+	bool mConstantBufferOffsets;		// Whether the driver supports binding and mapping parts of constant buffers.
+	IDXGISwapChain* mSwapChain;
+	BackendRenderTarget* mBackBuffer;
+	ShaderCache* mShaderCache;
+
+	ID3D11Query* mFenceQueries[D3D11_FENCE_QUERY_COUNT];
+	unsigned long long mLastFence;		// The value of the last fence inserted.
+	unsigned long long mCompletedFence;
+};
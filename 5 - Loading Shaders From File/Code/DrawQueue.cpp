@@ -0,0 +1,245 @@
+// ###########################################################################################
+// ## A queue of draws, each with a 64 bit sort key. The queue is radix sorted by key before the
+// ## draws are submitted, so draws using the same state are drawn together.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "DrawQueue.h"
+#include "ConstantBuffers.h"
+#include "PipelineState.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const unsigned int DRAW_KEY_DEPTH_SHIFT = 0;
+static const unsigned int DRAW_KEY_MATERIAL_SHIFT = DRAW_KEY_DEPTH_BITS;
+static const unsigned int DRAW_KEY_PIPELINE_SHIFT = DRAW_KEY_MATERIAL_SHIFT + DRAW_KEY_MATERIAL_BITS;
+static const unsigned int DRAW_KEY_PASS_SHIFT = DRAW_KEY_PIPELINE_SHIFT + DRAW_KEY_PIPELINE_BITS;
+
+// Keeps the lowest bits of a value, so a field too large for its bits can't spill into the
+// next one.
+static unsigned long long KeyField(unsigned long long value, unsigned int bits)
+{
+	return value & ((1ull << bits) - 1);
+}
+
+// Turns a depth in [0, 1] into an integer with DRAW_KEY_DEPTH_BITS bits.
+static unsigned long long QuantiseDepth(float depth)
+{
+	const unsigned long long maxDepth = (1ull << DRAW_KEY_DEPTH_BITS) - 1;
+	if (!(depth > 0.0f))
+		return 0;	// Also catches NaN.
+	if (depth >= 1.0f)
+		return maxDepth;
+
+	return static_cast<unsigned long long>(static_cast<double>(depth) * maxDepth);
+}
+
+unsigned long long MakeOpaqueDrawKey(unsigned int pipelineId, unsigned int material, float depth)
+{
+	return (KeyField(static_cast<unsigned int>(DrawPass::Opaque), DRAW_KEY_PASS_BITS) << DRAW_KEY_PASS_SHIFT) |
+		(KeyField(pipelineId, DRAW_KEY_PIPELINE_BITS) << DRAW_KEY_PIPELINE_SHIFT) |
+		(KeyField(material, DRAW_KEY_MATERIAL_BITS) << DRAW_KEY_MATERIAL_SHIFT) |
+		(QuantiseDepth(depth) << DRAW_KEY_DEPTH_SHIFT);
+}
+
+unsigned long long MakeTransparentDrawKey(unsigned int pipelineId, unsigned int material, float depth)
+{
+	// The fields below the pass are laid out as depth, pipeline state, material. The depth is
+	// inverted so farther draws come first.
+	const unsigned long long maxDepth = (1ull << DRAW_KEY_DEPTH_BITS) - 1;
+	const unsigned int materialShift = 0;
+	const unsigned int pipelineShift = DRAW_KEY_MATERIAL_BITS;
+	const unsigned int depthShift = pipelineShift + DRAW_KEY_PIPELINE_BITS;
+
+	return (KeyField(static_cast<unsigned int>(DrawPass::Transparent), DRAW_KEY_PASS_BITS) << DRAW_KEY_PASS_SHIFT) |
+		((maxDepth - QuantiseDepth(depth)) << depthShift) |
+		(KeyField(pipelineId, DRAW_KEY_PIPELINE_BITS) << pipelineShift) |
+		(KeyField(material, DRAW_KEY_MATERIAL_BITS) << materialShift);
+}
+
+void RadixSortDrawKeys(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch)
+{
+	const size_t count = entries.size();
+	if (count < 2)
+		return;
+
+	// Count the values of all eight bytes in one go.
+	unsigned int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (const DrawSortEntry& entry : entries)
+	{
+		for (unsigned int byte = 0; byte < 8; ++byte)
+			++histograms[byte][(entry.key >> (byte * 8)) & 0xFF];
+	}
+
+	scratch.resize(count);
+	DrawSortEntry* source = entries.data();
+	DrawSortEntry* destination = scratch.data();
+	for (unsigned int byte = 0; byte < 8; ++byte)
+	{
+		// If every key has the same value in this byte, the pass wouldn't move anything.
+		unsigned int* histogram = histograms[byte];
+		if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count)
+			continue;
+
+		// Turn the counts into the position of the first entry with each value.
+		unsigned int offset = 0;
+		for (unsigned int value = 0; value < 256; ++value)
+		{
+			unsigned int valueCount = histogram[value];
+			histogram[value] = offset;
+			offset += valueCount;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const DrawSortEntry& entry = source[i];
+			destination[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+		}
+
+		DrawSortEntry* swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	// After an odd number of passes the sorted entries are in the scratch buffer.
+	if (source != entries.data())
+		entries.swap(scratch);
+}
+
+DrawQueue::DrawQueue()
+	: mCommandBufferCount(0)
+{
+}
+
+void DrawQueue::Add(unsigned long long key, const QueuedDraw& draw)
+{
+	DrawSortEntry entry;
+	entry.key = key;
+	entry.drawIndex = static_cast<unsigned int>(mDraws.size());
+	mEntries.push_back(entry);
+	mDraws.push_back(draw);
+}
+
+void DrawQueue::Sort()
+{
+	RadixSortDrawKeys(mEntries, mScratch);
+}
+
+void DrawQueue::Submit(RenderBackend* backend) const
+{
+	SubmitRange(backend, 0, mEntries.size());
+}
+
+void DrawQueue::SubmitParallel(RenderBackend* backend, ThreadPool* threadPool)
+{
+	// Share the draws out evenly, but not so thinly that a buffer gets too few of them.
+	size_t drawCount = mEntries.size();
+	size_t bufferCount = std::min<size_t>(threadPool->GetThreadCount(), drawCount / DRAW_QUEUE_MIN_DRAWS_PER_COMMAND_BUFFER);
+	if (bufferCount <= 1)
+	{
+		mCommandBufferCount = 0;
+		Submit(backend);
+		return;
+	}
+
+	while (mCommandBuffers.size() < bufferCount)
+		mCommandBuffers.push_back(std::unique_ptr<CommandBuffer>(new CommandBuffer(backend)));
+	mCommandBufferCount = static_cast<unsigned int>(bufferCount);
+
+	// The buffers are kept from call to call, but the backend may not be: a buffer passes
+	// resource creation on to the backend of this call.
+	threadPool->ParallelFor(static_cast<unsigned int>(bufferCount), [&](unsigned int index, unsigned int)
+	{
+		CommandBuffer& commandBuffer = *mCommandBuffers[index];
+		commandBuffer.Reset();
+		commandBuffer.SetDevice(backend);
+		SubmitRange(&commandBuffer, drawCount * index / bufferCount, drawCount * (index + 1) / bufferCount);
+	});
+
+	for (size_t i = 0; i < bufferCount; ++i)
+		mCommandBuffers[i]->Execute(backend);
+}
+
+void DrawQueue::SubmitRange(RenderBackend* backend, size_t begin, size_t end) const
+{
+	const PipelineState* pipelineState = nullptr;
+	BackendBuffer* vertexBuffer = nullptr;
+	unsigned int vertexStride = 0;
+	BackendBuffer* indexBuffer = nullptr;
+	IndexFormat indexFormat = IndexFormat::UInt16;
+	ConstantBufferManager* constants = nullptr;
+	unsigned int object = 0;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const QueuedDraw& draw = mDraws[mEntries[i].drawIndex];
+		if (draw.vertexBuffer != vertexBuffer || draw.vertexStride != vertexStride)
+		{
+			unsigned int offset = 0;
+			backend->IASetVertexBuffers(0, 1, &draw.vertexBuffer, &draw.vertexStride, &offset);
+			vertexBuffer = draw.vertexBuffer;
+			vertexStride = draw.vertexStride;
+		}
+
+		if (draw.indexBuffer != indexBuffer || draw.indexFormat != indexFormat)
+		{
+			backend->IASetIndexBuffer(draw.indexBuffer, draw.indexFormat, 0);
+			indexBuffer = draw.indexBuffer;
+			indexFormat = draw.indexFormat;
+		}
+
+		if (draw.pipelineState != pipelineState)
+		{
+			backend->SetPipelineState(draw.pipelineState);
+			pipelineState = draw.pipelineState;
+		}
+
+		if (draw.constants != nullptr && (draw.constants != constants || draw.object != object))
+		{
+			draw.constants->BindObject(backend, draw.object);
+			constants = draw.constants;
+			object = draw.object;
+		}
+
+		backend->DrawIndexed(draw.indexCount, draw.startIndexLocation, draw.baseVertexLocation);
+	}
+}
+
+void DrawQueue::Clear()
+{
+	mDraws.clear();
+	mEntries.clear();
+}
+
+unsigned int DrawQueue::GetDrawCount() const
+{
+	return static_cast<unsigned int>(mEntries.size());
+}
+
+const std::vector<DrawSortEntry>& DrawQueue::GetEntries() const
+{
+	return mEntries;
+}
+
+unsigned int DrawQueue::GetCommandBufferCount() const
+{
+	return mCommandBufferCount;
+}
@@ -0,0 +1,129 @@
+// ###########################################################################################
+// ## A queue of draws, each with a 64 bit sort key. The queue is radix sorted by key before the
+// ## draws are submitted, so draws using the same state are drawn together.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "CommandBuffer.h"
+#include "RenderBackend.h"
+#include "ThreadPool.h"
+
+#include <memory>
+#include <vector>
+
+class ConstantBufferManager;
+
+// The passes a frame is drawn in, in order. Stored in the top bits of a sort key.
+enum class DrawPass
+{
+	Opaque,
+	Transparent,
+};
+
+// The fewest draws recorded into a command buffer by SubmitParallel(). Fewer draws aren't
+// worth the cost of handing them to another thread.
+const unsigned int DRAW_QUEUE_MIN_DRAWS_PER_COMMAND_BUFFER = 1024;
+
+// The sizes of the fields of a sort key, from the most significant bits down.
+const unsigned int DRAW_KEY_PASS_BITS = 4;
+const unsigned int DRAW_KEY_PIPELINE_BITS = 16;
+const unsigned int DRAW_KEY_MATERIAL_BITS = 16;
+const unsigned int DRAW_KEY_DEPTH_BITS = 28;
+
+// Opaque draws are sorted by pass, pipeline state, material and then front to back, so state
+// changes are as few as possible and nearer draws hide farther ones before they are shaded.
+// pipelineId is PipelineState::GetId(); material is anything further telling draws apart
+// (e.g. textures), and depth is in [0, 1], 0 being nearest.
+unsigned long long MakeOpaqueDrawKey(unsigned int pipelineId, unsigned int material, float depth);
+
+// Transparent draws must be blended back to front, so depth (inverted) is sorted on before the
+// pipeline state and material.
+unsigned long long MakeTransparentDrawKey(unsigned int pipelineId, unsigned int material, float depth);
+
+// Everything needed to make an indexed draw.
+struct QueuedDraw
+{
+	const PipelineState* pipelineState;
+	BackendBuffer* vertexBuffer;
+	unsigned int vertexStride;
+	BackendBuffer* indexBuffer;
+	IndexFormat indexFormat;
+	unsigned int indexCount;
+	unsigned int startIndexLocation;
+	int baseVertexLocation;
+	ConstantBufferManager* constants;	// Binds the object constants, or nullptr if the draw has none.
+	unsigned int object;				// The object whose constants are bound, see ConstantBufferManager::AddObjects().
+};
+
+// A key and the draw it belongs to, which is what is sorted.
+struct DrawSortEntry
+{
+	unsigned long long key;
+	unsigned int drawIndex;
+};
+
+// Sorts the entries by key with a least significant digit radix sort, one byte per pass.
+// Bytes that are the same in every key are skipped. Entries with the same key keep their
+// order. scratch is resized as needed and can be kept between calls to avoid allocating.
+void RadixSortDrawKeys(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch);
+
+class DrawQueue
+{
+public:
+	DrawQueue();
+
+	// Adds a draw to make when the queue is submitted. Draws can be added in any order.
+	void Add(unsigned long long key, const QueuedDraw& draw);
+
+	// Sorts the draws by key.
+	void Sort();
+
+	// Makes the draws in the order of their keys (call Sort() first), binding only the buffers,
+	// pipeline states and object constants that differ from the previous draw's.
+	void Submit(RenderBackend* backend) const;
+
+	// Does the same as Submit(), but first records the draws into command buffers on the thread
+	// pool's threads, one buffer per consecutive range of draws, then executes the buffers in
+	// order on the backend. If there are too few draws to share out, they are submitted
+	// directly. Each buffer binds everything its first draw needs, so a backend behind a
+	// StateFilterBackend sees no more binds than with Submit().
+	void SubmitParallel(RenderBackend* backend, ThreadPool* threadPool);
+
+	// Removes all draws, keeping the memory for the next frame.
+	void Clear();
+
+	unsigned int GetDrawCount() const;
+	const std::vector<DrawSortEntry>& GetEntries() const;
+
+	// The command buffers used by the last SubmitParallel().
+	unsigned int GetCommandBufferCount() const;
+
+private:
+	void SubmitRange(RenderBackend* backend, size_t begin, size_t end) const;
+
+	std::vector<QueuedDraw> mDraws;
+	std::vector<DrawSortEntry> mEntries;
+	std::vector<DrawSortEntry> mScratch;
+
+	// Kept between frames so their memory is reused.
+	std::vector<std::unique_ptr<CommandBuffer>> mCommandBuffers;
+	unsigned int mCommandBufferCount;
+};
@@ -0,0 +1,115 @@
+// ###########################################################################################
+// ## A dynamic vertex/index buffer that streams data written each frame through a ring, using
+// ## WRITE_NO_OVERWRITE maps while it fills up and DISCARD when it starts over.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "DynamicBuffer.h"
+
+#include <cstring>
+#include <thread>
+
+void RenderBackend::UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+	const void* data, unsigned int size)
+{
+	unsigned char* mapped = static_cast<unsigned char*>(Map(buffer, mode));
+	if (mapped == nullptr)
+		return;
+
+	memcpy(mapped + offset, data, size);
+	Unmap(buffer);
+}
+
+DynamicBuffer::DynamicBuffer(RenderBackend* backend, unsigned int size, DynamicBufferUsage usage)
+	: mBackend(backend)
+	, mBuffer(usage == DynamicBufferUsage::Constants ? backend->CreateConstantBuffer(size) : backend->CreateDynamicBuffer(size))
+	, mAllocator(size)
+	, mWritten(false)
+{
+	memset(&mStatistics, 0, sizeof(mStatistics));
+}
+
+DynamicBuffer::~DynamicBuffer()
+{
+	delete mBuffer;
+}
+
+bool DynamicBuffer::Write(const void* data, unsigned int size, unsigned int alignment, unsigned int& offset)
+{
+	if (mBuffer == nullptr)
+		return false;
+
+	// When the buffer is full, wait for the oldest frame to finish and free its memory. If no
+	// earlier frame holds any, the data can't fit.
+	RingAllocation allocation;
+	bool waited = false;
+	while (!mAllocator.Allocate(size, alignment, allocation))
+	{
+		unsigned long long fence = mAllocator.GetOldestFence();
+		if (fence == 0)
+			return false;
+
+		unsigned long long completedFence = mBackend->GetCompletedFence();
+		if (completedFence < fence)
+		{
+			waited = true;
+			while ((completedFence = mBackend->GetCompletedFence()) < fence)
+				std::this_thread::yield();
+		}
+
+		mAllocator.ReleaseFrames(completedFence);
+	}
+
+	// Starting over throws away the previous contents, letting the GPU keep reading them while
+	// the buffer is written again. Otherwise the data goes where the GPU isn't reading.
+	MapMode mode = allocation.wrapped || !mWritten ? MapMode::WriteDiscard : MapMode::WriteNoOverwrite;
+	mBackend->UpdateDynamicBuffer(mBuffer, mode, allocation.offset, data, size);
+	mWritten = true;
+
+	++mStatistics.writes;
+	mStatistics.bytesWritten += size;
+	mStatistics.discards += mode == MapMode::WriteDiscard ? 1 : 0;
+	mStatistics.waits += waited ? 1 : 0;
+
+	offset = allocation.offset;
+	return true;
+}
+
+void DynamicBuffer::EndFrame(unsigned long long fence)
+{
+	mAllocator.EndFrame(fence);
+
+	// Free the frames the GPU has already finished, so the next frame rarely has to check.
+	mAllocator.ReleaseFrames(mBackend->GetCompletedFence());
+}
+
+BackendBuffer* DynamicBuffer::GetBuffer() const
+{
+	return mBuffer;
+}
+
+unsigned int DynamicBuffer::GetSize() const
+{
+	return mAllocator.GetSize();
+}
+
+const DynamicBufferStatistics& DynamicBuffer::GetStatistics() const
+{
+	return mStatistics;
+}
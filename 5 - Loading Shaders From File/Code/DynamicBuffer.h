@@ -0,0 +1,85 @@
+// ###########################################################################################
+// ## A dynamic vertex/index buffer that streams data written each frame through a ring, using
+// ## WRITE_NO_OVERWRITE maps while it fills up and DISCARD when it starts over.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "RenderBackend.h"
+#include "RingAllocator.h"
+
+// What a dynamic buffer is bound as. Direct3D doesn't allow constant buffers to be bound as
+// anything else.
+enum class DynamicBufferUsage
+{
+	Geometry,	// Vertex and index data, see RenderBackend::CreateDynamicBuffer().
+	Constants,	// Constants bound with offsets, see RenderBackend::CreateConstantBuffer().
+};
+
+// Counters for the data written to a dynamic buffer.
+struct DynamicBufferStatistics
+{
+	unsigned long long writes;
+	unsigned long long bytesWritten;
+	unsigned long long discards;	// Writes that started over at the beginning of the buffer.
+	unsigned long long waits;		// Writes that had to wait for the GPU to finish a frame.
+};
+
+// Geometry that changes every frame is written to one large dynamic buffer instead of being
+// put in new buffers. Each write goes after the previous one, mapped with WriteNoOverwrite as
+// the GPU isn't using that part of the buffer; when the end is reached the buffer starts over,
+// mapped with WriteDiscard. Draws bind the buffer with the offset the data was written to.
+//
+// The buffer never overwrites data a frame the GPU hasn't finished may read: EndFrame() ties
+// the frame's writes to a fence, and once the buffer is full it waits for the oldest frame's
+// fence. It should be large enough to hold a few frames of data so that doesn't happen.
+//
+// The data written before the buffer starts over must be drawn before it does, as the discard
+// throws it away. A dynamic buffer is used by one thread at a time.
+class DynamicBuffer
+{
+public:
+	// The buffer is created on the backend, which must outlive it. GetBuffer() returns nullptr
+	// if that failed.
+	DynamicBuffer(RenderBackend* backend, unsigned int size, DynamicBufferUsage usage = DynamicBufferUsage::Geometry);
+	~DynamicBuffer();
+
+	// Copies size bytes to the buffer, at an offset that is a multiple of alignment (a power of
+	// two). Returns false if the data doesn't fit even with every earlier frame finished.
+	bool Write(const void* data, unsigned int size, unsigned int alignment, unsigned int& offset);
+
+	// Ends the frame whose data has been written, once the draws using it have been made. The
+	// fence is one inserted after them (see RenderBackend::InsertFence()).
+	void EndFrame(unsigned long long fence);
+
+	BackendBuffer* GetBuffer() const;
+	unsigned int GetSize() const;
+	const DynamicBufferStatistics& GetStatistics() const;
+
+private:
+	DynamicBuffer(const DynamicBuffer&);
+	DynamicBuffer& operator=(const DynamicBuffer&);
+
+	RenderBackend* mBackend;
+	BackendBuffer* mBuffer;
+	RingAllocator mAllocator;
+	bool mWritten;		// Whether the buffer has been written to yet, the first map must discard.
+	DynamicBufferStatistics mStatistics;
+};
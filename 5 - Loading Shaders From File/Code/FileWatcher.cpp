@@ -0,0 +1,235 @@
+// ###########################################################################################
+// ## Watches a folder for files being written, using inotify on Linux and
+// ## ReadDirectoryChangesW on Windows.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "FileWatcher.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+FileWatcher::FileWatcher()
+	: mDirectory(INVALID_HANDLE_VALUE)
+	, mEvent(NULL)
+	, mOverlapped(nullptr)
+	, mReadPending(false)
+	, mBuffer(16 * 1024)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	Close();
+}
+
+bool FileWatcher::Watch(const std::string& directory)
+{
+	Close();
+
+	// The folder is opened for overlapped reads, so waiting for changes can time out.
+	mDirectory = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	if (mDirectory == INVALID_HANDLE_VALUE)
+		return false;
+
+	mEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	OVERLAPPED* overlapped = new OVERLAPPED();
+	overlapped->hEvent = mEvent;
+	mOverlapped = overlapped;
+	return true;
+}
+
+std::vector<std::string> FileWatcher::WaitForChanges(unsigned int timeoutMilliseconds)
+{
+	std::vector<std::string> names;
+	if (mDirectory == INVALID_HANDLE_VALUE)
+		return names;
+
+	OVERLAPPED* overlapped = static_cast<OVERLAPPED*>(mOverlapped);
+	if (!mReadPending)
+	{
+		ResetEvent(mEvent);
+		if (!ReadDirectoryChangesW(mDirectory, mBuffer.data(), static_cast<DWORD>(mBuffer.size() * sizeof(unsigned int)), FALSE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, NULL, overlapped, NULL))
+		{
+			return names;
+		}
+
+		mReadPending = true;
+	}
+
+	if (WaitForSingleObject(mEvent, timeoutMilliseconds) != WAIT_OBJECT_0)
+		return names;
+
+	mReadPending = false;
+	DWORD bytes = 0;
+	if (!GetOverlappedResult(mDirectory, overlapped, &bytes, FALSE) || bytes == 0)
+		return names;
+
+	const unsigned char* record = reinterpret_cast<const unsigned char*>(mBuffer.data());
+	for (;;)
+	{
+		const FILE_NOTIFY_INFORMATION* information = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record);
+		if (information->Action == FILE_ACTION_MODIFIED || information->Action == FILE_ACTION_ADDED ||
+			information->Action == FILE_ACTION_RENAMED_NEW_NAME)
+		{
+			// The shader file names used by the samples only contain ASCII characters.
+			std::string name;
+			for (DWORD i = 0; i < information->FileNameLength / sizeof(WCHAR); ++i)
+				name += static_cast<char>(information->FileName[i]);
+			names.push_back(name);
+		}
+
+		if (information->NextEntryOffset == 0)
+			break;
+		record += information->NextEntryOffset;
+	}
+
+	return names;
+}
+
+void FileWatcher::Close()
+{
+	if (mDirectory != INVALID_HANDLE_VALUE)
+	{
+		CancelIo(mDirectory);
+		if (mReadPending)
+		{
+			DWORD bytes;
+			GetOverlappedResult(mDirectory, static_cast<OVERLAPPED*>(mOverlapped), &bytes, TRUE);
+		}
+		CloseHandle(mDirectory);
+	}
+	if (mEvent != NULL)
+		CloseHandle(mEvent);
+	delete static_cast<OVERLAPPED*>(mOverlapped);
+
+	mDirectory = INVALID_HANDLE_VALUE;
+	mEvent = NULL;
+	mOverlapped = nullptr;
+	mReadPending = false;
+}
+
+#elif defined(__linux__)
+
+FileWatcher::FileWatcher()
+	: mInotify(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	Close();
+}
+
+bool FileWatcher::Watch(const std::string& directory)
+{
+	Close();
+
+	mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (mInotify < 0)
+		return false;
+
+	// Editors either write the file in place (closing it when done) or write a new file and
+	// move it over the old one.
+	if (inotify_add_watch(mInotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<std::string> FileWatcher::WaitForChanges(unsigned int timeoutMilliseconds)
+{
+	std::vector<std::string> names;
+	if (mInotify < 0)
+		return names;
+
+	pollfd descriptor;
+	descriptor.fd = mInotify;
+	descriptor.events = POLLIN;
+	descriptor.revents = 0;
+	if (poll(&descriptor, 1, static_cast<int>(timeoutMilliseconds)) <= 0)
+		return names;
+
+	// Events are variable sized: an inotify_event followed by the name.
+	alignas(inotify_event) char buffer[4096];
+	for (;;)
+	{
+		ssize_t bytes = read(mInotify, buffer, sizeof(buffer));
+		if (bytes <= 0)
+			break;
+
+		for (ssize_t offset = 0; offset < bytes; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len > 0)
+				names.push_back(event->name);
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+
+	return names;
+}
+
+void FileWatcher::Close()
+{
+	if (mInotify >= 0)
+		close(mInotify);
+
+	mInotify = -1;
+}
+
+#else
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+bool FileWatcher::Watch(const std::string& directory)
+{
+	(void)directory;
+	return false;
+}
+
+std::vector<std::string> FileWatcher::WaitForChanges(unsigned int timeoutMilliseconds)
+{
+	(void)timeoutMilliseconds;
+	return std::vector<std::string>();
+}
+
+void FileWatcher::Close()
+{
+}
+
+#endif
@@ -0,0 +1,59 @@
+// ###########################################################################################
+// ## Watches a folder for files being written, using inotify on Linux and
+// ## ReadDirectoryChangesW on Windows.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	// Starts watching the files directly inside directory. Returns false if the folder can't be
+	// watched, or if watching isn't supported on this platform.
+	bool Watch(const std::string& directory);
+
+	// Waits up to timeoutMilliseconds for files to be written, and returns the names (without
+	// folders) of the files that were. A file may be listed more than once, and the list may be
+	// empty even if the time hasn't run out.
+	std::vector<std::string> WaitForChanges(unsigned int timeoutMilliseconds);
+
+private:
+	// Watchers can't be copied, as the handles would be closed twice.
+	FileWatcher(const FileWatcher&);
+	FileWatcher& operator=(const FileWatcher&);
+
+	void Close();
+
+#if defined(_WIN32)
+	void* mDirectory;
+	void* mEvent;
+	void* mOverlapped;		// An OVERLAPPED, allocated to keep Windows.h out of this header.
+	bool mReadPending;
+	std::vector<unsigned int> mBuffer;	// FILE_NOTIFY_INFORMATION records, which are DWORD aligned.
+#elif defined(__linux__)
+	int mInotify;
+#endif
+};
@@ -0,0 +1,204 @@
+// ###########################################################################################
+// ## Linear arenas for memory that only lives for a frame, reset all at once at the start of
+// ## the frame instead of freed allocation by allocation.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+LinearArena::LinearArena(size_t size)
+	: mMemory(new unsigned char[size])
+	, mSize(size)
+	, mUsedSize(0)
+	, mOverflowSize(0)
+	, mHighWaterMark(0)
+	, mOverflowCount(0)
+{
+}
+
+LinearArena::~LinearArena()
+{
+	Reset();
+	delete[] mMemory;
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	// Align the address rather than the offset, the block itself is only aligned for the
+	// fundamental types.
+	uintptr_t start = reinterpret_cast<uintptr_t>(mMemory) + mUsedSize;
+	uintptr_t aligned = (start + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+	size_t end = static_cast<size_t>(aligned - reinterpret_cast<uintptr_t>(mMemory)) + size;
+
+	void* memory;
+	if (end <= mSize)
+	{
+		memory = reinterpret_cast<void*>(aligned);
+		mUsedSize = end;
+	}
+	else
+	{
+		// The block is full. Each allocation that doesn't fit gets a heap block of its own,
+		// large enough to be aligned within.
+		unsigned char* block = new unsigned char[size + alignment - 1];
+		mOverflowBlocks.push_back(block);
+		mOverflowSize += size + alignment - 1;
+		++mOverflowCount;
+
+		uintptr_t blockStart = reinterpret_cast<uintptr_t>(block);
+		memory = reinterpret_cast<void*>((blockStart + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+	}
+
+	mHighWaterMark = std::max(mHighWaterMark, mUsedSize + mOverflowSize);
+	return memory;
+}
+
+void LinearArena::Reset()
+{
+	for (unsigned char* block : mOverflowBlocks)
+		delete[] block;
+	mOverflowBlocks.clear();
+
+	mUsedSize = 0;
+	mOverflowSize = 0;
+}
+
+size_t LinearArena::GetSize() const
+{
+	return mSize;
+}
+
+size_t LinearArena::GetUsedSize() const
+{
+	return mUsedSize + mOverflowSize;
+}
+
+size_t LinearArena::GetHighWaterMark() const
+{
+	return mHighWaterMark;
+}
+
+unsigned long long LinearArena::GetOverflowCount() const
+{
+	return mOverflowCount;
+}
+
+FrameArenaDesc::FrameArenaDesc()
+	: frameCount(2)
+	, size(1024 * 1024)
+	, threadCount(0)
+	, threadArenaSize(256 * 1024)
+{
+}
+
+FrameArenaStatistics::FrameArenaStatistics()
+	: frames(0)
+	, highWaterMark(0)
+	, threadHighWaterMark(0)
+	, overflows(0)
+{
+}
+
+FrameArena::FrameArena(const FrameArenaDesc& desc)
+	: mFrameCount(std::min(std::max(desc.frameCount, 1u), FRAME_ARENA_MAX_FRAMES))
+	, mThreadCount(desc.threadCount)
+	, mFrameIndex(0)
+	, mFrames(0)
+{
+	for (unsigned int frame = 0; frame < mFrameCount; ++frame)
+	{
+		mArenas.push_back(new LinearArena(desc.size));
+		for (unsigned int thread = 0; thread < mThreadCount; ++thread)
+			mThreadArenas.push_back(new LinearArena(desc.threadArenaSize));
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	for (LinearArena* arena : mArenas)
+		delete arena;
+	for (LinearArena* arena : mThreadArenas)
+		delete arena;
+}
+
+void FrameArena::BeginFrame()
+{
+	// The arenas of the frame frameCount - 1 frames ago are reused, the others keep their data.
+	mFrameIndex = (mFrameIndex + 1) % mFrameCount;
+	mArenas[mFrameIndex]->Reset();
+	for (unsigned int thread = 0; thread < mThreadCount; ++thread)
+		mThreadArenas[mFrameIndex * mThreadCount + thread]->Reset();
+
+	++mFrames;
+}
+
+LinearArena& FrameArena::GetArena()
+{
+	return *mArenas[mFrameIndex];
+}
+
+LinearArena& FrameArena::GetThreadArena(unsigned int threadIndex)
+{
+	return *mThreadArenas[mFrameIndex * mThreadCount + threadIndex];
+}
+
+unsigned int FrameArena::GetFrameCount() const
+{
+	return mFrameCount;
+}
+
+unsigned int FrameArena::GetThreadCount() const
+{
+	return mThreadCount;
+}
+
+FrameArenaStatistics FrameArena::GetStatistics() const
+{
+	FrameArenaStatistics statistics;
+	statistics.frames = mFrames;
+	for (const LinearArena* arena : mArenas)
+	{
+		statistics.highWaterMark = std::max(statistics.highWaterMark, arena->GetHighWaterMark());
+		statistics.overflows += arena->GetOverflowCount();
+	}
+	for (const LinearArena* arena : mThreadArenas)
+	{
+		statistics.threadHighWaterMark = std::max(statistics.threadHighWaterMark, arena->GetHighWaterMark());
+		statistics.overflows += arena->GetOverflowCount();
+	}
+
+	return statistics;
+}
+
+void FrameArena::PrintReport() const
+{
+	FrameArenaStatistics statistics = GetStatistics();
+	std::cout << "Frame arena: " << statistics.frames << " frames, " << mFrameCount << " buffered" << std::endl;
+	std::cout << "  Render thread: " << statistics.highWaterMark << " of " << mArenas[0]->GetSize() << " bytes used at most" << std::endl;
+	if (mThreadCount != 0)
+	{
+		std::cout << "  Threads:       " << statistics.threadHighWaterMark << " of " << mThreadArenas[0]->GetSize()
+			<< " bytes used at most by one of " << mThreadCount << std::endl;
+	}
+	std::cout << "  Overflows:     " << statistics.overflows << " allocations went to the heap" << std::endl;
+}
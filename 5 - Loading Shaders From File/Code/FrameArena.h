@@ -0,0 +1,142 @@
+// ###########################################################################################
+// ## Linear arenas for memory that only lives for a frame, reset all at once at the start of
+// ## the frame instead of freed allocation by allocation.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// The most frames a FrameArena can keep apart.
+const unsigned int FRAME_ARENA_MAX_FRAMES = 3;
+
+// Hands out memory by moving an offset through a block allocated up front, so an allocation
+// costs a few instructions and never locks. Allocations can't be freed one by one: Reset()
+// frees all of them at once by moving the offset back to the start. No destructors are run,
+// so only trivially destructible data (vertices, keys, draw descriptions...) should be put in
+// an arena. An arena must only be used by one thread at a time.
+class LinearArena
+{
+public:
+	explicit LinearArena(size_t size);
+	~LinearArena();
+
+	// Returns size bytes at a multiple of alignment, which must be a power of two. When the
+	// block is full the memory comes from the heap instead and is freed by the next Reset(),
+	// so running out is slow rather than fatal. The high-water mark shows how big the block
+	// should have been.
+	void* Allocate(size_t size, size_t alignment);
+
+	// Returns uninitialised memory for count objects of type T.
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * count, std::alignment_of<T>::value));
+	}
+
+	// Frees everything allocated since the last reset.
+	void Reset();
+
+	size_t GetSize() const;
+	size_t GetUsedSize() const;			// Including what overflowed to the heap and alignment padding.
+	size_t GetHighWaterMark() const;	// The most ever used between two resets.
+	unsigned long long GetOverflowCount() const;	// Allocations that didn't fit in the block.
+
+private:
+	LinearArena(const LinearArena&);
+	LinearArena& operator=(const LinearArena&);
+
+	unsigned char* mMemory;
+	size_t mSize;
+	size_t mUsedSize;
+	size_t mOverflowSize;
+	size_t mHighWaterMark;
+	unsigned long long mOverflowCount;
+	std::vector<unsigned char*> mOverflowBlocks;
+};
+
+struct FrameArenaDesc
+{
+	FrameArenaDesc();
+
+	unsigned int frameCount;	// 2 for double buffering, 3 for triple buffering.
+	size_t size;				// The size of the arena for the thread rendering the frame.
+	unsigned int threadCount;	// The threads with an arena of their own, see GetThreadArena().
+	size_t threadArenaSize;
+};
+
+// How much of its arenas a FrameArena has needed.
+struct FrameArenaStatistics
+{
+	FrameArenaStatistics();
+
+	unsigned long long frames;
+	size_t highWaterMark;			// Of the arenas returned by GetArena().
+	size_t threadHighWaterMark;		// Of the thread arena that has needed the most.
+	unsigned long long overflows;	// Allocations that had to go to the heap, in every arena.
+};
+
+// A set of linear arenas for each of the last frameCount frames. BeginFrame() moves on to the
+// arenas of the oldest frame and resets them, so memory allocated in a frame stays valid while
+// the next frameCount - 1 frames are built. With double buffering, data from the previous frame
+// can still be read (e.g. to compare against) while the current one is written, and with triple
+// buffering it can be held onto until a backend a frame behind is done with it.
+//
+// Besides the arena for the thread rendering the frame, each thread of a ThreadPool has its own
+// arena, so worker threads can allocate without locking or sharing cache lines.
+class FrameArena
+{
+public:
+	explicit FrameArena(const FrameArenaDesc& desc);
+	~FrameArena();
+
+	// Call once at the start of every frame, before anything is allocated for it.
+	void BeginFrame();
+
+	// The current frame's arena for the thread rendering the frame.
+	LinearArena& GetArena();
+
+	// The current frame's arena for a thread, where threadIndex is the one passed by
+	// ThreadPool::ParallelFor() and must be less than the desc's threadCount.
+	LinearArena& GetThreadArena(unsigned int threadIndex);
+
+	unsigned int GetFrameCount() const;
+	unsigned int GetThreadCount() const;
+	FrameArenaStatistics GetStatistics() const;
+
+	// Writes the high-water marks to the console, to help pick the arena sizes.
+	void PrintReport() const;
+
+private:
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	unsigned int mFrameCount;
+	unsigned int mThreadCount;
+	unsigned int mFrameIndex;
+	unsigned long long mFrames;
+
+	// mArenas[frame] is the main arena of a frame, mThreadArenas[frame * mThreadCount + thread]
+	// the arenas of its threads.
+	std::vector<LinearArena*> mArenas;
+	std::vector<LinearArena*> mThreadArenas;
+};
@@ -0,0 +1,160 @@
+// ###########################################################################################
+// ## Paces the frames of the main loop: waits (mostly sleeping) until the next frame is due,
+// ## runs the scene's fixed time step updates and smooths the measured frame times.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX	// Windows.h would otherwise define min and max macros, breaking std::min and std::max.
+#include <Windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// The first guess of how much longer a sleep lasts than asked for, before any are measured.
+static const double INITIAL_SLEEP_MARGIN = 0.002;
+
+// How much the measured oversleep shrinks each time the clock is slept, so one slow wake-up
+// (e.g. the thread being moved to another core) doesn't make the scheduler spin for ever.
+static const double SLEEP_MARGIN_DECAY = 0.99;
+
+SystemFrameClock::SystemFrameClock()
+	: mTickFrequency(GetProfileTickFrequency())
+{
+#if defined(_WIN32)
+	timeBeginPeriod(1);
+#endif
+}
+
+SystemFrameClock::~SystemFrameClock()
+{
+#if defined(_WIN32)
+	timeEndPeriod(1);
+#endif
+}
+
+double SystemFrameClock::Now()
+{
+	// The whole seconds are divided out first so the fraction keeps its precision however long
+	// the counter has been running.
+	unsigned long long ticks = ReadProfileTicks();
+	return static_cast<double>(ticks / mTickFrequency) + static_cast<double>(ticks % mTickFrequency) / mTickFrequency;
+}
+
+void SystemFrameClock::Sleep(double seconds)
+{
+	if (seconds > 0.0)
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+	else
+		std::this_thread::yield();
+}
+
+FrameScheduler::FrameScheduler(FrameClock* clock, const FrameSchedulerDesc& desc)
+	: mClock(clock), mDesc(desc), mFramePeriod(0.0), mAccumulator(0.0), mFrameTime(0.0),
+	mSmoothedFrameTime(0.0), mSleepMargin(INITIAL_SLEEP_MARGIN), mFrameCount(0), mDroppedSteps(0)
+{
+	if (mDesc.targetFrameRate > 0.0)
+		mFramePeriod = 1.0 / mDesc.targetFrameRate;
+
+	mLastFrameTime = mClock->Now();
+	mNextFrameTime = mLastFrameTime + mFramePeriod;
+}
+
+unsigned int FrameScheduler::BeginFrame()
+{
+	if (mFramePeriod > 0.0)
+	{
+		WaitUntil(mNextFrameTime);
+
+		// Keep the frames on a steady schedule, unless this one is so late that keeping to it
+		// would mean running the next frames back to back.
+		mNextFrameTime += mFramePeriod;
+		double now = mClock->Now();
+		if (now > mNextFrameTime)
+			mNextFrameTime = now + mFramePeriod;
+	}
+
+	double now = mClock->Now();
+	mFrameTime = now - mLastFrameTime;
+	mLastFrameTime = now;
+
+	if (mFrameCount == 0)
+		mSmoothedFrameTime = mFrameTime;
+	else
+		mSmoothedFrameTime += (mFrameTime - mSmoothedFrameTime) * mDesc.smoothing;
+	++mFrameCount;
+
+	// Advance the scene in fixed steps covering the time since the last frame. What is left
+	// over is carried to the next frame.
+	mAccumulator += std::min(mFrameTime, mDesc.maxFrameTime);
+	unsigned int steps = static_cast<unsigned int>(std::floor(mAccumulator / mDesc.fixedTimeStep));
+	if (steps > mDesc.maxStepsPerFrame)
+	{
+		// The scene can't keep up: drop the steps that don't fit, so it runs slower instead of
+		// falling further and further behind.
+		mDroppedSteps += steps - mDesc.maxStepsPerFrame;
+		steps = mDesc.maxStepsPerFrame;
+		mAccumulator = std::fmod(mAccumulator, mDesc.fixedTimeStep);
+	}
+	else
+	{
+		mAccumulator -= steps * mDesc.fixedTimeStep;
+	}
+
+	return steps;
+}
+
+double FrameScheduler::GetInterpolation() const
+{
+	return std::min(mAccumulator / mDesc.fixedTimeStep, 1.0);
+}
+
+void FrameScheduler::WaitUntil(double deadline)
+{
+	TraceZone zone("WaitForFrame");
+
+	// Sleep while the deadline is further away than a sleep may overshoot by, which leaves the
+	// core free for other work. The last moment is spent yielding, checking the time, which is
+	// accurate but keeps the core busy.
+	double now = mClock->Now();
+	while (deadline - now > mSleepMargin)
+	{
+		double requested = deadline - now - mSleepMargin;
+		mClock->Sleep(requested);
+		double woken = mClock->Now();
+
+		double oversleep = woken - now - requested;
+		mSleepMargin = std::max(mSleepMargin * SLEEP_MARGIN_DECAY, oversleep);
+		now = woken;
+	}
+
+	while (now < deadline)
+	{
+		mClock->Sleep(0.0);
+		now = mClock->Now();
+	}
+}
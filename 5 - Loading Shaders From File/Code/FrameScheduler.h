@@ -0,0 +1,114 @@
+// ###########################################################################################
+// ## Paces the frames of the main loop: waits (mostly sleeping) until the next frame is due,
+// ## runs the scene's fixed time step updates and smooths the measured frame times.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+// The time source of a FrameScheduler. The scheduler only asks the clock for the time and to
+// sleep, so a made up clock can be given to check the pacing without waiting for real time to
+// pass (see RunPacingBenchmark() in Benchmarks.cpp).
+class FrameClock
+{
+public:
+	virtual ~FrameClock() {}
+
+	// Returns the time in seconds since some fixed point, never going backwards.
+	virtual double Now() = 0;
+
+	// Sleeps for about the given number of seconds. Sleeping usually takes a bit longer than
+	// asked for; the scheduler measures by how much and wakes up early enough to make up for it.
+	// Sleep(0.0) gives up the rest of the thread's time slice.
+	virtual void Sleep(double seconds) = 0;
+};
+
+// The real time, from the profiler's tick counter (see ReadProfileTicks()), which is
+// QueryPerformanceCounter on Windows: std::chrono::steady_clock only ticks in milliseconds in
+// older versions of Visual Studio. On Windows the timer resolution is raised to 1 ms while the
+// clock exists, otherwise a sleep may last up to 15.6 ms.
+class SystemFrameClock : public FrameClock
+{
+public:
+	SystemFrameClock();
+	~SystemFrameClock() override;
+
+	double Now() override;
+	void Sleep(double seconds) override;
+
+private:
+	unsigned long long mTickFrequency;
+};
+
+struct FrameSchedulerDesc
+{
+	double targetFrameRate;			// Frames per second to pace to. Zero runs frames as fast as possible.
+	double fixedTimeStep;			// Seconds the scene is advanced by in each Update().
+	unsigned int maxStepsPerFrame;	// The most updates run in a frame, so a slow frame can't make the next one slower still.
+	double maxFrameTime;			// Longer frames (e.g. after a breakpoint) are counted as this long.
+	double smoothing;				// How much each frame's time moves the smoothed frame time, in (0, 1].
+
+	// 60 frames and 60 updates per second.
+	FrameSchedulerDesc()
+		: targetFrameRate(60.0), fixedTimeStep(1.0 / 60.0), maxStepsPerFrame(5), maxFrameTime(0.25), smoothing(0.1)
+	{
+	}
+};
+
+class FrameScheduler
+{
+public:
+	// The clock is not owned by the scheduler and must outlive it.
+	FrameScheduler(FrameClock* clock, const FrameSchedulerDesc& desc);
+
+	// Waits until the next frame is due and measures the time since the last frame. Returns the
+	// number of fixed time steps to update the scene by before rendering the frame.
+	//
+	// Frames are due at a steady rate: if a frame is a little late, the next one is due a little
+	// sooner. If a frame is more than a whole frame late, the schedule starts over from now
+	// instead of rushing several frames out to catch up.
+	unsigned int BeginFrame();
+
+	// How far between the last two updates the frame is, in [0, 1). Rendering can interpolate
+	// between the previous and the current state with it, so motion stays smooth when the frame
+	// rate isn't a multiple of the update rate.
+	double GetInterpolation() const;
+
+	double GetFixedTimeStep() const { return mDesc.fixedTimeStep; }
+	double GetFrameTime() const { return mFrameTime; }					// The measured time of the last frame.
+	double GetSmoothedFrameTime() const { return mSmoothedFrameTime; }	// The exponential moving average of the frame times.
+	double GetSleepMargin() const { return mSleepMargin; }				// How early the scheduler stops sleeping.
+	unsigned long long GetFrameCount() const { return mFrameCount; }
+	unsigned long long GetDroppedSteps() const { return mDroppedSteps; }	// Updates skipped because of maxStepsPerFrame.
+
+private:
+	void WaitUntil(double deadline);
+
+	FrameClock* mClock;
+	FrameSchedulerDesc mDesc;
+	double mFramePeriod;		// Zero when not pacing.
+	double mNextFrameTime;
+	double mLastFrameTime;
+	double mAccumulator;		// Time not yet covered by fixed time steps.
+	double mFrameTime;
+	double mSmoothedFrameTime;
+	double mSleepMargin;
+	unsigned long long mFrameCount;
+	unsigned long long mDroppedSteps;
+};
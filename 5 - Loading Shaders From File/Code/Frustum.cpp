@@ -0,0 +1,83 @@
+// ###########################################################################################
+// ## The planes of a view frustum, for culling what the camera can't see.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "Frustum.h"
+
+#include <cmath>
+
+void ExtractFrustum(const Float4x4& viewProjection, const Float3x4& world, Frustum& frustum)
+{
+	// The rows of viewProjection * world, with world's missing last row being (0, 0, 0, 1).
+	float rows[4][4];
+	for (int i = 0; i < 4; ++i)
+	{
+		const Float4& row = viewProjection.rows[i];
+		for (int j = 0; j < 4; ++j)
+		{
+			rows[i][j] = row.x * (&world.rows[0].x)[j] + row.y * (&world.rows[1].x)[j] + row.z * (&world.rows[2].x)[j] +
+				(j == 3 ? row.w : 0.0f);
+		}
+	}
+
+	// A point p is inside when each of these combinations of its clip space coordinates is
+	// positive (Gribb and Hartmann's "Fast Extraction of Viewing Frustum Planes").
+	for (int j = 0; j < 4; ++j)
+	{
+		(&frustum.planes[0].x)[j] = rows[3][j] + rows[0][j];	// Left, x >= -w.
+		(&frustum.planes[1].x)[j] = rows[3][j] - rows[0][j];	// Right, x <= w.
+		(&frustum.planes[2].x)[j] = rows[3][j] + rows[1][j];	// Bottom, y >= -w.
+		(&frustum.planes[3].x)[j] = rows[3][j] - rows[1][j];	// Top, y <= w.
+		(&frustum.planes[4].x)[j] = rows[2][j];					// Near, z >= 0.
+		(&frustum.planes[5].x)[j] = rows[3][j] - rows[2][j];	// Far, z <= w.
+	}
+
+	for (Float4& plane : frustum.planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		plane = Float4(plane.x * scale, plane.y * scale, plane.z * scale, plane.w * scale);
+	}
+}
+
+bool IsSphereInFrustum(const Frustum& frustum, const Float3& centre, float radius)
+{
+	for (const Float4& plane : frustum.planes)
+	{
+		if (plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool IsBoxInFrustum(const Frustum& frustum, const BoundingBox& box)
+{
+	for (const Float4& plane : frustum.planes)
+	{
+		float x = plane.x > 0.0f ? box.maximum.x : box.minimum.x;
+		float y = plane.y > 0.0f ? box.maximum.y : box.minimum.y;
+		float z = plane.z > 0.0f ? box.maximum.z : box.minimum.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,54 @@
+// ###########################################################################################
+// ## The planes of a view frustum, for culling what the camera can't see.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "MathTypes.h"
+
+// The six planes bounding what a view-projection can see, in the order left, right, bottom,
+// top, near and far. A plane (x, y, z, w) holds the points p with x * p.x + y * p.y + z * p.z +
+// w = 0; the normal (x, y, z) has a length of 1 and points into the frustum, so the expression
+// is the distance of p from the plane, positive inside.
+struct Frustum
+{
+	Float4 planes[6];
+};
+
+// An axis aligned box, from its smallest to its largest corner.
+struct BoundingBox
+{
+	Float3 minimum;
+	Float3 maximum;
+};
+
+// Finds the planes of the frustum seen through viewProjection, in the space world moves
+// points from. With the identity as world they are in world space, with an object's world
+// matrix they are in the object's own space, where its bounds can be tested as they are.
+// Clip space is Direct3D's: -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+void ExtractFrustum(const Float4x4& viewProjection, const Float3x4& world, Frustum& frustum);
+
+// Returns false if the sphere is entirely outside one of the planes. Spheres near a corner of
+// the frustum may be outside it without this noticing, so true means it may be visible.
+bool IsSphereInFrustum(const Frustum& frustum, const Float3& centre, float radius);
+
+// Returns false if the box is entirely outside one of the planes, testing the corner furthest
+// along each plane's normal. Like IsSphereInFrustum(), true means it may be visible.
+bool IsBoxInFrustum(const Frustum& frustum, const BoundingBox& box);
@@ -0,0 +1,213 @@
+// ###########################################################################################
+// ## Runs the sample's scene on the SoftwareBackend without a window or GPU, and reports how
+// ## fast it renders. Usage:
+// ##   MWS-Headless [-width W] [-height H] [-frames N] [-isa scalar|sse41|avx2]
+// ##                [-threads T] [-output image.ppm]
+// ##   MWS-Headless -benchmark <name>
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Benchmarks.h"
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "SoftwareBackend.h"
+#include "StateFilterBackend.h"
+
+// Headless forward declarations.
+bool WriteBackBuffer(const SoftwareBackend& backend, const char* path);
+
+// Startup is timed like in the windowed program, see main.cpp.
+ProfileSection gSetupSceneSection("SetupScene");
+
+int main(int argc, char* argv[])
+{
+	unsigned int width = 800;
+	unsigned int height = 600;
+	unsigned int frameCount = 1000;
+	const char* outputPath = nullptr;
+	const char* profilePath = nullptr;	// CSV, or JSON if the name ends with .json.
+	const char* tracePath = nullptr;
+	const char* convertPath = nullptr;	// An OBJ or PLY file to convert to a mesh file at outputPath.
+	unsigned int threadCount = 0;	// Zero uses the backend's default.
+	double frameRate = 0.0;			// Zero renders as fast as possible.
+	RasteriserISA isa = DetectRasteriserISA();
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-width") == 0)
+			width = static_cast<unsigned int>(atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "-height") == 0)
+			height = static_cast<unsigned int>(atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "-frames") == 0)
+			frameCount = static_cast<unsigned int>(atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "-threads") == 0)
+			threadCount = static_cast<unsigned int>(atoi(argv[i + 1]));
+		else if (strcmp(argv[i], "-fps") == 0)
+			frameRate = atof(argv[i + 1]);
+		else if (strcmp(argv[i], "-output") == 0)
+			outputPath = argv[i + 1];
+		else if (strcmp(argv[i], "-profile") == 0)
+			profilePath = argv[i + 1];
+		else if (strcmp(argv[i], "-trace") == 0)
+			tracePath = argv[i + 1];
+		else if (strcmp(argv[i], "-isa") == 0)
+			isa = strcmp(argv[i + 1], "avx2") == 0 ? RasteriserISA::AVX2 : strcmp(argv[i + 1], "sse41") == 0 ? RasteriserISA::SSE41 : RasteriserISA::Scalar;
+		else if (strcmp(argv[i], "-convert") == 0)
+			convertPath = argv[i + 1];
+		else if (strcmp(argv[i], "-benchmark") == 0)
+			return RunBenchmark(argv[i + 1]) ? 0 : -1;
+	}
+
+	// Converting a mesh is done instead of rendering, writing the mesh file to the output path.
+	if (convertPath != nullptr)
+	{
+		if (outputPath == nullptr || !ConvertMesh(convertPath, outputPath))
+		{
+			std::cout << "ERROR: Could not convert " << convertPath << (outputPath != nullptr ? " to " : "")
+				<< (outputPath != nullptr ? outputPath : "") << std::endl;
+			return -1;
+		}
+
+		std::cout << "Converted " << convertPath << " to " << outputPath << std::endl;
+		return 0;
+	}
+
+	if (width == 0 || height == 0 || frameCount == 0)
+	{
+		std::cout << "ERROR: width, height and frames must be larger than zero" << std::endl;
+		return -1;
+	}
+
+	SetTraceThreadName("Main");
+	SoftwareBackend backend(width, height);
+	if (!backend.SetRasteriserISA(isa))
+	{
+		std::cout << "ERROR: " << GetRasteriserISAName(isa) << " is not supported by this CPU" << std::endl;
+		return -1;
+	}
+
+	if (threadCount != 0)
+		backend.SetThreadCount(threadCount);
+
+	if (tracePath != nullptr && !StartTrace(tracePath))
+	{
+		std::cout << "ERROR: Could not write " << tracePath << std::endl;
+		return -1;
+	}
+
+	bool sceneReady;
+	{
+		ProfileScope scope(gSetupSceneSection);
+		sceneReady = SetupScene(&backend);
+	}
+	PrintShaderCompileReport();
+	if (!sceneReady)
+	{
+		std::cout << "ERROR: Could not create the scene's shaders and pipeline state" << std::endl;
+		ReleaseScene();
+		StopTrace();
+		return -1;
+	}
+
+	// Render one frame before measuring so the first frame's allocations aren't counted.
+	Render();
+	backend.ResetStatistics();
+
+	// Frames are run like in the windowed program, but only paced if a frame rate is given.
+	SystemFrameClock clock;
+	FrameSchedulerDesc schedulerDesc;
+	schedulerDesc.targetFrameRate = frameRate;
+	FrameScheduler scheduler(&clock, schedulerDesc);
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < frameCount; ++i)
+	{
+		unsigned int steps = scheduler.BeginFrame();
+		for (unsigned int step = 0; step < steps; ++step)
+			Update(scheduler.GetFixedTimeStep());
+		Render();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	StopTrace();
+
+	const SoftwareStatistics& statistics = backend.GetStatistics();
+	const StateFilterStatistics& filterStatistics = GetStateFilterStatistics();
+	double seconds = elapsed.count();
+	std::cout << "Rendered " << statistics.framesPresented << " frames at " << width << "x" << height
+		<< " in " << seconds * 1000.0 << " ms using " << GetRasteriserISAName(isa) << " and " << backend.GetThreadCount() << " threads" << std::endl;
+	std::cout << "  Frames/s:      " << statistics.framesPresented / seconds << std::endl;
+	std::cout << "  Triangles/s:   " << statistics.trianglesRasterised / seconds << std::endl;
+	std::cout << "  Mpixels/s:     " << statistics.pixelsShaded / seconds / 1.0e6 << " shaded, "
+		<< statistics.pixelsCleared / seconds / 1.0e6 << " cleared" << std::endl;
+	std::cout << "  Binds:         " << filterStatistics.bindsIssued << " issued, " << filterStatistics.bindsElided
+		<< " elided of " << filterStatistics.bindCalls << " calls" << std::endl;
+	if (frameRate > 0.0)
+	{
+		std::cout << "  Frame time:    " << scheduler.GetSmoothedFrameTime() * 1000.0 << " ms smoothed, "
+			<< 1000.0 / frameRate << " ms target" << std::endl;
+	}
+
+	// Join the recording threads and free the scene's resources. The back buffer belongs to
+	// the backend and is still written below.
+	ReleaseScene();
+
+	PrintProfileReport();
+	if (profilePath != nullptr)
+	{
+		size_t length = strlen(profilePath);
+		bool json = length >= 5 && strcmp(profilePath + length - 5, ".json") == 0;
+		if (!(json ? WriteProfileJSON(profilePath) : WriteProfileCSV(profilePath)))
+		{
+			std::cout << "ERROR: Could not write " << profilePath << std::endl;
+			return -1;
+		}
+	}
+
+	if (outputPath != nullptr && !WriteBackBuffer(backend, outputPath))
+	{
+		std::cout << "ERROR: Could not write " << outputPath << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+// Writes the back buffer as a binary PPM image, dropping the alpha channel.
+bool WriteBackBuffer(const SoftwareBackend& backend, const char* path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	file << "P6\n" << backend.GetWidth() << " " << backend.GetHeight() << "\n255\n";
+
+	const unsigned char* pixels = backend.GetBackBufferData();
+	size_t pixelCount = static_cast<size_t>(backend.GetWidth()) * backend.GetHeight();
+	for (size_t i = 0; i < pixelCount; ++i)
+		file.write(reinterpret_cast<const char*>(pixels + i * 4), 3);
+
+	return file.good();
+}
@@ -0,0 +1,82 @@
+// ###########################################################################################
+// ## Builds the per instance data for instanced draws on the CPU: a transform and a tint for
+// ## each copy of a mesh, gathered into batches that share one instance buffer.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "InstanceBuffer.h"
+
+InstanceBufferBuilder::InstanceBufferBuilder()
+	: mBatchStart(0)
+{
+}
+
+void InstanceBufferBuilder::Add(const Float3x4& transform, const Float4& tint)
+{
+	mInstances.push_back(Instance(transform, UByteN4(tint)));
+}
+
+InstanceBatch InstanceBufferBuilder::EndBatch()
+{
+	InstanceBatch batch;
+	batch.startInstanceLocation = mBatchStart;
+	batch.instanceCount = static_cast<unsigned int>(mInstances.size()) - mBatchStart;
+	mBatchStart = static_cast<unsigned int>(mInstances.size());
+	return batch;
+}
+
+void InstanceBufferBuilder::Clear()
+{
+	mInstances.clear();
+	mBatchStart = 0;
+}
+
+BackendBuffer* InstanceBufferBuilder::CreateBuffer(RenderBackend* backend) const
+{
+	if (mInstances.empty())
+		return nullptr;
+
+	// The instances are read by the input assembler the same way as vertices, so the buffer is
+	// a vertex buffer, bound with Instance::STRIDE.
+	return backend->CreateVertexBuffer(mInstances.data(), GetByteWidth());
+}
+
+bool InstanceBufferBuilder::Write(DynamicBuffer& buffer, unsigned int& offset) const
+{
+	if (mInstances.empty())
+		return false;
+
+	// Instances are made of four byte components, see Instance.
+	return buffer.Write(mInstances.data(), GetByteWidth(), 4, offset);
+}
+
+const Instance* InstanceBufferBuilder::GetInstances() const
+{
+	return mInstances.data();
+}
+
+unsigned int InstanceBufferBuilder::GetInstanceCount() const
+{
+	return static_cast<unsigned int>(mInstances.size());
+}
+
+unsigned int InstanceBufferBuilder::GetByteWidth() const
+{
+	return static_cast<unsigned int>(mInstances.size()) * Instance::STRIDE;
+}
@@ -0,0 +1,87 @@
+// ###########################################################################################
+// ## Builds the per instance data for instanced draws on the CPU: a transform and a tint for
+// ## each copy of a mesh, gathered into batches that share one instance buffer.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "DynamicBuffer.h"
+#include "RenderBackend.h"
+#include "VertexFormat.h"
+
+#include <vector>
+
+// The data read for each instance by instancedVertexShader.hlsl: where the copy of the mesh is
+// placed and the colour its vertex colours are multiplied with. 52 bytes per instance.
+typedef VertexFormat<Transform, Tint<UByteN4>> Instance;
+
+// The input slot the instance buffer is bound to. The vertices of the mesh use slot 0.
+const unsigned int INSTANCE_INPUT_SLOT = 1;
+
+// Fills in the input layout of an instanced draw: the elements of the vertex format read per
+// vertex from slot 0, followed by those of Instance read per instance from INSTANCE_INPUT_SLOT.
+// elements must have room for VertexType::ELEMENT_COUNT + Instance::ELEMENT_COUNT elements.
+template <typename VertexType>
+void GetInstancedInputElements(InputElementDesc* elements)
+{
+	VertexType::GetInputElements(elements, 0);
+	Instance::GetInputElements(elements + VertexType::ELEMENT_COUNT, INSTANCE_INPUT_SLOT, InputClassification::PerInstance);
+}
+
+// A range of instances in an instance buffer, drawn with one DrawIndexedInstanced() call by
+// passing startInstanceLocation and instanceCount.
+struct InstanceBatch
+{
+	unsigned int startInstanceLocation;
+	unsigned int instanceCount;
+};
+
+// Gathers the instances of a frame. Instances of different meshes can share one buffer: add
+// the instances of a mesh, end the batch, and draw each batch with its own start location.
+class InstanceBufferBuilder
+{
+public:
+	InstanceBufferBuilder();
+
+	void Add(const Float3x4& transform, const Float4& tint);
+
+	// Ends the current batch, returning the instances added since the last batch ended.
+	InstanceBatch EndBatch();
+
+	// Removes all instances, keeping the memory for the next frame.
+	void Clear();
+
+	// Creates an immutable vertex buffer holding every instance added. Returns nullptr if there
+	// are none or the backend fails to create it.
+	BackendBuffer* CreateBuffer(RenderBackend* backend) const;
+
+	// Writes every instance added to a dynamic buffer instead, for instances that change each
+	// frame. Bind the buffer at the returned offset; the batches start from there. Returns false
+	// if there are no instances or they don't fit.
+	bool Write(DynamicBuffer& buffer, unsigned int& offset) const;
+
+	const Instance* GetInstances() const;
+	unsigned int GetInstanceCount() const;
+	unsigned int GetByteWidth() const;
+
+private:
+	std::vector<Instance> mInstances;
+	unsigned int mBatchStart;
+};
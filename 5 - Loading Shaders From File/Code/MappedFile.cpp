@@ -0,0 +1,155 @@
+// ###########################################################################################
+// ## Read-only memory mapping of files, so their contents can be used in place without
+// ## reading them into memory first.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: mData(nullptr)
+	, mSize(0)
+#if defined(_WIN32)
+	, mFileHandle(nullptr)
+	, mMappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFileHandle = file;
+	mMappingHandle = mapping;
+	mData = static_cast<const unsigned char*>(data);
+	mSize = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData != nullptr)
+		UnmapViewOfFile(mData);
+	if (mMappingHandle != nullptr)
+		CloseHandle(mMappingHandle);
+	if (mFileHandle != nullptr)
+		CloseHandle(mFileHandle);
+
+	mData = nullptr;
+	mSize = 0;
+	mFileHandle = nullptr;
+	mMappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size <= 0)
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping stays valid after the file is closed.
+	void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return false;
+
+	mData = static_cast<const unsigned char*>(data);
+	mSize = static_cast<size_t>(status.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData != nullptr)
+		munmap(const_cast<unsigned char*>(mData), mSize);
+
+	mData = nullptr;
+	mSize = 0;
+}
+
+#endif
+
+bool MappedFile::IsOpen() const
+{
+	return mData != nullptr;
+}
+
+const unsigned char* MappedFile::GetData() const
+{
+	return mData;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return mSize;
+}
@@ -0,0 +1,53 @@
+// ###########################################################################################
+// ## Read-only memory mapping of files, so their contents can be used in place without
+// ## reading them into memory first.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the whole file at path. Returns false if it can't be opened or is empty, in which
+	// case the object is left closed.
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const;
+	const unsigned char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	// Mappings can't be copied, as they would be unmapped twice.
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* mData;
+	size_t mSize;
+#if defined(_WIN32)
+	void* mFileHandle;
+	void* mMappingHandle;
+#endif
+};
@@ -0,0 +1,220 @@
+// ###########################################################################################
+// ## Small portable vector types mirroring DirectX::XMFLOAT2/3/4 and a few of the packed
+// ## types in DirectXPackedVector, so that code shared with the headless (non-Windows) build
+// ## doesn't depend on DirectXMath.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <cstring>
+
+// The layout of these structs is identical to the corresponding XMFLOAT types, so data
+// stored in them can be handed straight to Direct3D.
+struct Float2
+{
+	float x;
+	float y;
+
+	Float2() : x(0.0f), y(0.0f) {}
+	Float2(float x, float y) : x(x), y(y) {}
+};
+
+struct Float3
+{
+	float x;
+	float y;
+	float z;
+
+	Float3() : x(0.0f), y(0.0f), z(0.0f) {}
+	Float3(float x, float y, float z) : x(x), y(y), z(z) {}
+};
+
+struct Float4
+{
+	float x;
+	float y;
+	float z;
+	float w;
+
+	Float4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+	Float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+};
+
+// A 3x4 matrix stored row by row, like XMFLOAT3X4. It holds an affine transform: a point p is
+// moved to (dot(rows[0], p), dot(rows[1], p), dot(rows[2], p)) with p.w = 1, so the last
+// column is the translation. Defaults to the identity.
+struct Float3x4
+{
+	Float4 rows[3];
+
+	Float3x4()
+	{
+		rows[0] = Float4(1.0f, 0.0f, 0.0f, 0.0f);
+		rows[1] = Float4(0.0f, 1.0f, 0.0f, 0.0f);
+		rows[2] = Float4(0.0f, 0.0f, 1.0f, 0.0f);
+	}
+
+	Float3x4(const Float4& row0, const Float4& row1, const Float4& row2)
+	{
+		rows[0] = row0;
+		rows[1] = row1;
+		rows[2] = row2;
+	}
+};
+
+// A 4x4 matrix stored row by row, like XMFLOAT4X4, transforming a point p to
+// (dot(rows[0], p), dot(rows[1], p), dot(rows[2], p), dot(rows[3], p)). Used for projections,
+// which need the last row to set w. Defaults to the identity.
+struct Float4x4
+{
+	Float4 rows[4];
+
+	Float4x4()
+	{
+		rows[0] = Float4(1.0f, 0.0f, 0.0f, 0.0f);
+		rows[1] = Float4(0.0f, 1.0f, 0.0f, 0.0f);
+		rows[2] = Float4(0.0f, 0.0f, 1.0f, 0.0f);
+		rows[3] = Float4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	Float4x4(const Float4& row0, const Float4& row1, const Float4& row2, const Float4& row3)
+	{
+		rows[0] = row0;
+		rows[1] = row1;
+		rows[2] = row2;
+		rows[3] = row3;
+	}
+};
+
+// Converts between 32 bit floats and 16 bit (half precision) floats, rounding to the nearest
+// half. Values too large for a half become infinity.
+inline unsigned short FloatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int exponent = (bits >> 23) & 0xFF;
+	unsigned int mantissa = bits & 0x7FFFFF;
+
+	// Infinity and NaN.
+	if (exponent == 0xFF)
+		return static_cast<unsigned short>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+
+	int halfExponent = static_cast<int>(exponent) - 127 + 15;
+	if (halfExponent >= 0x1F)
+		return static_cast<unsigned short>(sign | 0x7C00);
+
+	// Numbers too small for a normal half become denormals, or zero.
+	unsigned int shift = 13;
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+			return static_cast<unsigned short>(sign);
+
+		mantissa |= 0x800000;
+		shift = 14 - halfExponent;
+		halfExponent = 0;
+	}
+
+	// Round to nearest, ties to even. Rounding up may carry into the exponent, which gives the
+	// right result (up to infinity).
+	unsigned int half = (static_cast<unsigned int>(halfExponent) << 10) | (mantissa >> shift);
+	unsigned int rest = mantissa & ((1u << shift) - 1);
+	unsigned int halfway = 1u << (shift - 1);
+	if (rest > halfway || (rest == halfway && (half & 1) != 0))
+		++half;
+
+	return static_cast<unsigned short>(sign | half);
+}
+
+inline float HalfToFloat(unsigned short half)
+{
+	unsigned int sign = static_cast<unsigned int>(half & 0x8000) << 16;
+	unsigned int exponent = (half >> 10) & 0x1F;
+	unsigned int mantissa = half & 0x3FF;
+
+	unsigned int bits;
+	if (exponent == 0)
+	{
+		// Zero or a denormal, mantissa * 2^-24.
+		float value = mantissa * (1.0f / 16777216.0f);
+		return sign != 0 ? -value : value;
+	}
+	else if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// Compact types for vertex data, with the same layout as XMHALF2, XMHALF4 and XMUBYTEN4. They
+// are converted from floats when created.
+struct Half2
+{
+	unsigned short x;
+	unsigned short y;
+
+	Half2() : x(0), y(0) {}
+	Half2(const Float2& value) : x(FloatToHalf(value.x)), y(FloatToHalf(value.y)) {}
+};
+
+struct Half4
+{
+	unsigned short x;
+	unsigned short y;
+	unsigned short z;
+	unsigned short w;
+
+	Half4() : x(0), y(0), z(0), w(0) {}
+	Half4(const Float4& value)
+		: x(FloatToHalf(value.x)), y(FloatToHalf(value.y)), z(FloatToHalf(value.z)), w(FloatToHalf(value.w)) {}
+
+	// Positions are usually given as three components, w is set to 1.
+	Half4(const Float3& value)
+		: x(FloatToHalf(value.x)), y(FloatToHalf(value.y)), z(FloatToHalf(value.z)), w(FloatToHalf(1.0f)) {}
+};
+
+// Four components in [0, 1] stored as bytes, e.g. a colour.
+struct UByteN4
+{
+	unsigned char x;
+	unsigned char y;
+	unsigned char z;
+	unsigned char w;
+
+	UByteN4() : x(0), y(0), z(0), w(0) {}
+	UByteN4(const Float4& value)
+		: x(ToUByteN(value.x)), y(ToUByteN(value.y)), z(ToUByteN(value.z)), w(ToUByteN(value.w)) {}
+
+	static unsigned char ToUByteN(float value)
+	{
+		value = value > 0.0f ? value : 0.0f;
+		value = value < 1.0f ? value : 1.0f;
+		return static_cast<unsigned char>(value * 255.0f + 0.5f);
+	}
+};
@@ -0,0 +1,314 @@
+// ###########################################################################################
+// ## Tools for building indexed meshes: welding identical vertices, reordering triangles for
+// ## the post-transform vertex cache and measuring how well the cache is used.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "MeshBuilder.h"
+
+#include <cmath>
+#include <cstring>
+
+// Hashes the bytes of a vertex (FNV-1a).
+static unsigned int HashBytes(const unsigned char* bytes, unsigned int size)
+{
+	unsigned int hash = 2166136261u;
+	for (unsigned int i = 0; i < size; ++i)
+		hash = (hash ^ bytes[i]) * 16777619u;
+
+	return hash;
+}
+
+void WeldVertices(const void* vertices, unsigned int vertexCount, unsigned int vertexStride, IndexedMesh& mesh)
+{
+	const unsigned char* input = static_cast<const unsigned char*>(vertices);
+
+	mesh.vertexStride = vertexStride;
+	mesh.vertexCount = 0;
+	mesh.vertices.clear();
+	mesh.vertices.reserve(static_cast<size_t>(vertexCount) * vertexStride);
+	mesh.indices.resize(vertexCount);
+
+	// An open addressing hash table of indices into mesh.vertices, at most half full.
+	const unsigned int EMPTY = ~0u;
+	unsigned int tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<unsigned int> table(tableSize, EMPTY);
+
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		const unsigned char* vertex = input + static_cast<size_t>(v) * vertexStride;
+		unsigned int slot = HashBytes(vertex, vertexStride) & (tableSize - 1);
+		while (table[slot] != EMPTY &&
+			memcmp(&mesh.vertices[static_cast<size_t>(table[slot]) * vertexStride], vertex, vertexStride) != 0)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == EMPTY)
+		{
+			table[slot] = mesh.vertexCount++;
+			mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + vertexStride);
+		}
+
+		mesh.indices[v] = table[slot];
+	}
+}
+
+// The scoring of Forsyth's algorithm. Vertices get a high score when they are near the front of
+// the cache, and when few triangles are left using them so that lone triangles aren't left
+// behind to be drawn after their vertices have left the cache.
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+static float VertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	// Vertices without triangles left can't help choose the next triangle.
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The three vertices of the last triangle get a fixed score, so the next triangle
+		// doesn't strongly prefer any of its edges.
+		if (cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			const float scale = 1.0f / (VERTEX_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+		}
+	}
+
+	return score + VALENCE_BOOST_SCALE * powf(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+}
+
+void OptimiseVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount)
+{
+	const unsigned int triangleCount = static_cast<unsigned int>(indices.size() / 3);
+	if (triangleCount == 0)
+		return;
+
+	// The triangles using each vertex, triangles[firstTriangle[v]] onwards. Triangles are
+	// removed from the list when they are added to the output.
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; ++i)
+		++remaining[indices[i]];
+
+	std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+	std::vector<unsigned int> triangles(triangleCount * 3);
+	std::vector<unsigned int> filled(vertexCount, 0);
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			unsigned int v = indices[t * 3 + i];
+			triangles[firstTriangle[v] + filled[v]++] = t;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> triangleAdded(triangleCount, false);
+	unsigned int bestTriangle = 0;
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[bestTriangle])
+			bestTriangle = t;
+	}
+
+	// The cache holds up to three extra vertices while a triangle is being added.
+	unsigned int cache[VERTEX_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+
+	std::vector<unsigned int> output(triangleCount * 3);
+	unsigned int nextUnadded = 0;
+	for (unsigned int outputTriangle = 0; outputTriangle < triangleCount; ++outputTriangle)
+	{
+		// When no triangle in the cache is left, continue with the first triangle not added.
+		// This doesn't give the best triangle, but keeps the algorithm linear.
+		if (bestTriangle == ~0u)
+		{
+			while (triangleAdded[nextUnadded])
+				++nextUnadded;
+			bestTriangle = nextUnadded;
+		}
+
+		const unsigned int* triangleVertices = &indices[bestTriangle * 3];
+		triangleAdded[bestTriangle] = true;
+		for (int i = 0; i < 3; ++i)
+		{
+			unsigned int v = triangleVertices[i];
+			output[outputTriangle * 3 + i] = v;
+
+			// Remove the triangle from the vertex's list.
+			unsigned int* first = &triangles[firstTriangle[v]];
+			unsigned int* last = first + remaining[v] - 1;
+			for (unsigned int* t = first; t <= last; ++t)
+			{
+				if (*t == bestTriangle)
+				{
+					*t = *last;
+					break;
+				}
+			}
+			--remaining[v];
+		}
+
+		// Move the triangle's vertices to the front of the cache, keeping the order of the rest.
+		unsigned int newCache[VERTEX_CACHE_SIZE + 3];
+		unsigned int newCacheCount = 0;
+		for (int i = 0; i < 3; ++i)
+			newCache[newCacheCount++] = triangleVertices[i];
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int v = cache[i];
+			if (v != triangleVertices[0] && v != triangleVertices[1] && v != triangleVertices[2])
+				newCache[newCacheCount++] = v;
+		}
+
+		// Update the scores of the vertices in the cache (and those that just dropped out of it)
+		// and of their triangles.
+		for (unsigned int i = 0; i < newCacheCount; ++i)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+			float score = VertexScore(cachePosition[v], remaining[v]);
+			float change = score - vertexScore[v];
+			vertexScore[v] = score;
+			for (unsigned int t = 0; t < remaining[v]; ++t)
+				triangleScore[triangles[firstTriangle[v] + t]] += change;
+		}
+
+		// The next triangle is the best one using a vertex in the cache.
+		bestTriangle = ~0u;
+		float bestScore = -1.0f;
+		cacheCount = newCacheCount < VERTEX_CACHE_SIZE ? newCacheCount : VERTEX_CACHE_SIZE;
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int v = newCache[i];
+			cache[i] = v;
+			for (unsigned int t = 0; t < remaining[v]; ++t)
+			{
+				unsigned int triangle = triangles[firstTriangle[v] + t];
+				if (triangleScore[triangle] > bestScore)
+				{
+					bestScore = triangleScore[triangle];
+					bestTriangle = triangle;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+void OptimiseVertexFetch(IndexedMesh& mesh)
+{
+	const unsigned int UNUSED = ~0u;
+	std::vector<unsigned int> remap(mesh.vertexCount, UNUSED);
+	std::vector<unsigned char> vertices(mesh.vertices.size());
+	unsigned int vertexCount = 0;
+	for (unsigned int& index : mesh.indices)
+	{
+		if (remap[index] == UNUSED)
+		{
+			memcpy(&vertices[static_cast<size_t>(vertexCount) * mesh.vertexStride],
+				&mesh.vertices[static_cast<size_t>(index) * mesh.vertexStride], mesh.vertexStride);
+			remap[index] = vertexCount++;
+		}
+
+		index = remap[index];
+	}
+
+	vertices.resize(static_cast<size_t>(vertexCount) * mesh.vertexStride);
+	mesh.vertices.swap(vertices);
+	mesh.vertexCount = vertexCount;
+}
+
+void BuildIndexedMesh(const void* vertices, unsigned int vertexCount, unsigned int vertexStride,
+	IndexedMesh& mesh, MeshBuildStatistics& statistics)
+{
+	WeldVertices(vertices, vertexCount, vertexStride, mesh);
+	statistics.acmrBefore = CalculateACMR(mesh.indices.data(), static_cast<unsigned int>(mesh.indices.size()), VERTEX_CACHE_SIZE);
+
+	OptimiseVertexCache(mesh.indices, mesh.vertexCount);
+	OptimiseVertexFetch(mesh);
+	statistics.acmrAfter = CalculateACMR(mesh.indices.data(), static_cast<unsigned int>(mesh.indices.size()), VERTEX_CACHE_SIZE);
+
+	statistics.inputVertexCount = vertexCount;
+	statistics.outputVertexCount = mesh.vertexCount;
+}
+
+float CalculateACMR(const unsigned int* indices, unsigned int indexCount, unsigned int cacheSize)
+{
+	unsigned int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return 0.0f;
+
+	unsigned int vertexCount = 0;
+	for (unsigned int i = 0; i < triangleCount * 3; ++i)
+		vertexCount = indices[i] + 1 > vertexCount ? indices[i] + 1 : vertexCount;
+
+	// A vertex is in the FIFO cache if fewer than cacheSize vertices have been added since it
+	// was. insertedAt holds the number of misses once each vertex was added, zero meaning it
+	// never was.
+	std::vector<unsigned int> insertedAt(vertexCount, 0);
+	unsigned int misses = 0;
+	for (unsigned int i = 0; i < triangleCount * 3; ++i)
+	{
+		unsigned int v = indices[i];
+		if (insertedAt[v] == 0 || misses - insertedAt[v] >= cacheSize)
+			insertedAt[v] = ++misses;
+	}
+
+	return static_cast<float>(misses) / triangleCount;
+}
+
+IndexFormat PackIndices(const std::vector<unsigned int>& indices, unsigned int vertexCount,
+	std::vector<unsigned char>& indexData)
+{
+	if (vertexCount <= 65536)
+	{
+		std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+		indexData.resize(shortIndices.size() * sizeof(unsigned short));
+		if (!indexData.empty())
+			memcpy(indexData.data(), shortIndices.data(), indexData.size());
+		return IndexFormat::UInt16;
+	}
+
+	indexData.resize(indices.size() * sizeof(unsigned int));
+	if (!indexData.empty())
+		memcpy(indexData.data(), indices.data(), indexData.size());
+	return IndexFormat::UInt32;
+}
@@ -0,0 +1,77 @@
+// ###########################################################################################
+// ## Tools for building indexed meshes: welding identical vertices, reordering triangles for
+// ## the post-transform vertex cache and measuring how well the cache is used.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "RenderBackend.h"
+
+#include <vector>
+
+// The size of the post-transform cache the triangle order is optimised for. Most GPUs have
+// a cache at least this large, and optimising for a larger cache than the GPU has costs less
+// than optimising for a smaller one.
+const unsigned int VERTEX_CACHE_SIZE = 32;
+
+// A mesh of indexed triangles. The vertices are kept as bytes so any vertex struct can be used.
+struct IndexedMesh
+{
+	std::vector<unsigned char> vertices;
+	unsigned int vertexStride;
+	unsigned int vertexCount;
+	std::vector<unsigned int> indices;	// Three per triangle.
+};
+
+// What BuildIndexedMesh() did to a mesh.
+struct MeshBuildStatistics
+{
+	unsigned int inputVertexCount;
+	unsigned int outputVertexCount;
+	float acmrBefore;	// The ACMR of the welded mesh in its original triangle order.
+	float acmrAfter;	// The ACMR after optimising the triangle order.
+};
+
+// Turns a triangle list where every triangle has its own three vertices into an indexed mesh,
+// merging vertices that are identical byte for byte.
+void WeldVertices(const void* vertices, unsigned int vertexCount, unsigned int vertexStride, IndexedMesh& mesh);
+
+// Reorders the triangles so vertices are used again while they are still in the post-transform
+// cache, using Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+void OptimiseVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount);
+
+// Reorders the vertices in the order the triangles first use them, so the vertex fetches walk
+// through memory instead of jumping around. Vertices no triangle uses are removed.
+void OptimiseVertexFetch(IndexedMesh& mesh);
+
+// Welds the vertices of a triangle list and optimises the result for the vertex cache and
+// vertex fetch.
+void BuildIndexedMesh(const void* vertices, unsigned int vertexCount, unsigned int vertexStride,
+	IndexedMesh& mesh, MeshBuildStatistics& statistics);
+
+// The average cache miss ratio: the number of vertices shaded per triangle, simulating a FIFO
+// post-transform cache holding cacheSize vertices. Without indices every triangle costs 3,
+// and a large regular grid can get close to 0.5.
+float CalculateACMR(const unsigned int* indices, unsigned int indexCount, unsigned int cacheSize);
+
+// Stores the indices in the smallest format that can address vertexCount vertices, returning
+// the format used. 16 bit indices halve the size of the index buffer.
+IndexFormat PackIndices(const std::vector<unsigned int>& indices, unsigned int vertexCount,
+	std::vector<unsigned char>& indexData);
@@ -0,0 +1,296 @@
+// ###########################################################################################
+// ## Splits meshes into small clusters of triangles with bounds that can be culled on their
+// ## own, and culls them against a frustum and the direction they face.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "MeshClusters.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// The triangles using each vertex: those of vertex v are triangles[offsets[v]] up to
+// triangles[offsets[v + 1]].
+struct ClusterAdjacency
+{
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> triangles;
+};
+
+static void BuildClusterAdjacency(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount,
+	ClusterAdjacency& adjacency)
+{
+	adjacency.offsets.assign(vertexCount + 1, 0);
+	for (unsigned int i = 0; i < indexCount; ++i)
+		++adjacency.offsets[indices[i] + 1];
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+	std::vector<unsigned int> next(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	adjacency.triangles.resize(indexCount);
+	for (unsigned int i = 0; i < indexCount; ++i)
+		adjacency.triangles[next[indices[i]]++] = i / 3;
+}
+
+static Float3 Subtract(const Float3& a, const Float3& b)
+{
+	return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+static float Dot(const Float3& a, const Float3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Normalises a vector, leaving a zero vector as it is.
+static Float3 Normalise(const Float3& a)
+{
+	float length = sqrtf(Dot(a, a));
+	float scale = length > 0.0f ? 1.0f / length : 0.0f;
+	return Float3(a.x * scale, a.y * scale, a.z * scale);
+}
+
+// Fills in a cluster's bounds from its triangles, which are at
+// clusterIndices[cluster.firstIndex].
+static void CalculateClusterBounds(const std::vector<Float3>& positions, const std::vector<Float3>& normals,
+	const unsigned int* triangles, const unsigned int* clusterIndices, MeshCluster& cluster)
+{
+	const unsigned int* indices = &clusterIndices[cluster.firstIndex];
+	const unsigned int indexCount = cluster.triangleCount * 3;
+
+	// The sphere is centred on the box around the vertices, which is close enough to the
+	// smallest sphere for a small, mostly flat patch.
+	Float3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+	Float3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int i = 0; i < indexCount; ++i)
+	{
+		const Float3& p = positions[indices[i]];
+		minimum = Float3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+		maximum = Float3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+	}
+
+	cluster.centre = Float3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+	float radiusSquared = 0.0f;
+	for (unsigned int i = 0; i < indexCount; ++i)
+	{
+		Float3 offset = Subtract(positions[indices[i]], cluster.centre);
+		radiusSquared = std::max(radiusSquared, Dot(offset, offset));
+	}
+	cluster.radius = sqrtf(radiusSquared);
+
+	// The cone's axis is the average of the normals, and it is as wide as the normal furthest
+	// from it. Degenerate triangles have no normal and are never drawn, so they don't count.
+	Float3 sum;
+	for (unsigned int t = 0; t < cluster.triangleCount; ++t)
+	{
+		const Float3& normal = normals[triangles[t]];
+		sum = Float3(sum.x + normal.x, sum.y + normal.y, sum.z + normal.z);
+	}
+	cluster.coneAxis = Normalise(sum);
+
+	float minimumDot = 1.0f;
+	for (unsigned int t = 0; t < cluster.triangleCount; ++t)
+	{
+		const Float3& normal = normals[triangles[t]];
+		if (normal.x != 0.0f || normal.y != 0.0f || normal.z != 0.0f)
+			minimumDot = std::min(minimumDot, Dot(normal, cluster.coneAxis));
+	}
+
+	// A cone wider than a half space (or no axis at all) faces the eye from everywhere.
+	if (cluster.coneAxis.x == 0.0f && cluster.coneAxis.y == 0.0f && cluster.coneAxis.z == 0.0f)
+		minimumDot = 0.0f;
+	cluster.coneCutoff = minimumDot > 0.0f ? sqrtf(1.0f - minimumDot * minimumDot) : 1.0f;
+}
+
+bool BuildMeshClusters(const IndexedMesh& mesh, const InputElementDesc* elements, unsigned int elementCount,
+	const unsigned int* indices, unsigned int indexCount, unsigned int maxVertices, unsigned int maxTriangles,
+	std::vector<MeshCluster>& clusters, std::vector<unsigned int>& clusterIndices)
+{
+	const InputElementDesc* position = nullptr;
+	for (unsigned int i = 0; i < elementCount; ++i)
+	{
+		if (strcmp(elements[i].semanticName, "POSITION") == 0 && elements[i].semanticIndex == 0)
+			position = &elements[i];
+	}
+
+	if (position == nullptr || maxVertices < 3 || maxTriangles < 1)
+		return false;
+
+	const unsigned int vertexCount = mesh.vertexCount;
+	const unsigned int triangleCount = indexCount / 3;
+	std::vector<Float3> positions(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		Float4 value = FetchElement(&mesh.vertices[static_cast<size_t>(v) * mesh.vertexStride] + position->byteOffset, position->format);
+		positions[v] = Float3(value.x, value.y, value.z);
+	}
+
+	// The normal cross(b - a, c - a) points towards the eye when a triangle is clockwise on
+	// screen, so it points out of the front face.
+	std::vector<Float3> normals(triangleCount);
+	for (unsigned int t = 0; t < triangleCount; ++t)
+	{
+		const Float3& a = positions[indices[t * 3]];
+		Float3 ab = Subtract(positions[indices[t * 3 + 1]], a);
+		Float3 ac = Subtract(positions[indices[t * 3 + 2]], a);
+		normals[t] = Normalise(Float3(ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x));
+	}
+
+	ClusterAdjacency adjacency;
+	BuildClusterAdjacency(indices, indexCount, vertexCount, adjacency);
+
+	// How many of each vertex's triangles aren't in a cluster yet, so vertices with none left
+	// aren't searched for neighbours.
+	std::vector<unsigned int> liveTriangles(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+	// The cluster each vertex was last added to, plus one, so a vertex is in the current
+	// cluster when its entry is the number of clusters made.
+	std::vector<unsigned int> vertexCluster(vertexCount, 0);
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	std::vector<unsigned int> clusterVertices;
+	std::vector<unsigned int> clusterTriangles;
+	clusterVertices.reserve(maxVertices);
+	clusterTriangles.reserve(maxTriangles);
+
+	unsigned int seed = 0;
+	unsigned int stamp = 0;
+	for (;;)
+	{
+		while (seed < triangleCount && emitted[seed] != 0)
+			++seed;
+		if (seed == triangleCount)
+			break;
+
+		MeshCluster cluster;
+		cluster.firstIndex = static_cast<unsigned int>(clusterIndices.size());
+		cluster.triangleCount = 0;
+		clusterVertices.clear();
+		clusterTriangles.clear();
+		++stamp;
+
+		Float3 normalSum;
+		unsigned int next = seed;
+		while (next != ~0u)
+		{
+			// Add the triangle.
+			emitted[next] = 1;
+			clusterTriangles.push_back(next);
+			for (int i = 0; i < 3; ++i)
+			{
+				unsigned int vertex = indices[next * 3 + i];
+				clusterIndices.push_back(vertex);
+				--liveTriangles[vertex];
+				if (vertexCluster[vertex] != stamp)
+				{
+					vertexCluster[vertex] = stamp;
+					clusterVertices.push_back(vertex);
+				}
+			}
+
+			const Float3& normal = normals[next];
+			normalSum = Float3(normalSum.x + normal.x, normalSum.y + normal.y, normalSum.z + normal.z);
+			if (clusterTriangles.size() == maxTriangles)
+				break;
+
+			// Pick the neighbour adding the fewest vertices, then facing most like the cluster.
+			const Float3 axis = Normalise(normalSum);
+			const unsigned int roomLeft = maxVertices - static_cast<unsigned int>(clusterVertices.size());
+			unsigned int bestNewVertices = 4;
+			float bestDot = -FLT_MAX;
+			next = ~0u;
+			for (unsigned int vertex : clusterVertices)
+			{
+				if (liveTriangles[vertex] == 0)
+					continue;
+
+				for (unsigned int a = adjacency.offsets[vertex]; a < adjacency.offsets[vertex + 1]; ++a)
+				{
+					unsigned int triangle = adjacency.triangles[a];
+					if (emitted[triangle] != 0)
+						continue;
+
+					unsigned int newVertices = 0;
+					for (int i = 0; i < 3; ++i)
+						newVertices += vertexCluster[indices[triangle * 3 + i]] != stamp ? 1 : 0;
+					if (newVertices > roomLeft || newVertices > bestNewVertices)
+						continue;
+
+					float dot = Dot(normals[triangle], axis);
+					if (newVertices < bestNewVertices || dot > bestDot)
+					{
+						bestNewVertices = newVertices;
+						bestDot = dot;
+						next = triangle;
+					}
+				}
+			}
+		}
+
+		cluster.triangleCount = static_cast<unsigned int>(clusterTriangles.size());
+		CalculateClusterBounds(positions, normals, clusterTriangles.data(), clusterIndices.data(), cluster);
+		clusters.push_back(cluster);
+	}
+
+	return true;
+}
+
+bool IsClusterBackFacing(const MeshCluster& cluster, const Float3& eyePosition)
+{
+	// Every normal is within the cone, so the eye is behind every triangle when the angle
+	// between the axis and the direction from the eye to any point of the sphere is less than
+	// 90 degrees minus the cone's half angle, the test meshoptimizer uses for its meshlets.
+	Float3 view = Subtract(cluster.centre, eyePosition);
+	return Dot(view, cluster.coneAxis) >= cluster.coneCutoff * sqrtf(Dot(view, view)) + cluster.radius;
+}
+
+unsigned int CullMeshClusters(const MeshCluster* clusters, unsigned int clusterCount, const unsigned int* clusterIndices,
+	const Frustum& frustum, const Float3& eyePosition, std::vector<unsigned int>& visibleIndices,
+	ClusterCullStatistics& statistics)
+{
+	const size_t start = visibleIndices.size();
+	for (unsigned int i = 0; i < clusterCount; ++i)
+	{
+		const MeshCluster& cluster = clusters[i];
+		++statistics.clustersTested;
+		statistics.trianglesTested += cluster.triangleCount;
+
+		if (!IsSphereInFrustum(frustum, cluster.centre, cluster.radius))
+		{
+			++statistics.clustersOutside;
+			continue;
+		}
+
+		if (IsClusterBackFacing(cluster, eyePosition))
+		{
+			++statistics.clustersBackFacing;
+			continue;
+		}
+
+		const unsigned int* first = &clusterIndices[cluster.firstIndex];
+		visibleIndices.insert(visibleIndices.end(), first, first + cluster.triangleCount * 3);
+		statistics.trianglesVisible += cluster.triangleCount;
+	}
+
+	return static_cast<unsigned int>(visibleIndices.size() - start);
+}
@@ -0,0 +1,84 @@
+// ###########################################################################################
+// ## Splits meshes into small clusters of triangles with bounds that can be culled on their
+// ## own, and culls them against a frustum and the direction they face.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "Frustum.h"
+#include "MeshBuilder.h"
+#include "RenderBackend.h"
+
+#include <vector>
+
+// The most vertices and triangles a cluster has by default. With 64 vertices a cluster's
+// indices fit in a byte, and 124 triangles is what 64 vertices of a regular grid give at most
+// with a little to spare, so clusters of a smooth surface are limited by both about equally.
+const unsigned int CLUSTER_MAX_VERTICES = 64;
+const unsigned int CLUSTER_MAX_TRIANGLES = 124;
+
+// A small, connected part of a mesh, with a sphere bounding its vertices and a cone holding the
+// normals of its triangles. A cluster's triangles can be skipped when the sphere is outside the
+// frustum, or when the eye is behind every one of them, which the cone tells without looking at
+// the triangles.
+struct MeshCluster
+{
+	unsigned int firstIndex;	// Into the cluster indices BuildMeshClusters() made.
+	unsigned int triangleCount;
+	Float3 centre;
+	float radius;
+	Float3 coneAxis;			// The average direction the triangles face, normalised.
+	float coneCutoff;			// The sine of the angle between the axis and the normal furthest from it, 1 if more than 90 degrees.
+};
+
+// The clusters CullMeshClusters() tested and why those it skipped were skipped.
+struct ClusterCullStatistics
+{
+	unsigned long long clustersTested;
+	unsigned long long clustersOutside;		// Outside the frustum.
+	unsigned long long clustersBackFacing;	// Inside, but facing away from the eye.
+	unsigned long long trianglesTested;
+	unsigned long long trianglesVisible;
+};
+
+// Splits the triangles given by indices into clusters of at most maxVertices vertices and
+// maxTriangles triangles. A cluster is grown one neighbouring triangle at a time, picking the
+// one that adds the fewest vertices and, among those, the one facing most like the cluster
+// does, so clusters are compact and their cones narrow. A cluster ends when it is full or has
+// no neighbours left, and the next one starts at the first triangle not in a cluster yet,
+// keeping the clusters close to the order of the input.
+//
+// The triangles are appended to clusterIndices cluster by cluster, in the order they were
+// added, and the clusters to clusters. Returns false if the mesh has no POSITION element or
+// the limits are below one triangle.
+bool BuildMeshClusters(const IndexedMesh& mesh, const InputElementDesc* elements, unsigned int elementCount,
+	const unsigned int* indices, unsigned int indexCount, unsigned int maxVertices, unsigned int maxTriangles,
+	std::vector<MeshCluster>& clusters, std::vector<unsigned int>& clusterIndices);
+
+// Whether the eye at eyePosition, in the cluster's space, is behind every triangle of the
+// cluster. Triangles face the side their vertices are clockwise from, as the backends cull.
+bool IsClusterBackFacing(const MeshCluster& cluster, const Float3& eyePosition);
+
+// Appends the indices of the clusters that may be visible to visibleIndices: those with their
+// sphere in the frustum and not facing away from the eye. The frustum and eye position are in
+// the clusters' space (see ExtractFrustum()). Returns the number of indices appended.
+unsigned int CullMeshClusters(const MeshCluster* clusters, unsigned int clusterCount, const unsigned int* clusterIndices,
+	const Frustum& frustum, const Float3& eyePosition, std::vector<unsigned int>& visibleIndices,
+	ClusterCullStatistics& statistics);
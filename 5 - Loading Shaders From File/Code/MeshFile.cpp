@@ -0,0 +1,383 @@
+// ###########################################################################################
+// ## Writing and mapping binary mesh files, see MeshFile.h.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "MeshFile.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// Changing the layout of mesh files changes the version, and old files have to be converted
+// again.
+const unsigned int MESH_FILE_VERSION = 2;
+const char MESH_FILE_MAGIC[4] = { 'M', 'W', 'S', 'M' };
+
+// A mesh file starts with this header, followed by the elementCount elements and the lodCount
+// levels of detail. The vertex and index data follow at the given offsets, which are multiples
+// of MESH_FILE_DATA_ALIGNMENT.
+struct MeshFileHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int vertexCount;
+	unsigned int vertexStride;
+	unsigned int indexCount;
+	unsigned int indexFormat;	// An IndexFormat.
+	unsigned int elementCount;
+	unsigned int lodCount;
+	unsigned long long vertexOffset;
+	unsigned long long indexOffset;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct MeshFileElement
+{
+	char semanticName[MESH_FILE_SEMANTIC_NAME_SIZE];
+	unsigned int semanticIndex;
+	unsigned int format;		// An ElementFormat.
+	unsigned int byteOffset;
+};
+
+struct MeshFileLod
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int vertexCount;
+	float error;
+};
+
+static unsigned int IndexSize(IndexFormat format)
+{
+	return format == IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+static unsigned long long AlignOffset(unsigned long long offset)
+{
+	return (offset + MESH_FILE_DATA_ALIGNMENT - 1) & ~static_cast<unsigned long long>(MESH_FILE_DATA_ALIGNMENT - 1);
+}
+
+bool CalculateMeshBounds(const void* vertices, unsigned int vertexCount, unsigned int vertexStride,
+	const InputElementDesc* elements, unsigned int elementCount, MeshBounds& bounds)
+{
+	bounds.min = Float3(0.0f, 0.0f, 0.0f);
+	bounds.max = Float3(0.0f, 0.0f, 0.0f);
+
+	const InputElementDesc* position = nullptr;
+	for (unsigned int i = 0; i < elementCount && position == nullptr; ++i)
+	{
+		if (strcmp(elements[i].semanticName, "POSITION") == 0 && elements[i].semanticIndex == 0)
+			position = &elements[i];
+	}
+
+	if (position == nullptr)
+		return false;
+	if (vertexCount == 0)
+		return true;
+
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	const unsigned char* vertex = static_cast<const unsigned char*>(vertices) + position->byteOffset;
+	for (unsigned int v = 0; v < vertexCount; ++v, vertex += vertexStride)
+	{
+		Float4 value = FetchElement(vertex, position->format);
+		const float components[3] = { value.x, value.y, value.z };
+		for (int i = 0; i < 3; ++i)
+		{
+			minimum[i] = components[i] < minimum[i] ? components[i] : minimum[i];
+			maximum[i] = components[i] > maximum[i] ? components[i] : maximum[i];
+		}
+	}
+
+	bounds.min = Float3(minimum[0], minimum[1], minimum[2]);
+	bounds.max = Float3(maximum[0], maximum[1], maximum[2]);
+	return true;
+}
+
+bool WriteMeshFile(const char* path, const MeshFileDesc& desc)
+{
+	if (desc.elementCount > MESH_FILE_MAX_ELEMENTS || desc.lodCount > MESH_MAX_LODS)
+		return false;
+
+	std::vector<MeshFileElement> elements(desc.elementCount);
+	for (unsigned int i = 0; i < desc.elementCount; ++i)
+	{
+		const InputElementDesc& element = desc.elements[i];
+		if (strlen(element.semanticName) >= MESH_FILE_SEMANTIC_NAME_SIZE)
+			return false;
+
+		memset(&elements[i], 0, sizeof(MeshFileElement));
+		strcpy(elements[i].semanticName, element.semanticName);
+		elements[i].semanticIndex = element.semanticIndex;
+		elements[i].format = static_cast<unsigned int>(element.format);
+		elements[i].byteOffset = element.byteOffset;
+	}
+
+	std::vector<MeshFileLod> lods(std::max(desc.lodCount, 1u));
+	for (unsigned int i = 0; i < desc.lodCount; ++i)
+	{
+		lods[i].firstIndex = desc.lods[i].firstIndex;
+		lods[i].indexCount = desc.lods[i].indexCount;
+		lods[i].vertexCount = desc.lods[i].vertexCount;
+		lods[i].error = desc.lods[i].error;
+	}
+
+	if (desc.lodCount == 0)
+	{
+		lods[0].firstIndex = 0;
+		lods[0].indexCount = desc.indexCount;
+		lods[0].vertexCount = desc.vertexCount;
+		lods[0].error = 0.0f;
+	}
+
+	MeshBounds bounds;
+	CalculateMeshBounds(desc.vertices, desc.vertexCount, desc.vertexStride, desc.elements, desc.elementCount, bounds);
+
+	const unsigned long long vertexSize = static_cast<unsigned long long>(desc.vertexCount) * desc.vertexStride;
+	const unsigned long long indexSize = static_cast<unsigned long long>(desc.indexCount) * IndexSize(desc.indexFormat);
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_FILE_MAGIC, 4);
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = desc.vertexCount;
+	header.vertexStride = desc.vertexStride;
+	header.indexCount = desc.indexCount;
+	header.indexFormat = static_cast<unsigned int>(desc.indexFormat);
+	header.elementCount = desc.elementCount;
+	header.lodCount = static_cast<unsigned int>(lods.size());
+	header.vertexOffset = AlignOffset(sizeof(MeshFileHeader) + elements.size() * sizeof(MeshFileElement) + lods.size() * sizeof(MeshFileLod));
+	header.indexOffset = AlignOffset(header.vertexOffset + vertexSize);
+	header.boundsMin[0] = bounds.min.x;
+	header.boundsMin[1] = bounds.min.y;
+	header.boundsMin[2] = bounds.min.z;
+	header.boundsMax[0] = bounds.max.x;
+	header.boundsMax[1] = bounds.max.y;
+	header.boundsMax[2] = bounds.max.z;
+
+	// The padding before the data is written from a block of zeroes.
+	const char padding[MESH_FILE_DATA_ALIGNMENT] = {};
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!elements.empty())
+		file.write(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(MeshFileElement));
+	file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(MeshFileLod));
+	file.write(padding, header.vertexOffset - sizeof(header) - elements.size() * sizeof(MeshFileElement) - lods.size() * sizeof(MeshFileLod));
+	file.write(static_cast<const char*>(desc.vertices), vertexSize);
+	file.write(padding, header.indexOffset - header.vertexOffset - vertexSize);
+	file.write(static_cast<const char*>(desc.indices), indexSize);
+	return file.good();
+}
+
+MeshFile::MeshFile()
+	: mVertexData(nullptr)
+	, mIndexData(nullptr)
+	, mElements(nullptr)
+	, mVertexCount(0)
+	, mVertexStride(0)
+	, mIndexCount(0)
+	, mIndexFormat(IndexFormat::UInt16)
+	, mElementCount(0)
+	, mLodCount(0)
+{
+	mBounds.min = Float3(0.0f, 0.0f, 0.0f);
+	mBounds.max = Float3(0.0f, 0.0f, 0.0f);
+}
+
+bool MeshFile::Open(const char* path)
+{
+	Close();
+	if (!mFile.Open(path))
+		return false;
+
+	const unsigned char* data = mFile.GetData();
+	const unsigned long long size = mFile.GetSize();
+
+	MeshFileHeader header;
+	if (size < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	const unsigned long long elementsEnd = sizeof(header) + static_cast<unsigned long long>(header.elementCount) * sizeof(MeshFileElement);
+	const unsigned long long lodsEnd = elementsEnd + static_cast<unsigned long long>(header.lodCount) * sizeof(MeshFileLod);
+	const unsigned long long vertexSize = static_cast<unsigned long long>(header.vertexCount) * header.vertexStride;
+	const unsigned long long indexSize = static_cast<unsigned long long>(header.indexCount) *
+		(header.indexFormat == static_cast<unsigned int>(IndexFormat::UInt16) ? sizeof(unsigned short) : sizeof(unsigned int));
+	bool valid = memcmp(header.magic, MESH_FILE_MAGIC, 4) == 0 && header.version == MESH_FILE_VERSION &&
+		header.vertexStride != 0 && header.elementCount <= MESH_FILE_MAX_ELEMENTS &&
+		header.lodCount >= 1 && header.lodCount <= MESH_MAX_LODS &&
+		header.indexFormat <= static_cast<unsigned int>(IndexFormat::UInt32) &&
+		header.vertexOffset % MESH_FILE_DATA_ALIGNMENT == 0 && header.indexOffset % MESH_FILE_DATA_ALIGNMENT == 0 &&
+		header.vertexOffset >= lodsEnd && header.vertexOffset <= size && vertexSize <= size - header.vertexOffset &&
+		header.indexOffset <= size && indexSize <= size - header.indexOffset &&
+		vertexSize <= ~0u && indexSize <= ~0u;
+
+	// Every element has to be one the backends know, inside the vertex and named by a string
+	// that ends inside its field.
+	for (unsigned int i = 0; i < header.elementCount && valid; ++i)
+	{
+		MeshFileElement element;
+		memcpy(&element, data + sizeof(header) + i * sizeof(MeshFileElement), sizeof(element));
+		valid = element.format <= static_cast<unsigned int>(ElementFormat::UByteN4) &&
+			memchr(element.semanticName, '\0', MESH_FILE_SEMANTIC_NAME_SIZE) != nullptr &&
+			element.byteOffset + ElementSize(static_cast<ElementFormat>(element.format)) <= header.vertexStride;
+	}
+
+	// Every level of detail has to be a range of whole triangles inside the indices.
+	for (unsigned int i = 0; i < header.lodCount && valid; ++i)
+	{
+		MeshFileLod lod;
+		memcpy(&lod, data + elementsEnd + i * sizeof(MeshFileLod), sizeof(lod));
+		valid = lod.firstIndex <= header.indexCount && lod.indexCount <= header.indexCount - lod.firstIndex &&
+			lod.indexCount % 3 == 0 && lod.vertexCount <= header.vertexCount;
+		mLods[i].firstIndex = lod.firstIndex;
+		mLods[i].indexCount = lod.indexCount;
+		mLods[i].vertexCount = lod.vertexCount;
+		mLods[i].error = lod.error;
+	}
+
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	mVertexData = data + header.vertexOffset;
+	mIndexData = data + header.indexOffset;
+	mElements = data + sizeof(header);
+	mVertexCount = header.vertexCount;
+	mVertexStride = header.vertexStride;
+	mIndexCount = header.indexCount;
+	mIndexFormat = static_cast<IndexFormat>(header.indexFormat);
+	mElementCount = header.elementCount;
+	mLodCount = header.lodCount;
+	mBounds.min = Float3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	mBounds.max = Float3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	return true;
+}
+
+void MeshFile::Close()
+{
+	mFile.Close();
+	mVertexData = nullptr;
+	mIndexData = nullptr;
+	mElements = nullptr;
+	mVertexCount = 0;
+	mVertexStride = 0;
+	mIndexCount = 0;
+	mIndexFormat = IndexFormat::UInt16;
+	mElementCount = 0;
+	mLodCount = 0;
+	mBounds.min = Float3(0.0f, 0.0f, 0.0f);
+	mBounds.max = Float3(0.0f, 0.0f, 0.0f);
+}
+
+bool MeshFile::IsOpen() const
+{
+	return mFile.IsOpen();
+}
+
+const void* MeshFile::GetVertexData() const
+{
+	return mVertexData;
+}
+
+unsigned int MeshFile::GetVertexDataSize() const
+{
+	return mVertexCount * mVertexStride;
+}
+
+unsigned int MeshFile::GetVertexCount() const
+{
+	return mVertexCount;
+}
+
+unsigned int MeshFile::GetVertexStride() const
+{
+	return mVertexStride;
+}
+
+const void* MeshFile::GetIndexData() const
+{
+	return mIndexData;
+}
+
+unsigned int MeshFile::GetIndexDataSize() const
+{
+	return mIndexCount * IndexSize(mIndexFormat);
+}
+
+unsigned int MeshFile::GetIndexCount() const
+{
+	return mIndexCount;
+}
+
+IndexFormat MeshFile::GetIndexFormat() const
+{
+	return mIndexFormat;
+}
+
+unsigned int MeshFile::GetElementCount() const
+{
+	return mElementCount;
+}
+
+void MeshFile::GetInputElements(InputElementDesc* elements, unsigned int inputSlot) const
+{
+	for (unsigned int i = 0; i < mElementCount; ++i)
+	{
+		// The names are used where they are in the file, the rest is copied out as the
+		// elements may not be aligned.
+		const unsigned char* element = mElements + i * sizeof(MeshFileElement);
+		unsigned int fields[3];
+		memcpy(fields, element + offsetof(MeshFileElement, semanticIndex), sizeof(fields));
+
+		elements[i].semanticName = reinterpret_cast<const char*>(element);
+		elements[i].semanticIndex = fields[0];
+		elements[i].format = static_cast<ElementFormat>(fields[1]);
+		elements[i].inputSlot = inputSlot;
+		elements[i].byteOffset = fields[2];
+		elements[i].inputSlotClass = InputClassification::PerVertex;
+		elements[i].instanceDataStepRate = 0;
+	}
+}
+
+const MeshBounds& MeshFile::GetBounds() const
+{
+	return mBounds;
+}
+
+unsigned int MeshFile::GetLodCount() const
+{
+	return mLodCount;
+}
+
+const MeshLod* MeshFile::GetLods() const
+{
+	return mLods;
+}
@@ -0,0 +1,125 @@
+// ###########################################################################################
+// ## Binary mesh files: the vertex and index data are stored exactly as they are given to the
+// ## backend, so a mesh is loaded by mapping the file and creating its buffers straight from
+// ## the mapped memory, without parsing or copying anything.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "MappedFile.h"
+#include "MathTypes.h"
+#include "MeshSimplifier.h"
+#include "RenderBackend.h"
+
+// The most input elements a mesh file can describe, and the size of the field each semantic
+// name is stored in, including the terminating zero.
+const unsigned int MESH_FILE_MAX_ELEMENTS = 16;
+const unsigned int MESH_FILE_SEMANTIC_NAME_SIZE = 16;
+
+// The vertex and index data start at multiples of this many bytes into the file. A file is
+// mapped at a page boundary, so the data starts at the beginning of a cache line.
+const unsigned int MESH_FILE_DATA_ALIGNMENT = 64;
+
+// An axis aligned box around a mesh's positions.
+struct MeshBounds
+{
+	Float3 min;
+	Float3 max;
+};
+
+// A mesh to write to a file. The elements describe one vertex, as read from input slot 0. The
+// levels of detail are ranges of the indices (see MeshSimplifier.h). Without any, the file gets
+// a single level drawing all of them.
+struct MeshFileDesc
+{
+	const void* vertices;
+	unsigned int vertexCount;
+	unsigned int vertexStride;
+	const InputElementDesc* elements;
+	unsigned int elementCount;
+	const void* indices;
+	unsigned int indexCount;
+	IndexFormat indexFormat;
+	const MeshLod* lods;
+	unsigned int lodCount;
+};
+
+// Calculates the bounds of the vertices' POSITION element. Returns false, leaving the bounds
+// empty, if the elements have no position.
+bool CalculateMeshBounds(const void* vertices, unsigned int vertexCount, unsigned int vertexStride,
+	const InputElementDesc* elements, unsigned int elementCount, MeshBounds& bounds);
+
+// Writes the mesh to path, along with its bounds. Returns false if the mesh can't be stored
+// (too many elements or levels of detail, or a semantic name that is too long) or the file
+// can't be written.
+bool WriteMeshFile(const char* path, const MeshFileDesc& desc);
+
+// A mesh file mapped into memory. The data stays valid while the file is open, and can be given
+// to CreateVertexBuffer() and CreateIndexBuffer() as it is.
+class MeshFile
+{
+public:
+	MeshFile();
+
+	// Maps the file at path and checks that its header is valid and that the data it describes
+	// fits in the file. The indices aren't checked against the vertex count, as that would mean
+	// reading all of them. Returns false if the file can't be used, leaving it closed.
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const;
+
+	const void* GetVertexData() const;
+	unsigned int GetVertexDataSize() const;
+	unsigned int GetVertexCount() const;
+	unsigned int GetVertexStride() const;
+
+	const void* GetIndexData() const;
+	unsigned int GetIndexDataSize() const;
+	unsigned int GetIndexCount() const;
+	IndexFormat GetIndexFormat() const;
+
+	// Fills in the GetElementCount() input elements describing a vertex, read from the given
+	// input slot. The semantic names point into the file.
+	unsigned int GetElementCount() const;
+	void GetInputElements(InputElementDesc* elements, unsigned int inputSlot) const;
+
+	const MeshBounds& GetBounds() const;
+
+	// The levels of detail, from the full mesh to the coarsest. There is always at least one.
+	unsigned int GetLodCount() const;
+	const MeshLod* GetLods() const;
+
+private:
+	MeshFile(const MeshFile&);
+	MeshFile& operator=(const MeshFile&);
+
+	MappedFile mFile;
+	const unsigned char* mVertexData;
+	const unsigned char* mIndexData;
+	const unsigned char* mElements;
+	unsigned int mVertexCount;
+	unsigned int mVertexStride;
+	unsigned int mIndexCount;
+	IndexFormat mIndexFormat;
+	unsigned int mElementCount;
+	MeshBounds mBounds;
+	MeshLod mLods[MESH_MAX_LODS];
+	unsigned int mLodCount;
+};
@@ -0,0 +1,1108 @@
+// ###########################################################################################
+// ## Parallel OBJ and PLY importers, see MeshImport.h.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "MeshImport.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+// Files are split into about this many chunks for each thread, so that threads finishing early
+// can take another one, but not into chunks smaller than these.
+const unsigned int IMPORT_CHUNKS_PER_THREAD = 8;
+const size_t IMPORT_MIN_CHUNK_BYTES = 256 * 1024;
+const unsigned int IMPORT_MIN_CHUNK_RECORDS = 16 * 1024;
+
+struct PlyElement;
+
+// A part of a file, parsed on one thread, and what was read from it.
+struct ImportChunk
+{
+	ImportChunk()
+		: begin(nullptr)
+		, end(nullptr)
+		, recordCount(0)
+		, element(nullptr)
+		, failed(false)
+	{
+	}
+
+	const char* begin;
+	const char* end;
+	unsigned int recordCount;		// The number of PLY records in the chunk.
+	const PlyElement* element;		// The PLY element the records belong to.
+
+	std::vector<Float3> positions;
+	std::vector<Float4> colours;
+	std::vector<unsigned int> indices;
+
+	// OBJ's negative indices count back from the last vertex read. Until the chunks are joined
+	// the number of vertices before a chunk isn't known, so these indices are stored relative
+	// to the chunk's first vertex (as ints, as they may point into an earlier chunk), and where
+	// they are in indices is listed here.
+	std::vector<size_t> relativeIndices;
+	bool failed;
+};
+
+// Splits a polygon into a fan of triangles as its corners are read.
+class TriangleFan
+{
+public:
+	explicit TriangleFan(ImportChunk& chunk)
+		: mChunk(chunk)
+		, mFirst(0)
+		, mPrevious(0)
+		, mFirstRelative(false)
+		, mPreviousRelative(false)
+		, mCornerCount(0)
+	{
+	}
+
+	void AddCorner(unsigned int index, bool relative = false)
+	{
+		if (mCornerCount >= 2)
+		{
+			Add(mFirst, mFirstRelative);
+			Add(mPrevious, mPreviousRelative);
+			Add(index, relative);
+		}
+		else if (mCornerCount == 0)
+		{
+			mFirst = index;
+			mFirstRelative = relative;
+		}
+
+		mPrevious = index;
+		mPreviousRelative = relative;
+		++mCornerCount;
+	}
+
+private:
+	TriangleFan& operator=(const TriangleFan&);
+
+	void Add(unsigned int index, bool relative)
+	{
+		if (relative)
+			mChunk.relativeIndices.push_back(mChunk.indices.size());
+		mChunk.indices.push_back(index);
+	}
+
+	ImportChunk& mChunk;
+	unsigned int mFirst;
+	unsigned int mPrevious;
+	bool mFirstRelative;
+	bool mPreviousRelative;
+	unsigned int mCornerCount;
+};
+
+// Chooses how many chunks to split work made of the given number of units into, where a unit
+// is the smallest amount worth a chunk of its own.
+static unsigned int ChooseChunkCount(ThreadPool* pool, size_t units)
+{
+	if (pool == nullptr)
+		return 1;
+
+	size_t maxChunks = static_cast<size_t>(pool->GetThreadCount()) * IMPORT_CHUNKS_PER_THREAD;
+	return static_cast<unsigned int>(std::max<size_t>(std::min(units, maxChunks), 1));
+}
+
+static void ForEachChunk(ThreadPool* pool, std::vector<ImportChunk>& chunks, const std::function<void(ImportChunk&)>& function)
+{
+	if (pool == nullptr)
+	{
+		for (ImportChunk& chunk : chunks)
+			function(chunk);
+		return;
+	}
+
+	pool->ParallelFor(static_cast<unsigned int>(chunks.size()), [&](unsigned int index, unsigned int)
+	{
+		function(chunks[index]);
+	});
+}
+
+// Joins what was read from the chunks, in order, into the mesh. Fails if a chunk failed or an
+// index refers to a vertex that doesn't exist.
+static bool JoinChunks(std::vector<ImportChunk>& chunks, ImportedMesh& mesh, ThreadPool* pool)
+{
+	std::vector<size_t> vertexBase(chunks.size());
+	std::vector<size_t> indexBase(chunks.size());
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		if (chunks[i].failed)
+			return false;
+
+		vertexBase[i] = vertexCount;
+		indexBase[i] = indexCount;
+		vertexCount += chunks[i].positions.size();
+		indexCount += chunks[i].indices.size();
+	}
+
+	if (vertexCount > ~0u)
+		return false;
+
+	mesh.positions.resize(vertexCount);
+	mesh.colours.resize(vertexCount);
+	mesh.indices.resize(indexCount);
+
+	// Each chunk copies its own part, and reuses its failed flag for indices out of range.
+	ForEachChunk(pool, chunks, [&](ImportChunk& chunk)
+	{
+		const size_t c = &chunk - chunks.data();
+		std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.begin() + vertexBase[c]);
+		std::copy(chunk.colours.begin(), chunk.colours.end(), mesh.colours.begin() + vertexBase[c]);
+
+		for (size_t i : chunk.relativeIndices)
+		{
+			long long index = static_cast<long long>(vertexBase[c]) + static_cast<int>(chunk.indices[i]);
+			chunk.failed = chunk.failed || index < 0;
+			chunk.indices[i] = static_cast<unsigned int>(index);
+		}
+
+		unsigned int* indices = mesh.indices.data() + indexBase[c];
+		for (size_t i = 0; i < chunk.indices.size(); ++i)
+		{
+			chunk.failed = chunk.failed || chunk.indices[i] >= vertexCount;
+			indices[i] = chunk.indices[i];
+		}
+
+		// The chunk's data isn't needed any more, and can take up as much memory as the mesh.
+		std::vector<Float3>().swap(chunk.positions);
+		std::vector<Float4>().swap(chunk.colours);
+		std::vector<unsigned int>().swap(chunk.indices);
+	});
+
+	for (const ImportChunk& chunk : chunks)
+	{
+		if (chunk.failed)
+			return false;
+	}
+
+	return true;
+}
+
+// Splits [begin, end) into chunkCount chunks of about the same size, each ending after a
+// newline (or at the end).
+static void SplitLines(const char* begin, const char* end, unsigned int chunkCount, std::vector<ImportChunk>& chunks)
+{
+	const char* start = begin;
+	for (unsigned int i = 1; i <= chunkCount && start < end; ++i)
+	{
+		const char* split = i == chunkCount ? end : begin + static_cast<size_t>(end - begin) / chunkCount * i;
+		split = std::max(split, start);
+		const char* newline = static_cast<const char*>(memchr(split, '\n', end - split));
+
+		ImportChunk chunk;
+		chunk.begin = start;
+		chunk.end = newline != nullptr ? newline + 1 : end;
+		chunks.push_back(chunk);
+		start = chunk.end;
+	}
+}
+
+// Spaces and tabs separate the values on a line. Carriage returns are treated the same, so files
+// with Windows line endings are read like any other.
+static bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool IsDigit(char c)
+{
+	return static_cast<unsigned char>(c - '0') < 10;
+}
+
+static const char* SkipSpaces(const char* text, const char* end)
+{
+	while (text != end && IsSpace(*text))
+		++text;
+	return text;
+}
+
+static const char* SkipValue(const char* text, const char* end)
+{
+	text = SkipSpaces(text, end);
+	while (text != end && !IsSpace(*text))
+		++text;
+	return text;
+}
+
+static const char* FindLineEnd(const char* text, const char* end)
+{
+	const char* newline = static_cast<const char*>(memchr(text, '\n', end - text));
+	return newline != nullptr ? newline : end;
+}
+
+static const char* NextLine(const char* lineEnd, const char* end)
+{
+	return lineEnd < end ? lineEnd + 1 : end;
+}
+
+// Integers are clamped far beyond the largest index, so they can't overflow.
+const long long MAX_INTEGER = 1ll << 40;
+
+static bool ParseInteger(const char*& text, const char* end, long long& value)
+{
+	const char* p = text;
+	bool negative = p != end && *p == '-';
+	if (p != end && (*p == '-' || *p == '+'))
+		++p;
+	if (p == end || !IsDigit(*p))
+		return false;
+
+	long long result = 0;
+	for (; p != end && IsDigit(*p); ++p)
+		result = result < MAX_INTEGER ? result * 10 + (*p - '0') : result;
+
+	value = negative ? -result : result;
+	text = p;
+	return true;
+}
+
+// Copies the number to a terminated buffer for strtof, which also handles inf, nan and hex.
+// Numbers too long for the buffer, e.g. written with many digits, are copied to the heap
+// instead, so strtof always sees the whole number.
+static bool ParseFloatSlow(const char*& text, const char* end, float& value)
+{
+	const char* tokenEnd = text;
+	while (tokenEnd != end && !IsSpace(*tokenEnd) && *tokenEnd != '\n')
+		++tokenEnd;
+	size_t length = tokenEnd - text;
+
+	char buffer[64];
+	std::string longNumber;
+	const char* number = buffer;
+	if (length < sizeof(buffer))
+	{
+		memcpy(buffer, text, length);
+		buffer[length] = '\0';
+	}
+	else
+	{
+		longNumber.assign(text, length);
+		number = longNumber.c_str();
+	}
+
+	char* parsedEnd = nullptr;
+	float result = strtof(number, &parsedEnd);
+	if (parsedEnd == number)
+		return false;
+
+	value = result;
+	text += parsedEnd - number;
+	return true;
+}
+
+// The powers of ten a double holds exactly.
+static const double EXACT_POWERS_OF_TEN[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+bool ParseFloat(const char*& text, const char* end, float& value)
+{
+	const char* p = text;
+	bool negative = p != end && *p == '-';
+	if (p != end && (*p == '-' || *p == '+'))
+		++p;
+
+	// Gather up to 19 significant digits in an integer, and count how far the decimal point
+	// moves them. exact is cleared if a non-zero digit doesn't fit.
+	unsigned long long digits = 0;
+	unsigned int digitCount = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	bool exact = true;
+	for (; p != end && IsDigit(*p); ++p)
+	{
+		if (digitCount < 19)
+		{
+			digits = digits * 10 + (*p - '0');
+			digitCount += digits != 0 ? 1 : 0;
+		}
+		else
+		{
+			++exponent;
+			exact = exact && *p == '0';
+		}
+		anyDigits = true;
+	}
+
+	if (p != end && *p == '.')
+	{
+		for (++p; p != end && IsDigit(*p); ++p)
+		{
+			if (digitCount < 19)
+			{
+				digits = digits * 10 + (*p - '0');
+				digitCount += digits != 0 ? 1 : 0;
+				--exponent;
+			}
+			else
+			{
+				exact = exact && *p == '0';
+			}
+			anyDigits = true;
+		}
+	}
+
+	if (!anyDigits)
+		return ParseFloatSlow(text, end, value);
+
+	// The exponent is only part of the number if digits follow the 'e'.
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = e != end && *e == '-';
+		if (e != end && (*e == '-' || *e == '+'))
+			++e;
+		if (e != end && IsDigit(*e))
+		{
+			int power = 0;
+			for (; e != end && IsDigit(*e); ++e)
+				power = power < 10000 ? power * 10 + (*e - '0') : power;
+			exponent += negativeExponent ? -power : power;
+			p = e;
+		}
+	}
+
+	// While the digits and the power of ten are both exact doubles, multiplying or dividing
+	// them rounds once, giving the closest double. Rounding that to a float can only differ
+	// from strtof for numbers within 2^-29 of halfway between two floats.
+	if (!exact || digits > (1ull << 53) || exponent < -22 || exponent > 22)
+		return ParseFloatSlow(text, end, value);
+
+	double result = static_cast<double>(digits);
+	result = exponent < 0 ? result / EXACT_POWERS_OF_TEN[-exponent] : result * EXACT_POWERS_OF_TEN[exponent];
+	value = static_cast<float>(negative ? -result : result);
+	text = p;
+	return true;
+}
+
+// Reads a "v x y z [r g b]" line, after the "v".
+static bool ParseObjVertex(const char* text, const char* end, ImportChunk& chunk)
+{
+	float values[6];
+	unsigned int count = 0;
+	for (; count < 6; ++count)
+	{
+		text = SkipSpaces(text, end);
+		if (!ParseFloat(text, end, values[count]))
+			break;
+	}
+
+	if (count < 3)
+		return false;
+
+	chunk.positions.push_back(Float3(values[0], values[1], values[2]));
+	chunk.colours.push_back(count == 6 ? Float4(values[3], values[4], values[5], 1.0f) : Float4(1.0f, 1.0f, 1.0f, 1.0f));
+	return true;
+}
+
+// Reads an "f" line, after the "f". Each corner is "v", "v/vt", "v//vn" or "v/vt/vn".
+static bool ParseObjFace(const char* text, const char* end, ImportChunk& chunk)
+{
+	TriangleFan fan(chunk);
+	for (;;)
+	{
+		text = SkipSpaces(text, end);
+		if (text == end || *text == '#')
+			break;
+
+		long long index;
+		if (!ParseInteger(text, end, index) || index == 0)
+			return false;
+
+		// Skip the texture coordinate and normal indices.
+		while (text != end && !IsSpace(*text))
+			++text;
+
+		// Indices too large or small to fit are clamped to ones that can't be valid.
+		if (index > 0)
+		{
+			fan.AddCorner(static_cast<unsigned int>(std::min(index - 1, static_cast<long long>(~0u))));
+		}
+		else
+		{
+			long long relative = std::max(static_cast<long long>(chunk.positions.size()) + index, static_cast<long long>(INT_MIN));
+			fan.AddCorner(static_cast<unsigned int>(static_cast<int>(relative)), true);
+		}
+	}
+
+	return true;
+}
+
+static void ParseObjChunk(ImportChunk& chunk)
+{
+	const char* line = chunk.begin;
+	while (line < chunk.end && !chunk.failed)
+	{
+		const char* lineEnd = FindLineEnd(line, chunk.end);
+		const char* text = SkipSpaces(line, lineEnd);
+		if (lineEnd - text >= 2 && text[0] == 'v' && IsSpace(text[1]))
+			chunk.failed = !ParseObjVertex(text + 1, lineEnd, chunk);
+		else if (lineEnd - text >= 2 && text[0] == 'f' && IsSpace(text[1]))
+			chunk.failed = !ParseObjFace(text + 1, lineEnd, chunk);
+
+		line = NextLine(lineEnd, chunk.end);
+	}
+}
+
+bool ImportObj(const char* path, ImportedMesh& mesh, ThreadPool* pool)
+{
+	mesh = ImportedMesh();
+
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	const char* begin = reinterpret_cast<const char*>(file.GetData());
+	const char* end = begin + file.GetSize();
+	std::vector<ImportChunk> chunks;
+	SplitLines(begin, end, ChooseChunkCount(pool, file.GetSize() / IMPORT_MIN_CHUNK_BYTES), chunks);
+	ForEachChunk(pool, chunks, ParseObjChunk);
+
+	if (!JoinChunks(chunks, mesh, pool))
+	{
+		mesh = ImportedMesh();
+		return false;
+	}
+
+	return true;
+}
+
+// The types of PLY properties.
+enum class PlyType
+{
+	Int8,
+	UInt8,
+	Int16,
+	UInt16,
+	Int32,
+	UInt32,
+	Float32,
+	Float64,
+};
+
+enum class PlyFormat
+{
+	Ascii,
+	BinaryLittleEndian,
+	BinaryBigEndian,
+};
+
+// What a vertex property is read into: the position, the colour or nothing.
+const int PLY_UNUSED = -1;
+const int PLY_X = 0;
+const int PLY_RED = 3;
+
+struct PlyProperty
+{
+	PlyType type;
+	bool list;
+	PlyType countType;		// The type of a list's length.
+	int component;			// For vertices, PLY_X to PLY_RED + 2 or PLY_UNUSED.
+	float divisor;			// Colour bytes are divided by 255.
+	bool indices;			// For faces, whether this is the list of vertex indices.
+};
+
+struct PlyElement
+{
+	std::string name;
+	unsigned int count;
+	std::vector<PlyProperty> properties;
+};
+
+static bool ParsePlyType(const std::string& name, PlyType& type)
+{
+	static const char* const NAMES[][2] =
+	{
+		{ "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+		{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" },
+	};
+
+	for (int i = 0; i < 8; ++i)
+	{
+		if (name == NAMES[i][0] || name == NAMES[i][1])
+		{
+			type = static_cast<PlyType>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static unsigned int PlyTypeSize(PlyType type)
+{
+	static const unsigned int SIZES[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+	return SIZES[static_cast<int>(type)];
+}
+
+// Reads a binary value. The host is taken to be little endian, like every CPU the program runs on.
+static double ReadPlyValue(const char* data, PlyType type, bool bigEndian)
+{
+	unsigned char bytes[8];
+	const unsigned int size = PlyTypeSize(type);
+	memcpy(bytes, data, size);
+	if (bigEndian)
+		std::reverse(bytes, bytes + size);
+
+	switch (type)
+	{
+	case PlyType::Int8: { signed char value; memcpy(&value, bytes, 1); return value; }
+	case PlyType::UInt8: return bytes[0];
+	case PlyType::Int16: { short value; memcpy(&value, bytes, 2); return value; }
+	case PlyType::UInt16: { unsigned short value; memcpy(&value, bytes, 2); return value; }
+	case PlyType::Int32: { int value; memcpy(&value, bytes, 4); return value; }
+	case PlyType::UInt32: { unsigned int value; memcpy(&value, bytes, 4); return value; }
+	case PlyType::Float32: { float value; memcpy(&value, bytes, 4); return value; }
+	case PlyType::Float64: { double value; memcpy(&value, bytes, 8); return value; }
+	}
+
+	return 0.0;
+}
+
+// Reads the length of a list, where a negative length is taken as an empty list.
+static size_t ReadPlyLength(const char* data, PlyType type, bool bigEndian)
+{
+	double length = ReadPlyValue(data, type, bigEndian);
+	return length > 0.0 ? static_cast<size_t>(length) : 0;
+}
+
+// Reads the header, leaving data at the first element's first record.
+static bool ParsePlyHeader(const char* begin, const char* end, PlyFormat& format, std::vector<PlyElement>& elements, const char*& data)
+{
+	bool formatFound = false;
+	const char* line = begin;
+	for (unsigned int lineNumber = 0; line < end; ++lineNumber)
+	{
+		const char* lineEnd = FindLineEnd(line, end);
+		std::istringstream words(std::string(line, lineEnd));
+		line = NextLine(lineEnd, end);
+
+		std::string keyword;
+		words >> keyword;
+		if (lineNumber == 0)
+		{
+			if (keyword != "ply")
+				return false;
+		}
+		else if (keyword == "format")
+		{
+			std::string name;
+			words >> name;
+			formatFound = true;
+			if (name == "ascii")
+				format = PlyFormat::Ascii;
+			else if (name == "binary_little_endian")
+				format = PlyFormat::BinaryLittleEndian;
+			else if (name == "binary_big_endian")
+				format = PlyFormat::BinaryBigEndian;
+			else
+				return false;
+		}
+		else if (keyword == "element")
+		{
+			PlyElement element;
+			if (!(words >> element.name >> element.count))
+				return false;
+			elements.push_back(element);
+		}
+		else if (keyword == "property")
+		{
+			if (elements.empty())
+				return false;
+
+			PlyElement& element = elements.back();
+			PlyProperty property;
+			std::string type;
+			std::string name;
+			words >> type;
+			property.list = type == "list";
+			property.countType = PlyType::UInt8;
+			if (property.list)
+			{
+				std::string countType;
+				words >> countType >> type;
+				if (!ParsePlyType(countType, property.countType))
+					return false;
+			}
+			words >> name;
+			if (!words || !ParsePlyType(type, property.type))
+				return false;
+
+			static const char* const COMPONENTS[] = { "x", "y", "z", "red", "green", "blue" };
+			property.component = PLY_UNUSED;
+			for (int i = 0; i < 6 && element.name == "vertex" && !property.list; ++i)
+				property.component = name == COMPONENTS[i] ? i : property.component;
+			property.divisor = property.component >= PLY_RED && property.type == PlyType::UInt8 ? 255.0f : 1.0f;
+			property.indices = element.name == "face" && property.list && (name == "vertex_indices" || name == "vertex_index");
+			element.properties.push_back(property);
+		}
+		else if (keyword == "end_header")
+		{
+			data = line;
+			return formatFound;
+		}
+
+		// Comments, obj_info and anything else are skipped.
+	}
+
+	return false;
+}
+
+// Returns the end of count records starting at data, or nullptr if the file ends first. An
+// ASCII record is a line, a binary one is walked property by property if it holds lists.
+static const char* SkipPlyRecords(const char* data, const char* end, const PlyElement& element, unsigned int count, PlyFormat format)
+{
+	if (format == PlyFormat::Ascii)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			if (data == end)
+				return nullptr;
+			data = NextLine(FindLineEnd(data, end), end);
+		}
+		return data;
+	}
+
+	bool hasLists = false;
+	size_t recordSize = 0;
+	for (const PlyProperty& property : element.properties)
+	{
+		hasLists = hasLists || property.list;
+		recordSize += PlyTypeSize(property.type);
+	}
+
+	if (!hasLists)
+		return static_cast<size_t>(end - data) / std::max<size_t>(recordSize, 1) >= count ? data + recordSize * count : nullptr;
+
+	const bool bigEndian = format == PlyFormat::BinaryBigEndian;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		for (const PlyProperty& property : element.properties)
+		{
+			size_t size = PlyTypeSize(property.type);
+			if (property.list)
+			{
+				if (static_cast<size_t>(end - data) < PlyTypeSize(property.countType))
+					return nullptr;
+				size *= ReadPlyLength(data, property.countType, bigEndian);
+				data += PlyTypeSize(property.countType);
+			}
+
+			if (static_cast<size_t>(end - data) < size)
+				return nullptr;
+			data += size;
+		}
+	}
+
+	return data;
+}
+
+static void ParsePlyVertices(ImportChunk& chunk, PlyFormat format)
+{
+	const PlyElement& element = *chunk.element;
+	const bool bigEndian = format == PlyFormat::BinaryBigEndian;
+	chunk.positions.resize(chunk.recordCount);
+	chunk.colours.resize(chunk.recordCount);
+
+	const char* data = chunk.begin;
+	for (unsigned int v = 0; v < chunk.recordCount && !chunk.failed; ++v)
+	{
+		float components[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+		if (format == PlyFormat::Ascii)
+		{
+			const char* lineEnd = FindLineEnd(data, chunk.end);
+			for (const PlyProperty& property : element.properties)
+			{
+				long long length = 0;
+				data = SkipSpaces(data, lineEnd);
+				if (property.list)
+				{
+					chunk.failed = chunk.failed || !ParseInteger(data, lineEnd, length);
+					for (long long i = 0; i < length; ++i)
+						data = SkipValue(data, lineEnd);
+				}
+				else if (property.component != PLY_UNUSED)
+				{
+					float value = 0.0f;
+					chunk.failed = chunk.failed || !ParseFloat(data, lineEnd, value);
+					components[property.component] = value / property.divisor;
+				}
+				else
+				{
+					data = SkipValue(data, lineEnd);
+				}
+			}
+			data = NextLine(lineEnd, chunk.end);
+		}
+		else
+		{
+			// The records were checked to fit when the chunks were split.
+			for (const PlyProperty& property : element.properties)
+			{
+				size_t size = PlyTypeSize(property.type);
+				if (property.list)
+				{
+					size *= ReadPlyLength(data, property.countType, bigEndian);
+					data += PlyTypeSize(property.countType);
+				}
+				else if (property.component != PLY_UNUSED)
+				{
+					components[property.component] = static_cast<float>(ReadPlyValue(data, property.type, bigEndian)) / property.divisor;
+				}
+				data += size;
+			}
+		}
+
+		chunk.positions[v] = Float3(components[0], components[1], components[2]);
+		chunk.colours[v] = Float4(components[3], components[4], components[5], 1.0f);
+	}
+}
+
+static void ParsePlyFaces(ImportChunk& chunk, PlyFormat format)
+{
+	const PlyElement& element = *chunk.element;
+	const bool bigEndian = format == PlyFormat::BinaryBigEndian;
+	chunk.indices.reserve(static_cast<size_t>(chunk.recordCount) * 3);
+
+	// Most binary files hold nothing but a byte count and 32 bit indices for each face, which
+	// are read without going through ReadPlyValue().
+	const PlyProperty* indexList = element.properties.size() == 1 ? &element.properties[0] : nullptr;
+	const bool simpleFaces = format == PlyFormat::BinaryLittleEndian && indexList != nullptr && indexList->indices &&
+		indexList->countType == PlyType::UInt8 && (indexList->type == PlyType::Int32 || indexList->type == PlyType::UInt32);
+
+	const char* data = chunk.begin;
+	for (unsigned int f = 0; f < chunk.recordCount && !chunk.failed; ++f)
+	{
+		TriangleFan fan(chunk);
+		if (format == PlyFormat::Ascii)
+		{
+			const char* lineEnd = FindLineEnd(data, chunk.end);
+			for (const PlyProperty& property : element.properties)
+			{
+				long long length = 0;
+				data = SkipSpaces(data, lineEnd);
+				if (!property.list)
+				{
+					data = SkipValue(data, lineEnd);
+					continue;
+				}
+
+				chunk.failed = chunk.failed || !ParseInteger(data, lineEnd, length);
+				for (long long i = 0; i < length && !chunk.failed; ++i)
+				{
+					long long index = 0;
+					data = SkipSpaces(data, lineEnd);
+					if (property.indices)
+					{
+						chunk.failed = !ParseInteger(data, lineEnd, index) || index < 0;
+						fan.AddCorner(static_cast<unsigned int>(std::min(index, static_cast<long long>(~0u))));
+					}
+					else
+					{
+						data = SkipValue(data, lineEnd);
+					}
+				}
+			}
+			data = NextLine(lineEnd, chunk.end);
+		}
+		else if (simpleFaces)
+		{
+			const unsigned int length = static_cast<unsigned char>(*data++);
+			for (unsigned int i = 0; i < length; ++i, data += sizeof(int))
+			{
+				int index;
+				memcpy(&index, data, sizeof(int));
+				chunk.failed = chunk.failed || (indexList->type == PlyType::Int32 && index < 0);
+				fan.AddCorner(static_cast<unsigned int>(index));
+			}
+		}
+		else
+		{
+			for (const PlyProperty& property : element.properties)
+			{
+				if (!property.list)
+				{
+					data += PlyTypeSize(property.type);
+					continue;
+				}
+
+				const size_t length = ReadPlyLength(data, property.countType, bigEndian);
+				data += PlyTypeSize(property.countType);
+				for (size_t i = 0; i < length && property.indices; ++i)
+				{
+					double index = ReadPlyValue(data + i * PlyTypeSize(property.type), property.type, bigEndian);
+					chunk.failed = chunk.failed || index < 0.0;
+					fan.AddCorner(static_cast<unsigned int>(std::min(index, static_cast<double>(~0u))));
+				}
+				data += length * PlyTypeSize(property.type);
+			}
+		}
+	}
+}
+
+bool ImportPly(const char* path, ImportedMesh& mesh, ThreadPool* pool)
+{
+	mesh = ImportedMesh();
+
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	const char* data = nullptr;
+	const char* end = reinterpret_cast<const char*>(file.GetData()) + file.GetSize();
+	PlyFormat format = PlyFormat::Ascii;
+	std::vector<PlyElement> elements;
+	if (!ParsePlyHeader(reinterpret_cast<const char*>(file.GetData()), end, format, elements, data))
+		return false;
+
+	// A position needs all three coordinates.
+	bool hasPositions = false;
+	for (const PlyElement& element : elements)
+	{
+		int found = 0;
+		for (const PlyProperty& property : element.properties)
+			found |= property.component >= PLY_X && property.component < PLY_RED ? 1 << property.component : 0;
+		hasPositions = hasPositions || (element.name == "vertex" && found == 7);
+	}
+
+	if (!hasPositions)
+		return false;
+
+	// The records only say where they end by being read, so finding where each chunk starts
+	// takes one pass over the file. For ASCII that is a search for newlines, and for binary
+	// records without lists no more than a multiplication.
+	std::vector<ImportChunk> chunks;
+	for (const PlyElement& element : elements)
+	{
+		const bool used = element.name == "vertex" || element.name == "face";
+		const unsigned int chunkCount = used ? ChooseChunkCount(pool, element.count / IMPORT_MIN_CHUNK_RECORDS) : 1;
+		const unsigned int recordsPerChunk = (element.count + chunkCount - 1) / chunkCount;
+		for (unsigned int first = 0; first < element.count; first += recordsPerChunk)
+		{
+			const unsigned int count = std::min(recordsPerChunk, element.count - first);
+			const char* next = SkipPlyRecords(data, end, element, count, format);
+			if (next == nullptr)
+				return false;
+
+			if (used)
+			{
+				ImportChunk chunk;
+				chunk.begin = data;
+				chunk.end = next;
+				chunk.recordCount = count;
+				chunk.element = &element;
+				chunks.push_back(chunk);
+			}
+			data = next;
+		}
+	}
+
+	ForEachChunk(pool, chunks, [format](ImportChunk& chunk)
+	{
+		if (chunk.element->name == "vertex")
+			ParsePlyVertices(chunk, format);
+		else
+			ParsePlyFaces(chunk, format);
+	});
+
+	if (!JoinChunks(chunks, mesh, pool))
+	{
+		mesh = ImportedMesh();
+		return false;
+	}
+
+	return true;
+}
+
+void WeldImportedMesh(ImportedMesh& mesh)
+{
+	const unsigned int vertexCount = static_cast<unsigned int>(mesh.positions.size());
+	if (vertexCount == 0)
+		return;
+
+	// An open addressing hash table of the vertices kept, at most half full, as in WeldVertices().
+	// The vertices kept are moved down in place, as none of them moves up.
+	const unsigned int EMPTY = ~0u;
+	unsigned int tableSize = 1;
+	while (tableSize < vertexCount * 2)
+		tableSize *= 2;
+	std::vector<unsigned int> table(tableSize, EMPTY);
+	std::vector<unsigned int> remap(vertexCount);
+
+	unsigned int keptCount = 0;
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		// FNV-1a over the seven 32 bit words of the position and colour.
+		unsigned int words[7];
+		memcpy(words, &mesh.positions[v], sizeof(Float3));
+		memcpy(words + 3, &mesh.colours[v], sizeof(Float4));
+		unsigned int hash = 2166136261u;
+		for (unsigned int word : words)
+			hash = (hash ^ word) * 16777619u;
+
+		unsigned int slot = hash & (tableSize - 1);
+		while (table[slot] != EMPTY &&
+			(memcmp(&mesh.positions[table[slot]], &mesh.positions[v], sizeof(Float3)) != 0 ||
+			memcmp(&mesh.colours[table[slot]], &mesh.colours[v], sizeof(Float4)) != 0))
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == EMPTY)
+		{
+			table[slot] = keptCount;
+			mesh.positions[keptCount] = mesh.positions[v];
+			mesh.colours[keptCount] = mesh.colours[v];
+			++keptCount;
+		}
+
+		remap[v] = table[slot];
+	}
+
+	for (unsigned int& index : mesh.indices)
+		index = remap[index];
+
+	mesh.positions.resize(keptCount);
+	mesh.colours.resize(keptCount);
+}
+
+// Whether path ends with the extension, ignoring case.
+static bool HasExtension(const char* path, const char* extension)
+{
+	size_t pathLength = strlen(path);
+	size_t extensionLength = strlen(extension);
+	if (pathLength < extensionLength)
+		return false;
+
+	for (size_t i = 0; i < extensionLength; ++i)
+	{
+		if (tolower(static_cast<unsigned char>(path[pathLength - extensionLength + i])) != extension[i])
+			return false;
+	}
+
+	return true;
+}
+
+bool ImportMesh(const char* path, ImportedMesh& mesh, ThreadPool* pool)
+{
+	bool imported = HasExtension(path, ".ply") ? ImportPly(path, mesh, pool) : HasExtension(path, ".obj") && ImportObj(path, mesh, pool);
+	if (imported)
+		WeldImportedMesh(mesh);
+	return imported;
+}
+
+bool ExportObj(const char* path, const ImportedMesh& mesh)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	// Nine significant digits are enough to read back exactly the same floats.
+	file << std::setprecision(9);
+	for (size_t v = 0; v < mesh.positions.size(); ++v)
+	{
+		const Float3& position = mesh.positions[v];
+		const Float4& colour = mesh.colours[v];
+		file << "v " << position.x << " " << position.y << " " << position.z << " "
+			<< colour.x << " " << colour.y << " " << colour.z << "\n";
+	}
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		file << "f " << mesh.indices[i] + 1 << " " << mesh.indices[i + 1] + 1 << " " << mesh.indices[i + 2] + 1 << "\n";
+
+	return file.good();
+}
+
+static unsigned char ColourToByte(float value)
+{
+	value = value > 0.0f ? value : 0.0f;
+	value = value < 1.0f ? value : 1.0f;
+	return static_cast<unsigned char>(value * 255.0f + 0.5f);
+}
+
+bool ExportPly(const char* path, const ImportedMesh& mesh, bool binary)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	file << "ply\nformat " << (binary ? "binary_little_endian" : "ascii") << " 1.0\n";
+	file << "element vertex " << mesh.positions.size() << "\n";
+	file << "property float x\nproperty float y\nproperty float z\n";
+	file << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+	file << "element face " << mesh.indices.size() / 3 << "\n";
+	file << "property list uchar int vertex_indices\nend_header\n";
+
+	if (!binary)
+	{
+		file << std::setprecision(9);
+		for (size_t v = 0; v < mesh.positions.size(); ++v)
+		{
+			const Float3& position = mesh.positions[v];
+			const Float4& colour = mesh.colours[v];
+			file << position.x << " " << position.y << " " << position.z << " " << static_cast<int>(ColourToByte(colour.x))
+				<< " " << static_cast<int>(ColourToByte(colour.y)) << " " << static_cast<int>(ColourToByte(colour.z)) << "\n";
+		}
+
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+			file << "3 " << mesh.indices[i] << " " << mesh.indices[i + 1] << " " << mesh.indices[i + 2] << "\n";
+
+		return file.good();
+	}
+
+	// The records are gathered and written at once.
+	std::vector<char> records;
+	records.reserve(mesh.positions.size() * 15 + mesh.indices.size() / 3 * 13);
+	for (size_t v = 0; v < mesh.positions.size(); ++v)
+	{
+		const Float4& colour = mesh.colours[v];
+		const unsigned char bytes[] = { ColourToByte(colour.x), ColourToByte(colour.y), ColourToByte(colour.z) };
+		const char* position = reinterpret_cast<const char*>(&mesh.positions[v]);
+		records.insert(records.end(), position, position + sizeof(Float3));
+		records.insert(records.end(), bytes, bytes + 3);
+	}
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const int triangle[] = { static_cast<int>(mesh.indices[i]), static_cast<int>(mesh.indices[i + 1]), static_cast<int>(mesh.indices[i + 2]) };
+		records.push_back(3);
+		records.insert(records.end(), reinterpret_cast<const char*>(triangle), reinterpret_cast<const char*>(triangle + 3));
+	}
+
+	file.write(records.data(), records.size());
+	return file.good();
+}
@@ -0,0 +1,72 @@
+// ###########################################################################################
+// ## Reads meshes from the files modelling tools and scanners export (OBJ and PLY). Even when
+// ## parsed in parallel these are far slower to load than mesh files (see MeshFile.h), so
+// ## meshes are converted to mesh files before the program loads them.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "MathTypes.h"
+
+#include <vector>
+
+class ThreadPool;
+
+// A mesh read from a text file: a position and a colour for each vertex, and three indices for
+// each triangle.
+struct ImportedMesh
+{
+	std::vector<Float3> positions;
+	std::vector<Float4> colours;
+	std::vector<unsigned int> indices;
+};
+
+// The importers map the file and split it into chunks of whole lines (or records), which are
+// parsed on the threads of the pool if one is given and then joined. Vertices without a colour
+// are white, and polygons are split into triangle fans. Each returns false if the file can't be
+// read, isn't in a form it understands or a face refers to a vertex that doesn't exist.
+
+// Reads a Wavefront OBJ file. Vertices are read from "v x y z" lines, with the colour following
+// the position ("v x y z r g b"), and triangles from "f" lines. Only the position index of each
+// face corner is used, and everything else in the file is ignored.
+bool ImportObj(const char* path, ImportedMesh& mesh, ThreadPool* pool = nullptr);
+
+// Reads a PLY file, in ASCII or either binary byte order. The vertices' x, y and z properties
+// are used along with red, green and blue if they are there (bytes are scaled to [0, 1]), and
+// the faces' vertex_indices (or vertex_index) list. Other elements and properties are skipped.
+bool ImportPly(const char* path, ImportedMesh& mesh, ThreadPool* pool = nullptr);
+
+// Merges vertices whose position and colour are identical byte for byte, keeping the first of
+// each in its place and renumbering the indices. Scans and exporters that write a vertex per
+// face corner leave many of these.
+void WeldImportedMesh(ImportedMesh& mesh);
+
+// Reads an OBJ or PLY file depending on its extension and welds its vertices.
+bool ImportMesh(const char* path, ImportedMesh& mesh, ThreadPool* pool = nullptr);
+
+// Parses a decimal number at text, which must end before end, and moves text past it. Returns
+// false, leaving text where it was, if there is no number there. Numbers with up to 19 digits
+// and a small exponent, which is what exporters write, are converted without calling strtod.
+bool ParseFloat(const char*& text, const char* end, float& value);
+
+// Write the mesh in a form the importers read, with the colours after the positions. The PLY
+// file stores the colours as bytes, and a binary one is written in little endian byte order.
+bool ExportObj(const char* path, const ImportedMesh& mesh);
+bool ExportPly(const char* path, const ImportedMesh& mesh, bool binary);
@@ -0,0 +1,801 @@
+// ###########################################################################################
+// ## Quadric error mesh simplification and chains of levels of detail.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "MeshSimplifier.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// The most dimensions a point has: the position and the attributes.
+const unsigned int SIMPLIFY_MAX_DIMENSIONS = 3 + SIMPLIFY_MAX_ATTRIBUTES;
+
+// The borders of open surfaces are held in place by planes at right angles to their triangles,
+// counting this much more than the triangles' own planes.
+const float SIMPLIFY_BORDER_WEIGHT = 10.0f;
+
+SimplifyDesc::SimplifyDesc()
+	: targetIndexCount(0)
+	, maxError(FLT_MAX)
+	, attributeWeight(0.5f)
+{
+}
+
+LodChainDesc::LodChainDesc()
+	: maxLodCount(MESH_MAX_LODS)
+	, reduction(0.5f)
+	, maxError(FLT_MAX)
+	, attributeWeight(0.5f)
+{
+}
+
+// What a vertex may be collapsed onto.
+enum class VertexKind
+{
+	Interior,	// Any of its neighbours.
+	Border,		// A neighbour along the border it is on.
+	Locked,		// Nothing, it stays where it is.
+};
+
+// Collapsing the edge between two vertices by moving from onto to.
+struct EdgeCollapse
+{
+	float cost;
+	unsigned int from;
+	unsigned int to;
+
+	bool operator<(const EdgeCollapse& other) const
+	{
+		return cost < other.cost;
+	}
+};
+
+// The vertices as points with a position and attributes, and the quadric each has gathered. A
+// quadric measures the squared distance of a point from a set of planes, each weighted by the
+// area it came from: Q(p) = p^T A p + 2 b.p + c. A is symmetric, so only its upper triangle is
+// stored (row by row), followed by b, c and the total weight.
+struct QuadricSpace
+{
+	unsigned int dimension;
+	unsigned int stride;
+	std::vector<float> points;
+	std::vector<float> quadrics;
+
+	const float* GetPoint(unsigned int vertex) const
+	{
+		return &points[static_cast<size_t>(vertex) * dimension];
+	}
+
+	float* GetQuadric(unsigned int vertex)
+	{
+		return &quadrics[static_cast<size_t>(vertex) * stride];
+	}
+
+	const float* GetQuadric(unsigned int vertex) const
+	{
+		return &quadrics[static_cast<size_t>(vertex) * stride];
+	}
+};
+
+// An edge between two vertices, with the number of triangles using it in each direction.
+struct MeshEdge
+{
+	unsigned int a;
+	unsigned int b;
+	unsigned int forward;	// From a to b.
+	unsigned int backward;	// From b to a.
+
+	// Only one triangle uses a border edge.
+	bool IsBorder() const
+	{
+		return forward + backward == 1;
+	}
+};
+
+// The triangles around each vertex, as offsets into a list of triangles.
+struct VertexTriangles
+{
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> triangles;
+};
+
+static unsigned int ComponentCount(ElementFormat format)
+{
+	switch (format)
+	{
+	case ElementFormat::Float2:
+	case ElementFormat::Half2:
+		return 2;
+	case ElementFormat::Float3:
+		return 3;
+	case ElementFormat::Float4:
+	case ElementFormat::Half4:
+	case ElementFormat::UByteN4:
+		return 4;
+	}
+
+	return 0;
+}
+
+static void Cross(const float* a, const float* b, float* result)
+{
+	result[0] = a[1] * b[2] - a[2] * b[1];
+	result[1] = a[2] * b[0] - a[0] * b[2];
+	result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float Dot3(const float* a, const float* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Adds the plane through p, q and r, with the given weight, to a quadric of n dimensions. In
+// more than three dimensions the plane is the one the triangle spans, and the distance of a
+// point from it is measured along everything at right angles to it.
+static void AddTriangleQuadric(float* quadric, const float* p, const float* q, const float* r, unsigned int n, double weight)
+{
+	// Two orthonormal vectors spanning the triangle.
+	double e1[SIMPLIFY_MAX_DIMENSIONS];
+	double e2[SIMPLIFY_MAX_DIMENSIONS];
+	double length1 = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		e1[i] = q[i] - p[i];
+		e2[i] = r[i] - p[i];
+		length1 += e1[i] * e1[i];
+	}
+
+	if (length1 <= 0.0 || weight <= 0.0)
+		return;
+
+	length1 = sqrt(length1);
+	double along = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		e1[i] /= length1;
+		along += e2[i] * e1[i];
+	}
+
+	double length2 = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		e2[i] -= along * e1[i];
+		length2 += e2[i] * e2[i];
+	}
+
+	if (length2 <= 0.0)
+		return;
+
+	length2 = sqrt(length2);
+	double pe1 = 0.0;
+	double pe2 = 0.0;
+	double pp = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		e2[i] /= length2;
+		pe1 += p[i] * e1[i];
+		pe2 += p[i] * e2[i];
+		pp += p[i] * p[i];
+	}
+
+	// A = I - e1 e1^T - e2 e2^T, b = (p.e1) e1 + (p.e2) e2 - p, c = p.p - (p.e1)^2 - (p.e2)^2.
+	float* a = quadric;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		for (unsigned int j = i; j < n; ++j)
+			*a++ += static_cast<float>(weight * ((i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j]));
+	}
+
+	float* b = a;
+	for (unsigned int i = 0; i < n; ++i)
+		b[i] += static_cast<float>(weight * (pe1 * e1[i] + pe2 * e2[i] - p[i]));
+
+	b[n] += static_cast<float>(weight * (pp - pe1 * pe1 - pe2 * pe2));
+	b[n + 1] += static_cast<float>(weight);
+}
+
+// Adds the plane normal.p + d = 0 in the position's three dimensions to a quadric of n.
+static void AddPlaneQuadric(float* quadric, const float* normal, float d, unsigned int n, float weight)
+{
+	float* a = quadric;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		for (unsigned int j = i; j < n; ++j, ++a)
+		{
+			if (j < 3)
+				*a += weight * normal[i] * normal[j];
+		}
+	}
+
+	float* b = a;
+	for (unsigned int i = 0; i < 3; ++i)
+		b[i] += weight * d * normal[i];
+
+	b[n] += weight * d * d;
+}
+
+// The weighted sum of the squared distances of point from the quadric's planes.
+static double EvaluateQuadric(const float* quadric, const float* point, unsigned int n)
+{
+	const float* a = quadric;
+	double error = 0.0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		double row = *a++ * point[i];
+		for (unsigned int j = i + 1; j < n; ++j)
+			row += 2.0 * *a++ * point[j];
+		error += row * point[i];
+	}
+
+	const float* b = a;
+	for (unsigned int i = 0; i < n; ++i)
+		error += 2.0 * b[i] * point[i];
+
+	error += b[n];
+	return error > 0.0 ? error : 0.0;
+}
+
+// The average squared distance of to's point from the planes both vertices have gathered.
+static float CollapseCost(const QuadricSpace& space, unsigned int from, unsigned int to)
+{
+	const float* fromQuadric = space.GetQuadric(from);
+	const float* toQuadric = space.GetQuadric(to);
+	const float* point = space.GetPoint(to);
+	double weight = static_cast<double>(fromQuadric[space.stride - 1]) + toQuadric[space.stride - 1];
+	double error = EvaluateQuadric(fromQuadric, point, space.dimension) + EvaluateQuadric(toQuadric, point, space.dimension);
+	return weight > 0.0 ? static_cast<float>(error / weight) : 0.0f;
+}
+
+static void BuildVertexTriangles(const std::vector<unsigned int>& indices, unsigned int vertexCount, VertexTriangles& adjacency)
+{
+	adjacency.offsets.assign(vertexCount + 1, 0);
+	for (unsigned int index : indices)
+		++adjacency.offsets[index + 1];
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+	adjacency.triangles.resize(indices.size());
+	std::vector<unsigned int> next(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); ++i)
+		adjacency.triangles[next[indices[i]]++] = static_cast<unsigned int>(i / 3);
+}
+
+// The edges of the triangles as (a << 32) | b for the edge from a to b, sorted, so the
+// triangles using an edge in either direction can be counted quickly.
+static void FindDirectedEdges(const std::vector<unsigned int>& indices, std::vector<unsigned long long>& directedEdges)
+{
+	directedEdges.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		unsigned long long a = indices[i];
+		unsigned long long b = indices[i - i % 3 + (i + 1) % 3];
+		directedEdges[i] = (a << 32) | b;
+	}
+	std::sort(directedEdges.begin(), directedEdges.end());
+}
+
+static unsigned int CountDirectedEdges(const std::vector<unsigned long long>& directedEdges, unsigned int a, unsigned int b)
+{
+	const unsigned long long key = (static_cast<unsigned long long>(a) << 32) | b;
+	std::pair<std::vector<unsigned long long>::const_iterator, std::vector<unsigned long long>::const_iterator> range =
+		std::equal_range(directedEdges.begin(), directedEdges.end(), key);
+	return static_cast<unsigned int>(range.second - range.first);
+}
+
+// Lists every edge once, with the triangles using it in each direction.
+static void FindEdges(const std::vector<unsigned long long>& directedEdges, std::vector<MeshEdge>& edges)
+{
+	edges.clear();
+	for (size_t i = 0; i < directedEdges.size();)
+	{
+		size_t next = i + 1;
+		while (next < directedEdges.size() && directedEdges[next] == directedEdges[i])
+			++next;
+
+		MeshEdge edge;
+		edge.a = static_cast<unsigned int>(directedEdges[i] >> 32);
+		edge.b = static_cast<unsigned int>(directedEdges[i] & 0xFFFFFFFF);
+		edge.forward = static_cast<unsigned int>(next - i);
+		edge.backward = CountDirectedEdges(directedEdges, edge.b, edge.a);
+
+		// An edge used both ways is listed from its smaller vertex.
+		if (edge.a < edge.b || edge.backward == 0)
+			edges.push_back(edge);
+		i = next;
+	}
+}
+
+// Finds the vertices on borders, which can only move along them, and locks the ones where the
+// surface isn't a simple sheet: corners where borders meet, and edges with more than two
+// triangles. The vertices of seams are always locked.
+static void ClassifyVertices(const std::vector<MeshEdge>& edges, const std::vector<unsigned char>& seams, std::vector<VertexKind>& kinds)
+{
+	const unsigned int vertexCount = static_cast<unsigned int>(seams.size());
+	std::vector<unsigned int> borderEdges(vertexCount, 0);
+	kinds.assign(vertexCount, VertexKind::Interior);
+	for (const MeshEdge& edge : edges)
+	{
+		if (edge.forward > 1 || edge.backward > 1)
+		{
+			kinds[edge.a] = VertexKind::Locked;
+			kinds[edge.b] = VertexKind::Locked;
+		}
+		else if (edge.IsBorder())
+		{
+			++borderEdges[edge.a];
+			++borderEdges[edge.b];
+		}
+	}
+
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		if (seams[v] != 0 || (borderEdges[v] != 0 && borderEdges[v] != 2))
+			kinds[v] = VertexKind::Locked;
+		else if (borderEdges[v] == 2 && kinds[v] == VertexKind::Interior)
+			kinds[v] = VertexKind::Border;
+	}
+}
+
+static bool CanCollapse(const std::vector<VertexKind>& kinds, const MeshEdge& edge, unsigned int from)
+{
+	switch (kinds[from])
+	{
+	case VertexKind::Interior: return true;
+	case VertexKind::Border: return edge.IsBorder();
+	case VertexKind::Locked: return false;
+	}
+
+	return false;
+}
+
+// Marks the vertices that share their position with another vertex, which are on a seam
+// between different attributes. Moving them would tear the surface open.
+static void FindSeams(const IndexedMesh& mesh, const InputElementDesc& position, std::vector<unsigned char>& seams)
+{
+	const unsigned int size = ElementSize(position.format);
+	const unsigned char* data = mesh.vertices.data() + position.byteOffset;
+	const unsigned int stride = mesh.vertexStride;
+	std::vector<unsigned int> order(mesh.vertexCount);
+	for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+		order[v] = v;
+
+	std::sort(order.begin(), order.end(), [data, stride, size](unsigned int a, unsigned int b)
+	{
+		return memcmp(data + static_cast<size_t>(a) * stride, data + static_cast<size_t>(b) * stride, size) < 0;
+	});
+
+	seams.assign(mesh.vertexCount, 0);
+	for (unsigned int i = 1; i < mesh.vertexCount; ++i)
+	{
+		if (memcmp(data + static_cast<size_t>(order[i - 1]) * stride, data + static_cast<size_t>(order[i]) * stride, size) == 0)
+		{
+			seams[order[i - 1]] = 1;
+			seams[order[i]] = 1;
+		}
+	}
+}
+
+// Checks that moving from onto to keeps the surface as it is: the two vertices share exactly
+// the neighbours of the triangles between them (so no part of the surface is pinched off), and
+// none of from's other triangles turn over. The triangles are read through remap, as they are
+// after the collapses made so far in the pass; the ones those collapses made empty are skipped.
+static bool IsCollapseValid(const std::vector<unsigned int>& indices, const VertexTriangles& adjacency,
+	const QuadricSpace& space, const std::vector<unsigned int>& remap, std::vector<unsigned int>& marks,
+	unsigned int& mark, unsigned int from, unsigned int to, unsigned int& sharedTriangles)
+{
+	// Mark to's neighbours, as they are now.
+	const unsigned int toMark = ++mark;
+	for (unsigned int i = adjacency.offsets[to]; i < adjacency.offsets[to + 1]; ++i)
+	{
+		const unsigned int* triangle = &indices[static_cast<size_t>(adjacency.triangles[i]) * 3];
+		for (int corner = 0; corner < 3; ++corner)
+			marks[remap[triangle[corner]]] = toMark;
+	}
+
+	// Count the neighbours of from that are also neighbours of to, once each.
+	const unsigned int fromMark = ++mark;
+	unsigned int sharedNeighbours = 0;
+	sharedTriangles = 0;
+	const float* toPosition = space.GetPoint(to);
+	for (unsigned int i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; ++i)
+	{
+		const unsigned int* triangle = &indices[static_cast<size_t>(adjacency.triangles[i]) * 3];
+		int corner = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+		unsigned int b = remap[triangle[(corner + 1) % 3]];
+		unsigned int c = remap[triangle[(corner + 2) % 3]];
+		if (b == c)
+			continue;
+
+		if (b == to || c == to)
+		{
+			++sharedTriangles;
+			continue;
+		}
+
+		// Each shared neighbour is counted the first time it is seen, then marked as seen.
+		for (unsigned int neighbour : { b, c })
+		{
+			if (marks[neighbour] == toMark)
+			{
+				++sharedNeighbours;
+				marks[neighbour] = fromMark;
+			}
+		}
+
+		// The triangle's normal before and after the collapse.
+		const float* pa = space.GetPoint(from);
+		const float* pb = space.GetPoint(b);
+		const float* pc = space.GetPoint(c);
+		float ab[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+		float ac[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+		float tb[3] = { pb[0] - toPosition[0], pb[1] - toPosition[1], pb[2] - toPosition[2] };
+		float tc[3] = { pc[0] - toPosition[0], pc[1] - toPosition[1], pc[2] - toPosition[2] };
+		float before[3];
+		float after[3];
+		Cross(ab, ac, before);
+		Cross(tb, tc, after);
+		if (Dot3(before, after) <= 0.0f)
+			return false;
+	}
+
+	// The vertex opposite the edge in each triangle between them is the only neighbour they
+	// may share, the edges of those triangles are the ones that are merged.
+	return sharedTriangles != 0 && sharedNeighbours == sharedTriangles;
+}
+
+float SimplifyMesh(const IndexedMesh& mesh, const InputElementDesc* elements, unsigned int elementCount,
+	const unsigned int* indices, unsigned int indexCount, const SimplifyDesc& desc, std::vector<unsigned int>& result)
+{
+	result.assign(indices, indices + indexCount - indexCount % 3);
+
+	// The position comes first in a point, followed by as many attribute components as fit.
+	const InputElementDesc* position = nullptr;
+	const InputElementDesc* attributes[SIMPLIFY_MAX_ATTRIBUTES];
+	unsigned int attributeCount = 0;
+	unsigned int attributeComponents = 0;
+	for (unsigned int i = 0; i < elementCount; ++i)
+	{
+		if (strcmp(elements[i].semanticName, "POSITION") == 0 && elements[i].semanticIndex == 0)
+		{
+			position = &elements[i];
+		}
+		else if (attributeComponents + ComponentCount(elements[i].format) <= SIMPLIFY_MAX_ATTRIBUTES)
+		{
+			attributes[attributeCount++] = &elements[i];
+			attributeComponents += ComponentCount(elements[i].format);
+		}
+	}
+
+	if (position == nullptr || result.size() <= desc.targetIndexCount)
+		return 0.0f;
+
+	const unsigned int vertexCount = mesh.vertexCount;
+	QuadricSpace space;
+	space.dimension = 3 + attributeComponents;
+	space.stride = space.dimension * (space.dimension + 1) / 2 + space.dimension + 2;
+	space.points.resize(static_cast<size_t>(vertexCount) * space.dimension);
+	space.quadrics.assign(static_cast<size_t>(vertexCount) * space.stride, 0.0f);
+
+	// Positions are scaled to fit in a unit cube, so the error doesn't depend on the size of the
+	// mesh and the attributes' weight means the same for every mesh.
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		const unsigned char* vertex = &mesh.vertices[static_cast<size_t>(v) * mesh.vertexStride];
+		Float4 value = FetchElement(vertex + position->byteOffset, position->format);
+		float* point = &space.points[static_cast<size_t>(v) * space.dimension];
+		point[0] = value.x;
+		point[1] = value.y;
+		point[2] = value.z;
+		for (int i = 0; i < 3; ++i)
+		{
+			minimum[i] = std::min(minimum[i], point[i]);
+			maximum[i] = std::max(maximum[i], point[i]);
+		}
+
+		float* component = point + 3;
+		for (unsigned int a = 0; a < attributeCount; ++a)
+		{
+			Float4 attribute = FetchElement(vertex + attributes[a]->byteOffset, attributes[a]->format);
+			const float values[4] = { attribute.x, attribute.y, attribute.z, attribute.w };
+			for (unsigned int i = 0; i < ComponentCount(attributes[a]->format); ++i)
+				*component++ = values[i] * desc.attributeWeight;
+		}
+	}
+
+	float extent = vertexCount != 0 ? std::max(std::max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]) : 0.0f;
+	extent = extent > 0.0f ? extent : 1.0f;
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		float* point = &space.points[static_cast<size_t>(v) * space.dimension];
+		for (int i = 0; i < 3; ++i)
+			point[i] = (point[i] - minimum[i]) / extent;
+	}
+
+	// Every vertex starts with the planes of its triangles.
+	std::vector<float> triangleQuadric(space.stride);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const float* p = space.GetPoint(result[i]);
+		const float* q = space.GetPoint(result[i + 1]);
+		const float* r = space.GetPoint(result[i + 2]);
+		float pq[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+		float pr[3] = { r[0] - p[0], r[1] - p[1], r[2] - p[2] };
+		float normal[3];
+		Cross(pq, pr, normal);
+		double area = 0.5 * sqrt(static_cast<double>(Dot3(normal, normal)));
+		std::fill(triangleQuadric.begin(), triangleQuadric.end(), 0.0f);
+		AddTriangleQuadric(triangleQuadric.data(), p, q, r, space.dimension, area);
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			float* quadric = space.GetQuadric(result[i + corner]);
+			for (unsigned int j = 0; j < space.stride; ++j)
+				quadric[j] += triangleQuadric[j];
+		}
+	}
+
+	std::vector<unsigned char> seams;
+	FindSeams(mesh, *position, seams);
+
+	std::vector<unsigned long long> directedEdges;
+	FindDirectedEdges(result, directedEdges);
+
+	// Border edges get a plane at right angles to their triangle as well, so moving a vertex
+	// away from the border costs as much as moving it away from the surface would.
+	for (size_t i = 0; i < result.size(); ++i)
+	{
+		size_t triangle = i - i % 3;
+		unsigned int a = result[i];
+		unsigned int b = result[triangle + (i + 1) % 3];
+		unsigned int c = result[triangle + (i + 2) % 3];
+		if (CountDirectedEdges(directedEdges, b, a) != 0)
+			continue;
+
+		const float* pa = space.GetPoint(a);
+		const float* pb = space.GetPoint(b);
+		const float* pc = space.GetPoint(c);
+		float ab[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+		float ac[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+		float normal[3];
+		float planeNormal[3];
+		Cross(ab, ac, normal);
+		Cross(ab, normal, planeNormal);
+		float length = sqrt(Dot3(planeNormal, planeNormal));
+		if (length <= 0.0f)
+			continue;
+
+		for (int j = 0; j < 3; ++j)
+			planeNormal[j] /= length;
+
+		float weight = SIMPLIFY_BORDER_WEIGHT * Dot3(ab, ab);
+		AddPlaneQuadric(space.GetQuadric(a), planeNormal, -Dot3(planeNormal, pa), space.dimension, weight);
+		AddPlaneQuadric(space.GetQuadric(b), planeNormal, -Dot3(planeNormal, pa), space.dimension, weight);
+	}
+
+	// Collapses are made in passes. Each pass finds the cost of every edge, then makes the
+	// cheapest collapses in order, skipping edges whose vertices have already been collapsed or
+	// collapsed onto in the same pass. The pass ends by removing the triangles the collapses
+	// made empty.
+	const float maxCost = desc.maxError < FLT_MAX ? (desc.maxError / extent) * (desc.maxError / extent) : FLT_MAX;
+	const unsigned int targetTriangleCount = desc.targetIndexCount / 3;
+	unsigned int triangleCount = static_cast<unsigned int>(result.size() / 3);
+	float largestCost = 0.0f;
+	std::vector<VertexKind> kinds;
+	std::vector<MeshEdge> edges;
+	std::vector<EdgeCollapse> collapses;
+	VertexTriangles adjacency;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned char> touched(vertexCount);
+	std::vector<unsigned int> marks(vertexCount, 0);
+	unsigned int mark = 0;
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		remap[v] = v;
+
+	while (triangleCount > targetTriangleCount)
+	{
+		BuildVertexTriangles(result, vertexCount, adjacency);
+		FindEdges(directedEdges, edges);
+		ClassifyVertices(edges, seams, kinds);
+
+		// The cheaper way of collapsing each edge.
+		collapses.clear();
+		for (const MeshEdge& edge : edges)
+		{
+			EdgeCollapse collapse = { FLT_MAX, edge.a, edge.b };
+			if (CanCollapse(kinds, edge, edge.a))
+				collapse.cost = CollapseCost(space, edge.a, edge.b);
+			if (CanCollapse(kinds, edge, edge.b))
+			{
+				float cost = CollapseCost(space, edge.b, edge.a);
+				if (cost < collapse.cost)
+				{
+					collapse.cost = cost;
+					collapse.from = edge.b;
+					collapse.to = edge.a;
+				}
+			}
+
+			// Edges neither vertex may be collapsed along keep the cost of FLT_MAX.
+			if (collapse.cost < FLT_MAX && collapse.cost <= maxCost)
+				collapses.push_back(collapse);
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		std::fill(touched.begin(), touched.end(), 0);
+		unsigned int collapseCount = 0;
+		for (const EdgeCollapse& collapse : collapses)
+		{
+			if (triangleCount <= targetTriangleCount)
+				break;
+
+			// A vertex is collapsed or collapsed onto at most once in a pass, so the triangles
+			// around from only change by their other vertices moving away.
+			unsigned int sharedTriangles = 0;
+			if (touched[collapse.from] != 0 || touched[collapse.to] != 0 || !IsCollapseValid(result, adjacency, space, remap, marks, mark, collapse.from, collapse.to, sharedTriangles))
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			float* fromQuadric = space.GetQuadric(collapse.from);
+			float* toQuadric = space.GetQuadric(collapse.to);
+			for (unsigned int i = 0; i < space.stride; ++i)
+				toQuadric[i] += fromQuadric[i];
+
+			touched[collapse.from] = 1;
+			touched[collapse.to] = 1;
+			triangleCount -= sharedTriangles;
+			largestCost = std::max(largestCost, collapse.cost);
+			++collapseCount;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// Move the collapsed vertices' corners onto the vertices they were collapsed onto and
+		// drop the triangles that lost a corner.
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = remap[result[i]];
+			unsigned int b = remap[result[i + 1]];
+			unsigned int c = remap[result[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			result[kept++] = a;
+			result[kept++] = b;
+			result[kept++] = c;
+		}
+		result.resize(kept);
+		triangleCount = static_cast<unsigned int>(kept / 3);
+
+		for (unsigned int v = 0; v < vertexCount; ++v)
+			remap[v] = v;
+		FindDirectedEdges(result, directedEdges);
+	}
+
+	return sqrt(largestCost) * extent;
+}
+
+unsigned int BuildLodChain(IndexedMesh& mesh, const InputElementDesc* elements, unsigned int elementCount,
+	const LodChainDesc& desc, std::vector<unsigned int>& indices, MeshLod* lods)
+{
+	const unsigned int maxLodCount = std::min(desc.maxLodCount, MESH_MAX_LODS);
+	if (maxLodCount == 0)
+		return 0;
+
+	const size_t firstIndex = indices.size();
+	lods[0].firstIndex = static_cast<unsigned int>(firstIndex);
+	lods[0].indexCount = static_cast<unsigned int>(mesh.indices.size());
+	lods[0].vertexCount = mesh.vertexCount;
+	lods[0].error = 0.0f;
+	indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+	// Each level is simplified from the one before, which is much faster than starting from the
+	// full mesh every time. Its error is at most the previous level's plus the error made
+	// simplifying it.
+	std::vector<unsigned int> previous(mesh.indices);
+	std::vector<unsigned int> simplified;
+	unsigned int lodCount = 1;
+	while (lodCount < maxLodCount)
+	{
+		const MeshLod& previousLod = lods[lodCount - 1];
+		if (previousLod.error >= desc.maxError)
+			break;
+
+		SimplifyDesc simplifyDesc;
+		simplifyDesc.targetIndexCount = static_cast<unsigned int>(previous.size() / 3 * desc.reduction) * 3;
+		simplifyDesc.maxError = desc.maxError - previousLod.error;
+		simplifyDesc.attributeWeight = desc.attributeWeight;
+		float error = SimplifyMesh(mesh, elements, elementCount, previous.data(), static_cast<unsigned int>(previous.size()),
+			simplifyDesc, simplified);
+
+		// Stop once the mesh can hardly be simplified any more, as another level would cost
+		// memory without saving much drawing.
+		if (simplified.empty() || simplified.size() * 10 > previous.size() * 9)
+			break;
+
+		previous.swap(simplified);
+		OptimiseVertexCache(previous, mesh.vertexCount);
+
+		MeshLod& lod = lods[lodCount++];
+		lod.firstIndex = static_cast<unsigned int>(indices.size());
+		lod.indexCount = static_cast<unsigned int>(previous.size());
+		lod.error = previousLod.error + error;
+		indices.insert(indices.end(), previous.begin(), previous.end());
+	}
+
+	// Number the vertices in the order the levels first use them, from the coarsest level to the
+	// full mesh, and then the vertices no triangle uses.
+	std::vector<unsigned int> remap(mesh.vertexCount, ~0u);
+	unsigned int nextVertex = 0;
+	for (unsigned int lod = lodCount; lod-- > 0;)
+	{
+		for (unsigned int i = 0; i < lods[lod].indexCount; ++i)
+		{
+			unsigned int& vertex = remap[indices[lods[lod].firstIndex + i]];
+			if (vertex == ~0u)
+				vertex = nextVertex++;
+		}
+		lods[lod].vertexCount = nextVertex;
+	}
+
+	for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+	{
+		if (remap[v] == ~0u)
+			remap[v] = nextVertex++;
+	}
+
+	std::vector<unsigned char> vertices(mesh.vertices.size());
+	for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+	{
+		memcpy(&vertices[static_cast<size_t>(remap[v]) * mesh.vertexStride],
+			&mesh.vertices[static_cast<size_t>(v) * mesh.vertexStride], mesh.vertexStride);
+	}
+
+	mesh.vertices.swap(vertices);
+	for (size_t i = firstIndex; i < indices.size(); ++i)
+		indices[i] = remap[indices[i]];
+	for (unsigned int& index : mesh.indices)
+		index = remap[index];
+
+	return lodCount;
+}
+
+float CalculatePixelsPerUnit(float distance, float fovY, unsigned int height)
+{
+	if (distance <= 0.0f)
+		return FLT_MAX;
+
+	return height / (2.0f * distance * tan(fovY * 0.5f));
+}
+
+unsigned int SelectLod(const MeshLod* lods, unsigned int lodCount, float pixelsPerUnit, float maxPixelError)
+{
+	// The errors grow from level to level, so the search stops at the first one that is too coarse.
+	unsigned int lod = 0;
+	while (lod + 1 < lodCount && lods[lod + 1].error * pixelsPerUnit <= maxPixelError)
+		++lod;
+
+	return lod;
+}
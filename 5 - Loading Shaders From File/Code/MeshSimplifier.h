@@ -0,0 +1,105 @@
+// ###########################################################################################
+// ## Mesh simplification by quadric error edge collapses, and chains of levels of detail built
+// ## with it. Distant objects are drawn with fewer vertices and triangles by picking a coarser
+// ## level of detail from how large the simplification's error would be on screen.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "MeshBuilder.h"
+#include "RenderBackend.h"
+
+#include <vector>
+
+// The most levels of detail a chain can have, including the full mesh.
+const unsigned int MESH_MAX_LODS = 8;
+
+// The most attribute components (beyond the position) the simplifier takes into account. A
+// colour is 4, further ones are ignored.
+const unsigned int SIMPLIFY_MAX_ATTRIBUTES = 12;
+
+// One level of detail of a mesh: a range of its indices. Every level uses the same vertex
+// buffer, a coarser level using fewer of the vertices at its start.
+struct MeshLod
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int vertexCount;	// The level uses the vertices [0, vertexCount).
+	float error;	// How far the surface is from the full mesh's at most, in the mesh's units.
+};
+
+struct SimplifyDesc
+{
+	SimplifyDesc();
+
+	unsigned int targetIndexCount;	// Edges are collapsed until there are at most this many indices left.
+	float maxError;					// Or until a collapse would make an error larger than this, in the mesh's units.
+
+	// How much attributes count compared with positions. A difference of 1 in an attribute
+	// component (a colour channel going from 0 to 1) counts as much as moving the surface by
+	// attributeWeight times the largest side of the mesh's bounds.
+	float attributeWeight;
+};
+
+struct LodChainDesc
+{
+	LodChainDesc();
+
+	unsigned int maxLodCount;	// At most MESH_MAX_LODS.
+	float reduction;			// Each level aims for this fraction of the previous level's triangles.
+	float maxError;				// No level is made with a larger error than this, in the mesh's units.
+	float attributeWeight;		// See SimplifyDesc.
+};
+
+// Simplifies the triangles given by indices by collapsing edges, moving one vertex of an edge
+// onto the other, cheapest first. The cost of a collapse is the quadric error of Garland and
+// Heckbert's "Simplifying Surfaces with Color and Texture using Quadric Error Metrics": every
+// triangle of the original surface is a plane in the space of positions and attributes, and a
+// collapse costs the squared distance of the kept vertex from the planes of the triangles the
+// removed vertex had gathered. Attributes are every element other than the POSITION.
+//
+// No vertices are created or changed, the result indexes the mesh's vertices like the input
+// does. The edges of open surfaces stay in place, vertices sharing their position with others
+// (seams between different attributes) are never moved, and collapses that would flip a
+// triangle or join two parts of the surface are skipped, so the result may have more indices
+// than asked for. Returns the largest error made, in the mesh's units.
+float SimplifyMesh(const IndexedMesh& mesh, const InputElementDesc* elements, unsigned int elementCount,
+	const unsigned int* indices, unsigned int indexCount, const SimplifyDesc& desc, std::vector<unsigned int>& result);
+
+// Builds levels of detail for a mesh, each one simplified from the one before, until one can't
+// be made smaller, is too coarse or there are maxLodCount of them. The first level is the mesh's
+// own triangles. Every level's indices are appended to indices, with its triangles optimised for
+// the vertex cache, and lods is filled in. Returns the number of levels.
+//
+// A level only uses vertices the finer levels use as well, so the vertices are reordered with
+// the coarsest level's first, followed by those each finer level adds. A level then reads a
+// range at the start of the vertex buffer rather than vertices spread all over it. The mesh's
+// indices are changed to match.
+unsigned int BuildLodChain(IndexedMesh& mesh, const InputElementDesc* elements, unsigned int elementCount,
+	const LodChainDesc& desc, std::vector<unsigned int>& indices, MeshLod* lods);
+
+// The number of pixels a length of 1 covers at the given distance from the eye, with a
+// perspective projection of vertical field of view fovY (in radians) onto a viewport height
+// pixels high. Multiply by an object's scale to use it with the object's LODs.
+float CalculatePixelsPerUnit(float distance, float fovY, unsigned int height);
+
+// Returns the coarsest level whose error covers at most maxPixelError pixels on screen, given
+// the pixels a unit of the mesh covers. The levels go from the full mesh to the coarsest.
+unsigned int SelectLod(const MeshLod* lods, unsigned int lodCount, float pixelsPerUnit, float maxPixelError);
@@ -0,0 +1,218 @@
+// ###########################################################################################
+// ## Pipeline state objects: the shaders, input layout and topology a draw uses, bundled into one
+// ## immutable object. A cache makes sure each description is only created once.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "PipelineState.h"
+#include "ShaderCache.h"
+
+#include <cstring>
+
+void RenderBackend::SetPipelineState(const PipelineState* state)
+{
+	// Backends that don't track their state bind every part of it.
+	IASetInputLayout(state->GetInputLayout());
+	IASetPrimitiveTopology(state->GetTopology());
+	VSSetShader(state->GetVertexShader());
+	PSSetShader(state->GetPixelShader());
+}
+
+PipelineStateCache::PipelineStateCache(RenderBackend* backend)
+	: mBackend(backend)
+	, mNextId(0)
+{
+	memset(&mStatistics, 0, sizeof(mStatistics));
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+	for (auto& state : mStates)
+		delete state.second;
+
+	for (auto& inputLayout : mInputLayouts)
+	{
+		delete inputLayout.second->inputLayout;
+		delete inputLayout.second;
+	}
+}
+
+const PipelineState* PipelineStateCache::GetPipelineState(const PipelineStateDesc& desc)
+{
+	unsigned long long inputLayoutHash = HashInputLayout(desc);
+	unsigned long long hash = inputLayoutHash;
+	hash = ShaderCache::Hash(&desc.pixelShader, sizeof(desc.pixelShader), hash);
+	hash = ShaderCache::Hash(&desc.topology, sizeof(desc.topology), hash);
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	// Input layouts are unique for a vertex shader and its elements, so a state matches if it
+	// uses the same input layout and the rest of the description is the same.
+	CachedInputLayout* inputLayout = nullptr;
+	auto inputLayouts = mInputLayouts.equal_range(inputLayoutHash);
+	for (auto i = inputLayouts.first; i != inputLayouts.second; ++i)
+	{
+		if (i->second->vertexShader == desc.vertexShader && ElementsMatch(i->second->elements, desc))
+		{
+			inputLayout = i->second;
+			break;
+		}
+	}
+
+	if (inputLayout != nullptr)
+	{
+		auto states = mStates.equal_range(hash);
+		for (auto i = states.first; i != states.second; ++i)
+		{
+			const PipelineState* state = i->second;
+			if (state->mInputLayout == inputLayout->inputLayout && state->mPixelShader == desc.pixelShader &&
+				state->mTopology == desc.topology)
+			{
+				++mStatistics.stateHits;
+				return state;
+			}
+		}
+	}
+	else
+	{
+		// The input layout is created while holding the lock, so two threads asking for the
+		// same description can't both create it.
+		BackendInputLayout* backendInputLayout = mBackend->CreateInputLayout(desc.inputElements, desc.inputElementCount, desc.vertexShader);
+		if (backendInputLayout == nullptr)
+			return nullptr;
+
+		inputLayout = new CachedInputLayout();
+		inputLayout->vertexShader = desc.vertexShader;
+		inputLayout->inputLayout = backendInputLayout;
+		inputLayout->stateCount = 0;
+		for (unsigned int i = 0; i < desc.inputElementCount; ++i)
+		{
+			const InputElementDesc& element = desc.inputElements[i];
+			InputElementKey key;
+			key.semanticName = element.semanticName;
+			key.semanticIndex = element.semanticIndex;
+			key.format = element.format;
+			key.inputSlot = element.inputSlot;
+			key.byteOffset = element.byteOffset;
+			key.inputSlotClass = element.inputSlotClass;
+			key.instanceDataStepRate = element.instanceDataStepRate;
+			inputLayout->elements.push_back(key);
+		}
+
+		mInputLayouts.insert(std::make_pair(inputLayoutHash, inputLayout));
+		++mStatistics.inputLayoutsCreated;
+	}
+
+	PipelineState* state = new PipelineState();
+	state->mVertexShader = desc.vertexShader;
+	state->mPixelShader = desc.pixelShader;
+	state->mInputLayout = inputLayout->inputLayout;
+	state->mTopology = desc.topology;
+	state->mHash = hash;
+	state->mInputLayoutHash = inputLayoutHash;
+	state->mId = mNextId++;
+	++inputLayout->stateCount;
+
+	mStates.insert(std::make_pair(hash, state));
+	++mStatistics.statesCreated;
+
+	return state;
+}
+
+void PipelineStateCache::Release(const PipelineState* state)
+{
+	if (state == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	auto states = mStates.equal_range(state->mHash);
+	for (auto i = states.first; i != states.second; ++i)
+	{
+		if (i->second == state)
+		{
+			mStates.erase(i);
+			break;
+		}
+	}
+
+	auto inputLayouts = mInputLayouts.equal_range(state->mInputLayoutHash);
+	for (auto i = inputLayouts.first; i != inputLayouts.second; ++i)
+	{
+		CachedInputLayout* inputLayout = i->second;
+		if (inputLayout->inputLayout == state->mInputLayout)
+		{
+			if (--inputLayout->stateCount == 0)
+			{
+				delete inputLayout->inputLayout;
+				delete inputLayout;
+				mInputLayouts.erase(i);
+			}
+			break;
+		}
+	}
+
+	delete state;
+}
+
+PipelineStateCacheStatistics PipelineStateCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStatistics;
+}
+
+unsigned long long PipelineStateCache::HashInputLayout(const PipelineStateDesc& desc)
+{
+	// The semantic names are hashed by their text, as the same name may be stored in
+	// different places.
+	unsigned long long hash = ShaderCache::Hash(&desc.vertexShader, sizeof(desc.vertexShader));
+	for (unsigned int i = 0; i < desc.inputElementCount; ++i)
+	{
+		const InputElementDesc& element = desc.inputElements[i];
+		hash = ShaderCache::Hash(element.semanticName, strlen(element.semanticName), hash);
+		hash = ShaderCache::Hash(&element.semanticIndex, sizeof(element.semanticIndex), hash);
+		hash = ShaderCache::Hash(&element.format, sizeof(element.format), hash);
+		hash = ShaderCache::Hash(&element.inputSlot, sizeof(element.inputSlot), hash);
+		hash = ShaderCache::Hash(&element.byteOffset, sizeof(element.byteOffset), hash);
+		hash = ShaderCache::Hash(&element.inputSlotClass, sizeof(element.inputSlotClass), hash);
+		hash = ShaderCache::Hash(&element.instanceDataStepRate, sizeof(element.instanceDataStepRate), hash);
+	}
+
+	return hash;
+}
+
+bool PipelineStateCache::ElementsMatch(const std::vector<InputElementKey>& elements, const PipelineStateDesc& desc)
+{
+	if (elements.size() != desc.inputElementCount)
+		return false;
+
+	for (unsigned int i = 0; i < desc.inputElementCount; ++i)
+	{
+		const InputElementKey& key = elements[i];
+		const InputElementDesc& element = desc.inputElements[i];
+		if (key.semanticName != element.semanticName || key.semanticIndex != element.semanticIndex ||
+			key.format != element.format || key.inputSlot != element.inputSlot || key.byteOffset != element.byteOffset ||
+			key.inputSlotClass != element.inputSlotClass || key.instanceDataStepRate != element.instanceDataStepRate)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
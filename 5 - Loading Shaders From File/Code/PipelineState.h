@@ -0,0 +1,137 @@
+// ###########################################################################################
+// ## Pipeline state objects: the shaders, input layout and topology a draw uses, bundled into one
+// ## immutable object. A cache makes sure each description is only created once.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "RenderBackend.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Describes a pipeline state to get from a PipelineStateCache. The shaders are not owned by
+// the state; the input layout is created from the elements and the vertex shader.
+struct PipelineStateDesc
+{
+	BackendVertexShader* vertexShader;
+	BackendPixelShader* pixelShader;
+	const InputElementDesc* inputElements;
+	unsigned int inputElementCount;
+	PrimitiveTopology topology;
+};
+
+// Everything a draw needs bound besides its buffers. Created by a PipelineStateCache and never
+// changed, so two draws with the same state can be told apart from two with different ones by
+// comparing pointers. Bound with RenderBackend::SetPipelineState().
+class PipelineState
+{
+public:
+	BackendVertexShader* GetVertexShader() const { return mVertexShader; }
+	BackendPixelShader* GetPixelShader() const { return mPixelShader; }
+	BackendInputLayout* GetInputLayout() const { return mInputLayout; }
+	PrimitiveTopology GetTopology() const { return mTopology; }
+	unsigned long long GetHash() const { return mHash; }
+
+	// A small number unique among the states of a cache, used to sort draws by state (see
+	// DrawQueue.h). Numbers of released states are not reused.
+	unsigned int GetId() const { return mId; }
+
+private:
+	friend class PipelineStateCache;
+
+	BackendVertexShader* mVertexShader;
+	BackendPixelShader* mPixelShader;
+	BackendInputLayout* mInputLayout;	// Owned by the cache, shared between states.
+	PrimitiveTopology mTopology;
+	unsigned long long mHash;
+	unsigned long long mInputLayoutHash;
+	unsigned int mId;
+};
+
+// Counters for what a cache has done.
+struct PipelineStateCacheStatistics
+{
+	unsigned long long statesCreated;
+	unsigned long long stateHits;			// Descriptions that were already in the cache.
+	unsigned long long inputLayoutsCreated;	// Input layouts are shared by states using the same vertex shader and elements.
+};
+
+class PipelineStateCache
+{
+public:
+	// States and input layouts are created with the backend, which must outlive the cache.
+	explicit PipelineStateCache(RenderBackend* backend);
+
+	// Deletes all states and their input layouts. The shaders are left alone.
+	~PipelineStateCache();
+
+	// Returns the state for the description, creating it the first time the description is
+	// seen. Returns nullptr if the input layout can't be created. May be called from several
+	// threads at the same time.
+	const PipelineState* GetPipelineState(const PipelineStateDesc& desc);
+
+	// Deletes a state, and its input layout if no other state uses it. Needed when a shader it
+	// uses is deleted, e.g. when it is reloaded, as a new shader could get the same address.
+	// Get the state replacing it first, so that can't get the address of the deleted one.
+	// Does nothing if state is nullptr.
+	void Release(const PipelineState* state);
+
+	PipelineStateCacheStatistics GetStatistics() const;
+
+private:
+	PipelineStateCache(const PipelineStateCache&);
+	PipelineStateCache& operator=(const PipelineStateCache&);
+
+	// A copy of the input elements of a description, with the semantic names copied too, to
+	// compare descriptions whose hashes are the same.
+	struct InputElementKey
+	{
+		std::string semanticName;
+		unsigned int semanticIndex;
+		ElementFormat format;
+		unsigned int inputSlot;
+		unsigned int byteOffset;
+		InputClassification inputSlotClass;
+		unsigned int instanceDataStepRate;
+	};
+
+	struct CachedInputLayout
+	{
+		BackendVertexShader* vertexShader;
+		std::vector<InputElementKey> elements;
+		BackendInputLayout* inputLayout;
+		unsigned int stateCount;
+	};
+
+	static unsigned long long HashInputLayout(const PipelineStateDesc& desc);
+	static bool ElementsMatch(const std::vector<InputElementKey>& elements, const PipelineStateDesc& desc);
+
+	RenderBackend* mBackend;
+	mutable std::mutex mMutex;
+	unsigned int mNextId;
+
+	// Both are keyed by hash. Descriptions with the same hash are told apart by comparing them.
+	std::unordered_multimap<unsigned long long, CachedInputLayout*> mInputLayouts;
+	std::unordered_multimap<unsigned long long, PipelineState*> mStates;
+	PipelineStateCacheStatistics mStatistics;
+};
@@ -0,0 +1,186 @@
+// ###########################################################################################
+// ## CPU timing of the phases of a frame (and of startup). Each timed section keeps its most
+// ## recent samples in a lock-free ring buffer, from which min/avg/percentiles are computed.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+// The sections in the order they were created. Sections are globals, so they are all created
+// before main() starts, on one thread.
+static std::vector<ProfileSection*>& GetSections()
+{
+	static std::vector<ProfileSection*> sections;
+	return sections;
+}
+
+unsigned long long ReadProfileTicks()
+{
+#if defined(_WIN32)
+	// steady_clock only has a resolution of milliseconds in older versions of Visual Studio.
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return static_cast<unsigned long long>(counter.QuadPart);
+#else
+	std::chrono::nanoseconds time = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<unsigned long long>(time.count());
+#endif
+}
+
+unsigned long long GetProfileTickFrequency()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<unsigned long long>(frequency.QuadPart);
+#else
+	return 1000000000ull;
+#endif
+}
+
+ProfileSection::ProfileSection(const char* name)
+	: mName(name), mWriteIndex(0)
+{
+	for (unsigned int i = 0; i < SAMPLE_COUNT; ++i)
+		mSamples[i].store(0, std::memory_order_relaxed);
+
+	GetSections().push_back(this);
+}
+
+void ProfileSection::CopySamples(std::vector<unsigned long long>& samples) const
+{
+	unsigned long long end = mWriteIndex.load(std::memory_order_relaxed);
+	unsigned long long begin = end > SAMPLE_COUNT ? end - SAMPLE_COUNT : 0;
+
+	samples.clear();
+	samples.reserve(static_cast<size_t>(end - begin));
+	for (unsigned long long i = begin; i < end; ++i)
+		samples.push_back(mSamples[i & (SAMPLE_COUNT - 1)].load(std::memory_order_relaxed));
+}
+
+// Returns the sample at the given percentile of sorted samples, using the nearest rank.
+static unsigned long long Percentile(const std::vector<unsigned long long>& sorted, unsigned int percent)
+{
+	size_t rank = (sorted.size() * percent + 99) / 100;
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+std::vector<ProfileStatistics> GetProfileStatistics()
+{
+	const double millisecondsPerTick = 1000.0 / GetProfileTickFrequency();
+
+	std::vector<ProfileStatistics> statistics;
+	std::vector<unsigned long long> samples;
+	for (const ProfileSection* section : GetSections())
+	{
+		section->CopySamples(samples);
+		if (samples.empty())
+			continue;
+
+		std::sort(samples.begin(), samples.end());
+		unsigned long long sum = 0;
+		for (unsigned long long sample : samples)
+			sum += sample;
+
+		ProfileStatistics sectionStatistics;
+		sectionStatistics.name = section->GetName();
+		sectionStatistics.totalSampleCount = section->GetTotalSampleCount();
+		sectionStatistics.sampleCount = static_cast<unsigned int>(samples.size());
+		sectionStatistics.min = samples.front() * millisecondsPerTick;
+		sectionStatistics.average = static_cast<double>(sum) / samples.size() * millisecondsPerTick;
+		sectionStatistics.p50 = Percentile(samples, 50) * millisecondsPerTick;
+		sectionStatistics.p95 = Percentile(samples, 95) * millisecondsPerTick;
+		sectionStatistics.p99 = Percentile(samples, 99) * millisecondsPerTick;
+		sectionStatistics.max = samples.back() * millisecondsPerTick;
+		statistics.push_back(sectionStatistics);
+	}
+
+	return statistics;
+}
+
+bool WriteProfileCSV(const char* path)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	file << "section,samples,min_ms,avg_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+	file << std::setprecision(6);
+	for (const ProfileStatistics& s : GetProfileStatistics())
+	{
+		file << s.name << "," << s.sampleCount << "," << s.min << "," << s.average << "," << s.p50
+			<< "," << s.p95 << "," << s.p99 << "," << s.max << "\n";
+	}
+
+	return file.good();
+}
+
+bool WriteProfileJSON(const char* path)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	// Section names are plain identifiers and slashes, so they need no escaping.
+	std::vector<ProfileStatistics> statistics = GetProfileStatistics();
+	file << "[\n" << std::setprecision(6);
+	for (size_t i = 0; i < statistics.size(); ++i)
+	{
+		const ProfileStatistics& s = statistics[i];
+		file << "  { \"section\": \"" << s.name << "\", \"samples\": " << s.sampleCount
+			<< ", \"min_ms\": " << s.min << ", \"avg_ms\": " << s.average << ", \"p50_ms\": " << s.p50
+			<< ", \"p95_ms\": " << s.p95 << ", \"p99_ms\": " << s.p99 << ", \"max_ms\": " << s.max
+			<< " }" << (i + 1 < statistics.size() ? "," : "") << "\n";
+	}
+	file << "]\n";
+
+	return file.good();
+}
+
+void PrintProfileReport()
+{
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+
+	std::cout << "CPU time (ms) over the last " << ProfileSection::SAMPLE_COUNT << " samples" << std::endl;
+	std::cout << std::left << std::setw(24) << "  Section" << std::right << std::setw(9) << "Samples"
+		<< std::setw(10) << "Min" << std::setw(10) << "Avg" << std::setw(10) << "P50"
+		<< std::setw(10) << "P95" << std::setw(10) << "P99" << std::setw(10) << "Max" << std::endl;
+
+	std::cout << std::fixed << std::setprecision(4);
+	for (const ProfileStatistics& s : GetProfileStatistics())
+	{
+		std::cout << "  " << std::left << std::setw(22) << s.name << std::right << std::setw(9) << s.sampleCount
+			<< std::setw(10) << s.min << std::setw(10) << s.average << std::setw(10) << s.p50
+			<< std::setw(10) << s.p95 << std::setw(10) << s.p99 << std::setw(10) << s.max << std::endl;
+	}
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
@@ -0,0 +1,130 @@
+// ###########################################################################################
+// ## CPU timing of the phases of a frame (and of startup). Each timed section keeps its most
+// ## recent samples in a lock-free ring buffer, from which min/avg/percentiles are computed.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Trace.h"
+
+// Returns a timestamp from the highest resolution clock available (QueryPerformanceCounter on
+// Windows), in ticks of GetProfileTickFrequency() per second.
+unsigned long long ReadProfileTicks();
+unsigned long long GetProfileTickFrequency();
+
+// A named part of the program to time, e.g. the clear in Render(). Sections register
+// themselves when created and must live until the program ends, so they are made globals:
+//
+//		ProfileSection gClearSection("Render/Clear");
+//		...
+//		{
+//			ProfileScope scope(gClearSection);
+//			gBackend->ClearRenderTargetView(...);
+//		}
+//
+// Adding a sample is a few instructions and takes no lock, so sections can be timed from any
+// number of threads at once and left on in release builds.
+class ProfileSection
+{
+public:
+	// The number of samples kept; older ones are overwritten.
+	static const unsigned int SAMPLE_COUNT = 1024;
+
+	explicit ProfileSection(const char* name);
+
+	void AddSample(unsigned long long ticks)
+	{
+		unsigned long long index = mWriteIndex.fetch_add(1, std::memory_order_relaxed);
+		mSamples[index & (SAMPLE_COUNT - 1)].store(ticks, std::memory_order_relaxed);
+	}
+
+	const char* GetName() const { return mName; }
+
+	// The number of samples ever added, including those that have been overwritten.
+	unsigned long long GetTotalSampleCount() const { return mWriteIndex.load(std::memory_order_relaxed); }
+
+	// Copies the kept samples, oldest first. A sample being written at the same time may be
+	// missing or be the one it replaces, which doesn't matter for the statistics.
+	void CopySamples(std::vector<unsigned long long>& samples) const;
+
+private:
+	ProfileSection(const ProfileSection&);
+	ProfileSection& operator=(const ProfileSection&);
+
+	const char* mName;
+	std::atomic<unsigned long long> mWriteIndex;
+	std::atomic<unsigned long long> mSamples[SAMPLE_COUNT];
+};
+
+// Times the rest of the enclosing block and adds it to a section, and to the trace if one is
+// being captured (see Trace.h).
+class ProfileScope
+{
+public:
+	explicit ProfileScope(ProfileSection& section)
+		: mSection(section), mStart(ReadProfileTicks())
+	{
+	}
+
+	~ProfileScope()
+	{
+		unsigned long long end = ReadProfileTicks();
+		mSection.AddSample(end - mStart);
+		if (IsTracing())
+			AddTraceEvent(mSection.GetName(), mStart, end);
+	}
+
+private:
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+
+	ProfileSection& mSection;
+	unsigned long long mStart;
+};
+
+// The statistics of the samples a section has kept, in milliseconds. Percentiles use the
+// nearest rank, so they are always one of the samples.
+struct ProfileStatistics
+{
+	std::string name;
+	unsigned long long totalSampleCount;
+	unsigned int sampleCount;	// The samples the statistics are computed from, at most SAMPLE_COUNT.
+	double min;
+	double average;
+	double p50;
+	double p95;
+	double p99;
+	double max;
+};
+
+// Computes the statistics of every section with samples, in the order the sections were created.
+std::vector<ProfileStatistics> GetProfileStatistics();
+
+// Writes the statistics of every section as CSV (one line per section, after a header) or as
+// JSON (an array of objects). Return false if the file can't be written.
+bool WriteProfileCSV(const char* path);
+bool WriteProfileJSON(const char* path);
+
+// Writes the statistics of every section to the console as a table.
+void PrintProfileReport();
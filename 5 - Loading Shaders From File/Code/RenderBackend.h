@@ -0,0 +1,188 @@
+// ###########################################################################################
+// ## The interface between the scene code and the API doing the actual rendering. It covers
+// ## the resources the sample creates and the calls Render() makes, so the same scene can be
+// ## drawn with Direct3D 11 (D3D11Backend) or on the CPU without a GPU (SoftwareBackend).
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+// The formats an input element can have. Each corresponds to a DXGI format.
+enum class ElementFormat
+{
+	Float2,		// DXGI_FORMAT_R32G32_FLOAT
+	Float3,		// DXGI_FORMAT_R32G32B32_FLOAT
+	Float4,		// DXGI_FORMAT_R32G32B32A32_FLOAT
+	Half2,		// DXGI_FORMAT_R16G16_FLOAT
+	Half4,		// DXGI_FORMAT_R16G16B16A16_FLOAT
+	UByteN4,	// DXGI_FORMAT_R8G8B8A8_UNORM
+};
+
+// The formats an index buffer can have.
+enum class IndexFormat
+{
+	UInt16,		// DXGI_FORMAT_R16_UINT
+	UInt32,		// DXGI_FORMAT_R32_UINT
+};
+
+// The ways vertices can be assembled into primitives. Only triangle lists are used so far.
+enum class PrimitiveTopology
+{
+	TriangleList,	// D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+};
+
+// Whether an element is read once per vertex or once per instance, see D3D11_INPUT_CLASSIFICATION.
+enum class InputClassification
+{
+	PerVertex,		// D3D11_INPUT_PER_VERTEX_DATA
+	PerInstance,	// D3D11_INPUT_PER_INSTANCE_DATA
+};
+
+// Describes one element of a vertex, see D3D11_INPUT_ELEMENT_DESC. Per instance elements
+// move on to the next value every instanceDataStepRate instances, per vertex elements use 0.
+struct InputElementDesc
+{
+	const char* semanticName;
+	unsigned int semanticIndex;
+	ElementFormat format;
+	unsigned int inputSlot;
+	unsigned int byteOffset;
+	InputClassification inputSlotClass;
+	unsigned int instanceDataStepRate;
+};
+
+// How a dynamic buffer is mapped for writing, see D3D11_MAP.
+enum class MapMode
+{
+	WriteDiscard,		// D3D11_MAP_WRITE_DISCARD: the previous contents are thrown away, the GPU may still read them.
+	WriteNoOverwrite,	// D3D11_MAP_WRITE_NO_OVERWRITE: the caller promises not to write anything the GPU may still read.
+};
+
+// Constant buffers are bound in units of 16 byte constants. A shader sees at most this many
+// constants of a buffer, and with offsets (see RenderBackend::VSSetConstantBuffers()) the first
+// constant and count must be multiples of CONSTANT_BUFFER_OFFSET_ALIGNMENT.
+const unsigned int CONSTANT_SIZE = 16;
+const unsigned int CONSTANT_BUFFER_MAX_CONSTANTS = 4096;
+const unsigned int CONSTANT_BUFFER_OFFSET_ALIGNMENT = 16;
+
+// Describes a shader to create: the file containing its HLSL source, the name of the entry
+// function and the shader model to compile it with (e.g. "vs_5_0").
+struct ShaderDesc
+{
+	const wchar_t* path;
+	const char* entryPoint;
+	const char* target;
+};
+
+// Resources created by a backend. Every backend derives its own types from these and casts
+// back to them when the resources are bound. Deleting a resource releases it.
+class BackendResource
+{
+public:
+	virtual ~BackendResource() {}
+};
+
+class BackendBuffer : public BackendResource {};
+class BackendVertexShader : public BackendResource {};
+class BackendPixelShader : public BackendResource {};
+class BackendInputLayout : public BackendResource {};
+class BackendRenderTarget : public BackendResource {};
+
+class PipelineState;
+
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	// Resource creation. All of these return nullptr on failure. Like with ID3D11Device, they
+	// may be called from several threads at the same time.
+	virtual BackendBuffer* CreateVertexBuffer(const void* data, unsigned int byteWidth) = 0;
+	virtual BackendBuffer* CreateIndexBuffer(const void* data, unsigned int byteWidth) = 0;
+	virtual BackendVertexShader* CreateVertexShader(const ShaderDesc& desc) = 0;
+	virtual BackendPixelShader* CreatePixelShader(const ShaderDesc& desc) = 0;
+	virtual BackendInputLayout* CreateInputLayout(const InputElementDesc* elements,
+		unsigned int elementCount, BackendVertexShader* vertexShader) = 0;
+
+	// Creates a buffer of byteWidth bytes that the CPU writes to while rendering, rather than
+	// an immutable one. It can be bound as both a vertex and an index buffer.
+	virtual BackendBuffer* CreateDynamicBuffer(unsigned int byteWidth) = 0;
+
+	// Creates a constant buffer of byteWidth bytes (a multiple of CONSTANT_SIZE), written by the
+	// CPU the same way as a dynamic buffer. Without offset support a shader only sees its first
+	// CONSTANT_BUFFER_MAX_CONSTANTS constants.
+	virtual BackendBuffer* CreateConstantBuffer(unsigned int byteWidth) = 0;
+
+	// Whether VSSetConstantBuffers() can bind part of a buffer, and constant buffers may be
+	// mapped with WriteNoOverwrite. Both came with Direct3D 11.1.
+	virtual bool SupportsConstantBufferOffsets() const = 0;
+
+	// The render target wrapping the back buffer. Owned by the backend.
+	virtual BackendRenderTarget* GetBackBuffer() = 0;
+
+	// The calls made when rendering a frame. These work like their ID3D11DeviceContext and
+	// IDXGISwapChain counterparts of the same name.
+	virtual void ClearRenderTargetView(BackendRenderTarget* target, const float colour[4]) = 0;
+	virtual void IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+		BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) = 0;
+	virtual void IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset) = 0;
+	virtual void IASetInputLayout(BackendInputLayout* inputLayout) = 0;
+	virtual void IASetPrimitiveTopology(PrimitiveTopology topology) = 0;
+	virtual void VSSetShader(BackendVertexShader* shader) = 0;
+	virtual void PSSetShader(BackendPixelShader* shader) = 0;
+
+	// Binds constant buffers to the vertex shader's registers b[startSlot] onwards. Each buffer
+	// can be bound from its firstConstants entry on, showing the shader constantCounts constants,
+	// like VSSetConstantBuffers1(); only pass these if SupportsConstantBufferOffsets(). With
+	// nullptr the buffers are bound from their start, like VSSetConstantBuffers().
+	virtual void VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+		const unsigned int* firstConstants, const unsigned int* constantCounts) = 0;
+
+	// Maps a dynamic buffer for writing, returning a pointer to its first byte, or nullptr on
+	// failure. Unmap() before drawing with it.
+	virtual void* Map(BackendBuffer* buffer, MapMode mode) = 0;
+	virtual void Unmap(BackendBuffer* buffer) = 0;
+
+	// Copies size bytes to the given offset of a dynamic buffer. Unless a backend does better,
+	// this maps the buffer, copies the data and unmaps it.
+	virtual void UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+		const void* data, unsigned int size);
+
+	// Binds the input layout, topology and shaders of a pipeline state (see PipelineState.h).
+	// Unless a backend does better, this makes the four calls above.
+	virtual void SetPipelineState(const PipelineState* state);
+
+	virtual void Draw(unsigned int vertexCount, unsigned int startVertexLocation) = 0;
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation) = 0;
+
+	// Draws instanceCount copies of the same vertices in one call. Per instance elements are
+	// read starting at startInstanceLocation, e.g. to give each copy its own transform.
+	virtual void DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+		unsigned int startVertexLocation, unsigned int startInstanceLocation) = 0;
+	virtual void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+		unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation) = 0;
+	virtual void Present() = 0;
+
+	// Fences tell when the GPU has finished the work submitted before them, so memory it reads
+	// can be written again. InsertFence() returns the value of the new fence, one more than the
+	// last one (starting at 1), and GetCompletedFence() the value of the last fence the GPU has
+	// passed, 0 before the first.
+	virtual unsigned long long InsertFence() = 0;
+	virtual unsigned long long GetCompletedFence() = 0;
+};
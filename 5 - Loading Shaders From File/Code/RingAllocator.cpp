@@ -0,0 +1,127 @@
+// ###########################################################################################
+// ## Hands out memory from a ring one allocation after the other, freeing it a frame at a time
+// ## once the GPU is done with it. Knows nothing about buffers, so it works for any memory.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(unsigned int size)
+	: mSize(size)
+	, mHead(0)
+	, mTail(0)
+	, mUsedSize(0)
+	, mFrameSize(0)
+{
+}
+
+bool RingAllocator::Allocate(unsigned int size, unsigned int alignment, RingAllocation& allocation)
+{
+	if (size == 0 || size > mSize)
+		return false;
+
+	// The memory in use runs from the tail to the head, possibly past the end and around. When
+	// the head is behind the tail, the free memory lies between them; otherwise it runs from the
+	// head to the end, and from the start up to the tail.
+	unsigned long long aligned = (static_cast<unsigned long long>(mHead) + alignment - 1) & ~static_cast<unsigned long long>(alignment - 1);
+	bool headBehindTail = mHead < mTail || (mHead == mTail && mUsedSize != 0);
+	unsigned int taken;
+	if (headBehindTail)
+	{
+		if (aligned + size > mTail)
+			return false;
+
+		allocation.offset = static_cast<unsigned int>(aligned);
+		allocation.wrapped = false;
+		taken = static_cast<unsigned int>(aligned) + size - mHead;
+	}
+	else if (aligned + size <= mSize)
+	{
+		allocation.offset = static_cast<unsigned int>(aligned);
+		allocation.wrapped = false;
+		taken = static_cast<unsigned int>(aligned) + size - mHead;
+	}
+	else
+	{
+		// Skip the rest of the ring and start over at the beginning, which is aligned to
+		// anything. With nothing in use the tail moves to the start as well, so the skipped
+		// memory isn't taken up.
+		if (mUsedSize == 0)
+		{
+			mTail = 0;
+			taken = size;
+		}
+		else if (size <= mTail)
+		{
+			taken = mSize - mHead + size;
+		}
+		else
+		{
+			return false;
+		}
+
+		allocation.offset = 0;
+		allocation.wrapped = true;
+	}
+
+	// The head may stop at the very end, the next allocation then wraps.
+	mHead = allocation.offset + size;
+	mUsedSize += taken;
+	mFrameSize += taken;
+	return true;
+}
+
+void RingAllocator::EndFrame(unsigned long long fence)
+{
+	// A frame without allocations has nothing to free.
+	if (mFrameSize == 0)
+		return;
+
+	Frame frame;
+	frame.fence = fence;
+	frame.end = mHead;
+	frame.size = mFrameSize;
+	mFrames.push_back(frame);
+	mFrameSize = 0;
+}
+
+void RingAllocator::ReleaseFrames(unsigned long long completedFence)
+{
+	while (!mFrames.empty() && mFrames.front().fence <= completedFence)
+	{
+		mTail = mFrames.front().end;
+		mUsedSize -= mFrames.front().size;
+		mFrames.pop_front();
+	}
+}
+
+unsigned long long RingAllocator::GetOldestFence() const
+{
+	return mFrames.empty() ? 0 : mFrames.front().fence;
+}
+
+unsigned int RingAllocator::GetSize() const
+{
+	return mSize;
+}
+
+unsigned int RingAllocator::GetUsedSize() const
+{
+	return mUsedSize;
+}
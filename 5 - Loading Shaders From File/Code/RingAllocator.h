@@ -0,0 +1,77 @@
+// ###########################################################################################
+// ## Hands out memory from a ring one allocation after the other, freeing it a frame at a time
+// ## once the GPU is done with it. Knows nothing about buffers, so it works for any memory.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <deque>
+
+// Where an allocation was placed in the ring.
+struct RingAllocation
+{
+	unsigned int offset;	// In bytes from the start of the ring.
+	bool wrapped;			// Whether the ring started over at offset 0 for this allocation.
+};
+
+// Allocations are placed one after the other, starting over at the beginning when they reach
+// the end. They can't be freed one by one: the allocations made between two calls to EndFrame()
+// belong to a frame, which is tied to a fence (see RenderBackend::InsertFence()), and are all
+// freed by ReleaseFrames() once the GPU has passed the fence. Memory still in use by a frame is
+// never handed out again.
+class RingAllocator
+{
+public:
+	explicit RingAllocator(unsigned int size);
+
+	// Allocates size bytes at a multiple of alignment, which must be a power of two. Returns
+	// false if there isn't room without overwriting a frame the GPU may still be using, in which
+	// case the caller has to wait for a fence and release its frame first. Allocations larger
+	// than the ring never succeed.
+	bool Allocate(unsigned int size, unsigned int alignment, RingAllocation& allocation);
+
+	// Ends the frame the allocations since the last call belong to. Its memory is freed when
+	// ReleaseFrames() is called with a completed fence of at least fence.
+	void EndFrame(unsigned long long fence);
+
+	// Frees the memory of the frames whose fences are at most completedFence.
+	void ReleaseFrames(unsigned long long completedFence);
+
+	// The fence of the oldest frame still holding memory, or 0 if there is none.
+	unsigned long long GetOldestFence() const;
+
+	unsigned int GetSize() const;
+	unsigned int GetUsedSize() const;	// Including the space skipped when wrapping and aligning.
+
+private:
+	struct Frame
+	{
+		unsigned long long fence;
+		unsigned int end;		// Where the frame's last allocation ended.
+		unsigned int size;		// The bytes the frame took up.
+	};
+
+	unsigned int mSize;
+	unsigned int mHead;		// Where the next allocation starts looking.
+	unsigned int mTail;		// The start of the oldest memory in use.
+	unsigned int mUsedSize;
+	unsigned int mFrameSize;	// The bytes taken up by the current frame so far.
+	std::deque<Frame> mFrames;
+};
@@ -0,0 +1,398 @@
+// ###########################################################################################
+// ## The scene of the sample: a coloured rectangle made from two triangles, using vertex and
+// ## index buffers, an input layout and shaders in separate files.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "Scene.h"
+#include "ConstantBuffers.h"
+#include "DrawQueue.h"
+#include "MeshBuilder.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "MeshSimplifier.h"
+#include "PipelineState.h"
+#include "Profiler.h"
+#include "RenderBackend.h"
+#include "ShaderCompileScheduler.h"
+#include "ShaderReloader.h"
+#include "StateFilterBackend.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+// Scene global variables. The scene draws through a filter in front of the backend it was set
+// up with, which drops the binds that wouldn't change anything (see StateFilterBackend.h).
+RenderBackend* gBackend = nullptr;
+StateFilterBackend* gStateFilter = nullptr;
+
+BackendVertexShader* gVertexShader = nullptr;
+BackendPixelShader* gPixelShader = nullptr;
+PipelineStateCache* gPipelineStateCache = nullptr;
+const PipelineState* gPipelineState = nullptr;
+DrawQueue gDrawQueue;
+ThreadPool* gRecordingThreadPool = nullptr;	// Records the queued draws into command buffers.
+ConstantBufferManager* gConstantBuffers = nullptr;
+BackendBuffer* gVertexBuffer = nullptr;
+BackendBuffer* gIndexBuffer = nullptr;
+IndexFormat gIndexFormat = IndexFormat::UInt16;
+unsigned int gIndexCount = 0;
+
+// The rectangle's place in the world, handed to the vertex shader as its object constants, so
+// it can be moved without touching its vertices. The view doesn't transform anything yet, so
+// the world is already clip space.
+ObjectConstants gRectangleConstants;
+ViewConstants gViewConstants;
+double gTime = 0.0;
+double gTimeStep = 0.0;
+
+// The bytes of object constants the scene has room for, enough for 1024 objects in each of the
+// frames the GPU may be behind.
+const unsigned int SCENE_OBJECT_CONSTANTS_SIZE = 1024 * OBJECT_CONSTANTS_STRIDE * 3;
+
+ShaderCompileScheduler* gShaderScheduler = nullptr;
+ShaderReloader* gShaderReloader = nullptr;
+
+// The descriptions the shaders were created from, kept to reload them.
+ShaderDesc gVertexShaderDesc;
+ShaderDesc gPixelShaderDesc;
+
+// The phases of Render() that are timed, see Profiler.h.
+ProfileSection gRenderSection("Render");
+ProfileSection gClearSection("Render/Clear");
+ProfileSection gQueueSection("Render/Queue");
+ProfileSection gSortSection("Render/Sort");
+ProfileSection gSubmitSection("Render/Submit");
+ProfileSection gPresentSection("Render/Present");
+
+bool SetupScene(RenderBackend* backend)
+{
+	gStateFilter = new StateFilterBackend(backend);
+	gBackend = gStateFilter;
+	gShaderScheduler = new ShaderCompileScheduler(backend);
+	gPipelineStateCache = new PipelineStateCache(backend);
+	gRecordingThreadPool = new ThreadPool(std::max(std::thread::hardware_concurrency(), 1u));
+	gConstantBuffers = new ConstantBufferManager(gBackend, SCENE_OBJECT_CONSTANTS_SIZE);
+
+	CreateVertexBuffer();
+	return CreateShaders();
+}
+
+void CreateVertexBuffer()
+{
+	TraceZone zone("CreateVertexBuffer");
+
+	// Create vertices.
+	Vertex vertices[] =
+	{
+		// First triangle.
+		{ Float3(-0.5f, 0.5f, 0.0f), Float4(1.0f, 0.0f, 0.0f, 1.0f) },	// Vertex 0, red
+		{ Float3(0.5f, -0.5f, 0.0f), Float4(0.0f, 1.0f, 0.0f, 1.0f) },	// Vertex 1, green
+		{ Float3(-0.5f, -0.5f, 0.0f), Float4(0.0f, 0.0f, 1.0f, 1.0f) },	// Vertex 2, blue
+
+		// Second triangle, using two of the same vertices as the first triangle: vertex 1 and vertex 0.
+		{ Float3(0.5f, 0.5f, 0.0f), Float4(1.0f, 1.0f, 1.0f, 1.0f) },		// Vertex 3, white
+		{ Float3(0.5f, -0.5f, 0.0f), Float4(0.0f, 1.0f, 0.0f, 1.0f) },	// Vertex 1, green
+		{ Float3(-0.5f, 0.5f, 0.0f), Float4(1.0f, 0.0f, 0.0f, 1.0f) },	// Vertex 0, red
+	};
+
+	// Vertex 0 and 1 are stored twice, and will be run through the vertex shader twice. Turn
+	// the triangles into an indexed mesh instead: identical vertices are merged, leaving 4
+	// vertices, and each triangle refers to its vertices using three indices. The triangles are
+	// also reordered so that the GPU can reuse recently shaded vertices (see MeshBuilder.h).
+	IndexedMesh mesh;
+	MeshBuildStatistics statistics;
+	BuildIndexedMesh(vertices, sizeof(vertices) / sizeof(Vertex), Vertex::STRIDE, mesh, statistics);
+
+	// Create an immutable vertex buffer holding all unique vertices. See D3D11Backend.cpp for
+	// the buffer description used with Direct3D.
+	gVertexBuffer = gBackend->CreateVertexBuffer(mesh.vertices.data(), static_cast<unsigned int>(mesh.vertices.size()));
+
+	// The index buffer is created the same way. With fewer than 65536 vertices, 16 bit indices
+	// are enough.
+	std::vector<unsigned char> indexData;
+	gIndexFormat = PackIndices(mesh.indices, mesh.vertexCount, indexData);
+	gIndexBuffer = gBackend->CreateIndexBuffer(indexData.data(), static_cast<unsigned int>(indexData.size()));
+	gIndexCount = static_cast<unsigned int>(mesh.indices.size());
+}
+
+void ConvertImportedMesh(const ImportedMesh& imported, IndexedMesh& mesh)
+{
+	mesh.vertexStride = Vertex::STRIDE;
+	mesh.vertexCount = static_cast<unsigned int>(imported.positions.size());
+	mesh.vertices.resize(imported.positions.size() * Vertex::STRIDE);
+	for (unsigned int v = 0; v < mesh.vertexCount; ++v)
+	{
+		Vertex vertex(imported.positions[v], imported.colours[v]);
+		memcpy(&mesh.vertices[static_cast<size_t>(v) * Vertex::STRIDE], &vertex, Vertex::STRIDE);
+	}
+	mesh.indices = imported.indices;
+}
+
+bool ConvertMesh(const char* inputPath, const char* meshPath)
+{
+	ImportedMesh imported;
+	ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+	if (!ImportMesh(inputPath, imported, &pool))
+		return false;
+
+	IndexedMesh mesh;
+	ConvertImportedMesh(imported, mesh);
+	OptimiseVertexCache(mesh.indices, mesh.vertexCount);
+	OptimiseVertexFetch(mesh);
+
+	InputElementDesc elements[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(elements, 0);
+	std::vector<unsigned int> indices;
+	MeshLod lods[MESH_MAX_LODS];
+	unsigned int lodCount = BuildLodChain(mesh, elements, Vertex::ELEMENT_COUNT, LodChainDesc(), indices, lods);
+
+	std::vector<unsigned char> indexData;
+
+	MeshFileDesc desc;
+	desc.vertices = mesh.vertices.data();
+	desc.vertexCount = mesh.vertexCount;
+	desc.vertexStride = mesh.vertexStride;
+	desc.elements = elements;
+	desc.elementCount = Vertex::ELEMENT_COUNT;
+	desc.indexFormat = PackIndices(indices, mesh.vertexCount, indexData);
+	desc.indices = indexData.data();
+	desc.indexCount = static_cast<unsigned int>(indices.size());
+	desc.lods = lods;
+	desc.lodCount = lodCount;
+	return WriteMeshFile(meshPath, desc);
+}
+
+bool CreateShaders()
+{
+	TraceZone zone("CreateShaders");
+
+	// The shaders don't depend on each other, so instead of compiling one after the other they
+	// are added to the scheduler, which compiles and creates them on several threads at once.
+
+	// Compile and create vertex shader from the file vertexShader.hlsl in the folder Resources/Shaders/.
+	gVertexShaderDesc.path = L"../Resources/Shaders/vertexShader.hlsl";	// The path to the shader file relative to the .vxproj folder.
+	gVertexShaderDesc.entryPoint = "main";	// The name of the entry function. Must match function in source data.
+	gVertexShaderDesc.target = "vs_5_0";	// The shader model to use, "vs" specifies it is a vertex shader, 5_0 that it is shader model 5.0.
+	gShaderScheduler->AddVertexShader(gVertexShaderDesc, &gVertexShader);
+
+	// Compile and create pixel shader from the file pixelShader.hlsl in the folder Resources/Shaders/.
+	// Works the same way as above.
+	gPixelShaderDesc.path = L"../Resources/Shaders/pixelShader.hlsl";
+	gPixelShaderDesc.entryPoint = "main";
+	gPixelShaderDesc.target = "ps_5_0";		// NOTE: This must be changed to ps_5_0 for pixel shader model 5.0
+	gShaderScheduler->AddPixelShader(gPixelShaderDesc, &gPixelShader);
+
+	// Wait for both shaders, the input layout needs the vertex shader.
+	if (!gShaderScheduler->Run())
+		return false;
+
+	return CreatePipelineState();
+}
+
+bool CreatePipelineState()
+{
+	// A shader that failed to compile has nothing to make a state from.
+	if (gVertexShader == nullptr || gPixelShader == nullptr)
+		return false;
+
+	// Get the input description from the vertex format. For each element it holds the semantic
+	// name (which must correspond to the semantic names used in the vertex shader inputs),
+	// semantic index (if multiple with the same name), input format, input slot (usually 0)
+	// and byte offset (depends on the previous format size).
+	InputElementDesc inputDesc[Vertex::ELEMENT_COUNT];
+	Vertex::GetInputElements(inputDesc, 0);
+
+	// Bundle the shaders, the input layout to go with our vertex shader (the layout is validated
+	// against the shader's input signature) and the topology into a pipeline state. The cache
+	// only creates the input layout the first time it sees this vertex shader and elements.
+	PipelineStateDesc pipelineDesc;
+	pipelineDesc.vertexShader = gVertexShader;
+	pipelineDesc.pixelShader = gPixelShader;
+	pipelineDesc.inputElements = inputDesc;
+	pipelineDesc.inputElementCount = Vertex::ELEMENT_COUNT;
+	pipelineDesc.topology = PrimitiveTopology::TriangleList;
+	// If the vertex shader's inputs don't match the elements there is no state, and the one
+	// already in use is kept.
+	const PipelineState* pipelineState = gPipelineStateCache->GetPipelineState(pipelineDesc);
+	if (pipelineState == nullptr)
+		return false;
+
+	gPipelineState = pipelineState;
+	return true;
+}
+
+void EnableShaderHotReload(const char* shaderFolder)
+{
+	// When a shader is reloaded the pipeline state using it is replaced. For a vertex shader
+	// this creates a new input layout, validated against the new shader's inputs; if that fails
+	// the reloader keeps the old shader and the old state stays. The old state is released
+	// after the new one is created, so the new one can't get the same address and be mistaken
+	// for it. While the other shader is missing (it failed to compile at startup) there is no
+	// state to make, and the shader is taken as it is.
+	auto replacePipelineState = []() -> bool
+	{
+		if (gVertexShader == nullptr || gPixelShader == nullptr)
+			return true;
+
+		const PipelineState* oldPipelineState = gPipelineState;
+		if (!CreatePipelineState())
+			return false;
+
+		gPipelineStateCache->Release(oldPipelineState);
+		return true;
+	};
+
+	gShaderReloader = new ShaderReloader(gBackend);
+	gShaderReloader->AddVertexShader(gVertexShaderDesc, &gVertexShader, replacePipelineState);
+	gShaderReloader->AddPixelShader(gPixelShaderDesc, &gPixelShader, replacePipelineState);
+	gShaderReloader->Start(shaderFolder);
+}
+
+void Update(double timeStep)
+{
+	// The rectangle doesn't move, so only the time is kept up to date.
+	gTime += timeStep;
+	gTimeStep = timeStep;
+}
+
+void Render()
+{
+	ProfileScope renderScope(gRenderSection);
+
+	// Put any shaders that have been reloaded in place before anything is drawn. This never
+	// waits for a shader to compile.
+	if (gShaderReloader != nullptr)
+		gShaderReloader->Update();
+
+	// Clear the render target to black (colour (0, 0, 0, 1) ).
+	{
+		ProfileScope scope(gClearSection);
+		float bgColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		gBackend->ClearRenderTargetView(gBackend->GetBackBuffer(), bgColor);
+	}
+
+	// Set the constants that are the same for everything drawn this frame, and from this view.
+	FrameConstants frameConstants;
+	memset(&frameConstants, 0, sizeof(frameConstants));
+	frameConstants.time = static_cast<float>(gTime);
+	frameConstants.timeStep = static_cast<float>(gTimeStep);
+	gConstantBuffers->SetFrameConstants(frameConstants);
+	gConstantBuffers->SetViewConstants(gViewConstants);
+
+	// Instead of drawing straight away, draws are added to a queue with a key saying what they
+	// need bound (see DrawQueue.h). The rectangle is the only draw: its 6 indices, three for
+	// each triangle, using the vertex and index buffers, the pipeline state (the input layout,
+	// topology and shaders) and its object constants. It lies at z = 0, the middle of the
+	// depth range. The constants of every object are written to the GPU at once, before any
+	// draw binds them. Without a pipeline state (the shaders haven't compiled yet) nothing is
+	// drawn.
+	{
+		ProfileScope scope(gQueueSection);
+		gDrawQueue.Clear();
+		unsigned int rectangle = gConstantBuffers->AddObjects(&gRectangleConstants, 1);
+		gConstantBuffers->WriteObjects();
+
+		if (gPipelineState != nullptr)
+		{
+			QueuedDraw draw;
+			draw.pipelineState = gPipelineState;
+			draw.vertexBuffer = gVertexBuffer;
+			draw.vertexStride = Vertex::STRIDE;
+			draw.indexBuffer = gIndexBuffer;
+			draw.indexFormat = gIndexFormat;
+			draw.indexCount = gIndexCount;
+			draw.startIndexLocation = 0;
+			draw.baseVertexLocation = 0;
+			draw.constants = gConstantBuffers;
+			draw.object = rectangle;
+			gDrawQueue.Add(MakeOpaqueDrawKey(gPipelineState->GetId(), 0, 0.5f), draw);
+		}
+	}
+
+	// Sort the draws so those using the same state are drawn together, then make them. With
+	// enough draws they are recorded into command buffers on several threads first.
+	{
+		ProfileScope scope(gSortSection);
+		gDrawQueue.Sort();
+	}
+	{
+		ProfileScope scope(gSubmitSection);
+		gDrawQueue.SubmitParallel(gBackend, gRecordingThreadPool);
+	}
+
+	// When everything has been drawn, present the final result on the screen by swapping the
+	// back and front buffers.
+	{
+		ProfileScope scope(gPresentSection);
+		gBackend->Present();
+	}
+
+	// The object constants written this frame can be overwritten once the GPU has drawn it.
+	gConstantBuffers->EndFrame(gBackend->InsertFence());
+}
+
+const StateFilterStatistics& GetStateFilterStatistics()
+{
+	return gStateFilter->GetStatistics();
+}
+
+void PrintShaderCompileReport()
+{
+	gShaderScheduler->PrintReport();
+}
+
+void ReleaseScene()
+{
+	// Stop reloading shaders before they are released.
+	delete gShaderReloader;
+	gShaderReloader = nullptr;
+
+	delete gShaderScheduler;
+	gShaderScheduler = nullptr;
+
+	delete gRecordingThreadPool;
+	gRecordingThreadPool = nullptr;
+	delete gConstantBuffers;
+	gConstantBuffers = nullptr;
+	gTime = 0.0;
+	gDrawQueue.Clear();
+
+	// The pipeline states go first, as they refer to the shaders.
+	delete gPipelineStateCache;
+	delete gPixelShader;
+	delete gVertexShader;
+	delete gVertexBuffer;
+	delete gIndexBuffer;
+
+	gPipelineStateCache = nullptr;
+	gPipelineState = nullptr;
+	gPixelShader = nullptr;
+	gVertexShader = nullptr;
+	gVertexBuffer = nullptr;
+	gIndexBuffer = nullptr;
+	gIndexCount = 0;
+
+	delete gStateFilter;
+	gStateFilter = nullptr;
+	gBackend = nullptr;
+}
@@ -0,0 +1,77 @@
+// ###########################################################################################
+// ## The scene of the sample: a coloured rectangle made from two triangles. It is created
+// ## and drawn through a RenderBackend, so it works with any of the backends.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "VertexFormat.h"
+
+class RenderBackend;
+struct ImportedMesh;
+struct IndexedMesh;
+struct StateFilterStatistics;
+
+// Define the information contained in each vertex: a position and a colour, matching the
+// inputs of vertexShader.hlsl. The input layout is generated from the same declaration (see
+// VertexFormat.h). The position is stored as four half floats and the colour as four bytes,
+// making a vertex 12 bytes instead of the 28 bytes needed with 32 bit floats.
+typedef VertexFormat<Position<Half4>, Colour<UByteN4>> Vertex;
+
+// Converts a mesh read from a text file (see MeshImport.h) to Vertex, keeping the vertices and
+// triangles in the same order.
+void ConvertImportedMesh(const ImportedMesh& imported, IndexedMesh& mesh);
+
+// Converts the OBJ or PLY file at inputPath to a mesh file at meshPath (see MeshFile.h) holding
+// Vertex, welded and with the triangles and vertices reordered for the vertex cache and vertex
+// fetch, along with a chain of simplified levels of detail (see MeshSimplifier.h). This is done
+// once, ahead of time, so the mesh can be loaded without parsing or simplifying it.
+// Returns false if the input can't be read or the mesh file can't be written.
+bool ConvertMesh(const char* inputPath, const char* meshPath);
+
+// Creates the scene's resources using the given backend, which is then used for rendering.
+// Returns false if a shader failed to compile or the pipeline state couldn't be created, in
+// which case nothing is drawn until hot reloading fixes it (see EnableShaderHotReload()).
+// PrintShaderCompileReport() tells which shader failed. Either way ReleaseScene() releases
+// what was created.
+bool SetupScene(RenderBackend* backend);
+void CreateVertexBuffer();
+bool CreateShaders();
+bool CreatePipelineState();
+
+// Advances the scene by timeStep seconds. Called a fixed number of times per second, however
+// often frames are rendered (see FrameScheduler.h).
+void Update(double timeStep);
+void Render();
+
+// Starts watching the shader files in shaderFolder, compiling them again when they are saved
+// and using the new shaders from the next frame. If a shader fails to compile, the last one that
+// worked is kept.
+void EnableShaderHotReload(const char* shaderFolder);
+
+// Returns how many of the binds made by Render() were passed on to the backend and how many
+// were dropped as they wouldn't have changed anything.
+const StateFilterStatistics& GetStateFilterStatistics();
+
+// Writes how long the scene's shaders took to compile to the console.
+void PrintShaderCompileReport();
+
+// Releases the scene's resources, after which SetupScene() may be called again.
+void ReleaseScene();
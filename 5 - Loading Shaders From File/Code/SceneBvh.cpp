@@ -0,0 +1,461 @@
+// ###########################################################################################
+// ## A bounding volume hierarchy over the bounds of a scene's objects, culled against a
+// ## frustum eight boxes at a time and refitted as objects move.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "SceneBvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+#if SOFTWARE_RASTERISER_X86
+#include <immintrin.h>
+#endif
+
+// A node's parent when it is the root.
+const unsigned int SCENE_BVH_NO_PARENT = ~0u;
+
+static void ClearNode(SceneBvhNode& node, unsigned int parent)
+{
+	for (unsigned int i = 0; i < SCENE_BVH_WIDTH; ++i)
+	{
+		node.bounds[0][i] = FLT_MAX;
+		node.bounds[1][i] = FLT_MAX;
+		node.bounds[2][i] = FLT_MAX;
+		node.bounds[3][i] = -FLT_MAX;
+		node.bounds[4][i] = -FLT_MAX;
+		node.bounds[5][i] = -FLT_MAX;
+		node.children[i] = 0;
+	}
+
+	node.childCount = 0;
+	node.parent = parent;
+}
+
+static void SetChildBounds(SceneBvhNode& node, unsigned int child, const BoundingBox& box)
+{
+	node.bounds[0][child] = box.minimum.x;
+	node.bounds[1][child] = box.minimum.y;
+	node.bounds[2][child] = box.minimum.z;
+	node.bounds[3][child] = box.maximum.x;
+	node.bounds[4][child] = box.maximum.y;
+	node.bounds[5][child] = box.maximum.z;
+}
+
+// The box around all of a node's children.
+static BoundingBox GetNodeBounds(const SceneBvhNode& node)
+{
+	float bounds[6] = { FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (unsigned int i = 0; i < node.childCount; ++i)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			bounds[axis] = std::min(bounds[axis], node.bounds[axis][i]);
+			bounds[axis + 3] = std::max(bounds[axis + 3], node.bounds[axis + 3][i]);
+		}
+	}
+
+	BoundingBox box;
+	box.minimum = Float3(bounds[0], bounds[1], bounds[2]);
+	box.maximum = Float3(bounds[3], bounds[4], bounds[5]);
+	return box;
+}
+
+// Sorts objects by the centre of their boxes along one axis, with the minimum and maximum
+// added together rather than halved, which gives the same order.
+class CentreLess
+{
+public:
+	CentreLess(const BoundingBox* boxes, int axis) : mBoxes(boxes), mAxis(axis) {}
+
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		return Centre(a) < Centre(b);
+	}
+
+private:
+	float Centre(unsigned int object) const
+	{
+		const BoundingBox& box = mBoxes[object];
+		return (&box.minimum.x)[mAxis] + (&box.maximum.x)[mAxis];
+	}
+
+	const BoundingBox* mBoxes;
+	int mAxis;
+};
+
+void TestSceneBvhNodeScalar(const SceneBvhNode& node, const SceneBvhPlane* planes, unsigned int& visible, unsigned int& inside)
+{
+	visible = 0;
+	inside = 0;
+	for (unsigned int i = 0; i < node.childCount; ++i)
+	{
+		bool childVisible = true;
+		bool childInside = true;
+		for (int p = 0; p < 6; ++p)
+		{
+			const SceneBvhPlane& plane = planes[p];
+			float furthest = plane.normal[0] * node.bounds[plane.furthest[0]][i] + plane.normal[1] * node.bounds[plane.furthest[1]][i] +
+				plane.normal[2] * node.bounds[plane.furthest[2]][i] + plane.distance;
+			float nearest = plane.normal[0] * node.bounds[plane.nearest[0]][i] + plane.normal[1] * node.bounds[plane.nearest[1]][i] +
+				plane.normal[2] * node.bounds[plane.nearest[2]][i] + plane.distance;
+			childVisible = childVisible && furthest >= 0.0f;
+			childInside = childInside && nearest >= 0.0f;
+		}
+
+		visible |= childVisible ? 1u << i : 0;
+		inside |= childVisible && childInside ? 1u << i : 0;
+	}
+}
+
+#if SOFTWARE_RASTERISER_X86
+RASTERISER_TARGET("sse4.1")
+void TestSceneBvhNodeSSE41(const SceneBvhNode& node, const SceneBvhPlane* planes, unsigned int& visible, unsigned int& inside)
+{
+	// The same sums in the same order as the scalar version, four children at a time.
+	const __m128 zero = _mm_setzero_ps();
+	visible = 0;
+	inside = 0;
+	for (unsigned int half = 0; half < SCENE_BVH_WIDTH; half += 4)
+	{
+		__m128 halfVisible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		__m128 halfInside = halfVisible;
+		for (int p = 0; p < 6; ++p)
+		{
+			const SceneBvhPlane& plane = planes[p];
+			const __m128 nx = _mm_set1_ps(plane.normal[0]);
+			const __m128 ny = _mm_set1_ps(plane.normal[1]);
+			const __m128 nz = _mm_set1_ps(plane.normal[2]);
+			const __m128 d = _mm_set1_ps(plane.distance);
+
+			__m128 furthest = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(nx, _mm_loadu_ps(&node.bounds[plane.furthest[0]][half])),
+				_mm_mul_ps(ny, _mm_loadu_ps(&node.bounds[plane.furthest[1]][half]))),
+				_mm_mul_ps(nz, _mm_loadu_ps(&node.bounds[plane.furthest[2]][half]))), d);
+			__m128 nearest = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(nx, _mm_loadu_ps(&node.bounds[plane.nearest[0]][half])),
+				_mm_mul_ps(ny, _mm_loadu_ps(&node.bounds[plane.nearest[1]][half]))),
+				_mm_mul_ps(nz, _mm_loadu_ps(&node.bounds[plane.nearest[2]][half]))), d);
+			halfVisible = _mm_and_ps(halfVisible, _mm_cmpge_ps(furthest, zero));
+			halfInside = _mm_and_ps(halfInside, _mm_cmpge_ps(nearest, zero));
+		}
+
+		visible |= static_cast<unsigned int>(_mm_movemask_ps(halfVisible)) << half;
+		inside |= static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(halfVisible, halfInside))) << half;
+	}
+
+	// Unused children have empty boxes and are never visible, but the mask makes sure.
+	const unsigned int used = (1u << node.childCount) - 1;
+	visible &= used;
+	inside &= used;
+}
+
+RASTERISER_TARGET("avx2")
+void TestSceneBvhNodeAVX2(const SceneBvhNode& node, const SceneBvhPlane* planes, unsigned int& visible, unsigned int& inside)
+{
+	// The same sums in the same order as the scalar version, all eight children at once.
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 allVisible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	__m256 allInside = allVisible;
+	for (int p = 0; p < 6; ++p)
+	{
+		const SceneBvhPlane& plane = planes[p];
+		const __m256 nx = _mm256_set1_ps(plane.normal[0]);
+		const __m256 ny = _mm256_set1_ps(plane.normal[1]);
+		const __m256 nz = _mm256_set1_ps(plane.normal[2]);
+		const __m256 d = _mm256_set1_ps(plane.distance);
+
+		__m256 furthest = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(nx, _mm256_loadu_ps(node.bounds[plane.furthest[0]])),
+			_mm256_mul_ps(ny, _mm256_loadu_ps(node.bounds[plane.furthest[1]]))),
+			_mm256_mul_ps(nz, _mm256_loadu_ps(node.bounds[plane.furthest[2]]))), d);
+		__m256 nearest = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(nx, _mm256_loadu_ps(node.bounds[plane.nearest[0]])),
+			_mm256_mul_ps(ny, _mm256_loadu_ps(node.bounds[plane.nearest[1]]))),
+			_mm256_mul_ps(nz, _mm256_loadu_ps(node.bounds[plane.nearest[2]]))), d);
+		allVisible = _mm256_and_ps(allVisible, _mm256_cmp_ps(furthest, zero, _CMP_GE_OQ));
+		allInside = _mm256_and_ps(allInside, _mm256_cmp_ps(nearest, zero, _CMP_GE_OQ));
+	}
+
+	const unsigned int used = (1u << node.childCount) - 1;
+	visible = static_cast<unsigned int>(_mm256_movemask_ps(allVisible)) & used;
+	inside = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_and_ps(allVisible, allInside))) & used;
+}
+#endif
+
+static SceneBvhTestFunction GetTestFunction(RasteriserISA isa)
+{
+#if SOFTWARE_RASTERISER_X86
+	if (isa == RasteriserISA::AVX2)
+		return TestSceneBvhNodeAVX2;
+	if (isa == RasteriserISA::SSE41)
+		return TestSceneBvhNodeSSE41;
+#endif
+
+	return TestSceneBvhNodeScalar;
+}
+
+SceneBvh::SceneBvh()
+	: mISA(DetectRasteriserISA())
+	, mTest(GetTestFunction(mISA))
+{
+	Build(nullptr, 0);
+}
+
+void SceneBvh::Build(const BoundingBox* boxes, unsigned int objectCount)
+{
+	mNodes.clear();
+	mObjectSlots.assign(objectCount, 0);
+	mDirtyNodes.clear();
+
+	std::vector<unsigned int> objects(objectCount);
+	for (unsigned int i = 0; i < objectCount; ++i)
+		objects[i] = i;
+
+	BuildNode(objects.data(), objectCount, boxes, SCENE_BVH_NO_PARENT);
+	mDirty.assign(mNodes.size(), 0);
+	ResetStatistics();
+}
+
+unsigned int SceneBvh::BuildNode(unsigned int* objects, unsigned int objectCount, const BoundingBox* boxes, unsigned int parent)
+{
+	const unsigned int index = static_cast<unsigned int>(mNodes.size());
+	mNodes.push_back(SceneBvhNode());
+	ClearNode(mNodes[index], parent);
+
+	// The objects are split into up to eight groups, each time splitting the largest group in
+	// two at the median of the centres along the axis they are spread furthest on. Simpler
+	// than weighing splits by surface area, and it keeps the tree balanced.
+	unsigned int groupStarts[SCENE_BVH_WIDTH + 1] = { 0, objectCount };
+	unsigned int groupCount = objectCount > 0 ? 1 : 0;
+	while (groupCount < SCENE_BVH_WIDTH && groupCount < objectCount)
+	{
+		unsigned int largest = 0;
+		for (unsigned int g = 1; g < groupCount; ++g)
+		{
+			if (groupStarts[g + 1] - groupStarts[g] > groupStarts[largest + 1] - groupStarts[largest])
+				largest = g;
+		}
+
+		unsigned int* first = objects + groupStarts[largest];
+		unsigned int* last = objects + groupStarts[largest + 1];
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (unsigned int* object = first; object != last; ++object)
+		{
+			const BoundingBox& box = boxes[*object];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float centre = (&box.minimum.x)[axis] + (&box.maximum.x)[axis];
+				minimum[axis] = std::min(minimum[axis], centre);
+				maximum[axis] = std::max(maximum[axis], centre);
+			}
+		}
+
+		int axis = 0;
+		for (int a = 1; a < 3; ++a)
+		{
+			if (maximum[a] - minimum[a] > maximum[axis] - minimum[axis])
+				axis = a;
+		}
+
+		unsigned int* middle = first + (last - first) / 2;
+		std::nth_element(first, middle, last, CentreLess(boxes, axis));
+
+		for (unsigned int g = groupCount; g > largest; --g)
+			groupStarts[g + 1] = groupStarts[g];
+		groupStarts[largest + 1] = static_cast<unsigned int>(middle - objects);
+		++groupCount;
+	}
+
+	for (unsigned int g = 0; g < groupCount; ++g)
+	{
+		const unsigned int count = groupStarts[g + 1] - groupStarts[g];
+		const unsigned int slot = index * SCENE_BVH_WIDTH + g;
+		if (count == 1)
+		{
+			const unsigned int object = objects[groupStarts[g]];
+			mNodes[index].children[g] = object | SCENE_BVH_OBJECT;
+			SetChildBounds(mNodes[index], g, boxes[object]);
+			mObjectSlots[object] = slot;
+		}
+		else
+		{
+			// The child is built first, as it adds to mNodes.
+			unsigned int child = BuildNode(objects + groupStarts[g], count, boxes, slot);
+			mNodes[index].children[g] = child;
+			SetChildBounds(mNodes[index], g, GetNodeBounds(mNodes[child]));
+		}
+	}
+
+	mNodes[index].childCount = groupCount;
+	return index;
+}
+
+void SceneBvh::SetObjectBounds(unsigned int object, const BoundingBox& box)
+{
+	const unsigned int node = mObjectSlots[object] / SCENE_BVH_WIDTH;
+	SetChildBounds(mNodes[node], mObjectSlots[object] % SCENE_BVH_WIDTH, box);
+	if (mDirty[node] == 0)
+	{
+		mDirty[node] = 1;
+		mDirtyNodes.push_back(node);
+	}
+}
+
+unsigned int SceneBvh::Refit()
+{
+	// Children are built after their parents and have larger indices, so taking the largest
+	// dirty node first updates every node after all of its children. A parent whose box for
+	// the node doesn't change is left alone.
+	unsigned int updated = 0;
+	std::make_heap(mDirtyNodes.begin(), mDirtyNodes.end());
+	while (!mDirtyNodes.empty())
+	{
+		std::pop_heap(mDirtyNodes.begin(), mDirtyNodes.end());
+		const unsigned int node = mDirtyNodes.back();
+		mDirtyNodes.pop_back();
+		mDirty[node] = 0;
+		++updated;
+
+		const unsigned int slot = mNodes[node].parent;
+		if (slot == SCENE_BVH_NO_PARENT)
+			continue;
+
+		const unsigned int parent = slot / SCENE_BVH_WIDTH;
+		const unsigned int child = slot % SCENE_BVH_WIDTH;
+		BoundingBox box = GetNodeBounds(mNodes[node]);
+		const float values[6] = { box.minimum.x, box.minimum.y, box.minimum.z, box.maximum.x, box.maximum.y, box.maximum.z };
+		bool changed = false;
+		for (int i = 0; i < 6; ++i)
+			changed = changed || mNodes[parent].bounds[i][child] != values[i];
+
+		if (changed)
+		{
+			SetChildBounds(mNodes[parent], child, box);
+			if (mDirty[parent] == 0)
+			{
+				mDirty[parent] = 1;
+				mDirtyNodes.push_back(parent);
+				std::push_heap(mDirtyNodes.begin(), mDirtyNodes.end());
+			}
+		}
+	}
+
+	return updated;
+}
+
+void SceneBvh::Cull(const Frustum& frustum, std::vector<unsigned int>& visibleObjects)
+{
+	SceneBvhPlane planes[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		const float* normal = &frustum.planes[p].x;
+		for (unsigned int axis = 0; axis < 3; ++axis)
+		{
+			planes[p].normal[axis] = normal[axis];
+			planes[p].furthest[axis] = normal[axis] > 0.0f ? axis + 3 : axis;
+			planes[p].nearest[axis] = normal[axis] > 0.0f ? axis : axis + 3;
+		}
+		planes[p].distance = frustum.planes[p].w;
+	}
+
+	const size_t start = visibleObjects.size();
+	mStack.clear();
+	mStack.push_back(0);
+	while (!mStack.empty())
+	{
+		const SceneBvhNode& node = mNodes[mStack.back()];
+		mStack.pop_back();
+		++mStatistics.nodesTested;
+
+		unsigned int visible;
+		unsigned int inside;
+		mTest(node, planes, visible, inside);
+		for (; visible != 0; visible &= visible - 1)
+		{
+			unsigned int i = 0;
+			while ((visible & (1u << i)) == 0)
+				++i;
+
+			const unsigned int child = node.children[i];
+			if ((child & SCENE_BVH_OBJECT) != 0)
+				visibleObjects.push_back(child & ~SCENE_BVH_OBJECT);
+			else if ((inside & (1u << i)) != 0)
+			{
+				++mStatistics.nodesInside;
+				AddSubtree(child, visibleObjects);
+			}
+			else
+				mStack.push_back(child);
+		}
+	}
+
+	++mStatistics.culls;
+	mStatistics.objectsVisible += visibleObjects.size() - start;
+}
+
+void SceneBvh::AddSubtree(unsigned int node, std::vector<unsigned int>& visibleObjects)
+{
+	const SceneBvhNode& children = mNodes[node];
+	for (unsigned int i = 0; i < children.childCount; ++i)
+	{
+		if ((children.children[i] & SCENE_BVH_OBJECT) != 0)
+			visibleObjects.push_back(children.children[i] & ~SCENE_BVH_OBJECT);
+		else
+			AddSubtree(children.children[i], visibleObjects);
+	}
+}
+
+bool SceneBvh::SetISA(RasteriserISA isa)
+{
+	if (!IsRasteriserISASupported(isa))
+		return false;
+
+	mISA = isa;
+	mTest = GetTestFunction(isa);
+	return true;
+}
+
+RasteriserISA SceneBvh::GetISA() const
+{
+	return mISA;
+}
+
+unsigned int SceneBvh::GetObjectCount() const
+{
+	return static_cast<unsigned int>(mObjectSlots.size());
+}
+
+unsigned int SceneBvh::GetNodeCount() const
+{
+	return static_cast<unsigned int>(mNodes.size());
+}
+
+const SceneBvhStatistics& SceneBvh::GetStatistics() const
+{
+	return mStatistics;
+}
+
+void SceneBvh::ResetStatistics()
+{
+	memset(&mStatistics, 0, sizeof(mStatistics));
+}
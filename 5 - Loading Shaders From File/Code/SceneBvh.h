@@ -0,0 +1,137 @@
+// ###########################################################################################
+// ## A bounding volume hierarchy over the bounds of a scene's objects, culled against a
+// ## frustum eight boxes at a time and refitted as objects move.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "Frustum.h"
+#include "SoftwareRasteriser.h"
+
+#include <vector>
+
+// The children of a node, tested together by one AVX2 instruction or two SSE4.1 ones.
+const unsigned int SCENE_BVH_WIDTH = 8;
+
+// The bit telling an object's index from a node's in SceneBvhNode::children.
+const unsigned int SCENE_BVH_OBJECT = 0x80000000;
+
+// A node of the hierarchy: the boxes of up to eight children, each of them a node or an
+// object. The boxes are stored component by component so a component of every box can be
+// loaded at once. Unused children have empty boxes, which are outside every frustum.
+struct SceneBvhNode
+{
+	float bounds[6][SCENE_BVH_WIDTH];			// minimum x, y, z, then maximum x, y, z.
+	unsigned int children[SCENE_BVH_WIDTH];	// A node's index, or an object's with SCENE_BVH_OBJECT set.
+	unsigned int childCount;
+	unsigned int parent;						// The parent's index * SCENE_BVH_WIDTH + this node's child index, for refits.
+};
+
+// A frustum plane ready for testing boxes: for each axis, the row of SceneBvhNode::bounds
+// holding the coordinate of the corner furthest along the normal and of the nearest one.
+struct SceneBvhPlane
+{
+	float normal[3];
+	float distance;
+	unsigned int furthest[3];
+	unsigned int nearest[3];
+};
+
+// Tests the children of a node against the six planes, setting bit i of visible if child i
+// may be inside them all and bit i of inside if it is entirely inside them all.
+typedef void (*SceneBvhTestFunction)(const SceneBvhNode& node, const SceneBvhPlane* planes,
+	unsigned int& visible, unsigned int& inside);
+
+void TestSceneBvhNodeScalar(const SceneBvhNode& node, const SceneBvhPlane* planes, unsigned int& visible, unsigned int& inside);
+#if SOFTWARE_RASTERISER_X86
+void TestSceneBvhNodeSSE41(const SceneBvhNode& node, const SceneBvhPlane* planes, unsigned int& visible, unsigned int& inside);
+void TestSceneBvhNodeAVX2(const SceneBvhNode& node, const SceneBvhPlane* planes, unsigned int& visible, unsigned int& inside);
+#endif
+
+// Counters for what the culls since ResetStatistics() did.
+struct SceneBvhStatistics
+{
+	unsigned long long culls;
+	unsigned long long nodesTested;
+	unsigned long long nodesInside;		// Nodes found entirely inside, whose objects were added untested.
+	unsigned long long objectsVisible;
+};
+
+// Scenes with many objects can't afford to test every one against the frustum each frame.
+// The hierarchy groups nearby objects under boxes bounding them all, so a box outside the
+// frustum removes all of its objects with one test, and a box entirely inside adds them all
+// without testing any.
+//
+// Each node holds eight children, which are tested against the six planes together: a box
+// is outside a plane if its corner furthest along the plane's normal is behind it, and
+// inside if the nearest corner is in front. Which corner that is only depends on the plane,
+// so it is the same load for every box. The SIMD versions give exactly the same results as
+// the scalar one, which gives the same as IsBoxInFrustum().
+//
+// When objects move, SetObjectBounds() updates their boxes and Refit() grows or shrinks the
+// nodes above them, visiting only the nodes whose boxes changed. The tree isn't rebuilt, so
+// it gets worse as objects move far from where they were; Build() again once that costs more
+// than the rebuild.
+class SceneBvh
+{
+public:
+	SceneBvh();
+
+	// Builds the hierarchy for objectCount objects with the given boxes, replacing what was
+	// there. The objects are numbered by their place in boxes.
+	void Build(const BoundingBox* boxes, unsigned int objectCount);
+
+	// Sets the box of an object that moved. The nodes above it are only updated by Refit().
+	void SetObjectBounds(unsigned int object, const BoundingBox& box);
+
+	// Updates the boxes of the nodes above the objects given new bounds. Returns the number of
+	// nodes updated.
+	unsigned int Refit();
+
+	// Appends the objects whose boxes may be inside the frustum, which is in the space of the
+	// boxes, to visibleObjects.
+	void Cull(const Frustum& frustum, std::vector<unsigned int>& visibleObjects);
+
+	// Selects the instruction set used to test boxes. The fastest one supported is used by
+	// default. Returns false, keeping the current one, if isa isn't supported.
+	bool SetISA(RasteriserISA isa);
+	RasteriserISA GetISA() const;
+
+	unsigned int GetObjectCount() const;
+	unsigned int GetNodeCount() const;
+	const SceneBvhStatistics& GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	SceneBvh(const SceneBvh&);
+	SceneBvh& operator=(const SceneBvh&);
+
+	unsigned int BuildNode(unsigned int* objects, unsigned int objectCount, const BoundingBox* boxes, unsigned int parent);
+	void AddSubtree(unsigned int node, std::vector<unsigned int>& visibleObjects);
+
+	std::vector<SceneBvhNode> mNodes;				// The root is the first.
+	std::vector<unsigned int> mObjectSlots;			// Each object's node times SCENE_BVH_WIDTH plus its child index.
+	std::vector<unsigned char> mDirty;				// Per node, whether a child's box changed since the last Refit().
+	std::vector<unsigned int> mDirtyNodes;
+	std::vector<unsigned int> mStack;
+	RasteriserISA mISA;
+	SceneBvhTestFunction mTest;
+	SceneBvhStatistics mStatistics;
+};
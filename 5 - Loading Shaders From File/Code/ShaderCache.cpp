@@ -0,0 +1,312 @@
+// ###########################################################################################
+// ## A disk cache of compiled shaders, keyed by a hash of everything that affects the compiled
+// ## bytecode. It doesn't depend on any graphics API, the backends use it around their compilers.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "ShaderCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Changing the layout of the cache files changes the version, which makes every old file a miss.
+const unsigned int SHADER_CACHE_VERSION = 1;
+const char SHADER_CACHE_MAGIC[4] = { 'M', 'W', 'S', 'C' };
+
+// A cache file starts with this header, followed by the includes (each a 32 bit path length,
+// the path and its 64 bit hash) and then the bytecode, starting at a multiple of 8 bytes.
+struct ShaderCacheFileHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned long long content;
+	unsigned int includeCount;
+	unsigned int bytecodeSize;
+};
+
+// The few file system operations the cache needs.
+static void CreateDirectoryIfMissing(const std::string& path)
+{
+#if defined(_WIN32)
+	CreateDirectoryA(path.c_str(), NULL);
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+static std::vector<std::string> ListDirectory(const std::string& path)
+{
+	std::vector<std::string> names;
+#if defined(_WIN32)
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((path + "/*").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+		return names;
+
+	do
+	{
+		if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+			names.push_back(findData.cFileName);
+	} while (FindNextFileA(find, &findData));
+	FindClose(find);
+#else
+	DIR* directory = opendir(path.c_str());
+	if (directory == nullptr)
+		return names;
+
+	while (dirent* entry = readdir(directory))
+	{
+		if (entry->d_name[0] != '.')
+			names.push_back(entry->d_name);
+	}
+	closedir(directory);
+#endif
+	return names;
+}
+
+// Returns a name that no other writer, in this process or another one, uses at the same time.
+static std::atomic<unsigned int> gTemporaryFileCount(0);
+static std::string MakeTemporarySuffix()
+{
+#if defined(_WIN32)
+	unsigned long processId = GetCurrentProcessId();
+#else
+	unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+	std::ostringstream suffix;
+	suffix << "." << processId << "." << gTemporaryFileCount++ << ".tmp";
+	return suffix.str();
+}
+
+static bool IsTemporaryFile(const std::string& name)
+{
+	return name.size() >= 4 && name.compare(name.size() - 4, 4, ".tmp") == 0;
+}
+
+// Replaces the file at to with the one at from, so readers see either the old or new file.
+static bool MoveFileOver(const std::string& from, const std::string& to)
+{
+#if defined(_WIN32)
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool ShaderCache::ReadSourceFile(const std::string& path, std::string& contents)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+const void* ShaderCacheEntry::GetBytecode() const
+{
+	return mFile.GetData() + mBytecodeOffset;
+}
+
+size_t ShaderCacheEntry::GetBytecodeSize() const
+{
+	return mBytecodeSize;
+}
+
+ShaderCache::ShaderCache(const std::string& directory)
+	: mDirectory(directory)
+{
+	CreateDirectoryIfMissing(mDirectory);
+}
+
+const std::string& ShaderCache::GetDirectory() const
+{
+	return mDirectory;
+}
+
+unsigned long long ShaderCache::Hash(const void* data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+	return hash;
+}
+
+// Hashes a string including its terminating zero, so that e.g. "ab" + "c" and "a" + "bc"
+// give different hashes.
+static unsigned long long HashString(const char* string, unsigned long long hash)
+{
+	return ShaderCache::Hash(string, strlen(string) + 1, hash);
+}
+
+ShaderCacheKey ShaderCache::MakeKey(const std::string& path, const std::string& source,
+	const ShaderDefine* defines, unsigned int defineCount, const char* entryPoint,
+	const char* target, unsigned int flags)
+{
+	ShaderCacheKey key;
+	key.slot = HashString(path.c_str(), Hash(nullptr, 0));
+	key.slot = HashString(entryPoint, key.slot);
+	key.slot = HashString(target, key.slot);
+
+	key.content = Hash(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION), key.slot);
+	key.content = Hash(source.data(), source.size(), key.content);
+	for (unsigned int i = 0; i < defineCount; ++i)
+	{
+		key.content = HashString(defines[i].name, key.content);
+		key.content = HashString(defines[i].value != nullptr ? defines[i].value : "", key.content);
+	}
+	key.content = Hash(&flags, sizeof(flags), key.content);
+
+	return key;
+}
+
+std::string ShaderCache::GetEntryPath(const ShaderCacheKey& key) const
+{
+	std::ostringstream name;
+	name << mDirectory << "/" << std::hex << std::setfill('0') << std::setw(16) << key.slot << "-"
+		<< std::setw(16) << key.content << ".cso";
+	return name.str();
+}
+
+std::unique_ptr<ShaderCacheEntry> ShaderCache::Load(const ShaderCacheKey& key) const
+{
+	std::unique_ptr<ShaderCacheEntry> entry(new ShaderCacheEntry());
+	if (!entry->mFile.Open(GetEntryPath(key).c_str()))
+		return nullptr;
+
+	const unsigned char* data = entry->mFile.GetData();
+	size_t size = entry->mFile.GetSize();
+
+	ShaderCacheFileHeader header;
+	if (size < sizeof(header))
+		return nullptr;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, SHADER_CACHE_MAGIC, 4) != 0 || header.version != SHADER_CACHE_VERSION ||
+		header.content != key.content)
+	{
+		return nullptr;
+	}
+
+	// Check that every included file still has the contents the shader was compiled with.
+	size_t offset = sizeof(header);
+	for (unsigned int i = 0; i < header.includeCount; ++i)
+	{
+		unsigned int pathLength;
+		if (offset + sizeof(pathLength) > size)
+			return nullptr;
+		memcpy(&pathLength, data + offset, sizeof(pathLength));
+		offset += sizeof(pathLength);
+
+		unsigned long long hash;
+		if (offset + pathLength + sizeof(hash) > size)
+			return nullptr;
+		std::string path(reinterpret_cast<const char*>(data + offset), pathLength);
+		memcpy(&hash, data + offset + pathLength, sizeof(hash));
+		offset += pathLength + sizeof(hash);
+
+		std::string contents;
+		if (!ReadSourceFile(path, contents) || Hash(contents.data(), contents.size()) != hash)
+			return nullptr;
+	}
+
+	offset = (offset + 7) & ~static_cast<size_t>(7);
+	if (offset + header.bytecodeSize > size || header.bytecodeSize == 0)
+		return nullptr;
+
+	entry->mBytecodeOffset = offset;
+	entry->mBytecodeSize = header.bytecodeSize;
+	return entry;
+}
+
+bool ShaderCache::Store(const ShaderCacheKey& key, const void* bytecode, size_t bytecodeSize,
+	const std::vector<ShaderCacheInclude>& includes)
+{
+	ShaderCacheFileHeader header;
+	memcpy(header.magic, SHADER_CACHE_MAGIC, 4);
+	header.version = SHADER_CACHE_VERSION;
+	header.content = key.content;
+	header.includeCount = static_cast<unsigned int>(includes.size());
+	header.bytecodeSize = static_cast<unsigned int>(bytecodeSize);
+
+	std::vector<unsigned char> file(reinterpret_cast<unsigned char*>(&header), reinterpret_cast<unsigned char*>(&header + 1));
+	for (const ShaderCacheInclude& include : includes)
+	{
+		unsigned int pathLength = static_cast<unsigned int>(include.path.size());
+		const unsigned char* length = reinterpret_cast<const unsigned char*>(&pathLength);
+		const unsigned char* hash = reinterpret_cast<const unsigned char*>(&include.hash);
+		file.insert(file.end(), length, length + sizeof(pathLength));
+		file.insert(file.end(), include.path.begin(), include.path.end());
+		file.insert(file.end(), hash, hash + sizeof(include.hash));
+	}
+
+	file.resize((file.size() + 7) & ~static_cast<size_t>(7), 0);
+	const unsigned char* bytes = static_cast<const unsigned char*>(bytecode);
+	file.insert(file.end(), bytes, bytes + bytecodeSize);
+
+	// Write to a temporary file first and then move it in place, so that a crash (or another
+	// instance of the program) never sees a half written entry. Each writer has its own
+	// temporary file, so two instances storing the same shader don't write to the same file.
+	std::string path = GetEntryPath(key);
+	std::string temporaryPath = path + MakeTemporarySuffix();
+	bool written;
+	{
+		std::ofstream stream(temporaryPath.c_str(), std::ios::binary | std::ios::trunc);
+		written = static_cast<bool>(stream.write(reinterpret_cast<const char*>(file.data()), file.size()));
+	}
+
+	if (!written || !MoveFileOver(temporaryPath, path))
+	{
+		remove(temporaryPath.c_str());
+		return false;
+	}
+
+	// The shader has been recompiled, so the versions it was compiled from before are stale.
+	std::string name = path.substr(mDirectory.size() + 1);
+	RemoveEntries(name.substr(0, 17), name);
+	return true;
+}
+
+void ShaderCache::Clear()
+{
+	RemoveEntries("", "");
+}
+
+void ShaderCache::RemoveEntries(const std::string& prefix, const std::string& keep)
+{
+	for (const std::string& name : ListDirectory(mDirectory))
+	{
+		// Temporary files belong to writers that haven't finished, which remove them themselves.
+		if (name.compare(0, prefix.size(), prefix) == 0 && name != keep && !IsTemporaryFile(name))
+			remove((mDirectory + "/" + name).c_str());
+	}
+}
@@ -0,0 +1,111 @@
+// ###########################################################################################
+// ## A disk cache of compiled shaders, keyed by a hash of everything that affects the compiled
+// ## bytecode. It doesn't depend on any graphics API, the backends use it around their compilers.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// A preprocessor define passed to the shader compiler, like D3D_SHADER_MACRO.
+struct ShaderDefine
+{
+	const char* name;
+	const char* value;
+};
+
+// Identifies a compiled shader in the cache. The slot identifies the shader (its path, entry
+// point and target) and the content hash everything it was compiled from. When a shader
+// changes its slot stays the same, which is how old versions of it are found and removed.
+struct ShaderCacheKey
+{
+	unsigned long long slot;
+	unsigned long long content;
+};
+
+// A file the compiler read through an #include, and a hash of its contents when it was read.
+// An entry is only used while all of its includes are unchanged.
+struct ShaderCacheInclude
+{
+	std::string path;
+	unsigned long long hash;
+};
+
+// The bytecode of a shader found in the cache, mapped straight from the cache file. The data
+// stays valid as long as the entry exists.
+class ShaderCacheEntry
+{
+public:
+	const void* GetBytecode() const;
+	size_t GetBytecodeSize() const;
+
+private:
+	friend class ShaderCache;
+
+	MappedFile mFile;
+	size_t mBytecodeOffset;
+	size_t mBytecodeSize;
+};
+
+class ShaderCache
+{
+public:
+	// The cache is stored in the given directory, which is created if it doesn't exist.
+	explicit ShaderCache(const std::string& directory);
+
+	const std::string& GetDirectory() const;
+
+	// Creates the key for a shader. source is the contents of the shader file at path, flags
+	// the compiler flags and defines may be nullptr if defineCount is zero.
+	static ShaderCacheKey MakeKey(const std::string& path, const std::string& source,
+		const ShaderDefine* defines, unsigned int defineCount, const char* entryPoint,
+		const char* target, unsigned int flags);
+
+	// Looks up a shader. Returns nullptr if it isn't cached, if the cache file is damaged or if
+	// one of the files it includes has changed since it was compiled.
+	std::unique_ptr<ShaderCacheEntry> Load(const ShaderCacheKey& key) const;
+
+	// Stores compiled bytecode along with the files included while compiling it. Any older
+	// versions of the same shader are removed from the cache. Returns false if the file could
+	// not be written.
+	bool Store(const ShaderCacheKey& key, const void* bytecode, size_t bytecodeSize,
+		const std::vector<ShaderCacheInclude>& includes);
+
+	// Removes every cached shader.
+	void Clear();
+
+	// Reads the whole file at path, e.g. the source of a shader. Returns false if it can't be read.
+	static bool ReadSourceFile(const std::string& path, std::string& contents);
+
+	// The hash used for keys and includes (64 bit FNV-1a), continuing from hash.
+	static unsigned long long Hash(const void* data, size_t size, unsigned long long hash = 14695981039346656037ull);
+
+private:
+	std::string GetEntryPath(const ShaderCacheKey& key) const;
+	// Removes the cache files whose names start with prefix, except the one named keep and the
+	// temporary files being written.
+	void RemoveEntries(const std::string& prefix, const std::string& keep);
+
+	std::string mDirectory;
+};
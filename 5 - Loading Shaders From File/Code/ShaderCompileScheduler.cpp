@@ -0,0 +1,155 @@
+// ###########################################################################################
+// ## Compiles and creates many shaders at once, spreading the work over a pool of threads and
+// ## timing each shader.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "ShaderCompileScheduler.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+ShaderCompileScheduler::ShaderCompileScheduler(RenderBackend* backend)
+	: mBackend(backend)
+	, mWallSeconds(0.0)
+	, mThreadCount(0)
+{
+}
+
+void ShaderCompileScheduler::AddVertexShader(const ShaderDesc& desc, BackendVertexShader** shader)
+{
+	AddJob(desc, shader, nullptr);
+}
+
+void ShaderCompileScheduler::AddPixelShader(const ShaderDesc& desc, BackendPixelShader** shader)
+{
+	AddJob(desc, nullptr, shader);
+}
+
+void ShaderCompileScheduler::AddJob(const ShaderDesc& desc, BackendVertexShader** vertexShader, BackendPixelShader** pixelShader)
+{
+	Job job;
+	job.path = desc.path;
+	job.entryPoint = desc.entryPoint;
+	job.target = desc.target;
+	job.vertexShader = vertexShader;
+	job.pixelShader = pixelShader;
+	mJobs.push_back(job);
+}
+
+bool ShaderCompileScheduler::Run(unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	// There is no point in starting more threads than there are shaders.
+	mThreadCount = std::min(threadCount, static_cast<unsigned int>(mJobs.size()));
+	ThreadPool threadPool(mThreadCount);
+
+	// Timed with the profiler's clock, since the standard clocks only tick in milliseconds in
+	// older versions of Visual Studio.
+	const double secondsPerTick = 1.0 / GetProfileTickFrequency();
+	mTimings.assign(mJobs.size(), ShaderCompileTiming());
+	unsigned long long start = ReadProfileTicks();
+	threadPool.ParallelFor(static_cast<unsigned int>(mJobs.size()), [this, secondsPerTick](unsigned int index, unsigned int)
+	{
+		const Job& job = mJobs[index];
+		ShaderDesc desc;
+		desc.path = job.path.c_str();
+		desc.entryPoint = job.entryPoint.c_str();
+		desc.target = job.target.c_str();
+
+		// The shader is created on the thread that compiled it, as soon as it is compiled.
+		TraceZone zone(job.vertexShader != nullptr ? "CompileVertexShader" : "CompilePixelShader");
+		unsigned long long jobStart = ReadProfileTicks();
+		bool succeeded;
+		if (job.vertexShader != nullptr)
+		{
+			*job.vertexShader = mBackend->CreateVertexShader(desc);
+			succeeded = *job.vertexShader != nullptr;
+		}
+		else
+		{
+			*job.pixelShader = mBackend->CreatePixelShader(desc);
+			succeeded = *job.pixelShader != nullptr;
+		}
+		unsigned long long jobEnd = ReadProfileTicks();
+
+		ShaderCompileTiming& timing = mTimings[index];
+		timing.path = job.path;
+		timing.entryPoint = job.entryPoint;
+		timing.seconds = (jobEnd - jobStart) * secondsPerTick;
+		timing.succeeded = succeeded;
+	});
+	mWallSeconds = (ReadProfileTicks() - start) * secondsPerTick;
+
+	mJobs.clear();
+
+	for (const ShaderCompileTiming& timing : mTimings)
+	{
+		if (!timing.succeeded)
+			return false;
+	}
+
+	return true;
+}
+
+const std::vector<ShaderCompileTiming>& ShaderCompileScheduler::GetTimings() const
+{
+	return mTimings;
+}
+
+double ShaderCompileScheduler::GetWallSeconds() const
+{
+	return mWallSeconds;
+}
+
+unsigned int ShaderCompileScheduler::GetThreadCount() const
+{
+	return mThreadCount;
+}
+
+void ShaderCompileScheduler::PrintReport() const
+{
+	// Keep the formatting of std::cout as it was for whoever prints next.
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+
+	// Only the time of the whole batch is comparable between runs with different thread counts
+	// (see ShaderCompileTiming).
+	std::cout << "Compiled " << mTimings.size() << " shaders in " << std::fixed << std::setprecision(2)
+		<< mWallSeconds * 1000.0 << " ms using " << mThreadCount << (mThreadCount == 1 ? " thread" : " threads") << std::endl;
+	for (const ShaderCompileTiming& timing : mTimings)
+	{
+		// The paths used by the samples only contain ASCII characters.
+		std::string path;
+		for (wchar_t c : timing.path)
+			path += static_cast<char>(c);
+
+		std::cout << "  " << std::setw(10) << timing.seconds * 1000.0 << " ms  " << path << " (" << timing.entryPoint << ")"
+			<< (timing.succeeded ? "" : " FAILED") << std::endl;
+	}
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
@@ -0,0 +1,85 @@
+// ###########################################################################################
+// ## Compiles and creates many shaders at once, spreading the work over a pool of threads and
+// ## timing each shader.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "RenderBackend.h"
+
+#include <string>
+#include <vector>
+
+// How long a shader took to compile and create. The shaders compile at the same time, so each
+// one also waits for the others (e.g. for memory or the backend), and the times can't be added
+// up to tell how long compiling them one after the other would take.
+struct ShaderCompileTiming
+{
+	std::wstring path;
+	std::string entryPoint;
+	double seconds;
+	bool succeeded;
+};
+
+class ShaderCompileScheduler
+{
+public:
+	// The shaders are created with the given backend, whose Create*Shader() functions must be
+	// safe to call from several threads at once (see RenderBackend.h).
+	explicit ShaderCompileScheduler(RenderBackend* backend);
+
+	// Queues a shader to be compiled by Run(), which stores the created shader (or nullptr if
+	// it failed) in *shader. The description is copied, so it doesn't need to outlive the call.
+	void AddVertexShader(const ShaderDesc& desc, BackendVertexShader** shader);
+	void AddPixelShader(const ShaderDesc& desc, BackendPixelShader** shader);
+
+	// Compiles and creates every queued shader, each one as soon as a thread is free, and
+	// waits for all of them. Uses as many threads as the hardware supports, or threadCount if
+	// it isn't zero. Returns false if any shader failed.
+	bool Run(unsigned int threadCount = 0);
+
+	// The timings of the shaders compiled by the last Run(), in the order they were added.
+	const std::vector<ShaderCompileTiming>& GetTimings() const;
+
+	// The time the last Run() took from start to finish, and the number of threads it used.
+	double GetWallSeconds() const;
+	unsigned int GetThreadCount() const;
+
+	// Writes the timings of the last Run() to std::cout.
+	void PrintReport() const;
+
+private:
+	struct Job
+	{
+		std::wstring path;
+		std::string entryPoint;
+		std::string target;
+		BackendVertexShader** vertexShader;
+		BackendPixelShader** pixelShader;
+	};
+
+	void AddJob(const ShaderDesc& desc, BackendVertexShader** vertexShader, BackendPixelShader** pixelShader);
+
+	RenderBackend* mBackend;
+	std::vector<Job> mJobs;
+	std::vector<ShaderCompileTiming> mTimings;
+	double mWallSeconds;
+	unsigned int mThreadCount;
+};
@@ -0,0 +1,277 @@
+// ###########################################################################################
+// ## Reloads shaders while the program is running: when a shader file is saved it is compiled
+// ## again on a background thread, and the new shader replaces the old one between frames.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "ShaderReloader.h"
+#include "ShaderCache.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Editors often write a file in several steps, so changes are collected for a moment before
+// the shaders are compiled.
+const unsigned int RELOAD_SETTLE_MILLISECONDS = 50;
+
+// Returns the part of path after its last folder.
+static std::string GetFileName(const std::string& path)
+{
+	size_t folderEnd = path.find_last_of("/\\");
+	return folderEnd == std::string::npos ? path : path.substr(folderEnd + 1);
+}
+
+// Adds the files named by the #include directives in source to includes, and the files they
+// include in turn, reading them relative to folder like the include handler of D3D11Backend.
+// Directives the preprocessor would skip are followed too, which at worst reloads a shader
+// that didn't need it.
+static void FindIncludes(const std::string& folder, const std::string& source, std::vector<std::string>& includes)
+{
+	size_t lineStart = 0;
+	while (lineStart < source.size())
+	{
+		size_t lineEnd = source.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = source.size();
+
+		size_t i = source.find_first_not_of(" \t", lineStart);
+		if (i < lineEnd && source[i] == '#')
+		{
+			i = source.find_first_not_of(" \t", i + 1);
+			if (i < lineEnd && source.compare(i, 7, "include") == 0)
+			{
+				size_t nameStart = source.find_first_of("\"<", i + 7);
+				size_t nameEnd = nameStart < lineEnd ? source.find_first_of("\">", nameStart + 1) : std::string::npos;
+				if (nameEnd < lineEnd)
+				{
+					std::string name = source.substr(nameStart + 1, nameEnd - nameStart - 1);
+					if (std::find(includes.begin(), includes.end(), name) == includes.end())
+					{
+						includes.push_back(name);
+						std::string contents;
+						if (ShaderCache::ReadSourceFile(folder + name, contents))
+							FindIncludes(folder, contents, includes);
+					}
+				}
+			}
+		}
+
+		lineStart = lineEnd + 1;
+	}
+}
+
+// Finds the files the shader includes, as file names like the FileWatcher reports. A file that
+// can't be read is still listed, so the shader is reloaded once it is written.
+static void UpdateIncludes(const std::string& folder, const std::wstring& path, std::vector<std::string>& includes)
+{
+	// The paths used by the samples only contain ASCII characters.
+	std::string narrowPath;
+	for (wchar_t c : path)
+		narrowPath += static_cast<char>(c);
+
+	std::vector<std::string> includePaths;
+	std::string source;
+	if (ShaderCache::ReadSourceFile(narrowPath, source))
+		FindIncludes(folder, source, includePaths);
+
+	includes.clear();
+	for (const std::string& includePath : includePaths)
+		includes.push_back(GetFileName(includePath));
+}
+
+ShaderReloader::ShaderReloader(RenderBackend* backend)
+	: mBackend(backend)
+	, mQuit(false)
+{
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	mQuit = true;
+	if (mThread.joinable())
+		mThread.join();
+
+	// Shaders compiled but never put in place.
+	for (const ReloadedShader& reloaded : mReloadedShaders)
+	{
+		delete reloaded.vertexShader;
+		delete reloaded.pixelShader;
+	}
+}
+
+void ShaderReloader::AddVertexShader(const ShaderDesc& desc, BackendVertexShader** shader, const std::function<bool()>& onReloaded)
+{
+	AddShader(desc, shader, nullptr, onReloaded);
+}
+
+void ShaderReloader::AddPixelShader(const ShaderDesc& desc, BackendPixelShader** shader, const std::function<bool()>& onReloaded)
+{
+	AddShader(desc, nullptr, shader, onReloaded);
+}
+
+void ShaderReloader::AddShader(const ShaderDesc& desc, BackendVertexShader** vertexShader, BackendPixelShader** pixelShader,
+	const std::function<bool()>& onReloaded)
+{
+	WatchedShader watched;
+	watched.path = desc.path;
+	watched.entryPoint = desc.entryPoint;
+	watched.target = desc.target;
+	watched.vertexShader = vertexShader;
+	watched.pixelShader = pixelShader;
+	watched.onReloaded = onReloaded;
+
+	// The file name is what the watcher reports. The paths used by the samples only contain
+	// ASCII characters.
+	size_t folderEnd = watched.path.find_last_of(L"/\\");
+	for (size_t i = 0; i < watched.path.size(); ++i)
+	{
+		if (folderEnd == std::wstring::npos || i > folderEnd)
+			watched.fileName += static_cast<char>(watched.path[i]);
+		else
+			watched.folder += static_cast<char>(watched.path[i]);
+	}
+	UpdateIncludes(watched.folder, watched.path, watched.includes);
+
+	mWatchedShaders.push_back(watched);
+}
+
+bool ShaderReloader::Start(const std::string& directory)
+{
+	if (mThread.joinable() || !mWatcher.Watch(directory))
+		return false;
+
+	mThread = std::thread(&ShaderReloader::ThreadMain, this);
+	return true;
+}
+
+unsigned int ShaderReloader::Update()
+{
+	// Only take the shaders if the background thread isn't holding the lock right now, so the
+	// frame never waits for it.
+	std::vector<ReloadedShader> reloadedShaders;
+	{
+		std::unique_lock<std::mutex> lock(mReloadedMutex, std::try_to_lock);
+		if (!lock.owns_lock() || mReloadedShaders.empty())
+			return 0;
+
+		reloadedShaders.swap(mReloadedShaders);
+	}
+
+	unsigned int replaced = 0;
+	for (const ReloadedShader& reloaded : reloadedShaders)
+	{
+		// The old shader is kept until onReloaded has accepted the new one, so it can be put
+		// back if the new one doesn't fit, e.g. a vertex shader whose inputs changed.
+		const WatchedShader& watched = mWatchedShaders[reloaded.watchedIndex];
+		BackendVertexShader* oldVertexShader = nullptr;
+		BackendPixelShader* oldPixelShader = nullptr;
+		if (watched.vertexShader != nullptr)
+		{
+			oldVertexShader = *watched.vertexShader;
+			*watched.vertexShader = reloaded.vertexShader;
+		}
+		else
+		{
+			oldPixelShader = *watched.pixelShader;
+			*watched.pixelShader = reloaded.pixelShader;
+		}
+
+		if (watched.onReloaded && !watched.onReloaded())
+		{
+			std::cout << "Reloaded " << watched.fileName << " can't be used, keeping the last working version" << std::endl;
+			if (watched.vertexShader != nullptr)
+				*watched.vertexShader = oldVertexShader;
+			else
+				*watched.pixelShader = oldPixelShader;
+
+			delete reloaded.vertexShader;
+			delete reloaded.pixelShader;
+			continue;
+		}
+
+		delete oldVertexShader;
+		delete oldPixelShader;
+		++replaced;
+	}
+
+	return replaced;
+}
+
+void ShaderReloader::ThreadMain()
+{
+	SetTraceThreadName("ShaderReloader");
+
+	while (!mQuit)
+	{
+		// Wake up regularly to see if it's time to quit.
+		std::vector<std::string> changedFiles = mWatcher.WaitForChanges(100);
+		if (changedFiles.empty())
+			continue;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(RELOAD_SETTLE_MILLISECONDS));
+		std::vector<std::string> moreChangedFiles = mWatcher.WaitForChanges(0);
+		changedFiles.insert(changedFiles.end(), moreChangedFiles.begin(), moreChangedFiles.end());
+
+		// A shader is compiled again when its own file or one of the files it includes
+		// changes, e.g. every shader including a header of constants when the header is saved.
+		for (unsigned int i = 0; i < mWatchedShaders.size(); ++i)
+		{
+			const WatchedShader& watched = mWatchedShaders[i];
+			bool changed = std::find(changedFiles.begin(), changedFiles.end(), watched.fileName) != changedFiles.end();
+			for (size_t include = 0; include < watched.includes.size() && !changed; ++include)
+				changed = std::find(changedFiles.begin(), changedFiles.end(), watched.includes[include]) != changedFiles.end();
+
+			if (changed)
+				Reload(i);
+		}
+	}
+}
+
+void ShaderReloader::Reload(unsigned int watchedIndex)
+{
+	TraceZone zone("ReloadShader");
+
+	// The includes may have changed along with the file. Only this thread touches them once
+	// the reloader has started.
+	WatchedShader& watched = mWatchedShaders[watchedIndex];
+	UpdateIncludes(watched.folder, watched.path, watched.includes);
+
+	ShaderDesc desc;
+	desc.path = watched.path.c_str();
+	desc.entryPoint = watched.entryPoint.c_str();
+	desc.target = watched.target.c_str();
+
+	ReloadedShader reloaded;
+	reloaded.watchedIndex = watchedIndex;
+	reloaded.vertexShader = watched.vertexShader != nullptr ? mBackend->CreateVertexShader(desc) : nullptr;
+	reloaded.pixelShader = watched.pixelShader != nullptr ? mBackend->CreatePixelShader(desc) : nullptr;
+
+	// If the shader doesn't compile the old one is kept, and the next save gives it a new try.
+	if (reloaded.vertexShader == nullptr && reloaded.pixelShader == nullptr)
+	{
+		std::cout << "Reloading " << watched.fileName << " failed, keeping the last working version" << std::endl;
+		return;
+	}
+
+	std::cout << "Reloaded " << watched.fileName << std::endl;
+	std::lock_guard<std::mutex> lock(mReloadedMutex);
+	mReloadedShaders.push_back(reloaded);
+}
@@ -0,0 +1,96 @@
+// ###########################################################################################
+// ## Reloads shaders while the program is running: when a shader file is saved it is compiled
+// ## again on a background thread, and the new shader replaces the old one between frames.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "FileWatcher.h"
+#include "RenderBackend.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ShaderReloader
+{
+public:
+	// The new shaders are created with backend, whose Create*Shader() functions are called from
+	// the reloader's thread.
+	explicit ShaderReloader(RenderBackend* backend);
+	~ShaderReloader();
+
+	// Reloads the shader whenever its file or a file it includes changes, replacing *shader in
+	// Update(). onReloaded, if set, is called right after, e.g. to create a new input layout for
+	// a vertex shader. If it returns false the new shader can't be used: the old one is put back
+	// and the new one deleted. Otherwise the old one is deleted. The description is copied.
+	// Shaders must be added before Start().
+	void AddVertexShader(const ShaderDesc& desc, BackendVertexShader** shader, const std::function<bool()>& onReloaded);
+	void AddPixelShader(const ShaderDesc& desc, BackendPixelShader** shader, const std::function<bool()>& onReloaded);
+
+	// Starts watching the shader files in directory on a background thread. Returns false if
+	// the folder can't be watched, in which case nothing is ever reloaded.
+	bool Start(const std::string& directory);
+
+	// Puts the shaders that have finished compiling in place. Call between frames, on the
+	// thread rendering. Never waits for the background thread; if it is busy handing over a
+	// shader, the shader is picked up the next time. Returns the number of shaders replaced.
+	unsigned int Update();
+
+private:
+	struct WatchedShader
+	{
+		std::string fileName;	// Without folders, as reported by the FileWatcher.
+		std::string folder;		// The shader file's folder, which includes are read relative to.
+		std::vector<std::string> includes;	// File names of the files included, updated on each reload.
+		std::wstring path;
+		std::string entryPoint;
+		std::string target;
+		BackendVertexShader** vertexShader;
+		BackendPixelShader** pixelShader;
+		std::function<bool()> onReloaded;
+	};
+
+	// A shader that has been compiled and is waiting for Update().
+	struct ReloadedShader
+	{
+		unsigned int watchedIndex;
+		BackendVertexShader* vertexShader;
+		BackendPixelShader* pixelShader;
+	};
+
+	void AddShader(const ShaderDesc& desc, BackendVertexShader** vertexShader, BackendPixelShader** pixelShader,
+		const std::function<bool()>& onReloaded);
+	void ThreadMain();
+	void Reload(unsigned int watchedIndex);
+
+	RenderBackend* mBackend;
+	FileWatcher mWatcher;
+	std::vector<WatchedShader> mWatchedShaders;
+
+	std::mutex mReloadedMutex;
+	std::vector<ReloadedShader> mReloadedShaders;	// Guarded by mReloadedMutex.
+
+	std::atomic<bool> mQuit;
+	std::thread mThread;
+};
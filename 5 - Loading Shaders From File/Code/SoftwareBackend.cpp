@@ -0,0 +1,676 @@
+// ###########################################################################################
+// ## A reference backend rendering on the CPU into an in-memory RGBA8 back buffer. Vertices
+// ## are shaded here, while the triangles are rasterised by SoftwareRasteriser.cpp.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "SoftwareBackend.h"
+#include "Trace.h"
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// The software versions of the backend resources.
+class SoftwareBuffer : public BackendBuffer
+{
+public:
+	std::vector<unsigned char> data;
+};
+
+class SoftwareVertexShader : public BackendVertexShader
+{
+public:
+	const SoftwareShader* shader;
+};
+
+class SoftwarePixelShader : public BackendPixelShader
+{
+public:
+	const SoftwareShader* shader;
+};
+
+class SoftwareInputLayout : public BackendInputLayout
+{
+public:
+	// The element feeding each vertex shader input, in the order the shader declares them.
+	InputElementDesc inputs[SOFTWARE_MAX_INPUTS];
+	unsigned int inputCount;
+};
+
+class SoftwareRenderTarget : public BackendRenderTarget
+{
+public:
+	std::vector<unsigned char> pixels;
+};
+
+// Compares a semantic name to the first length characters of another. Like in HLSL, the case
+// of the letters doesn't matter.
+static bool SemanticsEqual(const char* a, const char* b, size_t length)
+{
+	size_t i = 0;
+	for (; a[i] != '\0' && i < length; ++i)
+	{
+		char ca = (a[i] >= 'a' && a[i] <= 'z') ? a[i] - 'a' + 'A' : a[i];
+		char cb = (b[i] >= 'a' && b[i] <= 'z') ? b[i] - 'a' + 'A' : b[i];
+		if (ca != cb)
+			return false;
+	}
+
+	return a[i] == '\0' && i == length;
+}
+
+// Whether an element provides the shader input with the given semantic. As in HLSL, digits at
+// the end of the semantic are its index, so "TRANSFORM1" is read from the element with the
+// semantic name TRANSFORM and index 1, and "COLOR" from COLOR with index 0.
+static bool ElementMatchesSemantic(const InputElementDesc& element, const char* semantic)
+{
+	size_t length = strlen(semantic);
+	size_t nameLength = length;
+	while (nameLength > 0 && semantic[nameLength - 1] >= '0' && semantic[nameLength - 1] <= '9')
+		--nameLength;
+
+	unsigned int index = 0;
+	for (size_t i = nameLength; i < length; ++i)
+		index = index * 10 + (semantic[i] - '0');
+
+	return SemanticsEqual(element.semanticName, semantic, nameLength) && element.semanticIndex == index;
+}
+
+SoftwareBackend::SoftwareBackend(unsigned int width, unsigned int height)
+	: mWidth(width)
+	, mHeight(height)
+	, mBackBuffer(nullptr)
+	, mIndexBuffer(nullptr)
+	, mIndexFormat(IndexFormat::UInt16)
+	, mIndexOffset(0)
+	, mInputLayout(nullptr)
+	, mTopology(PrimitiveTopology::TriangleList)
+	, mVertexShader(nullptr)
+	, mPixelShader(nullptr)
+	, mConstantsDirty(true)
+	, mConstantBufferOffsets(true)
+	, mFence(0)
+	, mRasteriserISA(DetectRasteriserISA())
+	, mRasterise(GetRasteriseFunction(mRasteriserISA))
+	, mThreadPool(new ThreadPool(std::max(std::thread::hardware_concurrency(), 1u)))
+	, mTilesX((width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE)
+	, mTilesY((height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE)
+{
+	SoftwareRenderTarget* backBuffer = new SoftwareRenderTarget();
+	backBuffer->pixels.resize(static_cast<size_t>(width) * height * 4, 0);
+	mBackBuffer = backBuffer;
+	mTileBins.resize(mTilesX * mTilesY);
+
+	for (unsigned int i = 0; i < SOFTWARE_MAX_VERTEX_BUFFERS; ++i)
+	{
+		mVertexBuffers[i] = nullptr;
+		mStrides[i] = 0;
+		mOffsets[i] = 0;
+	}
+
+	for (unsigned int i = 0; i < SOFTWARE_MAX_CONSTANT_BUFFERS; ++i)
+	{
+		mConstantBuffers[i] = nullptr;
+		mFirstConstants[i] = 0;
+		mConstantCounts[i] = 0;
+	}
+
+	ResetStatistics();
+}
+
+SoftwareBackend::~SoftwareBackend()
+{
+	delete mBackBuffer;
+}
+
+BackendBuffer* SoftwareBackend::CreateVertexBuffer(const void* data, unsigned int byteWidth)
+{
+	if (data == nullptr || byteWidth == 0)
+		return nullptr;
+
+	SoftwareBuffer* buffer = new SoftwareBuffer();
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	buffer->data.assign(bytes, bytes + byteWidth);
+	return buffer;
+}
+
+BackendBuffer* SoftwareBackend::CreateIndexBuffer(const void* data, unsigned int byteWidth)
+{
+	// Index buffers are only read by the CPU as well, so they are the same as vertex buffers.
+	return CreateVertexBuffer(data, byteWidth);
+}
+
+BackendBuffer* SoftwareBackend::CreateDynamicBuffer(unsigned int byteWidth)
+{
+	if (byteWidth == 0)
+		return nullptr;
+
+	SoftwareBuffer* buffer = new SoftwareBuffer();
+	buffer->data.resize(byteWidth, 0);
+	return buffer;
+}
+
+BackendBuffer* SoftwareBackend::CreateConstantBuffer(unsigned int byteWidth)
+{
+	if (byteWidth % CONSTANT_SIZE != 0)
+		return nullptr;
+
+	return CreateDynamicBuffer(byteWidth);
+}
+
+bool SoftwareBackend::SupportsConstantBufferOffsets() const
+{
+	return mConstantBufferOffsets;
+}
+
+BackendVertexShader* SoftwareBackend::CreateVertexShader(const ShaderDesc& desc)
+{
+	const SoftwareShader* shader = FindSoftwareShader(desc.path, desc.entryPoint);
+	if (shader == nullptr || shader->vertexShader == nullptr)
+		return nullptr;
+
+	SoftwareVertexShader* vertexShader = new SoftwareVertexShader();
+	vertexShader->shader = shader;
+	return vertexShader;
+}
+
+BackendPixelShader* SoftwareBackend::CreatePixelShader(const ShaderDesc& desc)
+{
+	const SoftwareShader* shader = FindSoftwareShader(desc.path, desc.entryPoint);
+	if (shader == nullptr || shader->pixelShader == nullptr)
+		return nullptr;
+
+	SoftwarePixelShader* pixelShader = new SoftwarePixelShader();
+	pixelShader->shader = shader;
+	return pixelShader;
+}
+
+BackendInputLayout* SoftwareBackend::CreateInputLayout(const InputElementDesc* elements,
+	unsigned int elementCount, BackendVertexShader* vertexShader)
+{
+	if (vertexShader == nullptr)
+		return nullptr;
+
+	// Like Direct3D, validate the layout against the shader's inputs: every input the shader
+	// declares must be provided by an element.
+	const SoftwareShader* shader = static_cast<SoftwareVertexShader*>(vertexShader)->shader;
+	SoftwareInputLayout* layout = new SoftwareInputLayout();
+	layout->inputCount = shader->inputCount;
+	for (unsigned int i = 0; i < shader->inputCount; ++i)
+	{
+		bool found = false;
+		for (unsigned int e = 0; e < elementCount && !found; ++e)
+		{
+			if (ElementMatchesSemantic(elements[e], shader->inputSemantics[i]) &&
+				elements[e].inputSlot < SOFTWARE_MAX_VERTEX_BUFFERS)
+			{
+				layout->inputs[i] = elements[e];
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			delete layout;
+			return nullptr;
+		}
+	}
+
+	return layout;
+}
+
+BackendRenderTarget* SoftwareBackend::GetBackBuffer()
+{
+	return mBackBuffer;
+}
+
+void SoftwareBackend::ClearRenderTargetView(BackendRenderTarget* target, const float colour[4])
+{
+	// There is only one render target, the back buffer.
+	(void)target;
+
+	unsigned char clearBytes[4] =
+	{
+		ToUnorm8(colour[0]), ToUnorm8(colour[1]), ToUnorm8(colour[2]), ToUnorm8(colour[3])
+	};
+
+	unsigned int clearValue;
+	memcpy(&clearValue, clearBytes, 4);
+
+	// The clear is done by each tile in turn when flushing, keeping it in order with the
+	// triangles drawn before and after it.
+	unsigned int command = TILE_CLEAR_COMMAND | static_cast<unsigned int>(mClearValues.size());
+	mClearValues.push_back(clearValue);
+	for (std::vector<unsigned int>& bin : mTileBins)
+		bin.push_back(command);
+
+	mStatistics.pixelsCleared += static_cast<unsigned long long>(mWidth) * mHeight;
+}
+
+void SoftwareBackend::IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+	BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+{
+	for (unsigned int i = 0; i < bufferCount && startSlot + i < SOFTWARE_MAX_VERTEX_BUFFERS; ++i)
+	{
+		mVertexBuffers[startSlot + i] = buffers[i];
+		mStrides[startSlot + i] = strides[i];
+		mOffsets[startSlot + i] = offsets[i];
+	}
+}
+
+void SoftwareBackend::IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset)
+{
+	mIndexBuffer = buffer;
+	mIndexFormat = format;
+	mIndexOffset = offset;
+}
+
+void SoftwareBackend::IASetInputLayout(BackendInputLayout* inputLayout)
+{
+	mInputLayout = inputLayout;
+}
+
+void SoftwareBackend::IASetPrimitiveTopology(PrimitiveTopology topology)
+{
+	mTopology = topology;
+}
+
+void SoftwareBackend::VSSetShader(BackendVertexShader* shader)
+{
+	mVertexShader = shader;
+}
+
+void SoftwareBackend::PSSetShader(BackendPixelShader* shader)
+{
+	mPixelShader = shader;
+}
+
+void SoftwareBackend::VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+	const unsigned int* firstConstants, const unsigned int* constantCounts)
+{
+	for (unsigned int i = 0; i < bufferCount && startSlot + i < SOFTWARE_MAX_CONSTANT_BUFFERS; ++i)
+	{
+		mConstantBuffers[startSlot + i] = buffers[i];
+		mFirstConstants[startSlot + i] = firstConstants != nullptr ? firstConstants[i] : 0;
+		mConstantCounts[startSlot + i] = constantCounts != nullptr ? constantCounts[i] : CONSTANT_BUFFER_MAX_CONSTANTS;
+	}
+
+	mConstantsDirty = true;
+}
+
+// Draws read their vertices and indices straight away, so nothing already drawn reads a buffer
+// after it has been written to, and both map modes simply give the buffer's memory.
+void* SoftwareBackend::Map(BackendBuffer* buffer, MapMode mode)
+{
+	(void)mode;
+	return buffer != nullptr ? static_cast<SoftwareBuffer*>(buffer)->data.data() : nullptr;
+}
+
+void SoftwareBackend::Unmap(BackendBuffer* buffer)
+{
+	(void)buffer;
+	mConstantsDirty = true;
+}
+
+void SoftwareBackend::UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+	const void* data, unsigned int size)
+{
+	// Unlike a mapped pointer, the size of the buffer is known, so writes past its end are dropped.
+	(void)mode;
+	std::vector<unsigned char>& bufferData = static_cast<SoftwareBuffer*>(buffer)->data;
+	if (static_cast<size_t>(offset) + size <= bufferData.size())
+		memcpy(bufferData.data() + offset, data, size);
+
+	mConstantsDirty = true;
+}
+
+void SoftwareBackend::Draw(unsigned int vertexCount, unsigned int startVertexLocation)
+{
+	// A draw that isn't instanced reads the first instance of any per instance elements, like
+	// Direct3D does.
+	DrawInstanced(vertexCount, 1, startVertexLocation, 0);
+}
+
+void SoftwareBackend::DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation)
+{
+	DrawIndexedInstanced(indexCount, 1, startIndexLocation, baseVertexLocation, 0);
+}
+
+void SoftwareBackend::DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+	unsigned int startVertexLocation, unsigned int startInstanceLocation)
+{
+	// As with Direct3D, a draw with incomplete state silently draws nothing.
+	if (mInputLayout == nullptr || mVertexShader == nullptr || mPixelShader == nullptr)
+		return;
+
+	// Each instance runs the vertex shader for all of its vertices, as its per instance inputs
+	// change the results.
+	for (unsigned int instance = 0; instance < instanceCount; ++instance)
+	{
+		unsigned int firstVertex = 0;
+		if (!ShadeVertices(vertexCountPerInstance, startVertexLocation, startInstanceLocation, instance, firstVertex))
+			return;
+
+		// Every three vertices form a triangle in a triangle list, left over vertices are ignored.
+		for (unsigned int i = 0; i + 2 < vertexCountPerInstance; i += 3)
+			BinTriangle(firstVertex + i, firstVertex + i + 1, firstVertex + i + 2);
+	}
+}
+
+void SoftwareBackend::DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+	unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation)
+{
+	if (mInputLayout == nullptr || mVertexShader == nullptr || mPixelShader == nullptr || mIndexBuffer == nullptr)
+		return;
+
+	const std::vector<unsigned char>& indexData = static_cast<SoftwareBuffer*>(mIndexBuffer)->data;
+	unsigned int indexSize = mIndexFormat == IndexFormat::UInt16 ? 2 : 4;
+	size_t first = mIndexOffset + static_cast<size_t>(startIndexLocation) * indexSize;
+	if (indexCountPerInstance == 0 || first + static_cast<size_t>(indexCountPerInstance) * indexSize > indexData.size())
+		return;
+
+	// Read the indices and find the range of vertices they use.
+	mIndices.resize(indexCountPerInstance);
+	unsigned int minIndex = ~0u;
+	unsigned int maxIndex = 0;
+	for (unsigned int i = 0; i < indexCountPerInstance; ++i)
+	{
+		const unsigned char* index = &indexData[first + static_cast<size_t>(i) * indexSize];
+		if (mIndexFormat == IndexFormat::UInt16)
+		{
+			unsigned short shortIndex;
+			memcpy(&shortIndex, index, 2);
+			mIndices[i] = shortIndex;
+		}
+		else
+		{
+			memcpy(&mIndices[i], index, 4);
+		}
+
+		minIndex = std::min(minIndex, mIndices[i]);
+		maxIndex = std::max(maxIndex, mIndices[i]);
+	}
+
+	long long startVertex = static_cast<long long>(baseVertexLocation) + minIndex;
+	if (startVertex < 0)
+		return;
+
+	// Every vertex in the range is shaded once per instance, however many triangles use it.
+	// This is what a post-transform cache that never misses would do, and works well as long as
+	// the indices don't skip large parts of the vertex buffer. The indices are only read once.
+	for (unsigned int instance = 0; instance < instanceCount; ++instance)
+	{
+		unsigned int firstVertex = 0;
+		if (!ShadeVertices(maxIndex - minIndex + 1, static_cast<unsigned int>(startVertex), startInstanceLocation, instance, firstVertex))
+			return;
+
+		unsigned int base = firstVertex - minIndex;
+		for (unsigned int i = 0; i + 2 < indexCountPerInstance; i += 3)
+			BinTriangle(base + mIndices[i], base + mIndices[i + 1], base + mIndices[i + 2]);
+	}
+}
+
+void SoftwareBackend::Present()
+{
+	// The back buffer is what the caller reads, so there is nothing to swap once everything
+	// has been rasterised.
+	Flush();
+	++mStatistics.framesPresented;
+}
+
+// For the same reason every fence has been passed as soon as it is inserted.
+unsigned long long SoftwareBackend::InsertFence()
+{
+	return ++mFence;
+}
+
+unsigned long long SoftwareBackend::GetCompletedFence()
+{
+	return mFence;
+}
+
+void SoftwareBackend::SetConstantBufferOffsetsSupported(bool supported)
+{
+	mConstantBufferOffsets = supported;
+}
+
+bool SoftwareBackend::SetRasteriserISA(RasteriserISA isa)
+{
+	if (!IsRasteriserISASupported(isa))
+		return false;
+
+	mRasteriserISA = isa;
+	mRasterise = GetRasteriseFunction(isa);
+	return true;
+}
+
+RasteriserISA SoftwareBackend::GetRasteriserISA() const
+{
+	return mRasteriserISA;
+}
+
+void SoftwareBackend::SetThreadCount(unsigned int threadCount)
+{
+	Flush();
+	mThreadPool.reset(new ThreadPool(std::max(threadCount, 1u)));
+}
+
+unsigned int SoftwareBackend::GetThreadCount() const
+{
+	return mThreadPool->GetThreadCount();
+}
+
+void SoftwareBackend::Flush()
+{
+	if (mTriangles.empty() && mClearValues.empty())
+		return;
+
+	for (BinnedTriangle& binned : mTriangles)
+	{
+		for (int i = 0; i < 3; ++i)
+			binned.triangle.attributes[i] = mVertices[binned.vertices[i]].attributes;
+	}
+
+	// Tiles don't overlap, so they can be rasterised in any order by any thread.
+	TraceZone zone("RasteriseTiles");
+	std::atomic<unsigned long long> pixelsShaded(0);
+	mThreadPool->ParallelFor(mTilesX * mTilesY, [&](unsigned int tileIndex, unsigned int)
+	{
+		TraceZone tileZone("RasteriseTile");
+		pixelsShaded += RasteriseTile(tileIndex);
+	});
+
+	mStatistics.pixelsShaded += pixelsShaded;
+
+	for (std::vector<unsigned int>& bin : mTileBins)
+		bin.clear();
+	mTriangles.clear();
+	mClearValues.clear();
+	mVertices.clear();
+}
+
+const unsigned char* SoftwareBackend::GetBackBufferData() const
+{
+	return static_cast<SoftwareRenderTarget*>(mBackBuffer)->pixels.data();
+}
+
+unsigned int SoftwareBackend::GetWidth() const
+{
+	return mWidth;
+}
+
+unsigned int SoftwareBackend::GetHeight() const
+{
+	return mHeight;
+}
+
+const SoftwareStatistics& SoftwareBackend::GetStatistics() const
+{
+	return mStatistics;
+}
+
+void SoftwareBackend::ResetStatistics()
+{
+	memset(&mStatistics, 0, sizeof(mStatistics));
+}
+
+bool SoftwareBackend::ShadeVertices(unsigned int vertexCount, unsigned int startVertexLocation,
+	unsigned int startInstanceLocation, unsigned int instance, unsigned int& firstVertex)
+{
+	const SoftwareInputLayout* layout = static_cast<SoftwareInputLayout*>(mInputLayout);
+	const SoftwareShader* shader = static_cast<SoftwareVertexShader*>(mVertexShader)->shader;
+	if (mConstantsDirty)
+		GatherConstants();
+
+	// Find where each input is read from, and make sure the whole draw is inside the buffers.
+	const unsigned char* inputData[SOFTWARE_MAX_INPUTS];
+	unsigned int inputStride[SOFTWARE_MAX_INPUTS];
+	for (unsigned int i = 0; i < layout->inputCount; ++i)
+	{
+		unsigned int slot = layout->inputs[i].inputSlot;
+		const SoftwareBuffer* buffer = static_cast<SoftwareBuffer*>(mVertexBuffers[slot]);
+		if (buffer == nullptr)
+			return false;
+
+		// Per instance elements are the same for every vertex of the instance. They move on to
+		// the next value every instanceDataStepRate instances, or never if it is 0.
+		const InputElementDesc& element = layout->inputs[i];
+		size_t first = mOffsets[slot] + element.byteOffset;
+		if (element.inputSlotClass == InputClassification::PerInstance)
+		{
+			unsigned int step = element.instanceDataStepRate != 0 ? instance / element.instanceDataStepRate : 0;
+			first += (static_cast<size_t>(startInstanceLocation) + step) * mStrides[slot];
+			inputStride[i] = 0;
+		}
+		else
+		{
+			first += static_cast<size_t>(startVertexLocation) * mStrides[slot];
+			inputStride[i] = mStrides[slot];
+		}
+
+		size_t end = first + static_cast<size_t>(vertexCount - 1) * inputStride[i] + ElementSize(element.format);
+		if (vertexCount > 0 && end > buffer->data.size())
+			return false;
+
+		inputData[i] = buffer->data.data() + first;
+	}
+
+	firstVertex = static_cast<unsigned int>(mVertices.size());
+	mVertices.resize(mVertices.size() + vertexCount);
+
+	Float4 input[SOFTWARE_MAX_INPUTS];
+	for (unsigned int v = 0; v < vertexCount; ++v)
+	{
+		for (unsigned int i = 0; i < layout->inputCount; ++i)
+			input[i] = FetchElement(inputData[i] + static_cast<size_t>(v) * inputStride[i], layout->inputs[i].format);
+
+		shader->vertexShader(input, mConstants, mVertices[firstVertex + v]);
+	}
+
+	mStatistics.verticesShaded += vertexCount;
+	return true;
+}
+
+void SoftwareBackend::GatherConstants()
+{
+	mConstants = SoftwareConstants();
+	for (unsigned int slot = 0; slot < SOFTWARE_MAX_CONSTANT_BUFFERS; ++slot)
+	{
+		const SoftwareBuffer* buffer = static_cast<SoftwareBuffer*>(mConstantBuffers[slot]);
+		if (buffer == nullptr)
+			continue;
+
+		// Only the constants inside both the bound range and the buffer are read.
+		size_t bufferConstants = buffer->data.size() / CONSTANT_SIZE;
+		size_t first = mFirstConstants[slot];
+		size_t count = std::min<size_t>(std::min<size_t>(mConstantCounts[slot], SOFTWARE_MAX_CONSTANTS),
+			first < bufferConstants ? bufferConstants - first : 0);
+		if (count > 0)
+			memcpy(mConstants.buffers[slot], buffer->data.data() + first * CONSTANT_SIZE, count * CONSTANT_SIZE);
+	}
+
+	mConstantsDirty = false;
+}
+
+void SoftwareBackend::BinTriangle(unsigned int v0, unsigned int v1, unsigned int v2)
+{
+	BinnedTriangle binned;
+	binned.pixelShader = static_cast<SoftwarePixelShader*>(mPixelShader)->shader;
+	binned.vertices[0] = v0;
+	binned.vertices[1] = v1;
+	binned.vertices[2] = v2;
+	if (!SetupTriangle(mVertices[v0], mVertices[v1], mVertices[v2], binned.pixelShader->attributeCount,
+		mWidth, mHeight, binned.triangle))
+	{
+		return;
+	}
+
+	++mStatistics.trianglesRasterised;
+
+	// Add the triangle to every tile it may cover. Tiles inside the bounding box but outside
+	// the triangle are skipped.
+	const RasteriserTriangle& triangle = binned.triangle;
+	unsigned int index = static_cast<unsigned int>(mTriangles.size());
+	mTriangles.push_back(binned);
+	for (unsigned int tileY = triangle.minY / SOFTWARE_TILE_SIZE; tileY <= triangle.maxY / SOFTWARE_TILE_SIZE; ++tileY)
+	{
+		for (unsigned int tileX = triangle.minX / SOFTWARE_TILE_SIZE; tileX <= triangle.maxX / SOFTWARE_TILE_SIZE; ++tileX)
+		{
+			int minX = tileX * SOFTWARE_TILE_SIZE;
+			int minY = tileY * SOFTWARE_TILE_SIZE;
+			if (TriangleOverlapsRect(triangle, minX, minY, minX + SOFTWARE_TILE_SIZE - 1, minY + SOFTWARE_TILE_SIZE - 1))
+				mTileBins[tileY * mTilesX + tileX].push_back(index);
+		}
+	}
+}
+
+unsigned long long SoftwareBackend::RasteriseTile(unsigned int tileIndex)
+{
+	RasteriserTarget target;
+	target.pixels = static_cast<SoftwareRenderTarget*>(mBackBuffer)->pixels.data();
+	target.pitch = mWidth * 4;
+	target.minX = (tileIndex % mTilesX) * SOFTWARE_TILE_SIZE;
+	target.minY = (tileIndex / mTilesX) * SOFTWARE_TILE_SIZE;
+	target.maxX = std::min(target.minX + static_cast<int>(SOFTWARE_TILE_SIZE), static_cast<int>(mWidth)) - 1;
+	target.maxY = std::min(target.minY + static_cast<int>(SOFTWARE_TILE_SIZE), static_cast<int>(mHeight)) - 1;
+
+	unsigned long long pixelsShaded = 0;
+	for (unsigned int command : mTileBins[tileIndex])
+	{
+		if ((command & TILE_CLEAR_COMMAND) != 0)
+		{
+			unsigned int clearValue = mClearValues[command & ~TILE_CLEAR_COMMAND];
+			for (int y = target.minY; y <= target.maxY; ++y)
+			{
+				unsigned int* row = reinterpret_cast<unsigned int*>(target.pixels + static_cast<size_t>(y) * target.pitch);
+				std::fill(row + target.minX, row + target.maxX + 1, clearValue);
+			}
+		}
+		else
+		{
+			const BinnedTriangle& binned = mTriangles[command];
+			pixelsShaded += mRasterise(binned.triangle, target, binned.pixelShader);
+		}
+	}
+
+	return pixelsShaded;
+}
@@ -0,0 +1,186 @@
+// ###########################################################################################
+// ## A reference backend rendering on the CPU into an in-memory RGBA8 back buffer. It needs
+// ## no window and no GPU, so it can run headless on any platform.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "RenderBackend.h"
+#include "SoftwareRasteriser.h"
+#include "SoftwareShaders.h"
+#include "ThreadPool.h"
+
+#include <memory>
+#include <vector>
+
+const unsigned int SOFTWARE_MAX_VERTEX_BUFFERS = 16;
+
+// The back buffer is split into tiles of this many pixels square. Draws only bin triangles
+// into the tiles they touch; the tiles are then rasterised in parallel when flushing.
+const unsigned int SOFTWARE_TILE_SIZE = 64;
+
+// Counters for the work done by the backend, used to measure throughput.
+struct SoftwareStatistics
+{
+	unsigned long long verticesShaded;
+	unsigned long long trianglesRasterised;	// Triangles surviving culling.
+	unsigned long long pixelsShaded;
+	unsigned long long pixelsCleared;
+	unsigned long long framesPresented;
+};
+
+class SoftwareBackend : public RenderBackend
+{
+public:
+	// The back buffer is width * height pixels and the viewport covers all of it, the same
+	// way CreateViewport() sets it up for Direct3D. Tiles are rasterised using as many threads
+	// as the hardware supports.
+	SoftwareBackend(unsigned int width, unsigned int height);
+	~SoftwareBackend() override;
+
+	BackendBuffer* CreateVertexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendBuffer* CreateIndexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendVertexShader* CreateVertexShader(const ShaderDesc& desc) override;
+	BackendPixelShader* CreatePixelShader(const ShaderDesc& desc) override;
+	BackendInputLayout* CreateInputLayout(const InputElementDesc* elements,
+		unsigned int elementCount, BackendVertexShader* vertexShader) override;
+	BackendBuffer* CreateDynamicBuffer(unsigned int byteWidth) override;
+	BackendBuffer* CreateConstantBuffer(unsigned int byteWidth) override;
+	bool SupportsConstantBufferOffsets() const override;
+	BackendRenderTarget* GetBackBuffer() override;
+
+	void ClearRenderTargetView(BackendRenderTarget* target, const float colour[4]) override;
+	void IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+		BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) override;
+	void IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset) override;
+	void IASetInputLayout(BackendInputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(PrimitiveTopology topology) override;
+	void VSSetShader(BackendVertexShader* shader) override;
+	void PSSetShader(BackendPixelShader* shader) override;
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+		const unsigned int* firstConstants, const unsigned int* constantCounts) override;
+	void* Map(BackendBuffer* buffer, MapMode mode) override;
+	void Unmap(BackendBuffer* buffer) override;
+	void UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+		const void* data, unsigned int size) override;
+	void Draw(unsigned int vertexCount, unsigned int startVertexLocation) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation) override;
+	void DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+		unsigned int startVertexLocation, unsigned int startInstanceLocation) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+		unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation) override;
+	void Present() override;
+	unsigned long long InsertFence() override;
+	unsigned long long GetCompletedFence() override;
+
+	// Selects the instruction set used to rasterise triangles. The fastest one supported is
+	// used by default. Returns false, keeping the current one, if isa isn't supported.
+	bool SetRasteriserISA(RasteriserISA isa);
+
+	// Constant buffers can always be bound with offsets, but the backend can claim otherwise
+	// so the path taken on older Direct3D runtimes can be tested.
+	void SetConstantBufferOffsetsSupported(bool supported);
+	RasteriserISA GetRasteriserISA() const;
+
+	// Sets the number of threads rasterising tiles, counting the thread flushing.
+	void SetThreadCount(unsigned int threadCount);
+	unsigned int GetThreadCount() const;
+
+	// Rasterises everything cleared and drawn since the last flush. Present() flushes, so this
+	// is only needed to read the back buffer of a frame that hasn't been presented. Within each
+	// tile, clears and triangles are applied in the order they were issued, so the result is
+	// the same regardless of the number of threads.
+	void Flush();
+
+	// The back buffer holds width * height pixels of four bytes each (R, G, B, A), stored
+	// row by row starting at the top left corner.
+	const unsigned char* GetBackBufferData() const;
+	unsigned int GetWidth() const;
+	unsigned int GetHeight() const;
+
+	const SoftwareStatistics& GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	// A triangle waiting in the tile bins. The attribute pointers of the set up triangle are
+	// filled in when flushing, as mVertices may grow (and move) until then.
+	struct BinnedTriangle
+	{
+		RasteriserTriangle triangle;
+		unsigned int vertices[3];	// Indices into mVertices.
+		const SoftwareShader* pixelShader;
+	};
+
+	// Tile bins hold indices into mTriangles, or into mClearValues if TILE_CLEAR_COMMAND is set.
+	static const unsigned int TILE_CLEAR_COMMAND = 0x80000000;
+
+	// Runs the vertex shader for the vertices of one instance of a draw, adding the results to
+	// mVertices. firstVertex is set to the index of the first one.
+	bool ShadeVertices(unsigned int vertexCount, unsigned int startVertexLocation,
+		unsigned int startInstanceLocation, unsigned int instance, unsigned int& firstVertex);
+	// Copies the constants of the bound constant buffers to mConstants.
+	void GatherConstants();
+	void BinTriangle(unsigned int v0, unsigned int v1, unsigned int v2);
+	// Runs the commands binned into a tile. Returns the number of pixels shaded.
+	unsigned long long RasteriseTile(unsigned int tileIndex);
+
+	unsigned int mWidth;
+	unsigned int mHeight;
+	BackendRenderTarget* mBackBuffer;
+
+	// Bound state.
+	BackendBuffer* mVertexBuffers[SOFTWARE_MAX_VERTEX_BUFFERS];
+	unsigned int mStrides[SOFTWARE_MAX_VERTEX_BUFFERS];
+	unsigned int mOffsets[SOFTWARE_MAX_VERTEX_BUFFERS];
+	BackendBuffer* mIndexBuffer;
+	IndexFormat mIndexFormat;
+	unsigned int mIndexOffset;
+	BackendInputLayout* mInputLayout;
+	PrimitiveTopology mTopology;
+	BackendVertexShader* mVertexShader;
+	BackendPixelShader* mPixelShader;
+	BackendBuffer* mConstantBuffers[SOFTWARE_MAX_CONSTANT_BUFFERS];
+	unsigned int mFirstConstants[SOFTWARE_MAX_CONSTANT_BUFFERS];
+	unsigned int mConstantCounts[SOFTWARE_MAX_CONSTANT_BUFFERS];
+
+	// The constants the vertex shader sees. They are gathered again before a draw whenever a
+	// constant buffer has been bound or any buffer written since the last time.
+	SoftwareConstants mConstants;
+	bool mConstantsDirty;
+	bool mConstantBufferOffsets;
+
+	unsigned long long mFence;	// The value of the last fence inserted.
+
+	RasteriserISA mRasteriserISA;
+	RasteriseFunction mRasterise;
+
+	std::unique_ptr<ThreadPool> mThreadPool;
+	unsigned int mTilesX;
+	unsigned int mTilesY;
+
+	// Work recorded since the last flush. The vectors keep their memory between frames.
+	std::vector<std::vector<unsigned int>> mTileBins;
+	std::vector<BinnedTriangle> mTriangles;
+	std::vector<unsigned int> mClearValues;		// RGBA8 clear colours.
+	std::vector<SoftwareVSOutput> mVertices;
+	std::vector<unsigned int> mIndices;		// The indices of the current indexed draw.
+
+	SoftwareStatistics mStatistics;
+};
@@ -0,0 +1,305 @@
+// ###########################################################################################
+// ## Triangle setup, the scalar reference rasteriser and runtime selection of the SIMD
+// ## rasterisers. Triangles follow the Direct3D 11 rasterisation rules: pixel centres at .5,
+// ## the top-left fill rule and clockwise front faces.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "SoftwareRasteriser.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if SOFTWARE_RASTERISER_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// The edge function: twice the signed area of the triangle (a, b, p). Positive when p lies to
+// the right of a -> b in screen space (y pointing down). The SIMD rasterisers evaluate it
+// with the same operations in the same order, so they agree with this one on every pixel.
+static float EdgeFunction(float ax, float ay, float bx, float by, float px, float py)
+{
+	return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// Direct3D's top-left rule: pixels exactly on an edge are only drawn if it is a top edge (a
+// horizontal edge above the other vertex) or a left edge. With the clockwise winding of
+// front faces, top edges go right and left edges go up.
+static bool IsTopLeftEdge(float ax, float ay, float bx, float by)
+{
+	return (ay == by && bx > ax) || (by < ay);
+}
+
+bool SetupTriangle(const SoftwareVSOutput& v0, const SoftwareVSOutput& v1,
+	const SoftwareVSOutput& v2, unsigned int attributeCount, unsigned int width,
+	unsigned int height, RasteriserTriangle& triangle)
+{
+	const SoftwareVSOutput* vertices[3] = { &v0, &v1, &v2 };
+
+	// There is no clipping, so triangles reaching behind the eye are skipped rather than
+	// drawn wrongly. The samples only draw triangles with w = 1.
+	if (v0.position.w <= 0.0f || v1.position.w <= 0.0f || v2.position.w <= 0.0f)
+		return false;
+
+	// Perspective divide and viewport transform, with y flipped to point down.
+	for (int i = 0; i < 3; ++i)
+	{
+		triangle.invW[i] = 1.0f / vertices[i]->position.w;
+		triangle.x[i] = (vertices[i]->position.x * triangle.invW[i] * 0.5f + 0.5f) * width;
+		triangle.y[i] = (0.5f - vertices[i]->position.y * triangle.invW[i] * 0.5f) * height;
+		triangle.attributes[i] = vertices[i]->attributes;
+	}
+
+	// Front faces are clockwise on screen, which gives a positive area. Cull the rest.
+	const float* x = triangle.x;
+	const float* y = triangle.y;
+	float area = EdgeFunction(x[0], y[0], x[1], y[1], x[2], y[2]);
+	if (area <= 0.0f)
+		return false;
+
+	triangle.invArea = 1.0f / area;
+	triangle.attributeCount = attributeCount;
+
+	// Edge i is the one opposite vertex i, so its value is the barycentric weight of vertex i.
+	triangle.topLeft[0] = IsTopLeftEdge(x[1], y[1], x[2], y[2]);
+	triangle.topLeft[1] = IsTopLeftEdge(x[2], y[2], x[0], y[0]);
+	triangle.topLeft[2] = IsTopLeftEdge(x[0], y[0], x[1], y[1]);
+
+	// The pixels whose centres may be covered, clamped to the viewport.
+	triangle.minX = std::max(static_cast<int>(std::floor(std::min(x[0], std::min(x[1], x[2])))), 0);
+	triangle.minY = std::max(static_cast<int>(std::floor(std::min(y[0], std::min(y[1], y[2])))), 0);
+	triangle.maxX = std::min(static_cast<int>(std::ceil(std::max(x[0], std::max(x[1], x[2])))), static_cast<int>(width) - 1);
+	triangle.maxY = std::min(static_cast<int>(std::ceil(std::max(y[0], std::max(y[1], y[2])))), static_cast<int>(height) - 1);
+
+	return triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY;
+}
+
+bool TriangleOverlapsRect(const RasteriserTriangle& triangle, int minX, int minY, int maxX, int maxY)
+{
+	if (triangle.maxX < minX || triangle.minX > maxX || triangle.maxY < minY || triangle.minY > maxY)
+		return false;
+
+	// The edge functions are linear, so their largest value over the rectangle is found at one
+	// of its corners. If an edge is negative at all four, no pixel centre is inside.
+	const float left = minX + 0.5f;
+	const float right = maxX + 0.5f;
+	const float top = minY + 0.5f;
+	const float bottom = maxY + 0.5f;
+	const float* x = triangle.x;
+	const float* y = triangle.y;
+	for (int i = 0; i < 3; ++i)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		float largest = std::max(
+			std::max(EdgeFunction(x[a], y[a], x[b], y[b], left, top), EdgeFunction(x[a], y[a], x[b], y[b], right, top)),
+			std::max(EdgeFunction(x[a], y[a], x[b], y[b], left, bottom), EdgeFunction(x[a], y[a], x[b], y[b], right, bottom)));
+		if (largest < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+unsigned int RasteriseTriangleScalar(const RasteriserTriangle& triangle,
+	const RasteriserTarget& target, const SoftwareShader* pixelShader)
+{
+	const int minX = std::max(triangle.minX, target.minX);
+	const int minY = std::max(triangle.minY, target.minY);
+	const int maxX = std::min(triangle.maxX, target.maxX);
+	const int maxY = std::min(triangle.maxY, target.maxY);
+	const float* x = triangle.x;
+	const float* y = triangle.y;
+
+	unsigned int pixelsShaded = 0;
+	Float4 attributes[SOFTWARE_MAX_ATTRIBUTES];
+	for (int py = minY; py <= maxY; ++py)
+	{
+		float cy = py + 0.5f;
+		unsigned char* row = target.pixels + static_cast<size_t>(py) * target.pitch;
+		for (int px = minX; px <= maxX; ++px)
+		{
+			float cx = px + 0.5f;
+			float e[3] =
+			{
+				EdgeFunction(x[1], y[1], x[2], y[2], cx, cy),
+				EdgeFunction(x[2], y[2], x[0], y[0], cx, cy),
+				EdgeFunction(x[0], y[0], x[1], y[1], cx, cy),
+			};
+
+			bool inside = true;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (e[i] < 0.0f || (e[i] == 0.0f && !triangle.topLeft[i]))
+					inside = false;
+			}
+
+			if (!inside)
+				continue;
+
+			// Perspective correct interpolation: interpolate attribute / w and 1 / w linearly
+			// in screen space, then divide.
+			float b[3];
+			float oneOverW = 0.0f;
+			for (int i = 0; i < 3; ++i)
+			{
+				b[i] = e[i] * triangle.invArea * triangle.invW[i];
+				oneOverW += b[i];
+			}
+
+			float w = 1.0f / oneOverW;
+			for (unsigned int a = 0; a < triangle.attributeCount; ++a)
+			{
+				const Float4& a0 = triangle.attributes[0][a];
+				const Float4& a1 = triangle.attributes[1][a];
+				const Float4& a2 = triangle.attributes[2][a];
+				attributes[a] = Float4(
+					(a0.x * b[0] + a1.x * b[1] + a2.x * b[2]) * w,
+					(a0.y * b[0] + a1.y * b[1] + a2.y * b[2]) * w,
+					(a0.z * b[0] + a1.z * b[1] + a2.z * b[2]) * w,
+					(a0.w * b[0] + a1.w * b[1] + a2.w * b[2]) * w);
+			}
+
+			Float4 colour = pixelShader->pixelShader(attributes);
+			unsigned char* pixel = row + static_cast<size_t>(px) * 4;
+			pixel[0] = ToUnorm8(colour.x);
+			pixel[1] = ToUnorm8(colour.y);
+			pixel[2] = ToUnorm8(colour.z);
+			pixel[3] = ToUnorm8(colour.w);
+			++pixelsShaded;
+		}
+	}
+
+	return pixelsShaded;
+}
+
+void ShadePixelBlock(const SoftwareShader* pixelShader, SoftwarePixelBlock& block,
+	unsigned int laneMask, unsigned int attributeCount)
+{
+	if (pixelShader->pixelShaderBlock != nullptr)
+	{
+		pixelShader->pixelShaderBlock(block);
+		return;
+	}
+
+	// Without a block version, run the regular shader one covered pixel at a time.
+	Float4 attributes[SOFTWARE_MAX_ATTRIBUTES];
+	for (unsigned int lane = 0; lane < SOFTWARE_BLOCK_WIDTH; ++lane)
+	{
+		if ((laneMask & (1u << lane)) == 0)
+			continue;
+
+		for (unsigned int a = 0; a < attributeCount; ++a)
+		{
+			attributes[a] = Float4(block.attributes[a][0][lane], block.attributes[a][1][lane],
+				block.attributes[a][2][lane], block.attributes[a][3][lane]);
+		}
+
+		Float4 colour = pixelShader->pixelShader(attributes);
+		block.colour[0][lane] = colour.x;
+		block.colour[1][lane] = colour.y;
+		block.colour[2][lane] = colour.z;
+		block.colour[3][lane] = colour.w;
+	}
+}
+
+#if SOFTWARE_RASTERISER_X86
+static void CpuId(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex(reinterpret_cast<int*>(registers), static_cast<int>(leaf), static_cast<int>(subleaf));
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Reads the XCR0 register, telling which register states the operating system saves.
+static unsigned long long ReadXCR0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax;
+	unsigned int edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+RasteriserISA DetectRasteriserISA()
+{
+#if SOFTWARE_RASTERISER_X86
+	unsigned int registers[4];	// eax, ebx, ecx, edx
+	CpuId(0, 0, registers);
+	const unsigned int maxLeaf = registers[0];
+
+	CpuId(1, 0, registers);
+	const bool sse41 = (registers[2] & (1u << 19)) != 0;
+	const bool osxsave = (registers[2] & (1u << 27)) != 0;
+	const bool avx = (registers[2] & (1u << 28)) != 0;
+
+	// AVX2 needs both the CPU to support it and the OS to save the ymm registers.
+	if (avx && osxsave && (ReadXCR0() & 0x6) == 0x6 && maxLeaf >= 7)
+	{
+		CpuId(7, 0, registers);
+		if ((registers[1] & (1u << 5)) != 0)
+			return RasteriserISA::AVX2;
+	}
+
+	if (sse41)
+		return RasteriserISA::SSE41;
+#endif
+
+	return RasteriserISA::Scalar;
+}
+
+bool IsRasteriserISASupported(RasteriserISA isa)
+{
+	return static_cast<int>(isa) <= static_cast<int>(DetectRasteriserISA());
+}
+
+RasteriseFunction GetRasteriseFunction(RasteriserISA isa)
+{
+	switch (isa)
+	{
+#if SOFTWARE_RASTERISER_X86
+	case RasteriserISA::SSE41: return RasteriseTriangleSSE41;
+	case RasteriserISA::AVX2: return RasteriseTriangleAVX2;
+#endif
+	default: return RasteriseTriangleScalar;
+	}
+}
+
+const char* GetRasteriserISAName(RasteriserISA isa)
+{
+	switch (isa)
+	{
+	case RasteriserISA::Scalar: return "Scalar";
+	case RasteriserISA::SSE41: return "SSE4.1";
+	case RasteriserISA::AVX2: return "AVX2";
+	}
+
+	return "Unknown";
+}
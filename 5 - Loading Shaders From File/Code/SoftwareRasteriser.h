@@ -0,0 +1,123 @@
+// ###########################################################################################
+// ## Triangle rasterisation for the SoftwareBackend. Triangles are set up once and can then
+// ## be rasterised by a scalar reference implementation or by SSE4.1 (4 pixels at a time)
+// ## and AVX2 (8 pixels at a time) versions, picked at runtime depending on the CPU.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "SoftwareShaders.h"
+
+// The SIMD versions are only available when compiling for x86 or x64.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SOFTWARE_RASTERISER_X86 1
+#else
+#define SOFTWARE_RASTERISER_X86 0
+#endif
+
+// GCC and Clang need to be told which instruction set a function may use, while Visual Studio
+// lets any function use any intrinsic.
+#if defined(__GNUC__)
+#define RASTERISER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RASTERISER_TARGET(isa)
+#endif
+
+// The instruction sets a triangle can be rasterised with, from slowest to fastest.
+enum class RasteriserISA
+{
+	Scalar,
+	SSE41,
+	AVX2,
+};
+
+// A triangle ready to be rasterised: in screen space (pixels, y pointing down), known to be
+// front facing and with the bounding box of the pixels it may cover.
+struct RasteriserTriangle
+{
+	float x[3];
+	float y[3];
+	float invW[3];		// 1 / w of each vertex, for perspective correct interpolation.
+	float invArea;		// 1 / (twice the area of the triangle).
+	bool topLeft[3];	// Whether the edge opposite each vertex is a top or left edge.
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+	const Float4* attributes[3];
+	unsigned int attributeCount;
+};
+
+// The pixels a triangle is rasterised into. Only pixels inside [minX, maxX] x [minY, maxY]
+// are written, which is used to clip to the viewport or to a part of it.
+struct RasteriserTarget
+{
+	unsigned char* pixels;	// RGBA8, row by row from the top left corner.
+	unsigned int pitch;		// The number of bytes between the starts of two rows.
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+};
+
+// Rasterises a triangle, shading the covered pixels with the given pixel shader. Returns the
+// number of pixels shaded.
+typedef unsigned int (*RasteriseFunction)(const RasteriserTriangle& triangle,
+	const RasteriserTarget& target, const SoftwareShader* pixelShader);
+
+// Projects the vertices to a width * height viewport and fills in the triangle. Returns false
+// if the triangle is back facing, degenerate or reaches behind the eye (w <= 0), in which case
+// it should not be drawn.
+bool SetupTriangle(const SoftwareVSOutput& v0, const SoftwareVSOutput& v1,
+	const SoftwareVSOutput& v2, unsigned int attributeCount, unsigned int width,
+	unsigned int height, RasteriserTriangle& triangle);
+
+// Conservatively tests whether the triangle may cover any pixel centre in the rectangle
+// [minX, maxX] x [minY, maxY]. Used when binning triangles into tiles.
+bool TriangleOverlapsRect(const RasteriserTriangle& triangle, int minX, int minY, int maxX, int maxY);
+
+unsigned int RasteriseTriangleScalar(const RasteriserTriangle& triangle,
+	const RasteriserTarget& target, const SoftwareShader* pixelShader);
+#if SOFTWARE_RASTERISER_X86
+unsigned int RasteriseTriangleSSE41(const RasteriserTriangle& triangle,
+	const RasteriserTarget& target, const SoftwareShader* pixelShader);
+unsigned int RasteriseTriangleAVX2(const RasteriserTriangle& triangle,
+	const RasteriserTarget& target, const SoftwareShader* pixelShader);
+#endif
+
+// Runs the pixel shader for the lanes of the block set in laneMask, using the shader's block
+// version if it has one. Used by the SIMD rasterisers.
+void ShadePixelBlock(const SoftwareShader* pixelShader, SoftwarePixelBlock& block,
+	unsigned int laneMask, unsigned int attributeCount);
+
+// Returns the fastest instruction set supported by the CPU (and operating system).
+RasteriserISA DetectRasteriserISA();
+bool IsRasteriserISASupported(RasteriserISA isa);
+RasteriseFunction GetRasteriseFunction(RasteriserISA isa);
+const char* GetRasteriserISAName(RasteriserISA isa);
+
+// Converts a colour channel from [0, 1] to [0, 255]. The comparisons are written to match
+// what the SIMD max/min instructions do, so all instruction sets give the same result.
+inline unsigned char ToUnorm8(float value)
+{
+	value = value > 0.0f ? value : 0.0f;
+	value = value < 1.0f ? value : 1.0f;
+	return static_cast<unsigned char>(value * 255.0f + 0.5f);
+}
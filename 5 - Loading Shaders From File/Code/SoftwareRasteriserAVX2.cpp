@@ -0,0 +1,155 @@
+// ###########################################################################################
+// ## The AVX2 rasteriser: walks the triangle's bounding box eight pixels at a time,
+// ## evaluating the edge functions and interpolating the attributes for all eight at once.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "SoftwareRasteriser.h"
+
+#if SOFTWARE_RASTERISER_X86
+
+#include <algorithm>
+#include <immintrin.h>
+
+RASTERISER_TARGET("avx2")
+unsigned int RasteriseTriangleAVX2(const RasteriserTriangle& triangle,
+	const RasteriserTarget& target, const SoftwareShader* pixelShader)
+{
+	const int minX = std::max(triangle.minX, target.minX);
+	const int minY = std::max(triangle.minY, target.minY);
+	const int maxX = std::min(triangle.maxX, target.maxX);
+	const int maxY = std::min(triangle.maxY, target.maxY);
+	if (minX > maxX || minY > maxY)
+		return 0;
+
+	// Edge i goes from vertex i + 1 to vertex i + 2 and is evaluated as
+	// (bx - ax) * (py - ay) - (by - ay) * (px - ax), exactly like the scalar rasteriser.
+	__m256 edgeAX[3];
+	__m256 edgeAY[3];
+	__m256 edgeDX[3];
+	__m256 edgeDY[3];
+	__m256 edgeTopLeft[3];
+	__m256 invW[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		edgeAX[i] = _mm256_set1_ps(triangle.x[a]);
+		edgeAY[i] = _mm256_set1_ps(triangle.y[a]);
+		edgeDX[i] = _mm256_set1_ps(triangle.x[b] - triangle.x[a]);
+		edgeDY[i] = _mm256_set1_ps(triangle.y[b] - triangle.y[a]);
+		edgeTopLeft[i] = _mm256_castsi256_ps(_mm256_set1_epi32(triangle.topLeft[i] ? -1 : 0));
+		invW[i] = _mm256_set1_ps(triangle.invW[i]);
+	}
+
+	const __m256 invArea = _mm256_set1_ps(triangle.invArea);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 unormScale = _mm256_set1_ps(255.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 laneOffset = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 lastCentreX = _mm256_set1_ps(maxX + 0.5f);
+
+	unsigned int pixelsShaded = 0;
+	SoftwarePixelBlock block;
+	for (int py = minY; py <= maxY; ++py)
+	{
+		const __m256 cy = _mm256_set1_ps(py + 0.5f);
+		__m256 rowTerm[3];
+		for (int i = 0; i < 3; ++i)
+			rowTerm[i] = _mm256_mul_ps(edgeDX[i], _mm256_sub_ps(cy, edgeAY[i]));
+
+		unsigned char* row = target.pixels + static_cast<size_t>(py) * target.pitch;
+		for (int px = minX; px <= maxX; px += 8)
+		{
+			const __m256 cx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(px)), laneOffset);
+
+			// A pixel is inside if all edge functions are positive, or zero on a top-left edge.
+			__m256 e[3];
+			__m256 inside = _mm256_cmp_ps(cx, lastCentreX, _CMP_LE_OQ);
+			for (int i = 0; i < 3; ++i)
+			{
+				e[i] = _mm256_sub_ps(rowTerm[i], _mm256_mul_ps(edgeDY[i], _mm256_sub_ps(cx, edgeAX[i])));
+				__m256 edgeInside = _mm256_blendv_ps(_mm256_cmp_ps(e[i], zero, _CMP_GT_OQ), _mm256_cmp_ps(e[i], zero, _CMP_GE_OQ), edgeTopLeft[i]);
+				inside = _mm256_and_ps(inside, edgeInside);
+			}
+
+			const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(inside));
+			if (mask == 0)
+				continue;
+
+			// Perspective correct barycentric weights, see RasteriseTriangleScalar().
+			__m256 b[3];
+			for (int i = 0; i < 3; ++i)
+				b[i] = _mm256_mul_ps(_mm256_mul_ps(e[i], invArea), invW[i]);
+			const __m256 w = _mm256_div_ps(one, _mm256_add_ps(_mm256_add_ps(b[0], b[1]), b[2]));
+
+			for (unsigned int a = 0; a < triangle.attributeCount; ++a)
+			{
+				const float* a0 = &triangle.attributes[0][a].x;
+				const float* a1 = &triangle.attributes[1][a].x;
+				const float* a2 = &triangle.attributes[2][a].x;
+				for (int c = 0; c < 4; ++c)
+				{
+					__m256 value = _mm256_add_ps(
+						_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a0[c]), b[0]), _mm256_mul_ps(_mm256_set1_ps(a1[c]), b[1])),
+						_mm256_mul_ps(_mm256_set1_ps(a2[c]), b[2]));
+					_mm256_storeu_ps(block.attributes[a][c], _mm256_mul_ps(value, w));
+				}
+			}
+
+			ShadePixelBlock(pixelShader, block, mask, triangle.attributeCount);
+
+			// Convert the colours to RGBA8 and pack the four channels of each pixel together.
+			__m256i channels[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				__m256 channel = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(block.colour[c]), zero), one);
+				channels[c] = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(channel, unormScale), half));
+			}
+
+			__m256i packed = _mm256_or_si256(
+				_mm256_or_si256(channels[0], _mm256_slli_epi32(channels[1], 8)),
+				_mm256_or_si256(_mm256_slli_epi32(channels[2], 16), _mm256_slli_epi32(channels[3], 24)));
+
+			unsigned char* pixels = row + static_cast<size_t>(px) * 4;
+			if (mask == 0xFF)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels), packed);
+			}
+			else
+			{
+				unsigned int lanes[8];
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), packed);
+				for (int lane = 0; lane < 8; ++lane)
+				{
+					if ((mask & (1u << lane)) != 0)
+						reinterpret_cast<unsigned int*>(pixels)[lane] = lanes[lane];
+				}
+			}
+
+			for (unsigned int m = mask; m != 0; m &= m - 1)
+				++pixelsShaded;
+		}
+	}
+
+	return pixelsShaded;
+}
+
+#endif
@@ -0,0 +1,155 @@
+// ###########################################################################################
+// ## The SSE4.1 rasteriser: walks the triangle's bounding box four pixels at a time,
+// ## evaluating the edge functions and interpolating the attributes for all four at once.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "SoftwareRasteriser.h"
+
+#if SOFTWARE_RASTERISER_X86
+
+#include <algorithm>
+#include <immintrin.h>
+
+RASTERISER_TARGET("sse4.1")
+unsigned int RasteriseTriangleSSE41(const RasteriserTriangle& triangle,
+	const RasteriserTarget& target, const SoftwareShader* pixelShader)
+{
+	const int minX = std::max(triangle.minX, target.minX);
+	const int minY = std::max(triangle.minY, target.minY);
+	const int maxX = std::min(triangle.maxX, target.maxX);
+	const int maxY = std::min(triangle.maxY, target.maxY);
+	if (minX > maxX || minY > maxY)
+		return 0;
+
+	// Edge i goes from vertex i + 1 to vertex i + 2 and is evaluated as
+	// (bx - ax) * (py - ay) - (by - ay) * (px - ax), exactly like the scalar rasteriser.
+	__m128 edgeAX[3];
+	__m128 edgeAY[3];
+	__m128 edgeDX[3];
+	__m128 edgeDY[3];
+	__m128 edgeTopLeft[3];
+	__m128 invW[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		edgeAX[i] = _mm_set1_ps(triangle.x[a]);
+		edgeAY[i] = _mm_set1_ps(triangle.y[a]);
+		edgeDX[i] = _mm_set1_ps(triangle.x[b] - triangle.x[a]);
+		edgeDY[i] = _mm_set1_ps(triangle.y[b] - triangle.y[a]);
+		edgeTopLeft[i] = _mm_castsi128_ps(_mm_set1_epi32(triangle.topLeft[i] ? -1 : 0));
+		invW[i] = _mm_set1_ps(triangle.invW[i]);
+	}
+
+	const __m128 invArea = _mm_set1_ps(triangle.invArea);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 unormScale = _mm_set1_ps(255.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 lastCentreX = _mm_set1_ps(maxX + 0.5f);
+
+	unsigned int pixelsShaded = 0;
+	SoftwarePixelBlock block;
+	for (int py = minY; py <= maxY; ++py)
+	{
+		const __m128 cy = _mm_set1_ps(py + 0.5f);
+		__m128 rowTerm[3];
+		for (int i = 0; i < 3; ++i)
+			rowTerm[i] = _mm_mul_ps(edgeDX[i], _mm_sub_ps(cy, edgeAY[i]));
+
+		unsigned char* row = target.pixels + static_cast<size_t>(py) * target.pitch;
+		for (int px = minX; px <= maxX; px += 4)
+		{
+			const __m128 cx = _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), laneOffset);
+
+			// A pixel is inside if all edge functions are positive, or zero on a top-left edge.
+			__m128 e[3];
+			__m128 inside = _mm_cmple_ps(cx, lastCentreX);
+			for (int i = 0; i < 3; ++i)
+			{
+				e[i] = _mm_sub_ps(rowTerm[i], _mm_mul_ps(edgeDY[i], _mm_sub_ps(cx, edgeAX[i])));
+				__m128 edgeInside = _mm_blendv_ps(_mm_cmpgt_ps(e[i], zero), _mm_cmpge_ps(e[i], zero), edgeTopLeft[i]);
+				inside = _mm_and_ps(inside, edgeInside);
+			}
+
+			const unsigned int mask = static_cast<unsigned int>(_mm_movemask_ps(inside));
+			if (mask == 0)
+				continue;
+
+			// Perspective correct barycentric weights, see RasteriseTriangleScalar().
+			__m128 b[3];
+			for (int i = 0; i < 3; ++i)
+				b[i] = _mm_mul_ps(_mm_mul_ps(e[i], invArea), invW[i]);
+			const __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(b[0], b[1]), b[2]));
+
+			for (unsigned int a = 0; a < triangle.attributeCount; ++a)
+			{
+				const float* a0 = &triangle.attributes[0][a].x;
+				const float* a1 = &triangle.attributes[1][a].x;
+				const float* a2 = &triangle.attributes[2][a].x;
+				for (int c = 0; c < 4; ++c)
+				{
+					__m128 value = _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0[c]), b[0]), _mm_mul_ps(_mm_set1_ps(a1[c]), b[1])),
+						_mm_mul_ps(_mm_set1_ps(a2[c]), b[2]));
+					_mm_storeu_ps(block.attributes[a][c], _mm_mul_ps(value, w));
+				}
+			}
+
+			ShadePixelBlock(pixelShader, block, mask, triangle.attributeCount);
+
+			// Convert the colours to RGBA8 and pack the four channels of each pixel together.
+			__m128i channels[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				__m128 channel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(block.colour[c]), zero), one);
+				channels[c] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channel, unormScale), half));
+			}
+
+			__m128i packed = _mm_or_si128(
+				_mm_or_si128(channels[0], _mm_slli_epi32(channels[1], 8)),
+				_mm_or_si128(_mm_slli_epi32(channels[2], 16), _mm_slli_epi32(channels[3], 24)));
+
+			unsigned char* pixels = row + static_cast<size_t>(px) * 4;
+			if (mask == 0xF)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), packed);
+			}
+			else
+			{
+				unsigned int lanes[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), packed);
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					if ((mask & (1u << lane)) != 0)
+						reinterpret_cast<unsigned int*>(pixels)[lane] = lanes[lane];
+				}
+			}
+
+			for (unsigned int m = mask; m != 0; m &= m - 1)
+				++pixelsShaded;
+		}
+	}
+
+	return pixelsShaded;
+}
+
+#endif
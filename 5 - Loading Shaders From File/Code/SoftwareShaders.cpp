@@ -0,0 +1,112 @@
+// ###########################################################################################
+// ## C++ versions of the HLSL shaders in Resources/Shaders. When a shader file is changed,
+// ## the function here needs to be changed the same way.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "SoftwareShaders.h"
+#include "ConstantBuffers.h"
+
+#include <cstring>
+#include <cwchar>
+
+// The cbuffers of constants.hlsli, as they are laid out in the bound constants.
+static const Float4* ViewProjection(const SoftwareConstants& constants)
+{
+	return constants.buffers[CONSTANT_SLOT_VIEW];
+}
+
+static const Float4* World(const SoftwareConstants& constants)
+{
+	return constants.buffers[CONSTANT_SLOT_OBJECT];
+}
+
+// mul(matrix, point) for a row_major matrix with the given number of rows.
+static void Transform(const Float4* rows, unsigned int rowCount, const Float4& point, float* result)
+{
+	for (unsigned int row = 0; row < rowCount; ++row)
+		result[row] = rows[row].x * point.x + rows[row].y * point.y + rows[row].z * point.z + rows[row].w * point.w;
+}
+
+// vertexShader.hlsl: moves the position to world space by the object's world matrix and on to
+// clip space by the view-projection, and passes on the colour.
+static void VertexShaderMain(const Float4* input, const SoftwareConstants& constants, SoftwareVSOutput& output)
+{
+	float worldPosition[3];
+	Transform(World(constants), 3, Float4(input[0].x, input[0].y, input[0].z, 1.0f), worldPosition);
+	float clipPosition[4];
+	Transform(ViewProjection(constants), 4, Float4(worldPosition[0], worldPosition[1], worldPosition[2], 1.0f), clipPosition);
+	output.position = Float4(clipPosition[0], clipPosition[1], clipPosition[2], clipPosition[3]);
+	output.attributes[0] = input[1];
+}
+
+// instancedVertexShader.hlsl: moves the position by the instance's transform, given as three
+// rows, and on to clip space by the view-projection, and multiplies the colour by the
+// instance's tint.
+static void InstancedVertexShaderMain(const Float4* input, const SoftwareConstants& constants, SoftwareVSOutput& output)
+{
+	float worldPosition[3];
+	Transform(&input[2], 3, Float4(input[0].x, input[0].y, input[0].z, 1.0f), worldPosition);
+	float clipPosition[4];
+	Transform(ViewProjection(constants), 4, Float4(worldPosition[0], worldPosition[1], worldPosition[2], 1.0f), clipPosition);
+	output.position = Float4(clipPosition[0], clipPosition[1], clipPosition[2], clipPosition[3]);
+	output.attributes[0] = Float4(input[1].x * input[5].x, input[1].y * input[5].y, input[1].z * input[5].z, input[1].w * input[5].w);
+}
+
+// pixelShader.hlsl: returns the interpolated colour.
+static Float4 PixelShaderMain(const Float4* attributes)
+{
+	return attributes[0];
+}
+
+static void PixelShaderMainBlock(SoftwarePixelBlock& block)
+{
+	for (unsigned int c = 0; c < 4; ++c)
+	{
+		for (unsigned int lane = 0; lane < SOFTWARE_BLOCK_WIDTH; ++lane)
+			block.colour[c][lane] = block.attributes[0][c][lane];
+	}
+}
+
+static const SoftwareShader gSoftwareShaders[] =
+{
+	{ L"vertexShader.hlsl", "main", { "POSITION", "COLOR" }, 2, 1, VertexShaderMain, nullptr, nullptr },
+	{ L"instancedVertexShader.hlsl", "main", { "POSITION", "COLOR", "TRANSFORM0", "TRANSFORM1", "TRANSFORM2", "TINT" }, 6, 1,
+		InstancedVertexShaderMain, nullptr, nullptr },
+	{ L"pixelShader.hlsl", "main", { nullptr }, 0, 1, nullptr, PixelShaderMain, PixelShaderMainBlock },
+};
+
+const SoftwareShader* FindSoftwareShader(const wchar_t* path, const char* entryPoint)
+{
+	// Strip the folders, both kinds of slashes are accepted.
+	const wchar_t* fileName = path;
+	for (const wchar_t* c = path; *c != L'\0'; ++c)
+	{
+		if (*c == L'/' || *c == L'\\')
+			fileName = c + 1;
+	}
+
+	for (const SoftwareShader& shader : gSoftwareShaders)
+	{
+		if (wcscmp(shader.fileName, fileName) == 0 && strcmp(shader.entryPoint, entryPoint) == 0)
+			return &shader;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,89 @@
+// ###########################################################################################
+// ## C++ versions of the HLSL shaders in Resources/Shaders, run by the SoftwareBackend in
+// ## place of the compiled shaders as there is no GPU to run those on.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "MathTypes.h"
+
+// The maximum number of inputs a software vertex shader can take and the maximum number of
+// attributes (besides the position) it can pass on to the pixel shader.
+const unsigned int SOFTWARE_MAX_INPUTS = 8;
+const unsigned int SOFTWARE_MAX_ATTRIBUTES = 8;
+
+// The constant buffer slots a software vertex shader can read, and the constants it can read
+// from each.
+const unsigned int SOFTWARE_MAX_CONSTANT_BUFFERS = 4;
+const unsigned int SOFTWARE_MAX_CONSTANTS = 16;
+
+// The constants of the buffers bound when a draw is made, from the first constant of the range
+// bound. Constants past the end of the range, or of a slot with nothing bound, are zero, which
+// is what Direct3D returns for them.
+struct SoftwareConstants
+{
+	Float4 buffers[SOFTWARE_MAX_CONSTANT_BUFFERS][SOFTWARE_MAX_CONSTANTS];
+};
+
+// The output of a software vertex shader, i.e. the SV_POSITION and the attributes that are
+// interpolated over the triangle and handed to the pixel shader.
+struct SoftwareVSOutput
+{
+	Float4 position;
+	Float4 attributes[SOFTWARE_MAX_ATTRIBUTES];
+};
+
+// A vertex shader gets its inputs in the order they are declared in the shader, each one
+// expanded to four components the same way the input assembler does, and the bound constants.
+typedef void (*SoftwareVertexShaderFunction)(const Float4* input, const SoftwareConstants& constants, SoftwareVSOutput& output);
+
+// A pixel shader gets the interpolated attributes and returns the colour of the pixel.
+typedef Float4 (*SoftwarePixelShaderFunction)(const Float4* attributes);
+
+// The SIMD rasterisers shade pixels in blocks of up to SOFTWARE_BLOCK_WIDTH at a time. The
+// attributes and colours are stored one component at a time (structure of arrays), so that a
+// shader can work on every pixel of the block at once. Lanes of pixels not covered by the
+// triangle hold garbage, and a shader is free to write anything to them.
+const unsigned int SOFTWARE_BLOCK_WIDTH = 8;
+
+struct SoftwarePixelBlock
+{
+	float attributes[SOFTWARE_MAX_ATTRIBUTES][4][SOFTWARE_BLOCK_WIDTH];
+	float colour[4][SOFTWARE_BLOCK_WIDTH];
+};
+
+typedef void (*SoftwarePixelShaderBlockFunction)(SoftwarePixelBlock& block);
+
+// Ties a C++ shader to the HLSL file and entry point it replaces.
+struct SoftwareShader
+{
+	const wchar_t* fileName;	// The file name of the HLSL file, without any folders.
+	const char* entryPoint;
+	const char* inputSemantics[SOFTWARE_MAX_INPUTS];	// Vertex shader inputs, e.g. "POSITION".
+	unsigned int inputCount;
+	unsigned int attributeCount;	// The number of attributes passed from the VS to the PS.
+	SoftwareVertexShaderFunction vertexShader;	// Set for vertex shaders, otherwise nullptr.
+	SoftwarePixelShaderFunction pixelShader;	// Set for pixel shaders, otherwise nullptr.
+	SoftwarePixelShaderBlockFunction pixelShaderBlock;	// Optional block version of pixelShader.
+};
+
+// Finds the C++ version of the shader at the given path (the folders are ignored) with the
+// given entry point. Returns nullptr if there is none.
+const SoftwareShader* FindSoftwareShader(const wchar_t* path, const char* entryPoint);
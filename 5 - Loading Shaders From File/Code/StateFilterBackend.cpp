@@ -0,0 +1,406 @@
+// ###########################################################################################
+// ## A RenderBackend placed in front of another one, which only passes on the state binds that
+// ## change something, and binds them just before they are needed by a draw.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "StateFilterBackend.h"
+#include "PipelineState.h"
+
+#include <cstring>
+
+StateFilterBackend::StateFilterBackend(RenderBackend* backend)
+	: mBackend(backend)
+	, mAppliedKnown(false)
+{
+	memset(&mPending, 0, sizeof(mPending));
+	memset(&mApplied, 0, sizeof(mApplied));
+	memset(mBindCalls, 0, sizeof(mBindCalls));
+	ResetStatistics();
+}
+
+BackendBuffer* StateFilterBackend::CreateVertexBuffer(const void* data, unsigned int byteWidth)
+{
+	return mBackend->CreateVertexBuffer(data, byteWidth);
+}
+
+BackendBuffer* StateFilterBackend::CreateIndexBuffer(const void* data, unsigned int byteWidth)
+{
+	return mBackend->CreateIndexBuffer(data, byteWidth);
+}
+
+BackendVertexShader* StateFilterBackend::CreateVertexShader(const ShaderDesc& desc)
+{
+	return mBackend->CreateVertexShader(desc);
+}
+
+BackendPixelShader* StateFilterBackend::CreatePixelShader(const ShaderDesc& desc)
+{
+	return mBackend->CreatePixelShader(desc);
+}
+
+BackendInputLayout* StateFilterBackend::CreateInputLayout(const InputElementDesc* elements,
+	unsigned int elementCount, BackendVertexShader* vertexShader)
+{
+	return mBackend->CreateInputLayout(elements, elementCount, vertexShader);
+}
+
+BackendBuffer* StateFilterBackend::CreateDynamicBuffer(unsigned int byteWidth)
+{
+	return mBackend->CreateDynamicBuffer(byteWidth);
+}
+
+BackendBuffer* StateFilterBackend::CreateConstantBuffer(unsigned int byteWidth)
+{
+	return mBackend->CreateConstantBuffer(byteWidth);
+}
+
+bool StateFilterBackend::SupportsConstantBufferOffsets() const
+{
+	return mBackend->SupportsConstantBufferOffsets();
+}
+
+BackendRenderTarget* StateFilterBackend::GetBackBuffer()
+{
+	return mBackend->GetBackBuffer();
+}
+
+void StateFilterBackend::ClearRenderTargetView(BackendRenderTarget* target, const float colour[4])
+{
+	// Clearing doesn't depend on the bound state, so it is passed on straight away.
+	mBackend->ClearRenderTargetView(target, colour);
+}
+
+void StateFilterBackend::IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+	BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+{
+	++mStatistics.bindCalls;
+
+	if (startSlot + bufferCount > STATE_FILTER_MAX_VERTEX_BUFFERS)
+	{
+		// More slots than are tracked: pass the call on and stop trusting what is bound.
+		ApplyState();
+		mBackend->IASetVertexBuffers(startSlot, bufferCount, buffers, strides, offsets);
+		++mStatistics.bindsIssued;
+		mAppliedKnown = false;
+		return;
+	}
+
+	++mBindCalls[BIND_VERTEX_BUFFERS];
+
+	for (unsigned int i = 0; i < bufferCount; ++i)
+	{
+		VertexBufferBinding& binding = mPending.vertexBuffers[startSlot + i];
+		binding.buffer = buffers[i];
+		binding.stride = strides[i];
+		binding.offset = offsets[i];
+	}
+
+	if (startSlot + bufferCount > mPending.vertexBufferCount)
+		mPending.vertexBufferCount = startSlot + bufferCount;
+}
+
+void StateFilterBackend::IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset)
+{
+	++mStatistics.bindCalls;
+	++mBindCalls[BIND_INDEX_BUFFER];
+	mPending.indexBuffer = buffer;
+	mPending.indexFormat = format;
+	mPending.indexOffset = offset;
+}
+
+void StateFilterBackend::IASetInputLayout(BackendInputLayout* inputLayout)
+{
+	++mStatistics.bindCalls;
+	++mBindCalls[BIND_INPUT_LAYOUT];
+	mPending.inputLayout = inputLayout;
+	mPending.pipelineState = nullptr;
+}
+
+void StateFilterBackend::IASetPrimitiveTopology(PrimitiveTopology topology)
+{
+	++mStatistics.bindCalls;
+	++mBindCalls[BIND_TOPOLOGY];
+	mPending.topology = topology;
+	mPending.topologySet = true;
+	mPending.pipelineState = nullptr;
+}
+
+void StateFilterBackend::VSSetShader(BackendVertexShader* shader)
+{
+	++mStatistics.bindCalls;
+	++mBindCalls[BIND_VERTEX_SHADER];
+	mPending.vertexShader = shader;
+	mPending.pipelineState = nullptr;
+}
+
+void StateFilterBackend::PSSetShader(BackendPixelShader* shader)
+{
+	++mStatistics.bindCalls;
+	++mBindCalls[BIND_PIXEL_SHADER];
+	mPending.pixelShader = shader;
+	mPending.pipelineState = nullptr;
+}
+
+void StateFilterBackend::VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+	const unsigned int* firstConstants, const unsigned int* constantCounts)
+{
+	++mStatistics.bindCalls;
+
+	if (startSlot + bufferCount > STATE_FILTER_MAX_CONSTANT_BUFFERS)
+	{
+		ApplyState();
+		mBackend->VSSetConstantBuffers(startSlot, bufferCount, buffers, firstConstants, constantCounts);
+		++mStatistics.bindsIssued;
+		mAppliedKnown = false;
+		return;
+	}
+
+	++mBindCalls[BIND_CONSTANT_BUFFERS];
+
+	for (unsigned int i = 0; i < bufferCount; ++i)
+	{
+		ConstantBufferBinding& binding = mPending.constantBuffers[startSlot + i];
+		binding.buffer = buffers[i];
+		binding.firstConstant = firstConstants != nullptr ? firstConstants[i] : 0;
+		binding.constantCount = constantCounts != nullptr ? constantCounts[i] : 0;
+		binding.offset = firstConstants != nullptr;
+	}
+
+	if (startSlot + bufferCount > mPending.constantBufferCount)
+		mPending.constantBufferCount = startSlot + bufferCount;
+}
+
+// Writing to a buffer doesn't change what is bound, so it is passed on straight away. A draw
+// made after the write reads the new data either way.
+void* StateFilterBackend::Map(BackendBuffer* buffer, MapMode mode)
+{
+	return mBackend->Map(buffer, mode);
+}
+
+void StateFilterBackend::Unmap(BackendBuffer* buffer)
+{
+	mBackend->Unmap(buffer);
+}
+
+void StateFilterBackend::UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+	const void* data, unsigned int size)
+{
+	mBackend->UpdateDynamicBuffer(buffer, mode, offset, data, size);
+}
+
+void StateFilterBackend::SetPipelineState(const PipelineState* state)
+{
+	++mStatistics.bindCalls;
+
+	// Setting the same state again is one pointer compare. Otherwise its parts are set like
+	// the separate calls would, and only those that differ are passed on at the next draw.
+	if (state == mPending.pipelineState)
+	{
+		++mStatistics.bindsElided;
+		return;
+	}
+
+	mPending.inputLayout = state->GetInputLayout();
+	mPending.topology = state->GetTopology();
+	mPending.topologySet = true;
+	mPending.vertexShader = state->GetVertexShader();
+	mPending.pixelShader = state->GetPixelShader();
+	mPending.pipelineState = state;
+}
+
+void StateFilterBackend::Draw(unsigned int vertexCount, unsigned int startVertexLocation)
+{
+	ApplyState();
+	mBackend->Draw(vertexCount, startVertexLocation);
+}
+
+void StateFilterBackend::DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation)
+{
+	ApplyState();
+	mBackend->DrawIndexed(indexCount, startIndexLocation, baseVertexLocation);
+}
+
+void StateFilterBackend::DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+	unsigned int startVertexLocation, unsigned int startInstanceLocation)
+{
+	ApplyState();
+	mBackend->DrawInstanced(vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation);
+}
+
+void StateFilterBackend::DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+	unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation)
+{
+	ApplyState();
+	mBackend->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void StateFilterBackend::Present()
+{
+	mBackend->Present();
+}
+
+unsigned long long StateFilterBackend::InsertFence()
+{
+	return mBackend->InsertFence();
+}
+
+unsigned long long StateFilterBackend::GetCompletedFence()
+{
+	return mBackend->GetCompletedFence();
+}
+
+void StateFilterBackend::Invalidate()
+{
+	mAppliedKnown = false;
+}
+
+RenderBackend* StateFilterBackend::GetBackend() const
+{
+	return mBackend;
+}
+
+const StateFilterStatistics& StateFilterBackend::GetStatistics() const
+{
+	return mStatistics;
+}
+
+void StateFilterBackend::ResetStatistics()
+{
+	memset(&mStatistics, 0, sizeof(mStatistics));
+}
+
+void StateFilterBackend::ApplyState()
+{
+	// Find the range of vertex buffer slots that changed, and bind it with one call. Slots in
+	// between that didn't change are bound again, which is cheaper than another call.
+	unsigned int firstSlot = mPending.vertexBufferCount;
+	unsigned int lastSlot = 0;
+	for (unsigned int slot = 0; slot < mPending.vertexBufferCount; ++slot)
+	{
+		const VertexBufferBinding& pending = mPending.vertexBuffers[slot];
+		const VertexBufferBinding& applied = mApplied.vertexBuffers[slot];
+		if (!mAppliedKnown || pending.buffer != applied.buffer || pending.stride != applied.stride || pending.offset != applied.offset)
+		{
+			firstSlot = firstSlot < slot ? firstSlot : slot;
+			lastSlot = slot;
+		}
+	}
+
+	bool issued = firstSlot < mPending.vertexBufferCount;
+	if (issued)
+	{
+		BackendBuffer* buffers[STATE_FILTER_MAX_VERTEX_BUFFERS];
+		unsigned int strides[STATE_FILTER_MAX_VERTEX_BUFFERS];
+		unsigned int offsets[STATE_FILTER_MAX_VERTEX_BUFFERS];
+		for (unsigned int slot = firstSlot; slot <= lastSlot; ++slot)
+		{
+			buffers[slot - firstSlot] = mPending.vertexBuffers[slot].buffer;
+			strides[slot - firstSlot] = mPending.vertexBuffers[slot].stride;
+			offsets[slot - firstSlot] = mPending.vertexBuffers[slot].offset;
+			mApplied.vertexBuffers[slot] = mPending.vertexBuffers[slot];
+		}
+		mBackend->IASetVertexBuffers(firstSlot, lastSlot - firstSlot + 1, buffers, strides, offsets);
+	}
+	CountBind(BIND_VERTEX_BUFFERS, issued);
+
+	issued = !mAppliedKnown || mPending.indexBuffer != mApplied.indexBuffer ||
+		mPending.indexFormat != mApplied.indexFormat || mPending.indexOffset != mApplied.indexOffset;
+	if (issued)
+		mBackend->IASetIndexBuffer(mPending.indexBuffer, mPending.indexFormat, mPending.indexOffset);
+	CountBind(BIND_INDEX_BUFFER, issued);
+
+	issued = !mAppliedKnown || mPending.inputLayout != mApplied.inputLayout;
+	if (issued)
+		mBackend->IASetInputLayout(mPending.inputLayout);
+	CountBind(BIND_INPUT_LAYOUT, issued);
+
+	// There is no "no topology" to pass on, so it is only bound once it has been set.
+	issued = mPending.topologySet && (!mAppliedKnown || !mApplied.topologySet || mPending.topology != mApplied.topology);
+	if (issued)
+		mBackend->IASetPrimitiveTopology(mPending.topology);
+	CountBind(BIND_TOPOLOGY, issued);
+
+	issued = !mAppliedKnown || mPending.vertexShader != mApplied.vertexShader;
+	if (issued)
+		mBackend->VSSetShader(mPending.vertexShader);
+	CountBind(BIND_VERTEX_SHADER, issued);
+
+	issued = !mAppliedKnown || mPending.pixelShader != mApplied.pixelShader;
+	if (issued)
+		mBackend->PSSetShader(mPending.pixelShader);
+	CountBind(BIND_PIXEL_SHADER, issued);
+
+	// Constant buffers are bound like the vertex buffers. Offsets are only passed on if a slot
+	// in the range was bound with one; whole buffers in the same range are then bound from
+	// their start with as many constants as a shader can see.
+	firstSlot = mPending.constantBufferCount;
+	lastSlot = 0;
+	bool offsets = false;
+	for (unsigned int slot = 0; slot < mPending.constantBufferCount; ++slot)
+	{
+		const ConstantBufferBinding& pending = mPending.constantBuffers[slot];
+		const ConstantBufferBinding& applied = mApplied.constantBuffers[slot];
+		if (!mAppliedKnown || pending.buffer != applied.buffer || pending.offset != applied.offset ||
+			pending.firstConstant != applied.firstConstant || pending.constantCount != applied.constantCount)
+		{
+			firstSlot = firstSlot < slot ? firstSlot : slot;
+			lastSlot = slot;
+		}
+	}
+
+	issued = firstSlot < mPending.constantBufferCount;
+	if (issued)
+	{
+		BackendBuffer* buffers[STATE_FILTER_MAX_CONSTANT_BUFFERS];
+		unsigned int firstConstants[STATE_FILTER_MAX_CONSTANT_BUFFERS];
+		unsigned int constantCounts[STATE_FILTER_MAX_CONSTANT_BUFFERS];
+		for (unsigned int slot = firstSlot; slot <= lastSlot; ++slot)
+		{
+			const ConstantBufferBinding& pending = mPending.constantBuffers[slot];
+			buffers[slot - firstSlot] = pending.buffer;
+			firstConstants[slot - firstSlot] = pending.firstConstant;
+			constantCounts[slot - firstSlot] = pending.offset ? pending.constantCount : CONSTANT_BUFFER_MAX_CONSTANTS;
+			offsets = offsets || pending.offset;
+		}
+		mBackend->VSSetConstantBuffers(firstSlot, lastSlot - firstSlot + 1, buffers,
+			offsets ? firstConstants : nullptr, offsets ? constantCounts : nullptr);
+	}
+	CountBind(BIND_CONSTANT_BUFFERS, issued);
+
+	mApplied = mPending;
+	mAppliedKnown = true;
+}
+
+void StateFilterBackend::CountBind(BindKind kind, bool issued)
+{
+	// Every call made since the last draw that didn't lead to a call to the backend was elided.
+	if (issued)
+	{
+		++mStatistics.bindsIssued;
+		if (mBindCalls[kind] > 0)
+			mStatistics.bindsElided += mBindCalls[kind] - 1;
+	}
+	else
+	{
+		mStatistics.bindsElided += mBindCalls[kind];
+	}
+
+	mBindCalls[kind] = 0;
+}
@@ -0,0 +1,153 @@
+// ###########################################################################################
+// ## A RenderBackend placed in front of another one, which only passes on the state binds that
+// ## change something, and binds them just before they are needed by a draw.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "RenderBackend.h"
+
+const unsigned int STATE_FILTER_MAX_VERTEX_BUFFERS = 16;
+const unsigned int STATE_FILTER_MAX_CONSTANT_BUFFERS = 14;
+
+// Counters for the binds made through the filter.
+struct StateFilterStatistics
+{
+	unsigned long long bindCalls;		// The IASet*(), *SetShader(), VSSetConstantBuffers() and SetPipelineState() calls made to the filter.
+	unsigned long long bindsIssued;		// The calls passed on to the backend behind it. A pipeline state may need up to four.
+	unsigned long long bindsElided;		// Calls (or parts of a pipeline state) that didn't change anything, or were replaced before a draw.
+};
+
+// Binds are recorded and only passed on when a draw is made, and then only those that differ
+// from what the backend behind already has bound. Vertex and constant buffers set by several
+// calls are passed on as one call covering the slots that changed.
+//
+// Resources are compared by address, so a resource must not be deleted while it is bound and
+// replaced by a new one that may get the same address: create the new one first (see
+// EnableShaderHotReload() in Scene.cpp), or call Invalidate() after replacing it.
+class StateFilterBackend : public RenderBackend
+{
+public:
+	// The backend is not owned by the filter and must outlive it. Nothing is assumed to be bound
+	// to it yet.
+	explicit StateFilterBackend(RenderBackend* backend);
+
+	BackendBuffer* CreateVertexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendBuffer* CreateIndexBuffer(const void* data, unsigned int byteWidth) override;
+	BackendVertexShader* CreateVertexShader(const ShaderDesc& desc) override;
+	BackendPixelShader* CreatePixelShader(const ShaderDesc& desc) override;
+	BackendInputLayout* CreateInputLayout(const InputElementDesc* elements,
+		unsigned int elementCount, BackendVertexShader* vertexShader) override;
+	BackendBuffer* CreateDynamicBuffer(unsigned int byteWidth) override;
+	BackendBuffer* CreateConstantBuffer(unsigned int byteWidth) override;
+	bool SupportsConstantBufferOffsets() const override;
+	BackendRenderTarget* GetBackBuffer() override;
+
+	void ClearRenderTargetView(BackendRenderTarget* target, const float colour[4]) override;
+	void IASetVertexBuffers(unsigned int startSlot, unsigned int bufferCount,
+		BackendBuffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) override;
+	void IASetIndexBuffer(BackendBuffer* buffer, IndexFormat format, unsigned int offset) override;
+	void IASetInputLayout(BackendInputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(PrimitiveTopology topology) override;
+	void VSSetShader(BackendVertexShader* shader) override;
+	void PSSetShader(BackendPixelShader* shader) override;
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int bufferCount, BackendBuffer* const* buffers,
+		const unsigned int* firstConstants, const unsigned int* constantCounts) override;
+	void* Map(BackendBuffer* buffer, MapMode mode) override;
+	void Unmap(BackendBuffer* buffer) override;
+	void UpdateDynamicBuffer(BackendBuffer* buffer, MapMode mode, unsigned int offset,
+		const void* data, unsigned int size) override;
+	void SetPipelineState(const PipelineState* state) override;
+	void Draw(unsigned int vertexCount, unsigned int startVertexLocation) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndexLocation, int baseVertexLocation) override;
+	void DrawInstanced(unsigned int vertexCountPerInstance, unsigned int instanceCount,
+		unsigned int startVertexLocation, unsigned int startInstanceLocation) override;
+	void DrawIndexedInstanced(unsigned int indexCountPerInstance, unsigned int instanceCount,
+		unsigned int startIndexLocation, int baseVertexLocation, unsigned int startInstanceLocation) override;
+	void Present() override;
+	unsigned long long InsertFence() override;
+	unsigned long long GetCompletedFence() override;
+
+	// Forgets what the backend behind has bound, so every bind is passed on again at the next
+	// draw. Needed if the backend's state is changed other than through the filter.
+	void Invalidate();
+
+	RenderBackend* GetBackend() const;
+	const StateFilterStatistics& GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	struct VertexBufferBinding
+	{
+		BackendBuffer* buffer;
+		unsigned int stride;
+		unsigned int offset;
+	};
+
+	struct ConstantBufferBinding
+	{
+		BackendBuffer* buffer;
+		unsigned int firstConstant;
+		unsigned int constantCount;
+		bool offset;	// Whether it was bound with an offset, rather than whole.
+	};
+
+	// Everything the filter tracks, as set by the calls made to it (pending) or as last passed
+	// on to the backend (applied).
+	struct State
+	{
+		VertexBufferBinding vertexBuffers[STATE_FILTER_MAX_VERTEX_BUFFERS];
+		unsigned int vertexBufferCount;		// One past the highest slot ever set.
+		BackendBuffer* indexBuffer;
+		IndexFormat indexFormat;
+		unsigned int indexOffset;
+		BackendInputLayout* inputLayout;
+		PrimitiveTopology topology;
+		bool topologySet;
+		BackendVertexShader* vertexShader;
+		BackendPixelShader* pixelShader;
+		ConstantBufferBinding constantBuffers[STATE_FILTER_MAX_CONSTANT_BUFFERS];
+		unsigned int constantBufferCount;	// One past the highest slot ever set.
+		const PipelineState* pipelineState;	// The last pipeline state set, if its parts haven't been set separately since.
+	};
+
+	// The kinds of binds, counting the calls made to each since the last draw.
+	enum BindKind
+	{
+		BIND_VERTEX_BUFFERS,
+		BIND_INDEX_BUFFER,
+		BIND_INPUT_LAYOUT,
+		BIND_TOPOLOGY,
+		BIND_VERTEX_SHADER,
+		BIND_PIXEL_SHADER,
+		BIND_CONSTANT_BUFFERS,
+		BIND_KIND_COUNT,
+	};
+
+	void ApplyState();
+	void CountBind(BindKind kind, bool issued);
+
+	RenderBackend* mBackend;
+	State mPending;
+	State mApplied;
+	bool mAppliedKnown;		// False until the first draw and after Invalidate().
+	unsigned int mBindCalls[BIND_KIND_COUNT];
+	StateFilterStatistics mStatistics;
+};
@@ -0,0 +1,113 @@
+// ###########################################################################################
+// ## A simple pool of worker threads, used to spread work such as rasterising the tiles of
+// ## the back buffer over all cores.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <string>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+	: mFunction(nullptr)
+	, mCount(0)
+	, mNextIndex(0)
+	, mBusyWorkers(0)
+	, mGeneration(0)
+	, mQuit(false)
+{
+	for (unsigned int i = 1; i < threadCount; ++i)
+		mWorkers.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+
+	mWorkAvailable.notify_all();
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+	return static_cast<unsigned int>(mWorkers.size()) + 1;
+}
+
+void ThreadPool::ParallelFor(unsigned int count,
+	const std::function<void(unsigned int index, unsigned int threadIndex)>& function)
+{
+	// Waking the workers isn't worth it if there is only one thing to do.
+	if (mWorkers.empty() || count <= 1)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			function(i, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFunction = &function;
+		mCount = count;
+		mNextIndex = 0;
+		mBusyWorkers = static_cast<unsigned int>(mWorkers.size());
+		++mGeneration;
+	}
+
+	mWorkAvailable.notify_all();
+	RunJob(0);
+
+	// Every worker has to finish (and see the job) before the next one can be started.
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkDone.wait(lock, [this] { return mBusyWorkers == 0; });
+	mFunction = nullptr;
+}
+
+void ThreadPool::WorkerMain(unsigned int threadIndex)
+{
+	std::string name = "ThreadPool worker " + std::to_string(threadIndex);
+	SetTraceThreadName(name.c_str());
+
+	unsigned long long lastGeneration = 0;
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mWorkAvailable.wait(lock, [&] { return mQuit || mGeneration != lastGeneration; });
+		if (mQuit)
+			return;
+
+		lastGeneration = mGeneration;
+		lock.unlock();
+		RunJob(threadIndex);
+		lock.lock();
+
+		if (--mBusyWorkers == 0)
+			mWorkDone.notify_one();
+	}
+}
+
+void ThreadPool::RunJob(unsigned int threadIndex)
+{
+	for (unsigned int i = mNextIndex++; i < mCount; i = mNextIndex++)
+		(*mFunction)(i, threadIndex);
+}
@@ -0,0 +1,66 @@
+// ###########################################################################################
+// ## A simple pool of worker threads, used to spread work such as rasterising the tiles of
+// ## the back buffer over all cores.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// The thread calling ParallelFor() does its share of the work, so threadCount - 1 worker
+	// threads are created. With a thread count of 1 (or 0) all work runs on the calling thread.
+	explicit ThreadPool(unsigned int threadCount);
+	~ThreadPool();
+
+	unsigned int GetThreadCount() const;
+
+	// Calls function(index, threadIndex) for every index in [0, count) and waits for all calls
+	// to finish. Indices are handed out to threads one at a time as they become free, so the
+	// order of the calls is undefined. threadIndex is in [0, GetThreadCount()), 0 being the
+	// calling thread, and can be used to index per thread data.
+	void ParallelFor(unsigned int count,
+		const std::function<void(unsigned int index, unsigned int threadIndex)>& function);
+
+private:
+	void WorkerMain(unsigned int threadIndex);
+	void RunJob(unsigned int threadIndex);
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::condition_variable mWorkDone;
+
+	// The current job. Guarded by mMutex, except mNextIndex which the threads use to share
+	// out the indices.
+	const std::function<void(unsigned int, unsigned int)>* mFunction;
+	unsigned int mCount;
+	std::atomic<unsigned int> mNextIndex;
+	unsigned int mBusyWorkers;
+	unsigned long long mGeneration;		// Incremented for every job, so workers see new jobs.
+	bool mQuit;
+};
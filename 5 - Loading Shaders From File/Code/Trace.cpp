@@ -0,0 +1,189 @@
+// ###########################################################################################
+// ## Records when named zones of code run on which thread and writes them as a Chrome trace
+// ## event file, which chrome://tracing or ui.perfetto.dev can show as a timeline.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "Trace.h"
+#include "Profiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// thread_local isn't supported by Visual Studio 2013, but a thread local pointer is.
+#if defined(_MSC_VER)
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+// The number of events a thread collects before writing them to the file.
+static const size_t TRACE_BUFFER_EVENT_COUNT = 4096;
+
+struct TraceEvent
+{
+	const char* name;
+	unsigned long long start;
+	unsigned long long duration;
+};
+
+// The events of one thread. Only the thread itself adds events; the mutex is there for
+// StopTrace(), so it is almost never waited for.
+struct TraceThreadBuffer
+{
+	std::mutex mutex;
+	std::vector<TraceEvent> events;
+	std::string threadName;
+	unsigned int threadId;
+};
+
+std::atomic<bool> gTracing(false);
+
+// Guards the list of thread buffers and the file.
+static std::mutex gTraceMutex;
+static std::vector<std::unique_ptr<TraceThreadBuffer>> gTraceThreadBuffers;
+static std::ofstream gTraceFile;
+static unsigned long long gTraceStart = 0;
+static unsigned long long gTraceEventsWritten = 0;
+
+// The calling thread's buffer, created the first time it is needed. Buffers are kept until the
+// program ends, as the thread may add events any time.
+static TRACE_THREAD_LOCAL TraceThreadBuffer* tThreadBuffer = nullptr;
+
+static TraceThreadBuffer& GetThreadBuffer()
+{
+	if (tThreadBuffer == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(gTraceMutex);
+		gTraceThreadBuffers.push_back(std::unique_ptr<TraceThreadBuffer>(new TraceThreadBuffer()));
+		tThreadBuffer = gTraceThreadBuffers.back().get();
+		tThreadBuffer->threadId = static_cast<unsigned int>(gTraceThreadBuffers.size());
+	}
+
+	return *tThreadBuffer;
+}
+
+// Writes a "complete" event (a zone with a start and a duration) per event, with the times in
+// microseconds since the trace started. Called with gTraceMutex locked.
+static void WriteTraceEvents(const std::vector<TraceEvent>& events, unsigned int threadId)
+{
+	const double microsecondsPerTick = 1.0e6 / GetProfileTickFrequency();
+	for (const TraceEvent& event : events)
+	{
+		// Events that started before the trace are from an earlier capture.
+		if (event.start < gTraceStart)
+			continue;
+
+		gTraceFile << (gTraceEventsWritten++ == 0 ? "\n" : ",\n")
+			<< "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId
+			<< ",\"ts\":" << (event.start - gTraceStart) * microsecondsPerTick
+			<< ",\"dur\":" << event.duration * microsecondsPerTick << "}";
+	}
+}
+
+bool StartTrace(const char* path)
+{
+	std::lock_guard<std::mutex> lock(gTraceMutex);
+	if (IsTracing())
+		return false;
+
+	gTraceFile.open(path, std::ios::trunc);
+	if (!gTraceFile)
+		return false;
+
+	gTraceFile << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	gTraceStart = ReadProfileTicks();
+	gTraceEventsWritten = 0;
+	gTracing.store(true);
+
+	return true;
+}
+
+void StopTrace()
+{
+	std::lock_guard<std::mutex> lock(gTraceMutex);
+	if (!IsTracing())
+		return;
+
+	gTracing.store(false);
+
+	for (std::unique_ptr<TraceThreadBuffer>& buffer : gTraceThreadBuffers)
+	{
+		std::vector<TraceEvent> events;
+		{
+			std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+			events.swap(buffer->events);
+		}
+		WriteTraceEvents(events, buffer->threadId);
+
+		// Metadata events give the threads their names in the viewer.
+		if (!buffer->threadName.empty())
+		{
+			gTraceFile << (gTraceEventsWritten++ == 0 ? "\n" : ",\n")
+				<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+		}
+	}
+
+	gTraceFile << "\n]}\n";
+	gTraceFile.close();
+}
+
+void SetTraceThreadName(const char* name)
+{
+	TraceThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.threadName = name;
+}
+
+void AddTraceEvent(const char* name, unsigned long long start, unsigned long long end)
+{
+	TraceThreadBuffer& buffer = GetThreadBuffer();
+	TraceEvent event = { name, start, end - start };
+
+	std::vector<TraceEvent> fullEvents;
+	{
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.events.push_back(event);
+		if (buffer.events.size() < TRACE_BUFFER_EVENT_COUNT)
+			return;
+
+		fullEvents.swap(buffer.events);
+	}
+
+	// The buffer is full: write it out, unless the trace has been stopped since.
+	std::lock_guard<std::mutex> lock(gTraceMutex);
+	if (IsTracing())
+		WriteTraceEvents(fullEvents, buffer.threadId);
+}
+
+TraceZone::TraceZone(const char* name)
+	: mName(name), mStart(IsTracing() ? ReadProfileTicks() : 0)
+{
+}
+
+TraceZone::~TraceZone()
+{
+	if (mStart != 0 && IsTracing())
+		AddTraceEvent(mName, mStart, ReadProfileTicks());
+}
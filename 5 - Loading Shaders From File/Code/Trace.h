@@ -0,0 +1,71 @@
+// ###########################################################################################
+// ## Records when named zones of code run on which thread and writes them as a Chrome trace
+// ## event file, which chrome://tracing or ui.perfetto.dev can show as a timeline.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include <atomic>
+
+// Set while a trace is being captured. Read through IsTracing().
+extern std::atomic<bool> gTracing;
+
+inline bool IsTracing()
+{
+	return gTracing.load(std::memory_order_relaxed);
+}
+
+// Starts capturing a trace into the file at path, replacing it. Returns false if the file can't
+// be created or a trace is already being captured.
+bool StartTrace(const char* path);
+
+// Writes the rest of the captured events and the names of the threads, and closes the file.
+void StopTrace();
+
+// Names the calling thread in traces, e.g. "Main" or "ThreadPool worker 1". The name is copied.
+// Threads that haven't been named are shown by number.
+void SetTraceThreadName(const char* name);
+
+// Adds a zone that ran on the calling thread from start to end, in ReadProfileTicks() ticks
+// (see Profiler.h). The name is not copied, so it has to be a string literal or otherwise
+// outlive the trace, and must not need escaping in JSON.
+//
+// Events go into a buffer owned by the thread, so threads don't wait for each other. A full
+// buffer is written to the file by the thread that filled it.
+void AddTraceEvent(const char* name, unsigned long long start, unsigned long long end);
+
+// Adds the rest of the enclosing block to the trace, if a trace is being captured:
+//
+//		TraceZone zone("CreateShaders");
+//
+// Every ProfileScope is also added to the trace, named after its section.
+class TraceZone
+{
+public:
+	explicit TraceZone(const char* name);
+	~TraceZone();
+
+private:
+	TraceZone(const TraceZone&);
+	TraceZone& operator=(const TraceZone&);
+
+	const char* mName;
+	unsigned long long mStart;	// Zero if no trace was being captured when the zone started.
+};
@@ -0,0 +1,234 @@
+// ###########################################################################################
+// ## Vertex formats declared once as a list of elements. The declaration gives the vertex
+// ## struct, its stride and the matching input layout, so they can't get out of sync.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#pragma once
+
+#include "MathTypes.h"
+#include "RenderBackend.h"
+
+#include <cstring>
+
+// The ElementFormat matching each type that can be stored in a vertex.
+template <typename T> struct ElementFormatOf;
+template <> struct ElementFormatOf<Float2> { static const ElementFormat FORMAT = ElementFormat::Float2; };
+template <> struct ElementFormatOf<Float3> { static const ElementFormat FORMAT = ElementFormat::Float3; };
+template <> struct ElementFormatOf<Float4> { static const ElementFormat FORMAT = ElementFormat::Float4; };
+template <> struct ElementFormatOf<Half2> { static const ElementFormat FORMAT = ElementFormat::Half2; };
+template <> struct ElementFormatOf<Half4> { static const ElementFormat FORMAT = ElementFormat::Half4; };
+template <> struct ElementFormatOf<UByteN4> { static const ElementFormat FORMAT = ElementFormat::UByteN4; };
+
+// A matrix is too large for one input element, so it is read as one Float4 element per row,
+// using the semantic indices 0, 1 and 2 (TRANSFORM0 to TRANSFORM2 in HLSL).
+template <> struct ElementFormatOf<Float3x4> { static const ElementFormat FORMAT = ElementFormat::Float4; };
+
+// The number of input elements each type takes up.
+template <typename T> struct ElementRowCount { static const unsigned int VALUE = 1; };
+template <> struct ElementRowCount<Float3x4> { static const unsigned int VALUE = 3; };
+
+// The size in bytes of an element of the given format.
+inline unsigned int ElementSize(ElementFormat format)
+{
+	switch (format)
+	{
+	case ElementFormat::Float2: return 2 * sizeof(float);
+	case ElementFormat::Float3: return 3 * sizeof(float);
+	case ElementFormat::Float4: return 4 * sizeof(float);
+	case ElementFormat::Half2: return 2 * sizeof(unsigned short);
+	case ElementFormat::Half4: return 4 * sizeof(unsigned short);
+	case ElementFormat::UByteN4: return 4;
+	}
+
+	return 0;
+}
+
+// Reads an element from a vertex, converts it to floats and expands it to four components.
+// Missing components are filled in with (0, 0, 0, 1) the same way the input assembler does.
+inline Float4 FetchElement(const unsigned char* source, ElementFormat format)
+{
+	float values[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	switch (format)
+	{
+	case ElementFormat::Float2:
+	case ElementFormat::Float3:
+	case ElementFormat::Float4:
+		memcpy(values, source, ElementSize(format));
+		break;
+
+	case ElementFormat::Half2:
+	case ElementFormat::Half4:
+	{
+		unsigned short halves[4];
+		unsigned int count = ElementSize(format) / sizeof(unsigned short);
+		memcpy(halves, source, ElementSize(format));
+		for (unsigned int i = 0; i < count; ++i)
+			values[i] = HalfToFloat(halves[i]);
+		break;
+	}
+
+	case ElementFormat::UByteN4:
+		for (unsigned int i = 0; i < 4; ++i)
+			values[i] = source[i] / 255.0f;
+		break;
+	}
+
+	return Float4(values[0], values[1], values[2], values[3]);
+}
+
+// The elements a vertex can be made of. Each one holds a member with the usual name and knows
+// the semantic the vertex shader reads it with. T is the type the element is stored as, e.g.
+// Position<Float3> or the more compact Position<Half4>.
+template <typename T>
+struct Position
+{
+	typedef T Type;
+	static const char* SemanticName() { return "POSITION"; }
+
+	Position() {}
+	Position(const T& position) : position(position) {}
+
+	T position;
+};
+
+template <typename T>
+struct Colour
+{
+	typedef T Type;
+	static const char* SemanticName() { return "COLOR"; }
+
+	Colour() {}
+	Colour(const T& colour) : colour(colour) {}
+
+	T colour;
+};
+
+template <typename T>
+struct TexCoord
+{
+	typedef T Type;
+	static const char* SemanticName() { return "TEXCOORD"; }
+
+	TexCoord() {}
+	TexCoord(const T& uv) : uv(uv) {}
+
+	T uv;
+};
+
+// The elements an instance can be made of, see InstanceBuffer.h. A transform placing the
+// instance, and a colour the vertex colours are multiplied with.
+struct Transform
+{
+	typedef Float3x4 Type;
+	static const char* SemanticName() { return "TRANSFORM"; }
+
+	Transform() {}
+	Transform(const Float3x4& transform) : transform(transform) {}
+
+	Float3x4 transform;
+};
+
+template <typename T>
+struct Tint
+{
+	typedef T Type;
+	static const char* SemanticName() { return "TINT"; }
+
+	Tint() {}
+	Tint(const T& tint) : tint(tint) {}
+
+	T tint;
+};
+
+// Adds up the sizes of the elements' types, at compile time.
+template <typename... Elements> struct ElementSizeSum;
+template <> struct ElementSizeSum<> { static const unsigned int VALUE = 0; };
+template <typename First, typename... Rest>
+struct ElementSizeSum<First, Rest...>
+{
+	static const unsigned int VALUE = sizeof(typename First::Type) + ElementSizeSum<Rest...>::VALUE;
+};
+
+// Adds up the number of input elements the elements' types take up, at compile time.
+template <typename... Elements> struct ElementRowSum;
+template <> struct ElementRowSum<> { static const unsigned int VALUE = 0; };
+template <typename First, typename... Rest>
+struct ElementRowSum<First, Rest...>
+{
+	static const unsigned int VALUE = ElementRowCount<typename First::Type>::VALUE + ElementRowSum<Rest...>::VALUE;
+};
+
+// A vertex made of the given elements, stored in the order they are listed. For example
+//
+//   typedef VertexFormat<Position<Half4>, Colour<UByteN4>> Vertex;
+//
+// gives a 12 byte vertex with the members position and colour, which can be created with
+// Vertex v = { Float3(...), Float4(...) }; converting the values to the stored types.
+template <typename... Elements>
+struct VertexFormat : Elements...
+{
+	// The number of input elements, i.e. the size of the input layout. This is the number of
+	// elements, except that a transform takes up one input element per row.
+	static const unsigned int ELEMENT_COUNT = ElementRowSum<Elements...>::VALUE;
+
+	// The size of a vertex, to use as the stride when binding a vertex buffer.
+	static const unsigned int STRIDE = ElementSizeSum<Elements...>::VALUE;
+
+	VertexFormat() {}
+	VertexFormat(const typename Elements::Type&... values) : Elements(values)... {}
+
+	// Fills in the ELEMENT_COUNT input element descriptions for this format, reading the
+	// vertices from the given input slot. A format used for instances rather than vertices is
+	// read with InputClassification::PerInstance, moving on to the next one every instance.
+	static void GetInputElements(InputElementDesc* elements, unsigned int inputSlot,
+		InputClassification inputSlotClass = InputClassification::PerVertex)
+	{
+		// Every element type is made up of 1, 2 or 4 byte components, so the elements are
+		// packed without padding as long as the larger components come first.
+		static_assert(sizeof(VertexFormat) == STRIDE, "The vertex format has padding between its elements");
+
+		// The offset of each element is found from where the compiler placed it.
+		const VertexFormat vertex;
+		const unsigned char* start = reinterpret_cast<const unsigned char*>(&vertex);
+		const unsigned int offsets[] =
+		{
+			static_cast<unsigned int>(reinterpret_cast<const unsigned char*>(static_cast<const Elements*>(&vertex)) - start)...
+		};
+		const char* semanticNames[] = { Elements::SemanticName()... };
+		const ElementFormat formats[] = { ElementFormatOf<typename Elements::Type>::FORMAT... };
+		const unsigned int rowCounts[] = { ElementRowCount<typename Elements::Type>::VALUE... };
+		const unsigned int rowSizes[] = { sizeof(typename Elements::Type) / ElementRowCount<typename Elements::Type>::VALUE... };
+
+		unsigned int index = 0;
+		for (unsigned int i = 0; i < sizeof...(Elements); ++i)
+		{
+			for (unsigned int row = 0; row < rowCounts[i]; ++row, ++index)
+			{
+				elements[index].semanticName = semanticNames[i];
+				elements[index].semanticIndex = row;
+				elements[index].format = formats[i];
+				elements[index].inputSlot = inputSlot;
+				elements[index].byteOffset = offsets[i] + row * rowSizes[i];
+				elements[index].inputSlotClass = inputSlotClass;
+				elements[index].instanceDataStepRate = inputSlotClass == InputClassification::PerInstance ? 1 : 0;
+			}
+		}
+	}
+};
@@ -21,22 +21,11 @@
 // ###########################################################################################
 
 #include <Windows.h>
-#include <d3d11.h>
-#include <d3dcompiler.h>
-#include <DirectXMath.h>
 
-// Link to needed lib files. Can also be done by adding these to
-// Properties -> Linker -> Input -> Additional Dependencies
-#pragma comment(lib, "d3d11.lib")
-#pragma comment(lib, "D3DCompiler.lib")
-
-// Define the information contained in each vertex.
-struct Vertex
-{
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT4 colour;
-	DirectX::XMFLOAT2 uv;
-};
+#include "D3D11Backend.h"
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "Scene.h"
 
 // Window forward declarations.
 void InitialiseWindow();
@@ -45,38 +34,62 @@ LRESULT CALLBACK WindowProcedure(HWND handle, UINT message, WPARAM wParam, LPARA
 
 // DirectX forward declarations.
 void InitialiseDirect3D();
-void CreateDeviceAndSwapChain();
-void CreateRenderTargetView();
-void CreateViewport();
-
-// Remaining forward declarations
-void SetupScene();
-void CreateVertexBuffer();
-void CreateShaders();
-void Render();
 
 // Window global variables.
 HWND gWindowHandle = NULL;
 int gWindowWidth = 800;
 int gWindowHeight = 600;
 
-// DirectX global variables.
-ID3D11Device* gDevice = nullptr;
-ID3D11DeviceContext* gContext = nullptr;
-IDXGISwapChain* gSwapChain = nullptr;
-ID3D11RenderTargetView* gRTV = nullptr;
+// DirectX global variables. The device, swap chain and render target view are owned by the
+// backend, see D3D11Backend.cpp.
+D3D11Backend* gD3D11Backend = nullptr;
+
+// When shaders are compiled at runtime, the compiled shaders are cached in this folder
+// (relative to the .vcxproj folder, like the shader paths), so they only need to be compiled
+// again when they change. Otherwise they are baked into the program, see BakedShaders.cpp.
+ShaderCache* gShaderCache = nullptr;
 
-ID3D11VertexShader* gVertexShader = nullptr;
-ID3D11PixelShader* gPixelShader = nullptr;
-ID3D11InputLayout* gInputLayout = nullptr;
-ID3D11Buffer* gVertexBuffer = nullptr;
+// The startup phases that are timed, see Profiler.h. The phases of a frame are timed in Render().
+ProfileSection gInitialiseWindowSection("InitialiseWindow");
+ProfileSection gInitialiseDirect3DSection("InitialiseDirect3D");
+ProfileSection gSetupSceneSection("SetupScene");
 
 void main()
 {
-	InitialiseWindow();
-	InitialiseDirect3D();
-	SetupScene();
+	// Press F12 to start and stop capturing a trace of what each thread does, see Trace.h.
+	SetTraceThreadName("Main");
+
+	{
+		ProfileScope scope(gInitialiseWindowSection);
+		InitialiseWindow();
+	}
+	{
+		ProfileScope scope(gInitialiseDirect3DSection);
+		InitialiseDirect3D();
+	}
+	bool sceneReady;
+	{
+		ProfileScope scope(gSetupSceneSection);
+		sceneReady = SetupScene(gD3D11Backend);
+	}
+	PrintShaderCompileReport();
+#if RUNTIME_SHADER_COMPILATION
+	// When the shaders are compiled at runtime, they can also be changed while the program runs.
+	// If one failed to compile, nothing is drawn until it has been fixed and saved.
+	EnableShaderHotReload("../Resources/Shaders");
+#else
+	// Baked shaders can't be fixed while the program runs.
+	if (!sceneReady)
+	{
+		ReleaseScene();
+		return;
+	}
+#endif
 	Run();
+
+	// Report where the time went once the window has been closed.
+	PrintProfileReport();
+	WriteProfileCSV("Profile.csv");
 }
 
 void InitialiseWindow()
@@ -117,19 +130,31 @@ void InitialiseWindow()
 
 void Run()
 {
+	// Instead of rendering as many frames as possible, which keeps a core busy rendering frames
+	// the screen never shows, the scheduler waits until the next frame is due.
+	SystemFrameClock clock;
+	FrameScheduler scheduler(&clock, FrameSchedulerDesc());
+
 	MSG windowMsg = {0};
 
 	while (windowMsg.message != WM_QUIT)
 	{
 		if (PeekMessage(&windowMsg, NULL, NULL, NULL, PM_REMOVE))
 		{
+			TraceZone zone("DispatchMessage");
 			TranslateMessage(&windowMsg);
 			DispatchMessage(&windowMsg);
 		}
 		else
 		{
-			// If there are no more messages to handle, run a frame 
-			// Usually Update() + Render() but in this sample only the latter is needed.
+			// If there are no more messages to handle, run a frame: update the scene by as many
+			// fixed time steps as have passed since the last frame, then render it.
+			unsigned int steps = scheduler.BeginFrame();
+			{
+				TraceZone zone("Update");
+				for (unsigned int i = 0; i < steps; ++i)
+					Update(scheduler.GetFixedTimeStep());
+			}
 			Render();
 		}
 	}
@@ -139,7 +164,19 @@ LRESULT CALLBACK WindowProcedure(HWND handle, UINT message, WPARAM wParam, LPARA
 {
 	switch (message)
 	{
+	case WM_KEYDOWN:
+		if (wParam == VK_F12)
+		{
+			if (IsTracing())
+				StopTrace();
+			else
+				StartTrace("Trace.json");
+			return 0;
+		}
+		break;
+
 	case WM_DESTROY:
+		StopTrace();
 		PostQuitMessage(0);
 		return 0;
 	}
@@ -150,200 +187,11 @@ LRESULT CALLBACK WindowProcedure(HWND handle, UINT message, WPARAM wParam, LPARA
 
 void InitialiseDirect3D()
 {
-	CreateDeviceAndSwapChain();
-	CreateRenderTargetView();
-	CreateViewport();
-}
-
-void CreateDeviceAndSwapChain()
-{
-	DXGI_SWAP_CHAIN_DESC scDesc;
-	scDesc.BufferDesc.Width = gWindowWidth;
-	scDesc.BufferDesc.Height = gWindowHeight;
-	scDesc.BufferDesc.RefreshRate.Numerator = 0;
-	scDesc.BufferDesc.RefreshRate.Denominator = 0;
-	scDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	scDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
-	scDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
-	scDesc.SampleDesc.Count = 1;
-	scDesc.SampleDesc.Quality = 0;
-	scDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	scDesc.BufferCount = 1;
-	scDesc.OutputWindow = gWindowHandle;
-	scDesc.Windowed = true;
-	scDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-	scDesc.Flags = 0;
-
-	D3D11CreateDeviceAndSwapChain(
-		nullptr,
-		D3D_DRIVER_TYPE_HARDWARE,
-		NULL,
-		NULL,
-		nullptr,
-		0,
-		D3D11_SDK_VERSION,
-		&scDesc,
-		&gSwapChain,
-		&gDevice,
-		nullptr,
-		&gContext
-		);
-}
-
-void CreateRenderTargetView()
-{
-	// Get the back buffer from the swap chain, create a render target view of it to use as
-	// the target for rendering.
-	ID3D11Texture2D* backBuffer;
-	gSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer));
-	gDevice->CreateRenderTargetView(backBuffer, nullptr, &gRTV);
-	backBuffer->Release();
-
-	gContext->OMSetRenderTargets(1, &gRTV, nullptr);
-}
-
-void CreateViewport()
-{
-	D3D11_VIEWPORT vp;
-	vp.TopLeftX = 0.0f;		// The top left corner's x coordinate in pixels from the window's top left corner.
-	vp.TopLeftY = 0.0f;		// The top left corner's y coordinate in pixels from the window's top left corner.
-	vp.Width = static_cast<float>(gWindowWidth);	// This viewport will cover the entire window.
-	vp.Height = static_cast<float>(gWindowHeight);	// This viewport will cover the entire window.
-	vp.MinDepth = 0.0f;		// Minimum depth value used by Direct3D is 0.0f so this is used.
-	vp.MaxDepth = 1.0f;		// Maximum depth value used by Direct3D is 1.0f so this is used.
-
-	gContext->RSSetViewports(1, &vp);				// Set the viewport to use.
-}
-
-void SetupScene()
-{
-	CreateVertexBuffer();
-	CreateShaders();
-}
-
-void CreateVertexBuffer()
-{
-	// Create vertices.
-	Vertex vertices[] = 
-	{
-		// First triangle.
-		{ DirectX::XMFLOAT3(-0.5f, 0.5f, 0.0f), DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f) },	// Vertex 0, red
-		{ DirectX::XMFLOAT3(0.5f, -0.5f, 0.0f), DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f) },	// Vertex 1, green
-		{ DirectX::XMFLOAT3(-0.5f, -0.5f, 0.0f), DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f) },	// Vertex 2, blue
-
-		// Second triangle, using two of the same vertices as the first triangle: vertex 1 and vertex 0.
-		{ DirectX::XMFLOAT3(0.5f, 0.5f, 0.0f), DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) },		// Vertex 3, white
-		{ DirectX::XMFLOAT3(0.5f, -0.5f, 0.0f), DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f) },	// Vertex 1, green
-		{ DirectX::XMFLOAT3(-0.5f, 0.5f, 0.0f), DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f) },	// Vertex 0, red
-	};
-
-	// Fill out the buffer description to use when creating our vertex buffer.
-	D3D11_BUFFER_DESC bufferDesc;
-	bufferDesc.ByteWidth = sizeof(vertices);			// The buffer needs to know the total size of its data, i.e. all vertices.
-	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;			// A buffer whose contents never change after creation is IMMUTABLE.
-	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;	// For a vertex buffer, this flag must be specified.
-	bufferDesc.CPUAccessFlags = 0;						// The CPU won't access the buffer after creation.
-	bufferDesc.MiscFlags = 0;							// The buffer is not doing anything extraordinary.
-	bufferDesc.StructureByteStride = 0;					// Only used for structured buffers, which a vertex buffer is not.
-	
-	// Define what data our buffer will contain.
-	D3D11_SUBRESOURCE_DATA bufferContents;
-	bufferContents.pSysMem = vertices;
-
-	// Create the buffer.
-	gDevice->CreateBuffer(&bufferDesc, &bufferContents, &gVertexBuffer);
-}
-
-void CreateShaders()
-{
-	// Compile and create vertex shader from the file vertexShader.hlsl in the folder Resources/Shaders/.
-	ID3DBlob* compiledVS = nullptr;	// A variable to hold the compiled vertex shader data.
-	D3DCompileFromFile(
-		L"../Resources/Shaders/vertexShader.hlsl",		// The path to the shader file relative to the .vxproj folder.
-		nullptr,		// We don't use any defines.
-		nullptr,		// We don't have any includes.
-		"main",			// The name of the entry function. Must match function in source data.
-		"vs_5_0",		// The shader model to use, "vs" specifies it is a vertex shader, 5_0 that it is shader model 5.0.
-		0,				// No shader compile options.
-		0,				// Ignored when compiling a shader (effect compile options).
-		&compiledVS,	// [out] Compiled shader data.
-		nullptr			// [out] Compile time error data.
-		);
-
-	gDevice->CreateVertexShader(
-		compiledVS->GetBufferPointer(),
-		compiledVS->GetBufferSize(),
-		NULL,
-		&gVertexShader
-		);
-
-	// Compile and create pixel shader from the file vertexShader.hlsl in the folder Resources/Shaders/.
-	// Works the same way asbove.
-	ID3DBlob* compiledPS = nullptr;
-	D3DCompileFromFile(
-		L"../Resources/Shaders/pixelShader.hlsl",
-		nullptr,
-		nullptr,
-		"main",
-		"ps_5_0",		// NOTE: This must be changed to ps_5_0 for pixel shader model 5.0
-		0,
-		0,
-		&compiledPS,
-		nullptr
-		);
-
-	gDevice->CreatePixelShader(
-		compiledPS->GetBufferPointer(),
-		compiledPS->GetBufferSize(),
-		NULL,
-		&gPixelShader
-		);
-
-	// Define the input description. Semantic names must correspond to the semantic names used
-	// in the vertex shader inputs.
-	D3D11_INPUT_ELEMENT_DESC inputDesc[] =
-	{
-		// For each input: Semantic name, semantic index (if multiple with the same name), 
-		// input format, input slot (usually 0), byte offset (depends on the previous format
-		// size), input slot class (usually INPUT_PER_VERTEX_DATA), instance data step rate
-		// (always 0 when using INPUT_PER_VERTEX_DATA).
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-
-	// Create the input layout to go with our vertex shader (the layout is validated against
-	// the shader's input signature).
-	int inputLayoutSize = sizeof(inputDesc) / sizeof(D3D11_INPUT_ELEMENT_DESC);
-	gDevice->CreateInputLayout(
-		inputDesc,
-		inputLayoutSize,
-		compiledVS->GetBufferPointer(),
-		compiledVS->GetBufferSize(),
-		&gInputLayout);
-}
-
-void Render()
-{
-	// Clear the render target to black (colour (0, 0, 0, 1) ).
-	FLOAT bgColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
-	gContext->ClearRenderTargetView(gRTV, bgColor);
-
-	// The stride and offset need to be stored in variables as we need to provide pointers to
-	// them when setting the vertex buffer.
-	UINT vbStride = sizeof(Vertex);
-	UINT vbOffset = 0;
-
-	// Set the input layout, vertex buffer, topology and shaders to use when drawing.
-	gContext->IASetVertexBuffers(0, 1, &gVertexBuffer, &vbStride, &vbOffset);
-	gContext->IASetInputLayout(gInputLayout);
-	gContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	gContext->VSSetShader(gVertexShader, NULL, NULL);
-	gContext->PSSetShader(gPixelShader, NULL, NULL);
-
-	// Draw the 6 vertices, three for each triangle.
-	gContext->Draw(6, 0);
+	gD3D11Backend = new D3D11Backend();
+	gD3D11Backend->Initialise(gWindowHandle, gWindowWidth, gWindowHeight);
 
-	// When everything has been drawn, present the final result on the screen by swapping the
-	// back and front buffers.
-	gSwapChain->Present(0, 0);
+#if RUNTIME_SHADER_COMPILATION
+	gShaderCache = new ShaderCache("../ShaderCache");
+	gD3D11Backend->SetShaderCache(gShaderCache);
+#endif
 }
\ No newline at end of file
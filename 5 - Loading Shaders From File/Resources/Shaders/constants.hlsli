@@ -0,0 +1,43 @@
+// ###########################################################################################
+// ## The constant buffers read by the vertex shaders, grouped by how often they change. Their
+// ## layouts must match the structs in Code/ConstantBuffers.h.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+// Each cbuffer is bound to its own register. The matrices are declared row_major so they are
+// stored row by row like Float4x4 and Float3x4, and transform a point with mul(matrix, point).
+
+// Set once a frame.
+cbuffer FrameConstants : register(b0)
+{
+	float time;			// Seconds the scene has been updated for.
+	float timeStep;		// Seconds between two updates.
+};
+
+// Set for each view (camera) the scene is drawn from.
+cbuffer ViewConstants : register(b1)
+{
+	row_major float4x4 viewProjection;	// From world space to clip space.
+};
+
+// Set for each object drawn, as a part of a large buffer holding every object of the frame.
+cbuffer ObjectConstants : register(b2)
+{
+	row_major float3x4 world;	// From the object's space to world space.
+};
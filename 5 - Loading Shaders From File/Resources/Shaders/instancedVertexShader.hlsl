@@ -0,0 +1,59 @@
+// ###########################################################################################
+// ## A vertex shader for drawing many copies (instances) of a mesh in one call. Besides the
+// ## position and colour of each vertex it takes a transform and a tint for each instance.
+// ##
+// ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
+// ## 
+// ## This software is provided 'as-is', without any express or implied warranty. In no event
+// ## will the authors be held liable for any damages arising from the use of this software.
+// ## 
+// ## Permission is granted to anyone to use this software for any purpose, including
+// ## commercial applications, and to alter it and redistribute it freely, subject to the
+// ## following restrictions:
+// ## 
+// ## 1. The origin of this software must not be misrepresented; you must not claim that you
+// ## wrote the original software. If you use this software in a product, an acknowledgement
+// ## in the product documentation would be appreciated but is not required.
+// ## 2. Altered source versions must be plainly marked as such, and must not be
+// ## misrepresented as being the original software.
+// ## 3. This notice may not be removed or altered from any source distribution.
+// ##
+// ###########################################################################################
+
+#include "constants.hlsli"
+
+// The first two inputs are read from the vertex buffer in input slot 0, once for each vertex.
+// The rest are read from the instance buffer in input slot 1, once for each instance, as set
+// up by the input layout (see InstanceBuffer.h). The transform is a 3x4 matrix, too large for
+// one input, so it is passed as three rows with the semantic indices 0 to 2.
+struct VSInput
+{
+	float3 position : POSITION;
+	float4 colour : COLOR;
+	float4 transform0 : TRANSFORM0;
+	float4 transform1 : TRANSFORM1;
+	float4 transform2 : TRANSFORM2;
+	float4 tint : TINT;
+};
+
+// The output is the same as for vertexShader.hlsl, so the same pixel shader can be used.
+struct VSOutput
+{
+	float4 position : SV_POSITION;
+	float4 colour : COLOR;
+};
+
+// Moves each vertex by the transform of its instance (the last column of the matrix is the
+// translation, so w is 1.0f), which takes the place of the world matrix, then to clip space by
+// the view-projection. The colour is multiplied by the instance's tint.
+VSOutput main(VSInput input)
+{
+	VSOutput output;
+
+	float4 position = float4(input.position, 1.0f);
+	float4 worldPosition = float4(dot(input.transform0, position), dot(input.transform1, position), dot(input.transform2, position), 1.0f);
+	output.position = mul(viewProjection, worldPosition);
+	output.colour = input.colour * input.tint;
+
+	return output;
+}
@@ -1,6 +1,6 @@
 // ###########################################################################################
 // ## A simple vertex shader taking a position and a colour and outputting them to the next
-// ## stage (and changing the position to homogeneous coordinates).
+// ## stage, moving the position by the object's transform and the view's projection.
 // ##
 // ## Copyright (c) <2015> <Tim Henriksson and Kim Restad>
 // ## 
@@ -20,6 +20,8 @@
 // ##
 // ###########################################################################################
 
+#include "constants.hlsli"
+
 // Struct defining the format of the input to the vertex shader. This needs to correspond to
 // an input layout bound to the pipeline, which in turn should correspond to the vertex
 // structure.
@@ -38,14 +40,15 @@ struct VSOutput
 	float4 colour : COLOR;
 };
 
-// The main function simply passes on the input information for each vertex to the output, changing
-// the position from a three dimensional to a four dimensional vector where the last element, w, is
-// 1.0f.
+// The main function passes on the input information for each vertex to the output. The position
+// is made four dimensional with w = 1.0f, so the last column of the world matrix moves it, then
+// taken to world space by the object's world matrix and to clip space by the view-projection.
 VSOutput main(VSInput input)
 {
 	VSOutput output;
 
-	output.position = float4(input.position, 1.0f);
+	float3 worldPosition = mul(world, float4(input.position, 1.0f));
+	output.position = mul(viewProjection, float4(worldPosition, 1.0f));
 	output.colour = input.colour;
 
 	return output;